@@ -24,6 +24,7 @@
 #include "memory.h"
 #include "prefix.h"
 #include "hash.h"
+#include "jhash.h"
 #include "thread.h"
 #include "queue.h"
 #include "filter.h"
@@ -147,13 +148,13 @@ void bgp_advertise_unintern(struct hash *hash, struct bgp_advertise_attr *baa)
 int bgp_adj_out_lookup(struct peer *peer, struct bgp_node *rn,
 		       uint32_t addpath_tx_id)
 {
-	struct bgp_adj_out *adj;
+	struct bgp_adj_out *adj, compact;
 	struct peer_af *paf;
 	afi_t afi;
 	safi_t safi;
 	int addpath_capable;
 
-	RB_FOREACH (adj, bgp_adj_out_rb, &rn->adj_out)
+	RN_FOREACH_ADJ_OUT (rn, adj, &compact)
 		SUBGRP_FOREACH_PEER (adj->subgroup, paf)
 			if (paf->peer == peer) {
 				afi = SUBGRP_AFI(adj->subgroup);
@@ -177,60 +178,309 @@ int bgp_adj_out_lookup(struct peer *peer, struct bgp_node *rn,
 }
 
 
+/*
+ * Adj-RIB-In tables.
+ *
+ * Each peer has one table per AFI/SAFI, allocated while it holds entries.
+ * Entries are stored column-wise in arrays indexed by entry number, with
+ * the attribute referenced by its 32-bit intern ID, and found through an
+ * open addressing index keyed on the bgp_node.  All entries of a node
+ * (one per addpath ID) lie on that node's probe sequence.  Compared to a
+ * list hung off every bgp_node this saves the list pointers and per-entry
+ * allocations, and finding one peer's entries no longer walks the others'.
+ */
+struct bgp_adj_in_table {
+	/* entries used / allocated in the columns below */
+	uint32_t count;
+	uint32_t alloc;
+
+	struct bgp_node **rn;
+	uint32_t *attr_id;
+	uint32_t *addpath_rx_id;
+	uint32_t *uptime;
+
+	/* entry number + 1 per slot, 0 if free; size is a power of 2 */
+	uint32_t size;
+	uint32_t *index;
+};
+
+#define ADJ_IN_MIN_ENTRIES 64U
+
+/* Entry and memory totals, for "show bgp memory" */
+static unsigned long adj_in_entries;
+static size_t adj_in_bytes;
+
+static inline struct bgp_adj_in_table **adj_in_table(struct peer *peer,
+						     struct bgp_node *rn)
+{
+	struct bgp_table *table = bgp_node_table(rn);
+
+	return &peer->adj_in[table->afi][table->safi];
+}
+
+static inline uint32_t adj_in_hash(const struct bgp_node *rn)
+{
+	uint64_t p = (uintptr_t)rn;
+
+	return jhash_2words((uint32_t)p, (uint32_t)(p >> 32), 0x61646a69);
+}
+
+static size_t adj_in_entry_size(void)
+{
+	struct bgp_adj_in_table *t;
+
+	return sizeof(*t->rn) + sizeof(*t->attr_id)
+	       + sizeof(*t->addpath_rx_id) + sizeof(*t->uptime);
+}
+
+static void adj_in_index_add(struct bgp_adj_in_table *t, uint32_t e)
+{
+	uint32_t mask = t->size - 1;
+	uint32_t i = adj_in_hash(t->rn[e]) & mask;
+
+	while (t->index[i])
+		i = (i + 1) & mask;
+	t->index[i] = e + 1;
+}
+
+/* Make room for one more entry: grow the columns, and keep the index at
+ * most 3/4 full.
+ */
+static void adj_in_reserve(struct bgp_adj_in_table *t)
+{
+	uint32_t e;
+
+	if (t->count == t->alloc) {
+		adj_in_bytes -= t->alloc * adj_in_entry_size();
+		t->alloc = MAX(t->alloc * 2, ADJ_IN_MIN_ENTRIES);
+		adj_in_bytes += t->alloc * adj_in_entry_size();
+
+		t->rn = XREALLOC(MTYPE_BGP_ADJ_IN, t->rn,
+				 t->alloc * sizeof(*t->rn));
+		t->attr_id = XREALLOC(MTYPE_BGP_ADJ_IN, t->attr_id,
+				      t->alloc * sizeof(*t->attr_id));
+		t->addpath_rx_id =
+			XREALLOC(MTYPE_BGP_ADJ_IN, t->addpath_rx_id,
+				 t->alloc * sizeof(*t->addpath_rx_id));
+		t->uptime = XREALLOC(MTYPE_BGP_ADJ_IN, t->uptime,
+				     t->alloc * sizeof(*t->uptime));
+	}
+
+	if ((t->count + 1) * 4 <= t->size * 3)
+		return;
+
+	adj_in_bytes -= t->size * sizeof(*t->index);
+	XFREE(MTYPE_BGP_ADJ_IN, t->index);
+	t->size = t->size ? t->size * 2 : ADJ_IN_MIN_ENTRIES * 2;
+	t->index = XCALLOC(MTYPE_BGP_ADJ_IN, t->size * sizeof(*t->index));
+	adj_in_bytes += t->size * sizeof(*t->index);
+
+	for (e = 0; e < t->count; e++)
+		adj_in_index_add(t, e);
+}
+
+static void adj_in_table_free(struct peer *peer,
+			      struct bgp_adj_in_table **tp)
+{
+	struct bgp_adj_in_table *t = *tp;
+
+	adj_in_bytes -= t->alloc * adj_in_entry_size()
+			+ t->size * sizeof(*t->index) + sizeof(*t);
+
+	XFREE(MTYPE_BGP_ADJ_IN, t->rn);
+	XFREE(MTYPE_BGP_ADJ_IN, t->attr_id);
+	XFREE(MTYPE_BGP_ADJ_IN, t->addpath_rx_id);
+	XFREE(MTYPE_BGP_ADJ_IN, t->uptime);
+	XFREE(MTYPE_BGP_ADJ_IN, t->index);
+	XFREE(MTYPE_BGP_ADJ_IN, *tp);
+
+	peer_unlock(peer); /* adj_in peer reference */
+}
+
+/* Index slot of the entry for (rn, addpath_id), or UINT32_MAX */
+static uint32_t adj_in_find(const struct bgp_adj_in_table *t,
+			    const struct bgp_node *rn, uint32_t addpath_id)
+{
+	uint32_t mask = t->size - 1;
+	uint32_t i = adj_in_hash(rn) & mask;
+	uint32_t e;
+
+	for (; t->index[i]; i = (i + 1) & mask) {
+		e = t->index[i] - 1;
+		if (t->rn[e] == rn && t->addpath_rx_id[e] == addpath_id)
+			return i;
+	}
+	return UINT32_MAX;
+}
+
+/* Take out the entry in index slot 'slot'.  The attribute and node
+ * references are left to the caller.
+ */
+static void adj_in_delete(struct bgp_adj_in_table *t, uint32_t slot)
+{
+	uint32_t mask = t->size - 1;
+	uint32_t e = t->index[slot] - 1;
+	uint32_t last = t->count - 1;
+	uint32_t i, j, home;
+
+	/* Shift later entries of the probe sequence back into the hole, so
+	 * lookups never need tombstones.
+	 */
+	t->index[slot] = 0;
+	for (i = slot, j = (slot + 1) & mask; t->index[j]; j = (j + 1) & mask) {
+		home = adj_in_hash(t->rn[t->index[j] - 1]) & mask;
+
+		/* stays if its home lies cyclically in (i, j] */
+		if (i <= j ? (i < home && home <= j) : (i < home || home <= j))
+			continue;
+
+		t->index[i] = t->index[j];
+		t->index[j] = 0;
+		i = j;
+	}
+
+	/* Keep the columns dense: the last entry fills the gap */
+	if (e != last) {
+		i = adj_in_hash(t->rn[last]) & mask;
+		while (t->index[i] != last + 1)
+			i = (i + 1) & mask;
+		t->index[i] = e + 1;
+
+		t->rn[e] = t->rn[last];
+		t->attr_id[e] = t->attr_id[last];
+		t->addpath_rx_id[e] = t->addpath_rx_id[last];
+		t->uptime[e] = t->uptime[last];
+	}
+
+	t->count--;
+	adj_in_entries--;
+}
+
 void bgp_adj_in_set(struct bgp_node *rn, struct peer *peer, struct attr *attr,
 		    uint32_t addpath_id)
 {
-	struct bgp_adj_in *adj;
+	struct bgp_adj_in_table **tp = adj_in_table(peer, rn);
+	struct bgp_adj_in_table *t = *tp;
+	struct attr *old;
+	uint32_t slot, e;
+
+	if (!t) {
+		t = *tp = XCALLOC(MTYPE_BGP_ADJ_IN, sizeof(*t));
+		adj_in_bytes += sizeof(*t);
+		peer_lock(peer); /* adj_in peer reference */
+	}
 
-	for (adj = rn->adj_in; adj; adj = adj->next) {
-		if (adj->peer == peer && adj->addpath_rx_id == addpath_id) {
-			if (adj->attr != attr) {
-				bgp_attr_unintern(&adj->attr);
-				adj->attr = bgp_attr_intern(attr);
+	if (t->count) {
+		slot = adj_in_find(t, rn, addpath_id);
+		if (slot != UINT32_MAX) {
+			e = t->index[slot] - 1;
+			old = bgp_attr_by_id(t->attr_id[e]);
+			if (old != attr) {
+				bgp_attr_unintern(&old);
+				t->attr_id[e] = bgp_attr_intern(attr)->id;
 			}
 			return;
 		}
 	}
-	adj = XCALLOC(MTYPE_BGP_ADJ_IN, sizeof(struct bgp_adj_in));
-	adj->peer = peer_lock(peer); /* adj_in peer reference */
-	adj->attr = bgp_attr_intern(attr);
-	adj->uptime = bgp_clock();
-	adj->addpath_rx_id = addpath_id;
-	BGP_ADJ_IN_ADD(rn, adj);
-	bgp_lock_node(rn);
-}
 
-void bgp_adj_in_remove(struct bgp_node *rn, struct bgp_adj_in *bai)
-{
-	bgp_attr_unintern(&bai->attr);
-	BGP_ADJ_IN_DEL(rn, bai);
-	peer_unlock(bai->peer); /* adj_in peer reference */
-	XFREE(MTYPE_BGP_ADJ_IN, bai);
+	adj_in_reserve(t);
+
+	e = t->count++;
+	t->rn[e] = rn;
+	t->attr_id[e] = bgp_attr_intern(attr)->id;
+	t->addpath_rx_id[e] = addpath_id;
+	t->uptime[e] = bgp_clock();
+	adj_in_index_add(t, e);
+	adj_in_entries++;
+
+	bgp_lock_node(rn);
 }
 
 int bgp_adj_in_unset(struct bgp_node *rn, struct peer *peer,
 		     uint32_t addpath_id)
 {
-	struct bgp_adj_in *adj;
-	struct bgp_adj_in *adj_next;
+	struct bgp_adj_in_table **tp = adj_in_table(peer, rn);
+	struct bgp_adj_in_table *t = *tp;
+	struct attr *attr;
+	uint32_t slot;
 
-	adj = rn->adj_in;
+	if (!t)
+		return 0;
 
-	if (!adj)
+	slot = adj_in_find(t, rn, addpath_id);
+	if (slot == UINT32_MAX)
 		return 0;
 
-	while (adj) {
-		adj_next = adj->next;
+	attr = bgp_attr_by_id(t->attr_id[t->index[slot] - 1]);
+	adj_in_delete(t, slot);
+	if (!t->count)
+		adj_in_table_free(peer, tp);
 
-		if (adj->peer == peer && adj->addpath_rx_id == addpath_id) {
-			bgp_adj_in_remove(rn, adj);
-			bgp_unlock_node(rn);
-		}
+	bgp_attr_unintern(&attr);
+	bgp_unlock_node(rn);
+	return 1;
+}
 
-		adj = adj_next;
+bool bgp_adj_in_next(struct peer *peer, struct bgp_node *rn,
+		     struct bgp_adj_in *ain)
+{
+	struct bgp_adj_in_table *t = *adj_in_table(peer, rn);
+	uint32_t mask, h, e;
+
+	if (!t)
+		return false;
+
+	mask = t->size - 1;
+	h = adj_in_hash(rn);
+	for (; ain->pos < t->size; ain->pos++) {
+		e = t->index[(h + ain->pos) & mask];
+		if (!e)
+			return false;
+		e--;
+		if (t->rn[e] != rn)
+			continue;
+
+		ain->pos++;
+		ain->peer = peer;
+		ain->attr = bgp_attr_by_id(t->attr_id[e]);
+		ain->uptime = t->uptime[e];
+		ain->addpath_rx_id = t->addpath_rx_id[e];
+		return true;
 	}
+	return false;
+}
 
-	return 1;
+void bgp_clear_adj_in(struct peer *peer, afi_t afi, safi_t safi)
+{
+	struct bgp_adj_in_table **tp = &peer->adj_in[afi][safi];
+	struct bgp_adj_in_table *t = *tp;
+	struct attr *attr;
+	uint32_t e;
+
+	if (!t)
+		return;
+
+	/* It is possible that we have multiple paths for a prefix from a peer
+	 * if that peer is using AddPath; they are all in here.
+	 */
+	for (e = 0; e < t->count; e++) {
+		attr = bgp_attr_by_id(t->attr_id[e]);
+		bgp_attr_unintern(&attr);
+		bgp_unlock_node(t->rn[e]);
+	}
+
+	adj_in_entries -= t->count;
+	adj_in_table_free(peer, tp);
+}
+
+unsigned long bgp_adj_in_count(void)
+{
+	return adj_in_entries;
+}
+
+size_t bgp_adj_in_memory(void)
+{
+	return adj_in_bytes;
 }
 
 void bgp_sync_init(struct peer *peer)
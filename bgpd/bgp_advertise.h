@@ -89,12 +89,28 @@ RB_HEAD(bgp_adj_out_rb, bgp_adj_out);
 RB_PROTOTYPE(bgp_adj_out_rb, bgp_adj_out, adj_entry,
 	     bgp_adj_out_compare);
 
-/* BGP adjacency in. */
-struct bgp_adj_in {
-	/* Linked list pointer.  */
-	struct bgp_adj_in *next;
-	struct bgp_adj_in *prev;
+/* Adjacencies out of a prefix kept as one bit per subgroup, indexed by
+ * update_subgroup.adj_bit, when "bgp adj-rib-out compact" is on.  Only
+ * settled adjacencies (nothing queued for them) that were sent the same
+ * attribute end up here; anything else stays a full bgp_adj_out.
+ */
+struct bgp_adj_out_bits {
+	/* Attribute advertised to every subgroup with its bit set. */
+	struct attr *attr;
+
+	/* Number of bits set. */
+	uint32_t count;
 
+	/* Size of bits[]. */
+	uint32_t words;
+	uint64_t bits[];
+};
+
+/* BGP adjacency in.  Adj-RIB-In entries are stored in per-peer tables,
+ * see bgp_advertise.c; this is a copy of one, filled in by
+ * bgp_adj_in_next().
+ */
+struct bgp_adj_in {
 	/* Received peer.  */
 	struct peer *peer;
 
@@ -106,8 +122,22 @@ struct bgp_adj_in {
 
 	/* Addpath identifier */
 	uint32_t addpath_rx_id;
+
+	/* Iterator position for bgp_adj_in_next() */
+	uint32_t pos;
 };
 
+/* Walk the Adj-RIB-In entries of peer for rn, one per addpath ID:
+ *
+ *   struct bgp_adj_in ain;
+ *   for (ALL_ADJ_IN_ENTRIES(peer, rn, ain)) ...
+ *
+ * The walk must not add or remove entries of that peer.
+ */
+#define ALL_ADJ_IN_ENTRIES(peer, rn, ain)                                      \
+	(ain).pos = 0;                                                         \
+	bgp_adj_in_next((peer), (rn), &(ain));
+
 /* BGP advertisement list.  */
 struct bgp_synchronize {
 	struct bgp_adv_fifo_head update;
@@ -115,35 +145,16 @@ struct bgp_synchronize {
 	struct bgp_adv_fifo_head withdraw_low;
 };
 
-/* BGP adjacency linked list.  */
-#define BGP_PATH_INFO_ADD(N, A, TYPE)                                          \
-	do {                                                                   \
-		(A)->prev = NULL;                                              \
-		(A)->next = (N)->TYPE;                                         \
-		if ((N)->TYPE)                                                 \
-			(N)->TYPE->prev = (A);                                 \
-		(N)->TYPE = (A);                                               \
-	} while (0)
-
-#define BGP_PATH_INFO_DEL(N, A, TYPE)                                          \
-	do {                                                                   \
-		if ((A)->next)                                                 \
-			(A)->next->prev = (A)->prev;                           \
-		if ((A)->prev)                                                 \
-			(A)->prev->next = (A)->next;                           \
-		else                                                           \
-			(N)->TYPE = (A)->next;                                 \
-	} while (0)
-
-#define BGP_ADJ_IN_ADD(N, A) BGP_PATH_INFO_ADD(N, A, adj_in)
-#define BGP_ADJ_IN_DEL(N, A) BGP_PATH_INFO_DEL(N, A, adj_in)
-
 /* Prototypes.  */
 extern int bgp_adj_out_lookup(struct peer *, struct bgp_node *, uint32_t);
 extern void bgp_adj_in_set(struct bgp_node *, struct peer *, struct attr *,
 			   uint32_t);
 extern int bgp_adj_in_unset(struct bgp_node *, struct peer *, uint32_t);
-extern void bgp_adj_in_remove(struct bgp_node *, struct bgp_adj_in *);
+extern bool bgp_adj_in_next(struct peer *peer, struct bgp_node *rn,
+			    struct bgp_adj_in *ain);
+extern void bgp_clear_adj_in(struct peer *peer, afi_t afi, safi_t safi);
+extern unsigned long bgp_adj_in_count(void);
+extern size_t bgp_adj_in_memory(void);
 
 extern void bgp_sync_init(struct peer *);
 extern void bgp_sync_delete(struct peer *);
@@ -22,6 +22,7 @@
 #include <zebra.h>
 
 #include "hash.h"
+#include "chash.h"
 #include "memory.h"
 #include "vector.h"
 #include "log.h"
@@ -86,7 +87,7 @@ struct assegment_header {
 };
 
 /* Hash for aspath.  This is the top level structure of AS path. */
-static struct hash *ashash;
+static struct chash *ashash;
 
 /* Stream for SNMP. See aspath_snmp_pathseg */
 static struct stream *snmp_stream;
@@ -325,17 +326,13 @@ void aspath_free(struct aspath *aspath)
 /* Unintern aspath from AS path bucket. */
 void aspath_unintern(struct aspath **aspath)
 {
-	struct aspath *ret;
 	struct aspath *asp = *aspath;
 
-	if (asp->refcnt)
-		asp->refcnt--;
-
-	if (asp->refcnt == 0) {
-		/* This aspath must exist in aspath hash table. */
-		ret = hash_release(ashash, asp);
-		assert(ret != NULL);
-		aspath_free(asp);
+	/* Last reference gone: other pthreads may still be looking at it
+	 * in ashash, so free it through RCU.
+	 */
+	if (chash_release(ashash, asp)) {
+		rcu_call(aspath_free, asp, rcu_head);
 		*aspath = NULL;
 	}
 }
@@ -643,12 +640,10 @@ struct aspath *aspath_intern(struct aspath *aspath)
 	assert(aspath->str);
 
 	/* Check AS path hash. */
-	find = hash_get(ashash, aspath, hash_alloc_intern);
+	find = chash_intern(ashash, aspath, hash_alloc_intern);
 	if (find != aspath)
 		aspath_free(aspath);
 
-	find->refcnt++;
-
 	return find;
 }
 
@@ -823,13 +818,13 @@ struct aspath *aspath_parse(struct stream *s, size_t length, int use32bit)
 		return NULL;
 
 	/* If already same aspath exist then return it. */
-	find = hash_get(ashash, &as, aspath_hash_alloc);
+	find = chash_intern(ashash, &as, aspath_hash_alloc);
 
 	/* bug! should not happen, let the daemon crash below */
 	assert(find);
 
 	/* if the aspath was already hashed free temporary memory. */
-	if (find->refcnt) {
+	if (find->str != as.str) {
 		assegment_free_all(as.segments);
 		/* aspath_key_make() always updates the string */
 		XFREE(MTYPE_AS_STR, as.str);
@@ -839,8 +834,6 @@ struct aspath *aspath_parse(struct stream *s, size_t length, int use32bit)
 		}
 	}
 
-	find->refcnt++;
-
 	return find;
 }
 
@@ -1854,7 +1847,7 @@ struct aspath *aspath_empty_get(void)
 
 unsigned long aspath_count(void)
 {
-	return ashash->count;
+	return chash_count(ashash);
 }
 
 /*
@@ -2044,14 +2037,13 @@ bool aspath_cmp(const void *arg1, const void *arg2)
 /* AS path hash initialize. */
 void aspath_init(void)
 {
-	ashash = hash_create_size(32768, aspath_key_make, aspath_cmp,
-				  "BGP AS Path");
+	ashash = chash_create(aspath_key_make, aspath_cmp,
+			      offsetof(struct aspath, refcnt), "BGP AS Path");
 }
 
 void aspath_finish(void)
 {
-	hash_clean(ashash, (void (*)(void *))aspath_free);
-	hash_free(ashash);
+	chash_free(ashash, (void (*)(void *))aspath_free);
 	ashash = NULL;
 
 	if (snmp_stream)
@@ -2077,14 +2069,12 @@ void aspath_print_vty(struct vty *vty, const char *format, struct aspath *as,
 		vty_out(vty, "%s", suffix);
 }
 
-static void aspath_show_all_iterator(struct hash_bucket *bucket,
-				     struct vty *vty)
+static void aspath_show_all_iterator(void *data, void *arg)
 {
-	struct aspath *as;
-
-	as = (struct aspath *)bucket->data;
+	struct aspath *as = data;
+	struct vty *vty = arg;
 
-	vty_out(vty, "[%p:%u] (%ld) ", (void *)bucket, bucket->key, as->refcnt);
+	vty_out(vty, "[%p:%u] (%ld) ", data, aspath_key_make(as), as->refcnt);
 	vty_out(vty, "%s\n", as->str);
 }
 
@@ -2092,9 +2082,7 @@ static void aspath_show_all_iterator(struct hash_bucket *bucket,
    `show [ip] bgp paths' command. */
 void aspath_print_all_vty(struct vty *vty)
 {
-	hash_iterate(ashash, (void (*)(struct hash_bucket *,
-				       void *))aspath_show_all_iterator,
-		     vty);
+	chash_iterate(ashash, aspath_show_all_iterator, vty);
 }
 
 static struct aspath *bgp_aggr_aspath_lookup(struct bgp_aggregate *aggregate,
@@ -21,6 +21,7 @@
 #ifndef _QUAGGA_BGP_ASPATH_H
 #define _QUAGGA_BGP_ASPATH_H
 
+#include "lib/frrcu.h"
 #include "lib/json.h"
 #include "bgpd/bgp_route.h"
 
@@ -59,7 +60,10 @@ struct assegment {
 /* AS path may be include some AsSegments.  */
 struct aspath {
 	/* Reference count to this aspath.  */
-	unsigned long refcnt;
+	_Atomic unsigned long refcnt;
+
+	/* Deferred free once released from its intern table */
+	struct rcu_head rcu_head;
 
 	/* segment data */
 	struct assegment *segments;
@@ -27,6 +27,7 @@
 #include "stream.h"
 #include "log.h"
 #include "hash.h"
+#include "chash.h"
 #include "jhash.h"
 #include "queue.h"
 #include "table.h"
@@ -94,7 +95,7 @@ static const struct message attr_flag_str[] = {
 	{BGP_ATTR_FLAG_EXTLEN, "Extended Length"},
 	{0}};
 
-static struct hash *cluster_hash;
+static struct chash *cluster_hash;
 
 static void *cluster_hash_alloc(void *p)
 {
@@ -119,14 +120,11 @@ static void *cluster_hash_alloc(void *p)
 static struct cluster_list *cluster_parse(struct in_addr *pnt, int length)
 {
 	struct cluster_list tmp;
-	struct cluster_list *cluster;
 
 	tmp.length = length;
 	tmp.list = pnt;
 
-	cluster = hash_get(cluster_hash, &tmp, cluster_hash_alloc);
-	cluster->refcnt++;
-	return cluster;
+	return chash_intern(cluster_hash, &tmp, cluster_hash_alloc);
 }
 
 int cluster_loop_check(struct cluster_list *cluster, struct in_addr originator)
@@ -164,41 +162,32 @@ static void cluster_free(struct cluster_list *cluster)
 
 static struct cluster_list *cluster_intern(struct cluster_list *cluster)
 {
-	struct cluster_list *find;
-
-	find = hash_get(cluster_hash, cluster, cluster_hash_alloc);
-	find->refcnt++;
-
-	return find;
+	return chash_intern(cluster_hash, cluster, cluster_hash_alloc);
 }
 
 void cluster_unintern(struct cluster_list *cluster)
 {
-	if (cluster->refcnt)
-		cluster->refcnt--;
-
-	if (cluster->refcnt == 0) {
-		hash_release(cluster_hash, cluster);
-		cluster_free(cluster);
-	}
+	/* Other pthreads may still be looking at it.  */
+	if (chash_release(cluster_hash, cluster))
+		rcu_call(cluster_free, cluster, rcu_head);
 }
 
 static void cluster_init(void)
 {
-	cluster_hash = hash_create(cluster_hash_key_make, cluster_hash_cmp,
-				   "BGP Cluster");
+	cluster_hash = chash_create(cluster_hash_key_make, cluster_hash_cmp,
+				    offsetof(struct cluster_list, refcnt),
+				    "BGP Cluster");
 }
 
 static void cluster_finish(void)
 {
-	hash_clean(cluster_hash, (void (*)(void *))cluster_free);
-	hash_free(cluster_hash);
+	chash_free(cluster_hash, (void (*)(void *))cluster_free);
 	cluster_hash = NULL;
 }
 
-static struct hash *encap_hash = NULL;
+static struct chash *encap_hash = NULL;
 #if ENABLE_BGP_VNC
-static struct hash *vnc_hash = NULL;
+static struct chash *vnc_hash = NULL;
 #endif
 
 struct bgp_attr_encap_subtlv *encap_tlv_dup(struct bgp_attr_encap_subtlv *orig)
@@ -314,16 +303,15 @@ static struct bgp_attr_encap_subtlv *
 encap_intern(struct bgp_attr_encap_subtlv *encap, encap_subtlv_type type)
 {
 	struct bgp_attr_encap_subtlv *find;
-	struct hash *hash = encap_hash;
+	struct chash *hash = encap_hash;
 #if ENABLE_BGP_VNC
 	if (type == VNC_SUBTLV_TYPE)
 		hash = vnc_hash;
 #endif
 
-	find = hash_get(hash, encap, encap_hash_alloc);
+	find = chash_intern(hash, encap, encap_hash_alloc);
 	if (find != encap)
 		encap_free(encap);
-	find->refcnt++;
 
 	return find;
 }
@@ -332,17 +320,15 @@ static void encap_unintern(struct bgp_attr_encap_subtlv **encapp,
 			   encap_subtlv_type type)
 {
 	struct bgp_attr_encap_subtlv *encap = *encapp;
-	if (encap->refcnt)
-		encap->refcnt--;
-
-	if (encap->refcnt == 0) {
-		struct hash *hash = encap_hash;
+	struct chash *hash = encap_hash;
 #if ENABLE_BGP_VNC
-		if (type == VNC_SUBTLV_TYPE)
-			hash = vnc_hash;
+	if (type == VNC_SUBTLV_TYPE)
+		hash = vnc_hash;
 #endif
-		hash_release(hash, encap);
-		encap_free(encap);
+
+	/* Other pthreads may still be looking at it.  */
+	if (chash_release(hash, encap)) {
+		rcu_call(encap_free, encap, rcu_head);
 		*encapp = NULL;
 	}
 }
@@ -362,22 +348,22 @@ static bool encap_hash_cmp(const void *p1, const void *p2)
 
 static void encap_init(void)
 {
-	encap_hash = hash_create(encap_hash_key_make, encap_hash_cmp,
-				 "BGP Encap Hash");
+	encap_hash = chash_create(encap_hash_key_make, encap_hash_cmp,
+				  offsetof(struct bgp_attr_encap_subtlv, refcnt),
+				  "BGP Encap Hash");
 #if ENABLE_BGP_VNC
-	vnc_hash = hash_create(encap_hash_key_make, encap_hash_cmp,
-			       "BGP VNC Hash");
+	vnc_hash = chash_create(encap_hash_key_make, encap_hash_cmp,
+				offsetof(struct bgp_attr_encap_subtlv, refcnt),
+				"BGP VNC Hash");
 #endif
 }
 
 static void encap_finish(void)
 {
-	hash_clean(encap_hash, (void (*)(void *))encap_free);
-	hash_free(encap_hash);
+	chash_free(encap_hash, (void (*)(void *))encap_free);
 	encap_hash = NULL;
 #if ENABLE_BGP_VNC
-	hash_clean(vnc_hash, (void (*)(void *))encap_free);
-	hash_free(vnc_hash);
+	chash_free(vnc_hash, (void (*)(void *))encap_free);
 	vnc_hash = NULL;
 #endif
 }
@@ -395,7 +381,7 @@ static bool overlay_index_same(const struct attr *a1, const struct attr *a2)
 }
 
 /* Unknown transit attribute. */
-static struct hash *transit_hash;
+static struct chash *transit_hash;
 
 static void transit_free(struct transit *transit)
 {
@@ -413,23 +399,18 @@ static struct transit *transit_intern(struct transit *transit)
 {
 	struct transit *find;
 
-	find = hash_get(transit_hash, transit, transit_hash_alloc);
+	find = chash_intern(transit_hash, transit, transit_hash_alloc);
 	if (find != transit)
 		transit_free(transit);
-	find->refcnt++;
 
 	return find;
 }
 
 void transit_unintern(struct transit *transit)
 {
-	if (transit->refcnt)
-		transit->refcnt--;
-
-	if (transit->refcnt == 0) {
-		hash_release(transit_hash, transit);
-		transit_free(transit);
-	}
+	/* Other pthreads may still be looking at it.  */
+	if (chash_release(transit_hash, transit))
+		rcu_call(transit_free, transit, rcu_head);
 }
 
 static unsigned int transit_hash_key_make(const void *p)
@@ -450,19 +431,120 @@ static bool transit_hash_cmp(const void *p1, const void *p2)
 
 static void transit_init(void)
 {
-	transit_hash = hash_create(transit_hash_key_make, transit_hash_cmp,
-				   "BGP Transit Hash");
+	transit_hash = chash_create(transit_hash_key_make, transit_hash_cmp,
+				    offsetof(struct transit, refcnt),
+				    "BGP Transit Hash");
 }
 
 static void transit_finish(void)
 {
-	hash_clean(transit_hash, (void (*)(void *))transit_free);
-	hash_free(transit_hash);
+	chash_free(transit_hash, (void (*)(void *))transit_free);
 	transit_hash = NULL;
 }
 
 /* Attribute hash routines. */
-static struct hash *attrhash;
+static struct chash *attrhash;
+
+/*
+ * Interned attributes by ID.  Tables holding many attribute references,
+ * like the Adj-RIB-In, store the 32-bit ID instead of a pointer.  Lookups
+ * are lock-free under RCU; the array is replaced when it grows.
+ */
+struct attr_id_array {
+	struct rcu_head rcu_head;
+	uint32_t size;
+	struct attr *_Atomic attrs[];
+};
+
+static struct attr_id_array *_Atomic attr_ids;
+static pthread_mutex_t attr_ids_mtx = PTHREAD_MUTEX_INITIALIZER;
+
+/* IDs never handed out start here; 0 is not a valid ID */
+static uint32_t attr_ids_next = 1;
+
+/* IDs handed back by bgp_attr_unintern(), reused first */
+static uint32_t *attr_ids_free;
+static uint32_t attr_ids_free_count, attr_ids_free_size;
+
+static void attr_ids_grow(uint32_t id)
+{
+	struct attr_id_array *old, *new;
+	uint32_t size, i;
+
+	old = atomic_load_explicit(&attr_ids, memory_order_relaxed);
+	size = old ? old->size : 4096;
+	while (size <= id)
+		size *= 2;
+
+	new = XCALLOC(MTYPE_ATTR_IDS,
+		      sizeof(*new) + size * sizeof(new->attrs[0]));
+	new->size = size;
+	for (i = 0; old && i < old->size; i++)
+		atomic_store_explicit(&new->attrs[i],
+				      atomic_load_explicit(&old->attrs[i],
+							   memory_order_relaxed),
+				      memory_order_relaxed);
+
+	atomic_store_explicit(&attr_ids, new, memory_order_release);
+	if (old)
+		rcu_free(MTYPE_ATTR_IDS, old, rcu_head);
+}
+
+static void attr_id_alloc(struct attr *attr)
+{
+	struct attr_id_array *arr;
+	uint32_t id;
+
+	frr_with_mutex(&attr_ids_mtx) {
+		if (attr_ids_free_count)
+			id = attr_ids_free[--attr_ids_free_count];
+		else
+			id = attr_ids_next++;
+
+		arr = atomic_load_explicit(&attr_ids, memory_order_relaxed);
+		if (!arr || id >= arr->size) {
+			attr_ids_grow(id);
+			arr = atomic_load_explicit(&attr_ids,
+						   memory_order_relaxed);
+		}
+
+		attr->id = id;
+		atomic_store_explicit(&arr->attrs[id], attr,
+				      memory_order_release);
+	}
+}
+
+static void attr_id_free(struct attr *attr)
+{
+	struct attr_id_array *arr;
+
+	frr_with_mutex(&attr_ids_mtx) {
+		arr = atomic_load_explicit(&attr_ids, memory_order_relaxed);
+		atomic_store_explicit(&arr->attrs[attr->id], NULL,
+				      memory_order_relaxed);
+
+		if (attr_ids_free_count == attr_ids_free_size) {
+			attr_ids_free_size = MAX(attr_ids_free_size * 2, 1024);
+			attr_ids_free = XREALLOC(
+				MTYPE_ATTR_IDS, attr_ids_free,
+				attr_ids_free_size * sizeof(attr_ids_free[0]));
+		}
+		attr_ids_free[attr_ids_free_count++] = attr->id;
+	}
+}
+
+/* Interned attribute by ID; NULL once it has been released.  The caller
+ * must hold a reference or be in an RCU read section.
+ */
+struct attr *bgp_attr_by_id(uint32_t id)
+{
+	struct attr_id_array *arr;
+
+	arr = atomic_load_explicit(&attr_ids, memory_order_acquire);
+	if (!arr || id >= arr->size)
+		return NULL;
+	return atomic_load_explicit(&arr->attrs[id], memory_order_acquire);
+}
 
 /* Shallow copy of an attribute
  * Though, not so shallow that it doesn't copy the contents
@@ -475,12 +557,17 @@ void bgp_attr_dup(struct attr *new, struct attr *orig)
 
 unsigned long int attr_count(void)
 {
-	return attrhash->count;
+	return chash_count(attrhash);
+}
+
+unsigned long int attr_created_count(void)
+{
+	return chash_inserted(attrhash);
 }
 
 unsigned long int attr_unknown_count(void)
 {
-	return transit_hash->count;
+	return chash_count(transit_hash);
 }
 
 unsigned int attrhash_key_make(const void *p)
@@ -573,12 +660,12 @@ bool attrhash_cmp(const void *p1, const void *p2)
 
 static void attrhash_init(void)
 {
-	attrhash =
-		hash_create(attrhash_key_make, attrhash_cmp, "BGP Attributes");
+	attrhash = chash_create(attrhash_key_make, attrhash_cmp,
+				offsetof(struct attr, refcnt), "BGP Attributes");
 }
 
 /*
- * special for hash_clean below
+ * special for chash_free below
  */
 static void attr_vfree(void *attr)
 {
@@ -587,14 +674,19 @@ static void attr_vfree(void *attr)
 
 static void attrhash_finish(void)
 {
-	hash_clean(attrhash, attr_vfree);
-	hash_free(attrhash);
+	chash_free(attrhash, attr_vfree);
 	attrhash = NULL;
+
+	XFREE(MTYPE_ATTR_IDS, attr_ids);
+	XFREE(MTYPE_ATTR_IDS, attr_ids_free);
+	attr_ids_free_count = attr_ids_free_size = 0;
+	attr_ids_next = 1;
 }
 
-static void attr_show_all_iterator(struct hash_bucket *bucket, struct vty *vty)
+static void attr_show_all_iterator(void *data, void *arg)
 {
-	struct attr *attr = bucket->data;
+	struct attr *attr = data;
+	struct vty *vty = arg;
 
 	vty_out(vty, "attr[%ld] nexthop %s\n", attr->refcnt,
 		inet_ntoa(attr->nexthop));
@@ -605,9 +697,7 @@ static void attr_show_all_iterator(struct hash_bucket *bucket, struct vty *vty)
 
 void attr_show_all(struct vty *vty)
 {
-	hash_iterate(attrhash, (void (*)(struct hash_bucket *,
-					 void *))attr_show_all_iterator,
-		     vty);
+	chash_iterate(attrhash, attr_show_all_iterator, vty);
 }
 
 static void *bgp_attr_hash_alloc(void *p)
@@ -626,6 +716,7 @@ static void *bgp_attr_hash_alloc(void *p)
 	}
 #endif
 	attr->refcnt = 0;
+	attr_id_alloc(attr);
 	return attr;
 }
 
@@ -695,8 +786,7 @@ struct attr *bgp_attr_intern(struct attr *attr)
 	 * If we don't find it, we need to allocate a one because in all
 	 * cases this returns a new reference to a hashed attr, but the input
 	 * wasn't on hash. */
-	find = (struct attr *)hash_get(attrhash, attr, bgp_attr_hash_alloc);
-	find->refcnt++;
+	find = chash_intern(attrhash, attr, bgp_attr_hash_alloc);
 
 	return find;
 }
@@ -900,19 +990,16 @@ void bgp_attr_undup(struct attr *new, struct attr *old)
 void bgp_attr_unintern(struct attr **pattr)
 {
 	struct attr *attr = *pattr;
-	struct attr *ret;
 	struct attr tmp;
 
-	/* Decrement attribute reference. */
-	attr->refcnt--;
-
 	tmp = *attr;
 
-	/* If reference becomes zero then free attribute object. */
-	if (attr->refcnt == 0) {
-		ret = hash_release(attrhash, attr);
-		assert(ret != NULL);
-		XFREE(MTYPE_ATTR, attr);
+	/* If reference becomes zero then free attribute object; other
+	 * pthreads may still be looking at it in attrhash.
+	 */
+	if (chash_release(attrhash, attr)) {
+		attr_id_free(attr);
+		rcu_free(MTYPE_ATTR, attr, rcu_head);
 		*pattr = NULL;
 	}
 
@@ -22,6 +22,7 @@
 #define _QUAGGA_BGP_ATTR_H
 
 #include "mpls.h"
+#include "frrcu.h"
 #include "bgp_attr_evpn.h"
 #include "bgpd/bgp_encap_types.h"
 
@@ -72,7 +73,9 @@
 struct bgp_attr_encap_subtlv {
 	struct bgp_attr_encap_subtlv *next; /* for chaining */
 	/* Reference count of this attribute. */
-	unsigned long refcnt;
+	_Atomic unsigned long refcnt;
+	/* Deferred free of the chain once uninterned. */
+	struct rcu_head rcu_head;
 	uint16_t type;
 	uint16_t length;
 	uint8_t value[0]; /* will be extended */
@@ -114,7 +117,13 @@ struct attr {
 	struct community *community;
 
 	/* Reference count of this attribute. */
-	unsigned long refcnt;
+	_Atomic unsigned long refcnt;
+
+	/* Deferred free once released from attrhash */
+	struct rcu_head rcu_head;
+
+	/* While interned: 32-bit handle, see bgp_attr_by_id() */
+	uint32_t id;
 
 	/* Flag of attribute is set or not. */
 	uint64_t flag;
@@ -225,16 +234,18 @@ struct attr {
 
 /* Router Reflector related structure. */
 struct cluster_list {
-	unsigned long refcnt;
+	_Atomic unsigned long refcnt;
 	int length;
 	struct in_addr *list;
+	struct rcu_head rcu_head;
 };
 
 /* Unknown transit attribute. */
 struct transit {
-	unsigned long refcnt;
+	_Atomic unsigned long refcnt;
 	int length;
 	uint8_t *val;
+	struct rcu_head rcu_head;
 };
 
 /* "(void) 0" will generate a compiler error.  this is a safety check to
@@ -268,9 +279,17 @@ extern bgp_attr_parse_ret_t bgp_attr_parse(struct peer *, struct attr *,
 					   struct bgp_nlri *);
 extern void bgp_attr_dup(struct attr *, struct attr *);
 extern void bgp_attr_undup(struct attr *new, struct attr *old);
+/*
+ * Intern attr and all of its sub-attributes.  All intern tables are chash
+ * tables, so this and bgp_attr_unintern() may be called from any pthread
+ * in an RCU read section (any FRR pthread running a task).  Sub-attributes
+ * of attr that are already interned must be kept referenced by the caller,
+ * e.g. through the interned attr it was copied from, until this returns.
+ */
 extern struct attr *bgp_attr_intern(struct attr *attr);
 extern void bgp_attr_unintern_sub(struct attr *);
 extern void bgp_attr_unintern(struct attr **);
+extern struct attr *bgp_attr_by_id(uint32_t id);
 extern void bgp_attr_flush(struct attr *);
 extern struct attr *bgp_attr_default_set(struct attr *attr, uint8_t);
 extern struct attr *bgp_attr_aggregate_intern(struct bgp *bgp, uint8_t origin,
@@ -293,6 +312,7 @@ extern bool attrhash_cmp(const void *arg1, const void *arg2);
 extern unsigned int attrhash_key_make(const void *);
 extern void attr_show_all(struct vty *);
 extern unsigned long int attr_count(void);
+extern unsigned long int attr_created_count(void);
 extern unsigned long int attr_unknown_count(void);
 
 /* Cluster list prototypes. */
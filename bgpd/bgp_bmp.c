@@ -922,7 +922,9 @@ afibreak:
 	struct bgp_table *table = bmp->targets->bgp->rib[afi][safi];
 	struct bgp_node *bn;
 	struct bgp_path_info *bpi = NULL, *bpiter;
-	struct bgp_adj_in *adjin = NULL, *adjiter;
+	struct bgp_adj_in *adjin = NULL, adjiter, adjfound;
+	struct listnode *node;
+	struct peer *peer;
 
 	bn = bgp_node_lookup(table, &bmp->syncpos);
 	do {
@@ -958,15 +960,18 @@ afibreak:
 			}
 		}
 		if (bmp->targets->afimon[afi][safi] & BMP_MON_PREPOLICY) {
-			for (adjiter = bn->adj_in; adjiter;
-			     adjiter = adjiter->next) {
-				if (adjiter->peer->qobj_node.nid
-				    <= bmp->syncpeerid)
+			for (ALL_LIST_ELEMENTS_RO(bmp->targets->bgp->peer,
+						  node, peer)) {
+				if (peer->qobj_node.nid <= bmp->syncpeerid)
 					continue;
-				if (adjin && adjiter->peer->qobj_node.nid
+				if (adjin && peer->qobj_node.nid
 						> adjin->peer->qobj_node.nid)
 					continue;
-				adjin = adjiter;
+				adjiter.pos = 0;
+				if (!bgp_adj_in_next(peer, bn, &adjiter))
+					continue;
+				adjfound = adjiter;
+				adjin = &adjfound;
 			}
 		}
 		if (bpi || adjin)
@@ -1075,16 +1080,13 @@ static bool bmp_wrqueue(struct bmp *bmp, struct pullwr *pullwr)
 	}
 
 	if (bmp->targets->afimon[afi][safi] & BMP_MON_PREPOLICY) {
-		struct bgp_adj_in *adjin;
+		struct bgp_adj_in adjin = {};
+		bool found;
 
-		for (adjin = bn ? bn->adj_in : NULL; adjin;
-		     adjin = adjin->next) {
-			if (adjin->peer == peer)
-				break;
-		}
+		found = bn && bgp_adj_in_next(peer, bn, &adjin);
 		bmp_monitor(bmp, peer, BMP_PEER_FLAG_L, &bqe->p,
-			    adjin ? adjin->attr : NULL, afi, safi,
-			    adjin ? adjin->uptime : monotime(NULL));
+			    found ? adjin.attr : NULL, afi, safi,
+			    found ? adjin.uptime : monotime(NULL));
 		written = true;
 	}
 
@@ -111,6 +111,8 @@ static void community_entry_free(struct community_entry *entry)
 		XFREE(MTYPE_COMMUNITY_LIST_CONFIG, entry->config);
 		if (entry->reg)
 			bgp_regex_free(entry->reg);
+		if (entry->dfa)
+			bgp_regex_dfa_free(entry->dfa);
 	default:
 		break;
 	}
@@ -153,6 +155,7 @@ community_list_insert(struct community_list_handler *ch, const char *name,
 
 	/* Save for later */
 	hash_get(cm->hash, new, hash_alloc_intern);
+	cm->generation++;
 
 	/* If name is made by all digit character.  We treat it as
 	   number. */
@@ -241,6 +244,29 @@ struct community_list *community_list_lookup(struct community_list_handler *ch,
 	return hash_get(cm->hash, &lookup, NULL);
 }
 
+/* Same as community_list_lookup(), for route-map rules and the like that
+ * look up the same name over and over: the result is kept in *cache until
+ * a list of that type is created or deleted.
+ */
+struct community_list *
+community_list_lookup_cached(struct community_list_handler *ch,
+			     const char *name, uint32_t name_hash, int master,
+			     struct community_list_cache *cache)
+{
+	struct community_list_master *cm;
+
+	cm = community_list_master_lookup(ch, master);
+	if (!cm)
+		return NULL;
+
+	if (cache->generation != cm->generation) {
+		cache->list = community_list_lookup(ch, name, name_hash,
+						    master);
+		cache->generation = cm->generation;
+	}
+	return cache->list;
+}
+
 static struct community_list *
 community_list_get(struct community_list_handler *ch, const char *name,
 		   int master)
@@ -277,6 +303,7 @@ static void community_list_delete(struct community_list_master *cm,
 		clist->head = list->next;
 
 	hash_release(cm->hash, list);
+	cm->generation++;
 	community_list_free(list);
 }
 
@@ -427,9 +454,19 @@ static char *community_str_get(struct community *com, int i)
 	return str;
 }
 
+/* Regular expression match of an expanded community-list entry. */
+static bool community_entry_regexec(struct community_entry *entry,
+				    const char *str)
+{
+	if (entry->dfa)
+		return bgp_regex_dfa_str(entry->dfa, str);
+	return regexec(entry->reg, str, 0, NULL, 0) == 0;
+}
+
 /* Internal function to perform regular expression match for
  * a single community. */
-static int community_regexp_include(regex_t *reg, struct community *com, int i)
+static int community_regexp_include(struct community_entry *entry,
+				    struct community *com, int i)
 {
 	char *str;
 	int rv;
@@ -442,11 +479,11 @@ static int community_regexp_include(regex_t *reg, struct community *com, int i)
 		str = community_str_get(com, i);
 
 	/* Regular expression match.  */
-	rv = regexec(reg, str, 0, NULL, 0);
+	rv = community_entry_regexec(entry, str);
 
 	XFREE(MTYPE_COMMUNITY_STR, str);
 
-	if (rv == 0)
+	if (rv)
 		return 1;
 
 	/* No match.  */
@@ -455,7 +492,8 @@ static int community_regexp_include(regex_t *reg, struct community *com, int i)
 
 /* Internal function to perform regular expression match for community
    attribute.  */
-static int community_regexp_match(struct community *com, regex_t *reg)
+static int community_regexp_match(struct community *com,
+				  struct community_entry *entry)
 {
 	const char *str;
 
@@ -467,7 +505,7 @@ static int community_regexp_match(struct community *com, regex_t *reg)
 		str = community_str(com, false);
 
 	/* Regular expression match.  */
-	if (regexec(reg, str, 0, NULL, 0) == 0)
+	if (community_entry_regexec(entry, str))
 		return 1;
 
 	/* No match.  */
@@ -506,8 +544,8 @@ static char *lcommunity_str_get(struct lcommunity *lcom, int i)
 
 /* Internal function to perform regular expression match for
  * a single community. */
-static int lcommunity_regexp_include(regex_t *reg, struct lcommunity *lcom,
-				     int i)
+static int lcommunity_regexp_include(struct community_entry *entry,
+				     struct lcommunity *lcom, int i)
 {
 	char *str;
 
@@ -519,7 +557,7 @@ static int lcommunity_regexp_include(regex_t *reg, struct lcommunity *lcom,
 		str = lcommunity_str_get(lcom, i);
 
 	/* Regular expression match.  */
-	if (regexec(reg, str, 0, NULL, 0) == 0) {
+	if (community_entry_regexec(entry, str)) {
 		XFREE(MTYPE_LCOMMUNITY_STR, str);
 		return 1;
 	}
@@ -529,7 +567,8 @@ static int lcommunity_regexp_include(regex_t *reg, struct lcommunity *lcom,
 	return 0;
 }
 
-static int lcommunity_regexp_match(struct lcommunity *com, regex_t *reg)
+static int lcommunity_regexp_match(struct lcommunity *com,
+				   struct community_entry *entry)
 {
 	const char *str;
 
@@ -541,7 +580,7 @@ static int lcommunity_regexp_match(struct lcommunity *com, regex_t *reg)
 		str = lcommunity_str(com, false);
 
 	/* Regular expression match.  */
-	if (regexec(reg, str, 0, NULL, 0) == 0)
+	if (community_entry_regexec(entry, str))
 		return 1;
 
 	/* No match.  */
@@ -549,7 +588,8 @@ static int lcommunity_regexp_match(struct lcommunity *com, regex_t *reg)
 }
 
 
-static int ecommunity_regexp_match(struct ecommunity *ecom, regex_t *reg)
+static int ecommunity_regexp_match(struct ecommunity *ecom,
+				   struct community_entry *entry)
 {
 	const char *str;
 
@@ -561,7 +601,7 @@ static int ecommunity_regexp_match(struct ecommunity *ecom, regex_t *reg)
 		str = ecommunity_str(ecom);
 
 	/* Regular expression match.  */
-	if (regexec(reg, str, 0, NULL, 0) == 0)
+	if (community_entry_regexec(entry, str))
 		return 1;
 
 	/* No match.  */
@@ -667,7 +707,7 @@ int community_list_match(struct community *com, struct community_list *list)
 				return entry->direct == COMMUNITY_PERMIT ? 1
 									 : 0;
 		} else if (entry->style == COMMUNITY_LIST_EXPANDED) {
-			if (community_regexp_match(com, entry->reg))
+			if (community_regexp_match(com, entry))
 				return entry->direct == COMMUNITY_PERMIT ? 1
 									 : 0;
 		}
@@ -688,7 +728,7 @@ int lcommunity_list_match(struct lcommunity *lcom, struct community_list *list)
 				return entry->direct == COMMUNITY_PERMIT ? 1
 									 : 0;
 		} else if (entry->style == LARGE_COMMUNITY_LIST_EXPANDED) {
-			if (lcommunity_regexp_match(lcom, entry->reg))
+			if (lcommunity_regexp_match(lcom, entry))
 				return entry->direct == COMMUNITY_PERMIT ? 1
 									 : 0;
 		}
@@ -714,7 +754,7 @@ int lcommunity_list_exact_match(struct lcommunity *lcom,
 				return entry->direct == COMMUNITY_PERMIT ? 1
 									 : 0;
 		} else if (entry->style == LARGE_COMMUNITY_LIST_EXPANDED) {
-			if (lcommunity_regexp_match(lcom, entry->reg))
+			if (lcommunity_regexp_match(lcom, entry))
 				return entry->direct == COMMUNITY_PERMIT ? 1
 									 : 0;
 		}
@@ -735,7 +775,7 @@ int ecommunity_list_match(struct ecommunity *ecom, struct community_list *list)
 				return entry->direct == COMMUNITY_PERMIT ? 1
 									 : 0;
 		} else if (entry->style == EXTCOMMUNITY_LIST_EXPANDED) {
-			if (ecommunity_regexp_match(ecom, entry->reg))
+			if (ecommunity_regexp_match(ecom, entry))
 				return entry->direct == COMMUNITY_PERMIT ? 1
 									 : 0;
 		}
@@ -763,7 +803,7 @@ int community_list_exact_match(struct community *com,
 				return entry->direct == COMMUNITY_PERMIT ? 1
 									 : 0;
 		} else if (entry->style == COMMUNITY_LIST_EXPANDED) {
-			if (community_regexp_match(com, entry->reg))
+			if (community_regexp_match(com, entry))
 				return entry->direct == COMMUNITY_PERMIT ? 1
 									 : 0;
 		}
@@ -809,8 +849,7 @@ struct community *community_list_match_delete(struct community *com,
 			}
 
 			else if ((entry->style == COMMUNITY_LIST_EXPANDED)
-				 && community_regexp_include(entry->reg, com,
-							     i)) {
+				 && community_regexp_include(entry, com, i)) {
 				if (entry->direct == COMMUNITY_PERMIT) {
 					com_index_to_delete[delete_index] = i;
 					delete_index++;
@@ -919,6 +958,8 @@ int community_list_set(struct community_list_handler *ch, const char *name,
 	entry->any = (str ? 0 : 1);
 	entry->u.com = com;
 	entry->reg = regex;
+	if (regex)
+		entry->dfa = bgp_regex_dfa_compile(str);
 	entry->config =
 		(regex ? XSTRDUP(MTYPE_COMMUNITY_LIST_CONFIG, str) : NULL);
 
@@ -1008,8 +1049,7 @@ struct lcommunity *lcommunity_list_match_delete(struct lcommunity *lcom,
 			}
 
 			else if ((entry->style == LARGE_COMMUNITY_LIST_EXPANDED)
-				 && lcommunity_regexp_include(entry->reg, lcom,
-							      i)) {
+				 && lcommunity_regexp_include(entry, lcom, i)) {
 				if (entry->direct == COMMUNITY_PERMIT) {
 					com_index_to_delete[delete_index] = i;
 					delete_index++;
@@ -1101,6 +1141,8 @@ int lcommunity_list_set(struct community_list_handler *ch, const char *name,
 	entry->any = (str ? 0 : 1);
 	entry->u.lcom = lcom;
 	entry->reg = regex;
+	if (regex)
+		entry->dfa = bgp_regex_dfa_compile(str);
 	entry->config =
 		(regex ? XSTRDUP(MTYPE_COMMUNITY_LIST_CONFIG, str) : NULL);
 
@@ -1220,6 +1262,8 @@ int extcommunity_list_set(struct community_list_handler *ch, const char *name,
 
 	entry->u.ecom = ecom;
 	entry->reg = regex;
+	if (regex)
+		entry->dfa = bgp_regex_dfa_compile(str);
 
 	/* Do not put duplicated community entry.  */
 	if (community_list_dup_check(list, entry))
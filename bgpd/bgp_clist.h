@@ -93,6 +93,7 @@ struct community_entry {
 
 	/* Expanded community-list regular expression.  */
 	regex_t *reg;
+	struct bgp_regex_dfa *dfa;
 };
 
 /* Linked list of community-list.  */
@@ -106,6 +107,15 @@ struct community_list_master {
 	struct community_list_list num;
 	struct community_list_list str;
 	struct hash *hash;
+
+	/* Bumped whenever a list is created or deleted. */
+	uint32_t generation;
+};
+
+/* Result of a community_list_lookup_cached(), zero-initialized. */
+struct community_list_cache {
+	struct community_list *list;
+	uint32_t generation;
 };
 
 /* Community-list handler.  community_list_init() returns this
@@ -159,6 +169,10 @@ community_list_master_lookup(struct community_list_handler *, int);
 extern struct community_list *
 community_list_lookup(struct community_list_handler *c, const char *name,
 		      uint32_t name_hash, int master);
+extern struct community_list *
+community_list_lookup_cached(struct community_list_handler *c,
+			     const char *name, uint32_t name_hash, int master,
+			     struct community_list_cache *cache);
 
 extern int community_list_match(struct community *, struct community_list *);
 extern int ecommunity_list_match(struct ecommunity *, struct community_list *);
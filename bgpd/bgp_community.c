@@ -22,6 +22,7 @@
 
 #include "command.h"
 #include "hash.h"
+#include "chash.h"
 #include "memory.h"
 #include "jhash.h"
 
@@ -29,7 +30,7 @@
 #include "bgpd/bgp_community.h"
 
 /* Hash of community attribute. */
-static struct hash *comhash;
+static struct chash *comhash;
 
 /* Allocate a new communities value.  */
 static struct community *community_new(void)
@@ -465,6 +466,19 @@ static void set_community_string(struct community *com, bool make_json)
 	com->str = str;
 }
 
+/* Entries are read by other pthreads as soon as they are in comhash, so
+ * the string has to be made before.
+ */
+static void *community_hash_alloc(void *arg)
+{
+	struct community *com = arg;
+
+	if (!com->str)
+		set_community_string(com, false);
+
+	return com;
+}
+
 /* Intern communities attribute.  */
 struct community *community_intern(struct community *com)
 {
@@ -474,38 +488,30 @@ struct community *community_intern(struct community *com)
 	assert(com->refcnt == 0);
 
 	/* Lookup community hash. */
-	find = (struct community *)hash_get(comhash, com, hash_alloc_intern);
+	find = chash_intern(comhash, com, community_hash_alloc);
 
 	/* Arguemnt com is allocated temporary.  So when it is not used in
 	   hash, it should be freed.  */
 	if (find != com)
 		community_free(&com);
 
-	/* Increment refrence counter.  */
-	find->refcnt++;
-
-	/* Make string.  */
-	if (!find->str)
-		set_community_string(find, false);
-
 	return find;
 }
 
+static void community_free_rcu(struct community *com)
+{
+	community_free(&com);
+}
+
 /* Free community attribute. */
 void community_unintern(struct community **com)
 {
-	struct community *ret;
-
-	if ((*com)->refcnt)
-		(*com)->refcnt--;
-
-	/* Pull off from hash.  */
-	if ((*com)->refcnt == 0) {
-		/* Community value com must exist in hash. */
-		ret = (struct community *)hash_release(comhash, *com);
-		assert(ret != NULL);
-
-		community_free(com);
+	/* Pull off from hash; freed through RCU as other pthreads may
+	 * still be looking at it.
+	 */
+	if (chash_release(comhash, *com)) {
+		rcu_call(community_free_rcu, *com, rcu_head);
+		*com = NULL;
 	}
 }
 
@@ -868,11 +874,11 @@ struct community *community_str2com(const char *str)
 /* Return communities hash entry count.  */
 unsigned long community_count(void)
 {
-	return comhash->count;
+	return chash_count(comhash);
 }
 
 /* Return communities hash.  */
-struct hash *community_hash(void)
+struct chash *community_hash(void)
 {
 	return comhash;
 }
@@ -880,15 +886,15 @@ struct hash *community_hash(void)
 /* Initialize comminity related hash. */
 void community_init(void)
 {
-	comhash =
-		hash_create((unsigned int (*)(const void *))community_hash_make,
-			    (bool (*)(const void *, const void *))community_cmp,
-			    "BGP Community Hash");
+	comhash = chash_create(
+		(unsigned int (*)(const void *))community_hash_make,
+		(bool (*)(const void *, const void *))community_cmp,
+		offsetof(struct community, refcnt), "BGP Community Hash");
 }
 
 void community_finish(void)
 {
-	hash_free(comhash);
+	chash_free(comhash, NULL);
 	comhash = NULL;
 }
 
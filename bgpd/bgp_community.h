@@ -21,13 +21,17 @@
 #ifndef _QUAGGA_BGP_COMMUNITY_H
 #define _QUAGGA_BGP_COMMUNITY_H
 
+#include "lib/chash.h"
 #include "lib/json.h"
 #include "bgpd/bgp_route.h"
 
 /* Communities attribute.  */
 struct community {
 	/* Reference count of communities value.  */
-	unsigned long refcnt;
+	_Atomic unsigned long refcnt;
+
+	/* Deferred free once released from its intern table */
+	struct rcu_head rcu_head;
 
 	/* Communities value size.  */
 	int size;
@@ -88,7 +92,7 @@ extern struct community *community_dup(struct community *);
 extern int community_include(struct community *, uint32_t);
 extern void community_del_val(struct community *, uint32_t *);
 extern unsigned long community_count(void);
-extern struct hash *community_hash(void);
+extern struct chash *community_hash(void);
 extern uint32_t community_val_get(struct community *com, int i);
 extern void bgp_compute_aggregate_community(struct bgp_aggregate *aggregate,
 					    struct community *community);
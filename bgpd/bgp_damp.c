@@ -36,17 +36,10 @@
 #include "bgpd/bgp_attr.h"
 #include "bgpd/bgp_advertise.h"
 
-/* Global variable to access damping configuration */
-struct bgp_damp_config bgp_damp_cfg;
-static struct bgp_damp_config *damp = &bgp_damp_cfg;
-
-/* Utility macro to add and delete BGP dampening information to no
-   used list.  */
-#define BGP_DAMP_LIST_ADD(N, A) BGP_PATH_INFO_ADD(N, A, no_reuse_list)
-#define BGP_DAMP_LIST_DEL(N, A) BGP_PATH_INFO_DEL(N, A, no_reuse_list)
+DECLARE_DLIST(bgp_damp_list, struct bgp_damp_info, item)
 
 /* Calculate reuse list index by penalty value.  */
-static int bgp_reuse_index(int penalty)
+static int bgp_reuse_index(struct bgp_damp_config *damp, int penalty)
 {
 	unsigned int i;
 	int index;
@@ -62,33 +55,40 @@ static int bgp_reuse_index(int penalty)
 	return (damp->reuse_offset + index) % damp->reuse_list_size;
 }
 
+/* The list bdi is on, going by bdi->index. */
+static struct bgp_damp_list_head *bgp_damp_list_of(struct bgp_damp_info *bdi)
+{
+	struct bgp_damp_config *damp = bdi->config;
+
+	if (bdi->index >= 0)
+		return &damp->reuse_list[bdi->index];
+	if (bdi->index == BGP_DAMP_REUSE_PENDING)
+		return &damp->reuse_pending;
+	return &damp->no_reuse_list;
+}
+
 /* Add BGP dampening information to reuse list.  */
 static void bgp_reuse_list_add(struct bgp_damp_info *bdi)
 {
-	int index;
-
-	index = bdi->index = bgp_reuse_index(bdi->penalty);
+	bdi->index = bgp_reuse_index(bdi->config, bdi->penalty);
+	bgp_damp_list_add_head(bgp_damp_list_of(bdi), bdi);
+}
 
-	bdi->prev = NULL;
-	bdi->next = damp->reuse_list[index];
-	if (damp->reuse_list[index])
-		damp->reuse_list[index]->prev = bdi;
-	damp->reuse_list[index] = bdi;
+/* Add BGP dampening information to the list of entries not being reused. */
+static void bgp_no_reuse_list_add(struct bgp_damp_info *bdi)
+{
+	bdi->index = BGP_DAMP_NO_REUSE_LIST;
+	bgp_damp_list_add_head(bgp_damp_list_of(bdi), bdi);
 }
 
-/* Delete BGP dampening information from reuse list.  */
-static void bgp_reuse_list_delete(struct bgp_damp_info *bdi)
+/* Delete BGP dampening information from whichever list it is on.  */
+static void bgp_damp_list_remove(struct bgp_damp_info *bdi)
 {
-	if (bdi->next)
-		bdi->next->prev = bdi->prev;
-	if (bdi->prev)
-		bdi->prev->next = bdi->next;
-	else
-		damp->reuse_list[bdi->index] = bdi->next;
+	bgp_damp_list_del(bgp_damp_list_of(bdi), bdi);
 }
 
 /* Return decayed penalty value.  */
-int bgp_damp_decay(time_t tdiff, int penalty)
+int bgp_damp_decay(struct bgp_damp_config *damp, time_t tdiff, int penalty)
 {
 	unsigned int i;
 
@@ -100,44 +100,35 @@ int bgp_damp_decay(time_t tdiff, int penalty)
 	if (i >= damp->decay_array_size)
 		return 0;
 
-	return (int)(penalty * damp->decay_array[i]);
+	return ((uint64_t)penalty * damp->decay_array[i]) / BGP_DAMP_DECAY_ONE;
 }
 
-/* Handler of reuse timer event.  Each route in the current reuse-list
-   is evaluated.  RFC2439 Section 4.8.7.  */
-static int bgp_reuse_timer(struct thread *t)
+/* Each route taken off the reuse list by bgp_reuse_timer() is evaluated.
+   RFC2439 Section 4.8.7.  Done in batches, as the list can hold a large
+   part of the table after a bad flap.  */
+static int bgp_reuse_pending(struct thread *t)
 {
+	struct bgp_damp_config *damp = THREAD_ARG(t);
+	struct bgp *bgp = damp->bgp;
 	struct bgp_damp_info *bdi;
-	struct bgp_damp_info *next;
+	unsigned int count = 0;
 	time_t t_now, t_diff;
 
-	damp->t_reuse = NULL;
-	thread_add_timer(bm->master, bgp_reuse_timer, NULL, DELTA_REUSE,
-			 &damp->t_reuse);
-
 	t_now = bgp_clock();
 
-	/* 1.  save a pointer to the current zeroth queue head and zero the
-	   list head entry.  */
-	bdi = damp->reuse_list[damp->reuse_offset];
-	damp->reuse_list[damp->reuse_offset] = NULL;
-
-	/* 2.  set offset = modulo reuse-list-size ( offset + 1 ), thereby
-	   rotating the circular queue of list-heads.  */
-	damp->reuse_offset = (damp->reuse_offset + 1) % damp->reuse_list_size;
-
-	/* 3. if ( the saved list head pointer is non-empty ) */
-	for (; bdi; bdi = next) {
-		struct bgp *bgp = bdi->path->peer->bgp;
-
-		next = bdi->next;
+	while ((bdi = bgp_damp_list_first(&damp->reuse_pending))) {
+		if (count++ == BGP_DAMP_REUSE_BATCH) {
+			thread_add_event(bm->master, bgp_reuse_pending, damp, 0,
+					 &damp->t_reuse_pending);
+			break;
+		}
 
 		/* Set t-diff = t-now - t-updated.  */
 		t_diff = t_now - bdi->t_updated;
 
 		/* Set figure-of-merit = figure-of-merit * decay-array-ok
 		 * [t-diff] */
-		bdi->penalty = bgp_damp_decay(t_diff, bdi->penalty);
+		bdi->penalty = bgp_damp_decay(damp, t_diff, bdi->penalty);
 
 		/* Set t-updated = t-now.  */
 		bdi->t_updated = t_now;
@@ -160,14 +151,48 @@ static int bgp_reuse_timer(struct thread *t)
 
 			if (bdi->penalty <= damp->reuse_limit / 2.0)
 				bgp_damp_info_free(bdi, 1);
-			else
-				BGP_DAMP_LIST_ADD(damp, bdi);
-		} else
+			else {
+				bgp_damp_list_remove(bdi);
+				bgp_no_reuse_list_add(bdi);
+			}
+		} else {
 			/* Re-insert into another list (See RFC2439 Section
 			 * 4.8.6).  */
+			bgp_damp_list_remove(bdi);
 			bgp_reuse_list_add(bdi);
+		}
+	}
+
+	return 0;
+}
+
+/* Handler of reuse timer event.  */
+static int bgp_reuse_timer(struct thread *t)
+{
+	struct bgp_damp_config *damp = THREAD_ARG(t);
+	struct bgp_damp_list_head *list;
+	struct bgp_damp_info *bdi;
+
+	thread_add_timer(bm->master, bgp_reuse_timer, damp, DELTA_REUSE,
+			 &damp->t_reuse);
+
+	/* 1.  save a pointer to the current zeroth queue head and zero the
+	   list head entry.  */
+	list = &damp->reuse_list[damp->reuse_offset];
+	while ((bdi = bgp_damp_list_pop(list))) {
+		bdi->index = BGP_DAMP_REUSE_PENDING;
+		bgp_damp_list_add_tail(&damp->reuse_pending, bdi);
 	}
 
+	/* 2.  set offset = modulo reuse-list-size ( offset + 1 ), thereby
+	   rotating the circular queue of list-heads.  */
+	damp->reuse_offset = (damp->reuse_offset + 1) % damp->reuse_list_size;
+
+	/* 3. if ( the saved list head pointer is non-empty ) */
+	if (bgp_damp_list_count(&damp->reuse_pending))
+		thread_add_event(bm->master, bgp_reuse_pending, damp, 0,
+				 &damp->t_reuse_pending);
+
 	return 0;
 }
 
@@ -177,6 +202,7 @@ int bgp_damp_withdraw(struct bgp_path_info *path, struct bgp_node *rn,
 {
 	time_t t_now;
 	struct bgp_damp_info *bdi = NULL;
+	struct bgp_damp_config *damp;
 	unsigned int last_penalty = 0;
 
 	t_now = bgp_clock();
@@ -186,6 +212,10 @@ int bgp_damp_withdraw(struct bgp_path_info *path, struct bgp_node *rn,
 		bdi = path->extra->damp_info;
 
 	if (bdi == NULL) {
+		damp = path->peer->bgp->damp[afi][safi];
+		if (!damp)
+			return BGP_DAMP_USED;
+
 		/* If there is no previous stability history. */
 
 		/* RFC2439 said:
@@ -197,24 +227,25 @@ int bgp_damp_withdraw(struct bgp_path_info *path, struct bgp_node *rn,
 			      sizeof(struct bgp_damp_info));
 		bdi->path = path;
 		bdi->rn = rn;
+		bdi->config = damp;
 		bdi->penalty =
 			(attr_change ? DEFAULT_PENALTY / 2 : DEFAULT_PENALTY);
 		bdi->flap = 1;
 		bdi->start_time = t_now;
 		bdi->suppress_time = 0;
-		bdi->index = -1;
 		bdi->afi = afi;
 		bdi->safi = safi;
 		(bgp_path_info_extra_get(path))->damp_info = bdi;
-		BGP_DAMP_LIST_ADD(damp, bdi);
+		bgp_no_reuse_list_add(bdi);
 	} else {
+		damp = bdi->config;
 		last_penalty = bdi->penalty;
 
 		/* 1. Set t-diff = t-now - t-updated.  */
-		bdi->penalty =
-			(bgp_damp_decay(t_now - bdi->t_updated, bdi->penalty)
-			 + (attr_change ? DEFAULT_PENALTY / 2
-					: DEFAULT_PENALTY));
+		bdi->penalty = (bgp_damp_decay(damp, t_now - bdi->t_updated,
+					       bdi->penalty)
+				+ (attr_change ? DEFAULT_PENALTY / 2
+					       : DEFAULT_PENALTY));
 
 		if (bdi->penalty > damp->ceiling)
 			bdi->penalty = damp->ceiling;
@@ -234,7 +265,7 @@ int bgp_damp_withdraw(struct bgp_path_info *path, struct bgp_node *rn,
 	if (CHECK_FLAG(bdi->path->flags, BGP_PATH_DAMPED)) {
 		/* If decay rate isn't equal to 0, reinsert brn. */
 		if (bdi->penalty != last_penalty && bdi->index >= 0) {
-			bgp_reuse_list_delete(bdi);
+			bgp_damp_list_remove(bdi);
 			bgp_reuse_list_add(bdi);
 		}
 		return BGP_DAMP_SUPPRESSED;
@@ -245,7 +276,7 @@ int bgp_damp_withdraw(struct bgp_path_info *path, struct bgp_node *rn,
 	if (bdi->penalty >= damp->suppress_value) {
 		bgp_path_info_set_flag(rn, path, BGP_PATH_DAMPED);
 		bdi->suppress_time = t_now;
-		BGP_DAMP_LIST_DEL(damp, bdi);
+		bgp_damp_list_remove(bdi);
 		bgp_reuse_list_add(bdi);
 	}
 
@@ -257,16 +288,19 @@ int bgp_damp_update(struct bgp_path_info *path, struct bgp_node *rn, afi_t afi,
 {
 	time_t t_now;
 	struct bgp_damp_info *bdi;
+	struct bgp_damp_config *damp;
 	int status;
 
 	if (!path->extra || !((bdi = path->extra->damp_info)))
 		return BGP_DAMP_USED;
 
+	damp = bdi->config;
 	t_now = bgp_clock();
 	bgp_path_info_unset_flag(rn, path, BGP_PATH_HISTORY);
 
 	bdi->lastrecord = BGP_RECORD_UPDATE;
-	bdi->penalty = bgp_damp_decay(t_now - bdi->t_updated, bdi->penalty);
+	bdi->penalty =
+		bgp_damp_decay(damp, t_now - bdi->t_updated, bdi->penalty);
 
 	if (!CHECK_FLAG(bdi->path->flags, BGP_PATH_DAMPED)
 	    && (bdi->penalty < damp->suppress_value))
@@ -274,8 +308,8 @@ int bgp_damp_update(struct bgp_path_info *path, struct bgp_node *rn, afi_t afi,
 	else if (CHECK_FLAG(bdi->path->flags, BGP_PATH_DAMPED)
 		 && (bdi->penalty < damp->reuse_limit)) {
 		bgp_path_info_unset_flag(rn, path, BGP_PATH_DAMPED);
-		bgp_reuse_list_delete(bdi);
-		BGP_DAMP_LIST_ADD(damp, bdi);
+		bgp_damp_list_remove(bdi);
+		bgp_no_reuse_list_add(bdi);
 		bdi->suppress_time = 0;
 		status = BGP_DAMP_USED;
 	} else
@@ -294,11 +328,13 @@ int bgp_damp_scan(struct bgp_path_info *path, afi_t afi, safi_t safi)
 {
 	time_t t_now, t_diff;
 	struct bgp_damp_info *bdi;
+	struct bgp_damp_config *damp;
 
 	assert(path->extra && path->extra->damp_info);
 
 	t_now = bgp_clock();
 	bdi = path->extra->damp_info;
+	damp = bdi->config;
 
 	if (CHECK_FLAG(path->flags, BGP_PATH_DAMPED)) {
 		t_diff = t_now - bdi->suppress_time;
@@ -306,8 +342,8 @@ int bgp_damp_scan(struct bgp_path_info *path, afi_t afi, safi_t safi)
 		if (t_diff >= damp->max_suppress_time) {
 			bgp_path_info_unset_flag(bdi->rn, path,
 						 BGP_PATH_DAMPED);
-			bgp_reuse_list_delete(bdi);
-			BGP_DAMP_LIST_ADD(damp, bdi);
+			bgp_damp_list_remove(bdi);
+			bgp_no_reuse_list_add(bdi);
 			bdi->penalty = damp->reuse_limit;
 			bdi->suppress_time = 0;
 			bdi->t_updated = t_now;
@@ -321,7 +357,7 @@ int bgp_damp_scan(struct bgp_path_info *path, afi_t afi, safi_t safi)
 		}
 	} else {
 		t_diff = t_now - bdi->t_updated;
-		bdi->penalty = bgp_damp_decay(t_diff, bdi->penalty);
+		bdi->penalty = bgp_damp_decay(damp, t_diff, bdi->penalty);
 
 		if (bdi->penalty <= damp->reuse_limit / 2.0) {
 			/* release the bdi, bdi->path. */
@@ -343,10 +379,7 @@ void bgp_damp_info_free(struct bgp_damp_info *bdi, int withdraw)
 	path = bdi->path;
 	path->extra->damp_info = NULL;
 
-	if (CHECK_FLAG(path->flags, BGP_PATH_DAMPED))
-		bgp_reuse_list_delete(bdi);
-	else
-		BGP_DAMP_LIST_DEL(damp, bdi);
+	bgp_damp_list_remove(bdi);
 
 	bgp_path_info_unset_flag(bdi->rn, path,
 				 BGP_PATH_HISTORY | BGP_PATH_DAMPED);
@@ -357,7 +390,8 @@ void bgp_damp_info_free(struct bgp_damp_info *bdi, int withdraw)
 	XFREE(MTYPE_BGP_DAMP_INFO, bdi);
 }
 
-static void bgp_damp_parameter_set(int hlife, int reuse, int sup, int maxsup)
+static void bgp_damp_parameter_set(struct bgp_damp_config *damp, int hlife,
+				   int reuse, int sup, int maxsup)
 {
 	double reuse_max_ratio;
 	unsigned int i;
@@ -376,19 +410,19 @@ static void bgp_damp_parameter_set(int hlife, int reuse, int sup, int maxsup)
 					       (double)damp->max_suppress_time
 						       / damp->half_life)));
 
-	/* Decay-array computations */
+	/* Decay-array computations, done once here so that decaying a
+	 * penalty is a table lookup and an integer multiplication */
 	damp->decay_array_size =
 		ceil((double)damp->max_suppress_time / DELTA_T);
 	damp->decay_array = XMALLOC(MTYPE_BGP_DAMP_ARRAY,
-				    sizeof(double) * (damp->decay_array_size));
-	damp->decay_array[0] = 1.0;
-	damp->decay_array[1] =
-		exp((1.0 / ((double)damp->half_life / DELTA_T)) * log(0.5));
+				    sizeof(uint32_t) * (damp->decay_array_size));
 
 	/* Calculate decay values for all possible times */
-	for (i = 2; i < damp->decay_array_size; i++)
+	for (i = 0; i < damp->decay_array_size; i++)
 		damp->decay_array[i] =
-			damp->decay_array[i - 1] * damp->decay_array[1];
+			lround(BGP_DAMP_DECAY_ONE
+			       * pow(0.5, (double)i * DELTA_T
+						  / damp->half_life));
 
 	/* Reuse-list computations */
 	i = ceil((double)damp->max_suppress_time / DELTA_REUSE) + 1;
@@ -398,7 +432,9 @@ static void bgp_damp_parameter_set(int hlife, int reuse, int sup, int maxsup)
 
 	damp->reuse_list = XCALLOC(MTYPE_BGP_DAMP_ARRAY,
 				   damp->reuse_list_size
-					   * sizeof(struct bgp_reuse_node *));
+					   * sizeof(struct bgp_damp_list_head));
+	for (i = 0; i < damp->reuse_list_size; i++)
+		bgp_damp_list_init(&damp->reuse_list[i]);
 
 	/* Reuse-array computations */
 	damp->reuse_index = XCALLOC(MTYPE_BGP_DAMP_ARRAY,
@@ -426,6 +462,8 @@ static void bgp_damp_parameter_set(int hlife, int reuse, int sup, int maxsup)
 int bgp_damp_enable(struct bgp *bgp, afi_t afi, safi_t safi, time_t half,
 		    unsigned int reuse, unsigned int suppress, time_t max)
 {
+	struct bgp_damp_config *damp = bgp->damp[afi][safi];
+
 	if (CHECK_FLAG(bgp->af_flags[afi][safi], BGP_CONFIG_DAMPENING)) {
 		if (damp->half_life == half && damp->reuse_limit == reuse
 		    && damp->suppress_value == suppress
@@ -434,11 +472,19 @@ int bgp_damp_enable(struct bgp *bgp, afi_t afi, safi_t safi, time_t half,
 		bgp_damp_disable(bgp, afi, safi);
 	}
 
+	damp = XCALLOC(MTYPE_BGP_DAMP_CONFIG, sizeof(*damp));
+	damp->bgp = bgp;
+	damp->afi = afi;
+	damp->safi = safi;
+	bgp_damp_list_init(&damp->no_reuse_list);
+	bgp_damp_list_init(&damp->reuse_pending);
+	bgp->damp[afi][safi] = damp;
+
 	SET_FLAG(bgp->af_flags[afi][safi], BGP_CONFIG_DAMPENING);
-	bgp_damp_parameter_set(half, reuse, suppress, max);
+	bgp_damp_parameter_set(damp, half, reuse, suppress, max);
 
 	/* Register reuse timer.  */
-	thread_add_timer(bm->master, bgp_reuse_timer, NULL, DELTA_REUSE,
+	thread_add_timer(bm->master, bgp_reuse_timer, damp, DELTA_REUSE,
 			 &damp->t_reuse);
 
 	return 0;
@@ -446,6 +492,8 @@ int bgp_damp_enable(struct bgp *bgp, afi_t afi, safi_t safi, time_t half,
 
 static void bgp_damp_config_clean(struct bgp_damp_config *damp)
 {
+	unsigned int i;
+
 	/* Free decay array */
 	XFREE(MTYPE_BGP_DAMP_ARRAY, damp->decay_array);
 	damp->decay_array_size = 0;
@@ -455,79 +503,84 @@ static void bgp_damp_config_clean(struct bgp_damp_config *damp)
 	damp->reuse_index_size = 0;
 
 	/* Free reuse list array. */
+	for (i = 0; i < damp->reuse_list_size; i++)
+		bgp_damp_list_fini(&damp->reuse_list[i]);
 	XFREE(MTYPE_BGP_DAMP_ARRAY, damp->reuse_list);
 	damp->reuse_list_size = 0;
+
+	bgp_damp_list_fini(&damp->no_reuse_list);
+	bgp_damp_list_fini(&damp->reuse_pending);
 }
 
-/* Clean all the bgp_damp_info stored in reuse_list. */
-void bgp_damp_info_clean(void)
+/* Clean all the bgp_damp_info of one parameter set. */
+void bgp_damp_info_clean(struct bgp_damp_config *damp)
 {
 	unsigned int i;
-	struct bgp_damp_info *bdi, *next;
+	struct bgp_damp_info *bdi;
 
+	for (i = 0; i < damp->reuse_list_size; i++)
+		while ((bdi = bgp_damp_list_first(&damp->reuse_list[i])))
+			bgp_damp_info_free(bdi, 1);
 	damp->reuse_offset = 0;
 
-	for (i = 0; i < damp->reuse_list_size; i++) {
-		if (!damp->reuse_list[i])
-			continue;
-
-		for (bdi = damp->reuse_list[i]; bdi; bdi = next) {
-			next = bdi->next;
-			bgp_damp_info_free(bdi, 1);
-		}
-		damp->reuse_list[i] = NULL;
-	}
+	while ((bdi = bgp_damp_list_first(&damp->reuse_pending)))
+		bgp_damp_info_free(bdi, 1);
+	THREAD_OFF(damp->t_reuse_pending);
 
-	for (bdi = damp->no_reuse_list; bdi; bdi = next) {
-		next = bdi->next;
+	while ((bdi = bgp_damp_list_first(&damp->no_reuse_list)))
 		bgp_damp_info_free(bdi, 1);
-	}
-	damp->no_reuse_list = NULL;
 }
 
 int bgp_damp_disable(struct bgp *bgp, afi_t afi, safi_t safi)
 {
+	struct bgp_damp_config *damp = bgp->damp[afi][safi];
+
 	/* If it wasn't enabled, there's nothing to do. */
 	if (!CHECK_FLAG(bgp->af_flags[afi][safi], BGP_CONFIG_DAMPENING))
 		return 0;
 
 	/* Cancel reuse thread. */
-	if (damp->t_reuse)
-		thread_cancel(damp->t_reuse);
-	damp->t_reuse = NULL;
+	THREAD_OFF(damp->t_reuse);
 
 	/* Clean BGP dampening information.  */
-	bgp_damp_info_clean();
+	bgp_damp_info_clean(damp);
 
 	/* Clear configuration */
-	bgp_damp_config_clean(&bgp_damp_cfg);
+	bgp_damp_config_clean(damp);
+	XFREE(MTYPE_BGP_DAMP_CONFIG, bgp->damp[afi][safi]);
 
 	UNSET_FLAG(bgp->af_flags[afi][safi], BGP_CONFIG_DAMPENING);
 	return 0;
 }
 
-void bgp_config_write_damp(struct vty *vty)
+void bgp_config_write_damp(struct vty *vty, struct bgp *bgp, afi_t afi,
+			   safi_t safi)
 {
-	if (bgp_damp_cfg.half_life == DEFAULT_HALF_LIFE * 60
-	    && bgp_damp_cfg.reuse_limit == DEFAULT_REUSE
-	    && bgp_damp_cfg.suppress_value == DEFAULT_SUPPRESS
-	    && bgp_damp_cfg.max_suppress_time == bgp_damp_cfg.half_life * 4)
-		vty_out(vty, " bgp dampening\n");
-	else if (bgp_damp_cfg.half_life != DEFAULT_HALF_LIFE * 60
-		 && bgp_damp_cfg.reuse_limit == DEFAULT_REUSE
-		 && bgp_damp_cfg.suppress_value == DEFAULT_SUPPRESS
-		 && bgp_damp_cfg.max_suppress_time
-			    == bgp_damp_cfg.half_life * 4)
-		vty_out(vty, " bgp dampening %lld\n",
-			bgp_damp_cfg.half_life / 60LL);
+	struct bgp_damp_config *damp = bgp->damp[afi][safi];
+	/* ipv4 unicast is written outside of address-family */
+	const char *indent =
+		(afi == AFI_IP && safi == SAFI_UNICAST) ? " " : "  ";
+
+	if (damp->half_life == DEFAULT_HALF_LIFE * 60
+	    && damp->reuse_limit == DEFAULT_REUSE
+	    && damp->suppress_value == DEFAULT_SUPPRESS
+	    && damp->max_suppress_time == damp->half_life * 4)
+		vty_out(vty, "%sbgp dampening\n", indent);
+	else if (damp->half_life != DEFAULT_HALF_LIFE * 60
+		 && damp->reuse_limit == DEFAULT_REUSE
+		 && damp->suppress_value == DEFAULT_SUPPRESS
+		 && damp->max_suppress_time == damp->half_life * 4)
+		vty_out(vty, "%sbgp dampening %lld\n", indent,
+			damp->half_life / 60LL);
 	else
-		vty_out(vty, " bgp dampening %lld %d %d %lld\n",
-			bgp_damp_cfg.half_life / 60LL, bgp_damp_cfg.reuse_limit,
-			bgp_damp_cfg.suppress_value,
-			bgp_damp_cfg.max_suppress_time / 60LL);
+		vty_out(vty, "%sbgp dampening %lld %d %d %lld\n", indent,
+			damp->half_life / 60LL, damp->reuse_limit,
+			damp->suppress_value,
+			damp->max_suppress_time / 60LL);
 }
 
-static const char *bgp_get_reuse_time(unsigned int penalty, char *buf,
+static const char *bgp_get_reuse_time(struct bgp_damp_config *damp,
+				      unsigned int penalty, char *buf,
 				      size_t len, bool use_json,
 				      json_object *json)
 {
@@ -536,9 +589,9 @@ static const char *bgp_get_reuse_time(unsigned int penalty, char *buf,
 	int time_store = 0;
 
 	if (penalty > damp->reuse_limit) {
-		reuse_time = (int)(DELTA_T
-				   * ((log((double)damp->reuse_limit / penalty))
-				      / (log(damp->decay_array[1]))));
+		/* penalty * 0.5 ^ (t / half_life) = reuse_limit */
+		reuse_time = (int)(damp->half_life
+				   * log2((double)penalty / damp->reuse_limit));
 
 		if (reuse_time > damp->max_suppress_time)
 			reuse_time = damp->max_suppress_time;
@@ -609,13 +662,13 @@ void bgp_damp_info_vty(struct vty *vty, struct bgp_path_info *path,
 
 	/* If dampening is not enabled or there is no dampening information,
 	   return immediately.  */
-	if (!damp || !bdi)
+	if (!bdi)
 		return;
 
 	/* Calculate new penalty.  */
 	t_now = bgp_clock();
 	t_diff = t_now - bdi->t_updated;
-	penalty = bgp_damp_decay(t_diff, bdi->penalty);
+	penalty = bgp_damp_decay(bdi->config, t_diff, bdi->penalty);
 
 	if (json_path) {
 		json_object_int_add(json_path, "dampeningPenalty", penalty);
@@ -625,8 +678,8 @@ void bgp_damp_info_vty(struct vty *vty, struct bgp_path_info *path,
 
 		if (CHECK_FLAG(path->flags, BGP_PATH_DAMPED)
 		    && !CHECK_FLAG(path->flags, BGP_PATH_HISTORY))
-			bgp_get_reuse_time(penalty, timebuf, BGP_UPTIME_LEN, 1,
-					   json_path);
+			bgp_get_reuse_time(bdi->config, penalty, timebuf,
+					   BGP_UPTIME_LEN, 1, json_path);
 	} else {
 		vty_out(vty,
 			"      Dampinfo: penalty %d, flapped %d times in %s",
@@ -637,8 +690,8 @@ void bgp_damp_info_vty(struct vty *vty, struct bgp_path_info *path,
 		if (CHECK_FLAG(path->flags, BGP_PATH_DAMPED)
 		    && !CHECK_FLAG(path->flags, BGP_PATH_HISTORY))
 			vty_out(vty, ", reuse in %s",
-				bgp_get_reuse_time(penalty, timebuf,
-						   BGP_UPTIME_LEN, 0,
+				bgp_get_reuse_time(bdi->config, penalty,
+						   timebuf, BGP_UPTIME_LEN, 0,
 						   json_path));
 
 		vty_out(vty, "\n");
@@ -661,27 +714,32 @@ const char *bgp_damp_reuse_time_vty(struct vty *vty, struct bgp_path_info *path,
 
 	/* If dampening is not enabled or there is no dampening information,
 	   return immediately.  */
-	if (!damp || !bdi)
+	if (!bdi)
 		return NULL;
 
 	/* Calculate new penalty.  */
 	t_now = bgp_clock();
 	t_diff = t_now - bdi->t_updated;
-	penalty = bgp_damp_decay(t_diff, bdi->penalty);
+	penalty = bgp_damp_decay(bdi->config, t_diff, bdi->penalty);
 
-	return bgp_get_reuse_time(penalty, timebuf, len, use_json, json);
+	return bgp_get_reuse_time(bdi->config, penalty, timebuf, len, use_json,
+				  json);
 }
 
-int bgp_show_dampening_parameters(struct vty *vty, afi_t afi, safi_t safi)
+int bgp_show_dampening_parameters(struct vty *vty, struct bgp *bgp,
+				  afi_t afi, safi_t safi)
 {
-	struct bgp *bgp;
-	bgp = bgp_get_default();
+	struct bgp_damp_config *damp;
+
+	if (bgp == NULL)
+		bgp = bgp_get_default();
 
 	if (bgp == NULL) {
 		vty_out(vty, "No BGP process is configured\n");
 		return CMD_WARNING;
 	}
 
+	damp = bgp->damp[afi][safi];
 	if (CHECK_FLAG(bgp->af_flags[afi][safi], BGP_CONFIG_DAMPENING)) {
 		vty_out(vty, "Half-life time: %lld min\n",
 			(long long)damp->half_life / 60);
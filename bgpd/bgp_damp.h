@@ -21,12 +21,14 @@
 #ifndef _QUAGGA_BGP_DAMP_H
 #define _QUAGGA_BGP_DAMP_H
 
+#include "typesafe.h"
+
+PREDECL_DLIST(bgp_damp_list)
+
 /* Structure maintained on a per-route basis. */
 struct bgp_damp_info {
-	/* Doubly linked list.  This information must be linked to
-	   reuse_list or no_reuse_list.  */
-	struct bgp_damp_info *next;
-	struct bgp_damp_info *prev;
+	/* Linked to one of the lists of config, see index. */
+	struct bgp_damp_list_item item;
 
 	/* Figure-of-merit.  */
 	unsigned int penalty;
@@ -49,8 +51,13 @@ struct bgp_damp_info {
 	/* Back reference to bgp_node. */
 	struct bgp_node *rn;
 
-	/* Current index in the reuse_list. */
+	/* Parameter set of the path's AFI/SAFI. */
+	struct bgp_damp_config *config;
+
+	/* Current index in the reuse_list, or which other list. */
 	int index;
+#define BGP_DAMP_NO_REUSE_LIST	-1
+#define BGP_DAMP_REUSE_PENDING	-2
 
 	/* Last time message type. */
 	uint8_t lastrecord;
@@ -61,7 +68,7 @@ struct bgp_damp_info {
 	safi_t safi;
 };
 
-/* Specified parameter set configuration. */
+/* Specified parameter set configuration, one per AFI/SAFI of an instance. */
 struct bgp_damp_config {
 	/* Value over which routes suppressed.  */
 	unsigned int suppress_value;
@@ -91,21 +98,29 @@ struct bgp_damp_config {
 	double scale_factor;
 	unsigned int reuse_scale_factor;
 
-	/* Decay array per-set based. */
-	double *decay_array;
+	/* Decay array per-set based, in units of 1 / BGP_DAMP_DECAY_ONE. */
+	uint32_t *decay_array;
 
 	/* Reuse index array per-set based. */
 	int *reuse_index;
 
 	/* Reuse list array per-set based. */
-	struct bgp_damp_info **reuse_list;
+	struct bgp_damp_list_head *reuse_list;
 	int reuse_offset;
 
 	/* All dampening information which is not on reuse list.  */
-	struct bgp_damp_info *no_reuse_list;
+	struct bgp_damp_list_head no_reuse_list;
+
+	/* Taken off expired reuse lists, waiting for bgp_reuse_pending(). */
+	struct bgp_damp_list_head reuse_pending;
 
 	/* Reuse timer thread per-set base. */
 	struct thread *t_reuse;
+	struct thread *t_reuse_pending;
+
+	struct bgp *bgp;
+	afi_t afi;
+	safi_t safi;
 };
 
 #define BGP_DAMP_NONE           0
@@ -118,6 +133,12 @@ struct bgp_damp_config {
 /* Time granularity for decay arrays */
 #define DELTA_T 	           5
 
+/* Fixed point 1.0 of decay_array[] */
+#define BGP_DAMP_DECAY_ONE	   (1U << 16)
+
+/* Entries of expired reuse lists handled per event */
+#define BGP_DAMP_REUSE_BATCH	 1000
+
 #define DEFAULT_PENALTY         1000
 
 #define DEFAULT_HALF_LIFE         15
@@ -136,15 +157,18 @@ extern int bgp_damp_update(struct bgp_path_info *path, struct bgp_node *rn,
 			   afi_t afi, safi_t saff);
 extern int bgp_damp_scan(struct bgp_path_info *path, afi_t afi, safi_t safi);
 extern void bgp_damp_info_free(struct bgp_damp_info *path, int withdraw);
-extern void bgp_damp_info_clean(void);
-extern int bgp_damp_decay(time_t, int);
-extern void bgp_config_write_damp(struct vty *);
+extern void bgp_damp_info_clean(struct bgp_damp_config *damp);
+extern int bgp_damp_decay(struct bgp_damp_config *damp, time_t tdiff,
+			  int penalty);
+extern void bgp_config_write_damp(struct vty *vty, struct bgp *bgp, afi_t afi,
+				  safi_t safi);
 extern void bgp_damp_info_vty(struct vty *vty, struct bgp_path_info *path,
 			      json_object *json_path);
 extern const char *bgp_damp_reuse_time_vty(struct vty *vty,
 					   struct bgp_path_info *path,
 					   char *timebuf, size_t len,
 					   bool use_json, json_object *json);
-extern int bgp_show_dampening_parameters(struct vty *vty, afi_t, safi_t);
+extern int bgp_show_dampening_parameters(struct vty *vty, struct bgp *bgp,
+					 afi_t afi, safi_t safi);
 
 #endif /* _QUAGGA_BGP_DAMP_H */
@@ -21,6 +21,7 @@
 #include <zebra.h>
 
 #include "hash.h"
+#include "chash.h"
 #include "memory.h"
 #include "prefix.h"
 #include "command.h"
@@ -43,7 +44,7 @@ union traffic_rate {
 };
 
 /* Hash of community attribute. */
-static struct hash *ecomhash;
+static struct chash *ecomhash;
 
 /* Allocate a new ecommunities.  */
 struct ecommunity *ecommunity_new(void)
@@ -201,6 +202,18 @@ struct ecommunity *ecommunity_merge(struct ecommunity *ecom1,
 	return ecom1;
 }
 
+/* Make the string before the entry becomes visible to other pthreads. */
+static void *ecommunity_hash_alloc(void *arg)
+{
+	struct ecommunity *ecom = arg;
+
+	if (!ecom->str)
+		ecom->str =
+			ecommunity_ecom2str(ecom, ECOMMUNITY_FORMAT_DISPLAY, 0);
+
+	return ecom;
+}
+
 /* Intern Extended Communities Attribute.  */
 struct ecommunity *ecommunity_intern(struct ecommunity *ecom)
 {
@@ -208,35 +221,21 @@ struct ecommunity *ecommunity_intern(struct ecommunity *ecom)
 
 	assert(ecom->refcnt == 0);
 
-	find = (struct ecommunity *)hash_get(ecomhash, ecom, hash_alloc_intern);
+	find = chash_intern(ecomhash, ecom, ecommunity_hash_alloc);
 
 	if (find != ecom)
 		ecommunity_free(&ecom);
 
-	find->refcnt++;
-
-	if (!find->str)
-		find->str =
-			ecommunity_ecom2str(find, ECOMMUNITY_FORMAT_DISPLAY, 0);
-
 	return find;
 }
 
 /* Unintern Extended Communities Attribute.  */
 void ecommunity_unintern(struct ecommunity **ecom)
 {
-	struct ecommunity *ret;
-
-	if ((*ecom)->refcnt)
-		(*ecom)->refcnt--;
-
-	/* Pull off from hash.  */
-	if ((*ecom)->refcnt == 0) {
-		/* Extended community must be in the hash.  */
-		ret = (struct ecommunity *)hash_release(ecomhash, *ecom);
-		assert(ret != NULL);
-
-		ecommunity_free(ecom);
+	/* Pull off from hash; other pthreads may still be looking at it.  */
+	if (chash_release(ecomhash, *ecom)) {
+		rcu_call(ecommunity_hash_free, *ecom, rcu_head);
+		*ecom = NULL;
 	}
 }
 
@@ -269,14 +268,14 @@ bool ecommunity_cmp(const void *arg1, const void *arg2)
 /* Initialize Extended Comminities related hash. */
 void ecommunity_init(void)
 {
-	ecomhash = hash_create(ecommunity_hash_make, ecommunity_cmp,
-			       "BGP ecommunity hash");
+	ecomhash = chash_create(ecommunity_hash_make, ecommunity_cmp,
+				offsetof(struct ecommunity, refcnt),
+				"BGP ecommunity hash");
 }
 
 void ecommunity_finish(void)
 {
-	hash_clean(ecomhash, (void (*)(void *))ecommunity_hash_free);
-	hash_free(ecomhash);
+	chash_free(ecomhash, (void (*)(void *))ecommunity_hash_free);
 	ecomhash = NULL;
 }
 
@@ -21,6 +21,7 @@
 #ifndef _QUAGGA_BGP_ECOMMUNITY_H
 #define _QUAGGA_BGP_ECOMMUNITY_H
 
+#include "lib/frrcu.h"
 #include "bgpd/bgp_route.h"
 #include "bgpd/bgpd.h"
 
@@ -78,7 +79,10 @@
 /* Extended Communities attribute.  */
 struct ecommunity {
 	/* Reference counter.  */
-	unsigned long refcnt;
+	_Atomic unsigned long refcnt;
+
+	/* Deferred free once released from its intern table */
+	struct rcu_head rcu_head;
 
 	/* Size of Extended Communities attribute.  */
 	int size;
@@ -62,6 +62,9 @@ struct as_filter {
 
 	regex_t *reg;
 	char *reg_str;
+
+	/* Same expression as a DFA, when bgp_regex_dfa_compile() took it */
+	struct bgp_regex_dfa *dfa;
 };
 
 /* AS path filter list. */
@@ -95,6 +98,8 @@ static void as_filter_free(struct as_filter *asfilter)
 {
 	if (asfilter->reg)
 		bgp_regex_free(asfilter->reg);
+	if (asfilter->dfa)
+		bgp_regex_dfa_free(asfilter->dfa);
 	XFREE(MTYPE_AS_FILTER_STR, asfilter->reg_str);
 	XFREE(MTYPE_AS_FILTER, asfilter);
 }
@@ -109,6 +114,7 @@ static struct as_filter *as_filter_make(regex_t *reg, const char *reg_str,
 	asfilter->reg = reg;
 	asfilter->type = type;
 	asfilter->reg_str = XSTRDUP(MTYPE_AS_FILTER_STR, reg_str);
+	asfilter->dfa = bgp_regex_dfa_compile(reg_str);
 
 	return asfilter;
 }
@@ -342,6 +348,8 @@ static void as_list_filter_delete(struct as_list *aslist,
 
 static int as_filter_match(struct as_filter *asfilter, struct aspath *aspath)
 {
+	if (asfilter->dfa)
+		return bgp_regex_dfa_aspath(asfilter->dfa, aspath);
 	if (bgp_regexec(asfilter->reg, aspath) != REG_NOMATCH)
 		return 1;
 	return 0;
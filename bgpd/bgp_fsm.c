@@ -54,6 +54,7 @@
 #include "bgpd/bgp_memory.h"
 #include "bgpd/bgp_keepalives.h"
 #include "bgpd/bgp_io.h"
+#include "bgpd/bgp_pipeline.h"
 #include "bgpd/bgp_zebra.h"
 
 DEFINE_HOOK(peer_backward_transition, (struct peer * peer), (peer))
@@ -122,6 +123,8 @@ static void peer_xfer_stats(struct peer *peer_dst, struct peer *peer_src)
 	peer_dst->notify_out += peer_src->notify_out;
 	peer_dst->dynamic_cap_in += peer_src->dynamic_cap_in;
 	peer_dst->dynamic_cap_out += peer_src->dynamic_cap_out;
+	peer_dst->write_calls += peer_src->write_calls;
+	peer_dst->write_bytes += peer_src->write_bytes;
 }
 
 static struct peer *peer_xfer_conn(struct peer *from_peer)
@@ -186,6 +189,7 @@ static struct peer *peer_xfer_conn(struct peer *from_peer)
 
 		stream_fifo_clean(peer->ibuf);
 		stream_fifo_clean(peer->obuf);
+		bgp_pipeline_flush(peer);
 
 		/*
 		 * this should never happen, since bgp_process_packet() is the
@@ -216,6 +220,9 @@ static struct peer *peer_xfer_conn(struct peer *from_peer)
 			stream_fifo_push(peer->ibuf,
 					 stream_fifo_pop(from_peer->ibuf));
 
+		// and whatever was still waiting for a parse pthread
+		bgp_pipeline_xfer(peer, from_peer);
+
 		ringbuf_wipe(peer->ibuf_work);
 		ringbuf_copy(peer->ibuf_work, from_peer->ibuf_work,
 			     ringbuf_remain(from_peer->ibuf_work));
@@ -272,6 +279,10 @@ static struct peer *peer_xfer_conn(struct peer *from_peer)
 		peer->orf_plist[afi][safi] = from_peer->orf_plist[afi][safi];
 	}
 
+	/* Once the capabilities have moved over as well */
+	bgp_pipeline_peer_state(peer);
+	bgp_pipeline_peer_state(from_peer);
+
 	if (bgp_getsockname(peer) < 0) {
 		flog_err(
 			EC_LIB_SOCKET,
@@ -1019,6 +1030,7 @@ void bgp_fsm_change_status(struct peer *peer, int status)
 	/* Preserve old status and change into new status. */
 	peer->ostatus = peer->status;
 	peer->status = status;
+	bgp_pipeline_peer_state(peer);
 
 	/* Save event that caused status change. */
 	peer->last_major_event = peer->cur_event;
@@ -1169,6 +1181,7 @@ int bgp_stop(struct peer *peer)
 			stream_fifo_clean(peer->ibuf);
 		if (peer->obuf)
 			stream_fifo_clean(peer->obuf);
+		bgp_pipeline_flush(peer);
 
 		if (peer->ibuf_work)
 			ringbuf_wipe(peer->ibuf_work);
@@ -38,6 +38,7 @@
 #include "bgpd/bgp_errors.h"	// for expanded error reference information
 #include "bgpd/bgp_fsm.h"	// for BGP_EVENT_ADD, bgp_event
 #include "bgpd/bgp_packet.h"	// for bgp_notify_send_with_data, bgp_notify...
+#include "bgpd/bgp_pipeline.h"	// for bgp_pipeline_schedule
 #include "bgpd/bgpd.h"		// for peer, BGP_MARKER_SIZE, bgp_master, bm
 /* clang-format on */
 
@@ -48,6 +49,13 @@ static int bgp_process_writes(struct thread *);
 static int bgp_process_reads(struct thread *);
 static bool validate_header(struct peer *);
 
+/* Most packets handed to the kernel in one write */
+#if defined(IOV_MAX) && IOV_MAX < BGP_WRITE_PACKET_MAX
+#define BGP_WRITE_IOV_MAX IOV_MAX
+#else
+#define BGP_WRITE_IOV_MAX BGP_WRITE_PACKET_MAX
+#endif
+
 /* generic i/o status codes */
 #define BGP_IO_TRANS_ERR (1 << 0) // EAGAIN or similar occurred
 #define BGP_IO_FATAL_ERR (1 << 1) // some kind of fatal TCP error
@@ -109,6 +117,7 @@ void bgp_reads_off(struct peer *peer)
 	assert(fpt->running);
 
 	thread_cancel_async(fpt->master, &peer->t_read, NULL);
+	bgp_pipeline_peer_off(peer);
 	THREAD_OFF(peer->t_process_packet);
 
 	UNSET_FLAG(peer->thread_flags, PEER_THREAD_READS_ON);
@@ -163,7 +172,8 @@ static int bgp_process_writes(struct thread *thread)
  * or has hung up.
  *
  * We read as much data as possible, process as many packets as we can and
- * place them on peer->ibuf for secondary processing by the main thread.
+ * place them on peer->ibuf for secondary processing by the main thread, or
+ * on peer->ibuf_parse for a parse pthread to decode first.
  */
 static int bgp_process_reads(struct thread *thread)
 {
@@ -233,8 +243,12 @@ static int bgp_process_reads(struct thread *thread)
 			assert(ringbuf_get(ibw, pktbuf, pktsize) == pktsize);
 			stream_put(pkt, pktbuf, pktsize);
 
+			/* with parse pthreads, they move it on to ->ibuf */
 			frr_with_mutex(&peer->io_mtx) {
-				stream_fifo_push(peer->ibuf, pkt);
+				stream_fifo_push(bm->parse_workers
+							 ? peer->ibuf_parse
+							 : peer->ibuf,
+						 pkt);
 			}
 
 			added_pkt = true;
@@ -251,7 +265,9 @@ static int bgp_process_reads(struct thread *thread)
 
 		thread_add_read(fpt->master, bgp_process_reads, peer, peer->fd,
 				&peer->t_read);
-		if (added_pkt)
+		if (added_pkt && bm->parse_workers)
+			bgp_pipeline_schedule(peer);
+		else if (added_pkt)
 			thread_add_timer_msec(bm->master, bgp_process_packet,
 					      peer, 0, &peer->t_process_packet);
 	}
@@ -266,7 +282,11 @@ static int bgp_process_reads(struct thread *thread)
  * The amount of packets written is equal to the minimum of peer->wpkt_quanta
  * and the number of packets on the output buffer, unless an error occurs.
  *
- * If write() returns an error, the appropriate FSM event is generated.
+ * Consecutive packets are handed to the kernel together with writev(),
+ * directly from their streams, so that a burst of small UPDATEs costs one
+ * system call rather than one each.
+ *
+ * If writev() returns an error, the appropriate FSM event is generated.
  *
  * The return value is equal to the number of packets written
  * (which may be zero).
@@ -275,7 +295,10 @@ static uint16_t bgp_write(struct peer *peer)
 {
 	uint8_t type;
 	struct stream *s;
-	int num;
+	struct iovec iov[BGP_WRITE_IOV_MAX];
+	unsigned int iovcnt;
+	ssize_t num;
+	size_t len;
 	int update_last_write = 0;
 	unsigned int count = 0;
 	uint32_t uo = 0;
@@ -285,76 +308,112 @@ static uint16_t bgp_write(struct peer *peer)
 	wpkt_quanta_old = atomic_load_explicit(&peer->bgp->wpkt_quanta,
 					       memory_order_relaxed);
 
-	while (count < wpkt_quanta_old && (s = stream_fifo_head(peer->obuf))) {
-		int writenum;
-		do {
-			writenum = stream_get_endp(s) - stream_get_getp(s);
-			num = write(peer->fd, stream_pnt(s), writenum);
+	while (count < wpkt_quanta_old && stream_fifo_head(peer->obuf)) {
+		/*
+		 * Gather the queued packets, up to the quanta. Nothing may
+		 * follow a NOTIFY, so stop there.
+		 */
+		iovcnt = 0;
+		for (s = stream_fifo_head(peer->obuf);
+		     s && iovcnt < BGP_WRITE_IOV_MAX
+		     && count + iovcnt < wpkt_quanta_old;
+		     s = s->next) {
+			iov[iovcnt].iov_base = stream_pnt(s);
+			iov[iovcnt].iov_len =
+				stream_get_endp(s) - stream_get_getp(s);
+			iovcnt++;
+
+			if (stream_getc_from(s, BGP_MARKER_SIZE + 2)
+			    == BGP_MSG_NOTIFY)
+				break;
+		}
 
-			if (num < 0) {
-				if (!ERRNO_IO_RETRY(errno)) {
-					BGP_EVENT_ADD(peer, TCP_fatal_error);
-					SET_FLAG(status, BGP_IO_FATAL_ERR);
-				} else {
-					SET_FLAG(status, BGP_IO_TRANS_ERR);
-				}
+		num = writev(peer->fd, iov, iovcnt);
 
-				goto done;
-			} else if (num != writenum)
-				stream_forward_getp(s, num);
+		if (num < 0) {
+			if (!ERRNO_IO_RETRY(errno)) {
+				BGP_EVENT_ADD(peer, TCP_fatal_error);
+				SET_FLAG(status, BGP_IO_FATAL_ERR);
+			} else {
+				SET_FLAG(status, BGP_IO_TRANS_ERR);
+			}
 
-		} while (num != writenum);
+			goto done;
+		}
 
-		/* Retrieve BGP packet type. */
-		stream_set_getp(s, BGP_MARKER_SIZE + 2);
-		type = stream_getc(s);
+		atomic_fetch_add_explicit(&peer->write_calls, 1,
+					  memory_order_relaxed);
+		atomic_fetch_add_explicit(&peer->write_bytes, num,
+					  memory_order_relaxed);
 
-		switch (type) {
-		case BGP_MSG_OPEN:
-			atomic_fetch_add_explicit(&peer->open_out, 1,
-						  memory_order_relaxed);
-			break;
-		case BGP_MSG_UPDATE:
-			atomic_fetch_add_explicit(&peer->update_out, 1,
-						  memory_order_relaxed);
-			uo++;
-			break;
-		case BGP_MSG_NOTIFY:
-			atomic_fetch_add_explicit(&peer->notify_out, 1,
-						  memory_order_relaxed);
-			/* Double start timer. */
-			peer->v_start *= 2;
-
-			/* Overflow check. */
-			if (peer->v_start >= (60 * 2))
-				peer->v_start = (60 * 2);
-
-			/*
-			 * Handle Graceful Restart case where the state changes
-			 * to Connect instead of Idle.
-			 */
-			BGP_EVENT_ADD(peer, BGP_Stop);
-			goto done;
+		/*
+		 * Retire the packets that were written completely; a packet
+		 * that was written in part stays at the head of the queue,
+		 * and the rest of it goes out next time around.
+		 */
+		while (num > 0) {
+			s = stream_fifo_head(peer->obuf);
+			len = stream_get_endp(s) - stream_get_getp(s);
 
-		case BGP_MSG_KEEPALIVE:
-			atomic_fetch_add_explicit(&peer->keepalive_out, 1,
-						  memory_order_relaxed);
-			break;
-		case BGP_MSG_ROUTE_REFRESH_NEW:
-		case BGP_MSG_ROUTE_REFRESH_OLD:
-			atomic_fetch_add_explicit(&peer->refresh_out, 1,
-						  memory_order_relaxed);
-			break;
-		case BGP_MSG_CAPABILITY:
-			atomic_fetch_add_explicit(&peer->dynamic_cap_out, 1,
-						  memory_order_relaxed);
-			break;
-		}
+			if ((size_t)num < len) {
+				stream_forward_getp(s, num);
+				break;
+			}
+
+			num -= len;
+
+			/* Retrieve BGP packet type. */
+			type = stream_getc_from(s, BGP_MARKER_SIZE + 2);
+
+			switch (type) {
+			case BGP_MSG_OPEN:
+				atomic_fetch_add_explicit(&peer->open_out, 1,
+							  memory_order_relaxed);
+				break;
+			case BGP_MSG_UPDATE:
+				atomic_fetch_add_explicit(&peer->update_out, 1,
+							  memory_order_relaxed);
+				uo++;
+				break;
+			case BGP_MSG_NOTIFY:
+				atomic_fetch_add_explicit(&peer->notify_out, 1,
+							  memory_order_relaxed);
+				/* Double start timer. */
+				peer->v_start *= 2;
+
+				/* Overflow check. */
+				if (peer->v_start >= (60 * 2))
+					peer->v_start = (60 * 2);
+
+				/*
+				 * Handle Graceful Restart case where the state
+				 * changes to Connect instead of Idle.
+				 */
+				BGP_EVENT_ADD(peer, BGP_Stop);
+				goto done;
 
-		count++;
+			case BGP_MSG_KEEPALIVE:
+				atomic_fetch_add_explicit(&peer->keepalive_out,
+							  1,
+							  memory_order_relaxed);
+				break;
+			case BGP_MSG_ROUTE_REFRESH_NEW:
+			case BGP_MSG_ROUTE_REFRESH_OLD:
+				atomic_fetch_add_explicit(&peer->refresh_out, 1,
+							  memory_order_relaxed);
+				break;
+			case BGP_MSG_CAPABILITY:
+				atomic_fetch_add_explicit(
+					&peer->dynamic_cap_out, 1,
+					memory_order_relaxed);
+				break;
+			}
+
+			count++;
 
-		stream_free(stream_fifo_pop(peer->obuf));
-		update_last_write = 1;
+			stream_free(stream_fifo_pop(peer->obuf));
+			update_last_write = 1;
+		}
 	}
 
 done : {
@@ -21,6 +21,7 @@
 #include <zebra.h>
 
 #include "hash.h"
+#include "chash.h"
 #include "memory.h"
 #include "prefix.h"
 #include "command.h"
@@ -33,7 +34,7 @@
 #include "bgpd/bgp_aspath.h"
 
 /* Hash of community attribute. */
-static struct hash *lcomhash;
+static struct chash *lcomhash;
 
 /* Allocate a new lcommunities.  */
 static struct lcommunity *lcommunity_new(void)
@@ -247,6 +248,17 @@ static void set_lcommunity_string(struct lcommunity *lcom, bool make_json)
 	lcom->str = str_buf;
 }
 
+/* Make the string before the entry becomes visible to other pthreads. */
+static void *lcommunity_hash_alloc(void *arg)
+{
+	struct lcommunity *lcom = arg;
+
+	if (!lcom->str)
+		set_lcommunity_string(lcom, false);
+
+	return lcom;
+}
+
 /* Intern Large Communities Attribute.  */
 struct lcommunity *lcommunity_intern(struct lcommunity *lcom)
 {
@@ -254,34 +266,21 @@ struct lcommunity *lcommunity_intern(struct lcommunity *lcom)
 
 	assert(lcom->refcnt == 0);
 
-	find = (struct lcommunity *)hash_get(lcomhash, lcom, hash_alloc_intern);
+	find = chash_intern(lcomhash, lcom, lcommunity_hash_alloc);
 
 	if (find != lcom)
 		lcommunity_free(&lcom);
 
-	find->refcnt++;
-
-	if (!find->str)
-		set_lcommunity_string(find, false);
-
 	return find;
 }
 
 /* Unintern Large Communities Attribute.  */
 void lcommunity_unintern(struct lcommunity **lcom)
 {
-	struct lcommunity *ret;
-
-	if ((*lcom)->refcnt)
-		(*lcom)->refcnt--;
-
-	/* Pull off from hash.  */
-	if ((*lcom)->refcnt == 0) {
-		/* Large community must be in the hash.  */
-		ret = (struct lcommunity *)hash_release(lcomhash, *lcom);
-		assert(ret != NULL);
-
-		lcommunity_free(lcom);
+	/* Pull off from hash; other pthreads may still be looking at it.  */
+	if (chash_release(lcomhash, *lcom)) {
+		rcu_call(lcommunity_hash_free, *lcom, rcu_head);
+		*lcom = NULL;
 	}
 }
 
@@ -326,7 +325,7 @@ bool lcommunity_cmp(const void *arg1, const void *arg2)
 }
 
 /* Return communities hash.  */
-struct hash *lcommunity_hash(void)
+struct chash *lcommunity_hash(void)
 {
 	return lcomhash;
 }
@@ -334,14 +333,14 @@ struct hash *lcommunity_hash(void)
 /* Initialize Large Comminities related hash. */
 void lcommunity_init(void)
 {
-	lcomhash = hash_create(lcommunity_hash_make, lcommunity_cmp,
-			       "BGP lcommunity hash");
+	lcomhash = chash_create(lcommunity_hash_make, lcommunity_cmp,
+				offsetof(struct lcommunity, refcnt),
+				"BGP lcommunity hash");
 }
 
 void lcommunity_finish(void)
 {
-	hash_clean(lcomhash, (void (*)(void *))lcommunity_hash_free);
-	hash_free(lcomhash);
+	chash_free(lcomhash, (void (*)(void *))lcommunity_hash_free);
 	lcomhash = NULL;
 }
 
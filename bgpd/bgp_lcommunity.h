@@ -21,6 +21,7 @@
 #ifndef _QUAGGA_BGP_LCOMMUNITY_H
 #define _QUAGGA_BGP_LCOMMUNITY_H
 
+#include "lib/chash.h"
 #include "lib/json.h"
 #include "bgpd/bgp_route.h"
 
@@ -30,7 +31,10 @@
 /* Large Communities attribute.  */
 struct lcommunity {
 	/* Reference counter.  */
-	unsigned long refcnt;
+	_Atomic unsigned long refcnt;
+
+	/* Deferred free once released from its intern table */
+	struct rcu_head rcu_head;
 
 	/* Size of Extended Communities attribute.  */
 	int size;
@@ -64,7 +68,7 @@ extern struct lcommunity *lcommunity_intern(struct lcommunity *);
 extern bool lcommunity_cmp(const void *arg1, const void *arg2);
 extern void lcommunity_unintern(struct lcommunity **);
 extern unsigned int lcommunity_hash_make(const void *);
-extern struct hash *lcommunity_hash(void);
+extern struct chash *lcommunity_hash(void);
 extern struct lcommunity *lcommunity_str2com(const char *);
 extern int lcommunity_match(const struct lcommunity *,
 			    const struct lcommunity *);
@@ -75,6 +75,8 @@ static const struct option longopts[] = {
 	{"ecmp", required_argument, NULL, 'e'},
 	{"int_num", required_argument, NULL, 'I'},
 	{"no_zebra", no_argument, NULL, 'Z'},
+	{"parse_workers", required_argument, NULL, 'W'},
+	{"bestpath_workers", required_argument, NULL, 'B'},
 	{0}};
 
 /* signal definitions */
@@ -386,17 +388,21 @@ int main(int argc, char **argv)
 	int no_zebra_flag = 0;
 	int skip_runas = 0;
 	int instance = 0;
+	int parse_workers = 0;
+	int bestpath_workers = 0;
 
 	frr_preinit(&bgpd_di, argc, argv);
 	frr_opt_add(
-		"p:l:SnZe:I:" DEPRECATED_OPTIONS, longopts,
+		"p:l:SnZe:I:W:B:" DEPRECATED_OPTIONS, longopts,
 		"  -p, --bgp_port     Set BGP listen port number (0 means do not listen).\n"
 		"  -l, --listenon     Listen on specified address (implies -n)\n"
 		"  -n, --no_kernel    Do not install route to kernel.\n"
 		"  -Z, --no_zebra     Do not communicate with Zebra.\n"
 		"  -S, --skip_runas   Skip capabilities checks, and changing user and group IDs.\n"
 		"  -e, --ecmp         Specify ECMP to use.\n"
-		"  -I, --int_num      Set instance number (label-manager)\n");
+		"  -I, --int_num      Set instance number (label-manager)\n"
+		"  -W, --parse_workers Number of pthreads decoding received UPDATEs\n"
+		"  -B, --bestpath_workers Number of pthreads running best-path selection and UPDATE encoding\n");
 
 	/* Command line argument treatment. */
 	while (1) {
@@ -452,6 +458,26 @@ int main(int argc, char **argv)
 				zlog_err("Instance %i out of range (0..%u)",
 					 instance, (unsigned short)-1);
 			break;
+		case 'W':
+			parse_workers = atoi(optarg);
+			if (parse_workers < 0
+			    || parse_workers > BGP_PARSE_WORKERS_MAX) {
+				zlog_err(
+					"Parse workers %i out of range (0..%u)",
+					parse_workers, BGP_PARSE_WORKERS_MAX);
+				return 1;
+			}
+			break;
+		case 'B':
+			bestpath_workers = atoi(optarg);
+			if (bestpath_workers < 0
+			    || bestpath_workers > BGP_BESTPATH_WORKERS_MAX) {
+				zlog_err(
+					"Bestpath workers %i out of range (0..%u)",
+					bestpath_workers, BGP_BESTPATH_WORKERS_MAX);
+				return 1;
+			}
+			break;
 		default:
 			frr_help_exit(1);
 			break;
@@ -470,6 +496,8 @@ int main(int argc, char **argv)
 		bgp_option_set(BGP_OPT_NO_FIB);
 	if (no_zebra_flag)
 		bgp_option_set(BGP_OPT_NO_ZEBRA);
+	bm->parse_workers = parse_workers;
+	bm->bestpath_workers = bestpath_workers;
 	bgp_error_init();
 	/* Initializations. */
 	bgp_vrf_init();
@@ -41,8 +41,10 @@ DEFINE_MTYPE(BGPD, PEER_PASSWORD, "Peer password string")
 DEFINE_MTYPE(BGPD, BGP_PEER_AF, "BGP peer af")
 DEFINE_MTYPE(BGPD, BGP_UPDGRP, "BGP update group")
 DEFINE_MTYPE(BGPD, BGP_UPD_SUBGRP, "BGP update subgroup")
+DEFINE_MTYPE(BGPD, BGP_UPD_BUILD, "BGP update build batch")
 DEFINE_MTYPE(BGPD, BGP_PACKET, "BGP packet")
 DEFINE_MTYPE(BGPD, ATTR, "BGP attribute")
+DEFINE_MTYPE(BGPD, ATTR_IDS, "BGP attribute IDs")
 DEFINE_MTYPE(BGPD, AS_PATH, "BGP aspath")
 DEFINE_MTYPE(BGPD, AS_SEG, "BGP aspath seg")
 DEFINE_MTYPE(BGPD, AS_SEG_DATA, "BGP aspath segment data")
@@ -52,6 +54,7 @@ DEFINE_MTYPE(BGPD, BGP_TABLE, "BGP table")
 DEFINE_MTYPE(BGPD, BGP_NODE, "BGP node")
 DEFINE_MTYPE(BGPD, BGP_ROUTE, "BGP route")
 DEFINE_MTYPE(BGPD, BGP_ROUTE_EXTRA, "BGP ancillary route info")
+DEFINE_MTYPE(BGPD, BGP_ROUTE_CHUNK, "BGP route arena")
 DEFINE_MTYPE(BGPD, BGP_CONN, "BGP connected")
 DEFINE_MTYPE(BGPD, BGP_STATIC, "BGP static")
 DEFINE_MTYPE(BGPD, BGP_ADVERTISE_ATTR, "BGP adv attr")
@@ -59,6 +62,7 @@ DEFINE_MTYPE(BGPD, BGP_ADVERTISE, "BGP adv")
 DEFINE_MTYPE(BGPD, BGP_SYNCHRONISE, "BGP synchronise")
 DEFINE_MTYPE(BGPD, BGP_ADJ_IN, "BGP adj in")
 DEFINE_MTYPE(BGPD, BGP_ADJ_OUT, "BGP adj out")
+DEFINE_MTYPE(BGPD, BGP_ADJ_OUT_BITS, "BGP compact adj out")
 DEFINE_MTYPE(BGPD, BGP_MPATH_INFO, "BGP multipath info")
 
 DEFINE_MTYPE(BGPD, AS_LIST, "BGP AS list")
@@ -83,6 +87,7 @@ DEFINE_MTYPE(BGPD, CLUSTER, "Cluster list")
 DEFINE_MTYPE(BGPD, CLUSTER_VAL, "Cluster list val")
 
 DEFINE_MTYPE(BGPD, BGP_PROCESS_QUEUE, "BGP Process queue")
+DEFINE_MTYPE(BGPD, BGP_BESTPATH_BATCH, "BGP best-path batch")
 DEFINE_MTYPE(BGPD, BGP_CLEAR_NODE_QUEUE, "BGP node clear queue")
 
 DEFINE_MTYPE(BGPD, TRANSIT, "BGP transit attr")
@@ -98,6 +103,7 @@ DEFINE_MTYPE(BGPD, PEER_UPDATE_SOURCE, "BGP peer update interface")
 DEFINE_MTYPE(BGPD, PEER_CONF_IF, "BGP peer config interface")
 DEFINE_MTYPE(BGPD, BGP_DAMP_INFO, "Dampening info")
 DEFINE_MTYPE(BGPD, BGP_DAMP_ARRAY, "BGP Dampening array")
+DEFINE_MTYPE(BGPD, BGP_DAMP_CONFIG, "BGP Dampening parameters")
 DEFINE_MTYPE(BGPD, BGP_REGEXP, "BGP regexp")
 DEFINE_MTYPE(BGPD, BGP_AGGREGATE, "BGP aggregate")
 DEFINE_MTYPE(BGPD, BGP_ADDR, "BGP own address")
@@ -128,3 +134,10 @@ DEFINE_MTYPE(BGPD, BGP_FLOWSPEC_RULE_STR, "BGP flowspec rule str")
 DEFINE_MTYPE(BGPD, BGP_FLOWSPEC_COMPILED, "BGP flowspec compiled")
 DEFINE_MTYPE(BGPD, BGP_FLOWSPEC_NAME, "BGP flowspec name")
 DEFINE_MTYPE(BGPD, BGP_FLOWSPEC_INDEX, "BGP flowspec index")
+
+DEFINE_MTYPE(BGPD, BGP_NLRI_DECODED, "BGP decoded NLRI prefixes")
+DEFINE_MTYPE(BGPD, BGP_UPDATE_DECODED, "BGP decoded UPDATE")
+
+DEFINE_MTYPE(BGPD, BGP_RMAP_CACHE, "BGP route-map result cache")
+
+DEFINE_MTYPE(BGPD, BGP_SHOW_WALK, "BGP show table walk")
@@ -37,8 +37,10 @@ DECLARE_MTYPE(PEER_PASSWORD)
 DECLARE_MTYPE(BGP_PEER_AF)
 DECLARE_MTYPE(BGP_UPDGRP)
 DECLARE_MTYPE(BGP_UPD_SUBGRP)
+DECLARE_MTYPE(BGP_UPD_BUILD)
 DECLARE_MTYPE(BGP_PACKET)
 DECLARE_MTYPE(ATTR)
+DECLARE_MTYPE(ATTR_IDS)
 DECLARE_MTYPE(AS_PATH)
 DECLARE_MTYPE(AS_SEG)
 DECLARE_MTYPE(AS_SEG_DATA)
@@ -48,6 +50,7 @@ DECLARE_MTYPE(BGP_TABLE)
 DECLARE_MTYPE(BGP_NODE)
 DECLARE_MTYPE(BGP_ROUTE)
 DECLARE_MTYPE(BGP_ROUTE_EXTRA)
+DECLARE_MTYPE(BGP_ROUTE_CHUNK)
 DECLARE_MTYPE(BGP_CONN)
 DECLARE_MTYPE(BGP_STATIC)
 DECLARE_MTYPE(BGP_ADVERTISE_ATTR)
@@ -55,6 +58,7 @@ DECLARE_MTYPE(BGP_ADVERTISE)
 DECLARE_MTYPE(BGP_SYNCHRONISE)
 DECLARE_MTYPE(BGP_ADJ_IN)
 DECLARE_MTYPE(BGP_ADJ_OUT)
+DECLARE_MTYPE(BGP_ADJ_OUT_BITS)
 DECLARE_MTYPE(BGP_MPATH_INFO)
 
 DECLARE_MTYPE(AS_LIST)
@@ -79,6 +83,7 @@ DECLARE_MTYPE(CLUSTER)
 DECLARE_MTYPE(CLUSTER_VAL)
 
 DECLARE_MTYPE(BGP_PROCESS_QUEUE)
+DECLARE_MTYPE(BGP_BESTPATH_BATCH)
 DECLARE_MTYPE(BGP_CLEAR_NODE_QUEUE)
 
 DECLARE_MTYPE(TRANSIT)
@@ -94,6 +99,7 @@ DECLARE_MTYPE(PEER_UPDATE_SOURCE)
 DECLARE_MTYPE(PEER_CONF_IF)
 DECLARE_MTYPE(BGP_DAMP_INFO)
 DECLARE_MTYPE(BGP_DAMP_ARRAY)
+DECLARE_MTYPE(BGP_DAMP_CONFIG)
 DECLARE_MTYPE(BGP_REGEXP)
 DECLARE_MTYPE(BGP_AGGREGATE)
 DECLARE_MTYPE(BGP_ADDR)
@@ -126,4 +132,11 @@ DECLARE_MTYPE(BGP_FLOWSPEC_COMPILED)
 DECLARE_MTYPE(BGP_FLOWSPEC_NAME)
 DECLARE_MTYPE(BGP_FLOWSPEC_INDEX)
 
+DECLARE_MTYPE(BGP_NLRI_DECODED)
+DECLARE_MTYPE(BGP_UPDATE_DECODED)
+
+DECLARE_MTYPE(BGP_RMAP_CACHE)
+
+DECLARE_MTYPE(BGP_SHOW_WALK)
+
 #endif /* _QUAGGA_BGP_MEMORY_H */
@@ -70,6 +70,7 @@ struct bgp_nexthop_cache *bnc_new(void)
 
 void bnc_free(struct bgp_nexthop_cache *bnc)
 {
+	bgp_nht_bnc_cancel(bnc);
 	bnc_nexthop_free(bnc);
 	XFREE(MTYPE_BGP_NEXTHOP_CACHE, bnc);
 }
@@ -720,6 +721,11 @@ static void bgp_show_nexthops(struct vty *vty, struct bgp *bgp, int detail,
 			}
 			tbuf = time(NULL) - (bgp_clock() - bnc->last_update);
 			vty_out(vty, "  Last update: %s", ctime(&tbuf));
+			if (bnc->evaluated)
+				vty_out(vty,
+					"  Best-path re-run for %u of %u paths%s\n",
+					bnc->reprocessed, bnc->evaluated,
+					bnc->t_evaluate ? " so far" : "");
 			vty_out(vty, "\n");
 		}
 	}
@@ -24,6 +24,7 @@
 #include "if.h"
 #include "queue.h"
 #include "prefix.h"
+#include "typesafe.h"
 
 #define NEXTHOP_FAMILY(nexthop_len)                                            \
 	(((nexthop_len) == 4 || (nexthop_len) == 12                            \
@@ -36,6 +37,8 @@
 
 #define BGP_MP_NEXTHOP_FAMILY NEXTHOP_FAMILY
 
+PREDECL_DLIST(bgp_nht_reg)
+
 /* BGP nexthop cache value structure. */
 struct bgp_nexthop_cache {
 	/* IGP route's metric. */
@@ -54,6 +57,7 @@ struct bgp_nexthop_cache {
 #define BGP_STATIC_ROUTE              (1 << 4)
 #define BGP_STATIC_ROUTE_EXACT_MATCH  (1 << 5)
 #define BGP_NEXTHOP_LABELED_VALID     (1 << 6)
+#define BGP_NEXTHOP_REGISTER_PENDING  (1 << 7)
 
 	uint16_t change_flags;
 
@@ -66,6 +70,19 @@ struct bgp_nexthop_cache {
 	LIST_HEAD(path_list, bgp_path_info) paths;
 	unsigned int path_count;
 	struct bgp *bgp;
+
+	/* Queued for the next bundled registration with zebra */
+	struct bgp_nht_reg_item reg_item;
+
+	/* Paths still to be looked at after an update, see evaluate_paths() */
+	struct thread *t_evaluate;
+	struct bgp_path_info *evaluate_next;
+	unsigned int evaluate_left;
+	uint16_t evaluate_flags;
+
+	/* How the last update's evaluation went */
+	unsigned int evaluated;
+	unsigned int reprocessed;
 };
 
 /* Own tunnel-ip address structure */
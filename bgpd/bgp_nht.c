@@ -578,30 +578,20 @@ static int make_prefix(int afi, struct bgp_path_info *pi, struct prefix *p)
 	return 0;
 }
 
-/**
- * sendmsg_zebra_rnh -- Format and send a nexthop register/Unregister
- *   command to Zebra.
- * ARGUMENTS:
- *   struct bgp_nexthop_cache *bnc -- the nexthop structure.
- *   int command -- command to send to zebra
- * RETURNS:
- *   void.
+/* Whether zebra knows about bnc's instance, so that (un)registering makes
+ * sense at all.
  */
-static void sendmsg_zebra_rnh(struct bgp_nexthop_cache *bnc, int command)
+static bool bgp_nht_zebra_ready(struct bgp_nexthop_cache *bnc)
 {
-	struct prefix *p;
-	bool exact_match = false;
-	int ret;
-
 	if (!zclient)
-		return;
+		return false;
 
 	/* Don't try to register if Zebra doesn't know of this instance. */
 	if (!IS_BGP_INST_KNOWN_TO_ZEBRA(bnc->bgp)) {
 		if (BGP_DEBUG(zebra, ZEBRA))
 			zlog_debug("%s: No zebra instance to talk to, not installing NHT entry",
 				   __PRETTY_FUNCTION__);
-		return;
+		return false;
 	}
 
 	if (!bgp_zebra_num_connects()) {
@@ -609,23 +599,47 @@ static void sendmsg_zebra_rnh(struct bgp_nexthop_cache *bnc, int command)
 			zlog_debug("%s: We have not connected yet, cannot send nexthops",
 				   __PRETTY_FUNCTION__);
 	}
-	p = &(bnc->node->p);
-	if ((command == ZEBRA_NEXTHOP_REGISTER
-	     || command == ZEBRA_IMPORT_ROUTE_REGISTER)
-	    && (CHECK_FLAG(bnc->flags, BGP_NEXTHOP_CONNECTED)
-		|| CHECK_FLAG(bnc->flags, BGP_STATIC_ROUTE_EXACT_MATCH)))
-		exact_match = true;
+	return true;
+}
 
-	if (BGP_DEBUG(zebra, ZEBRA)) {
-		char buf[PREFIX2STR_BUFFER];
+static bool bgp_nht_exact_match(struct bgp_nexthop_cache *bnc, int command)
+{
+	return (command == ZEBRA_NEXTHOP_REGISTER
+		|| command == ZEBRA_IMPORT_ROUTE_REGISTER)
+	       && (CHECK_FLAG(bnc->flags, BGP_NEXTHOP_CONNECTED)
+		   || CHECK_FLAG(bnc->flags, BGP_STATIC_ROUTE_EXACT_MATCH));
+}
 
-		prefix2str(p, buf, PREFIX2STR_BUFFER);
-		zlog_debug("%s: sending cmd %s for %s (vrf %s)",
-			__func__, zserv_command_string(command), buf,
-			bnc->bgp->name);
-	}
+static void bgp_nht_debug_send(struct bgp_nexthop_cache *bnc, int command)
+{
+	char buf[PREFIX2STR_BUFFER];
+
+	prefix2str(&bnc->node->p, buf, PREFIX2STR_BUFFER);
+	zlog_debug("%s: sending cmd %s for %s (vrf %s)", __func__,
+		   zserv_command_string(command), buf, bnc->bgp->name);
+}
+
+/**
+ * sendmsg_zebra_rnh -- Format and send a nexthop register/Unregister
+ *   command to Zebra.
+ * ARGUMENTS:
+ *   struct bgp_nexthop_cache *bnc -- the nexthop structure.
+ *   int command -- command to send to zebra
+ * RETURNS:
+ *   void.
+ */
+static void sendmsg_zebra_rnh(struct bgp_nexthop_cache *bnc, int command)
+{
+	int ret;
+
+	if (!bgp_nht_zebra_ready(bnc))
+		return;
 
-	ret = zclient_send_rnh(zclient, command, p, exact_match,
+	if (BGP_DEBUG(zebra, ZEBRA))
+		bgp_nht_debug_send(bnc, command);
+
+	ret = zclient_send_rnh(zclient, command, &bnc->node->p,
+			       bgp_nht_exact_match(bnc, command),
 			       bnc->bgp->vrf_id);
 	/* TBD: handle the failure */
 	if (ret < 0)
@@ -641,6 +655,84 @@ static void sendmsg_zebra_rnh(struct bgp_nexthop_cache *bnc, int command)
 	return;
 }
 
+/*
+ * Registrations are not sent right away but queued up and flushed from an
+ * event, packing everything for the same instance and command into one
+ * message.  A table load or a session coming up registers its nexthops one
+ * path at a time; this turns those into a handful of messages.
+ */
+DECLARE_DLIST(bgp_nht_reg, struct bgp_nexthop_cache, reg_item)
+
+static struct bgp_nht_reg_head bgp_nht_reg_pending =
+	INIT_DLIST(bgp_nht_reg_pending);
+static struct thread *t_bgp_nht_reg;
+
+static int bgp_nht_reg_command(struct bgp_nexthop_cache *bnc)
+{
+	return CHECK_FLAG(bnc->flags, BGP_STATIC_ROUTE)
+		       ? ZEBRA_IMPORT_ROUTE_REGISTER
+		       : ZEBRA_NEXTHOP_REGISTER;
+}
+
+static int bgp_nht_reg_flush(struct thread *t)
+{
+	struct bgp_nexthop_cache *first, *bnc;
+	unsigned int count;
+	vrf_id_t vrf_id;
+	int command;
+
+	while ((first = bgp_nht_reg_pop(&bgp_nht_reg_pending))) {
+		UNSET_FLAG(first->flags, BGP_NEXTHOP_REGISTER_PENDING);
+		if (!bgp_nht_zebra_ready(first))
+			continue;
+
+		command = bgp_nht_reg_command(first);
+		vrf_id = first->bgp->vrf_id;
+
+		zclient_rnh_start(zclient, command, vrf_id);
+		bnc = first;
+		count = 0;
+		do {
+			if (BGP_DEBUG(zebra, ZEBRA))
+				bgp_nht_debug_send(bnc, command);
+			zclient_rnh_add(zclient, &bnc->node->p,
+					bgp_nht_exact_match(bnc, command));
+			SET_FLAG(bnc->flags, BGP_NEXTHOP_REGISTERED);
+			count++;
+
+			/* pick up the others going into this message */
+			frr_each_safe (bgp_nht_reg, &bgp_nht_reg_pending,
+				       bnc) {
+				if (bnc->bgp->vrf_id != vrf_id
+				    || bgp_nht_reg_command(bnc) != command
+				    || !IS_BGP_INST_KNOWN_TO_ZEBRA(bnc->bgp))
+					continue;
+				bgp_nht_reg_del(&bgp_nht_reg_pending, bnc);
+				UNSET_FLAG(bnc->flags,
+					   BGP_NEXTHOP_REGISTER_PENDING);
+				break;
+			}
+		} while (bnc && STREAM_WRITEABLE(zclient->obuf)
+				       >= 4 + IPV6_MAX_BYTELEN);
+
+		/* no room left for the one just taken, it goes first next */
+		if (bnc) {
+			bgp_nht_reg_add_head(&bgp_nht_reg_pending, bnc);
+			SET_FLAG(bnc->flags, BGP_NEXTHOP_REGISTER_PENDING);
+		}
+
+		if (BGP_DEBUG(nht, NHT))
+			zlog_debug("%s: %u nexthops in one %s (vrf %u)",
+				   __func__, count,
+				   zserv_command_string(command), vrf_id);
+
+		if (zclient_rnh_send(zclient) < 0)
+			flog_warn(EC_BGP_ZEBRA_SEND,
+				  "sendmsg_nexthop: zclient_send_message() failed");
+	}
+	return 0;
+}
+
 /**
  * register_zebra_rnh - register a NH/route with Zebra for notification
  *    when the route or the route to the nexthop changes.
@@ -653,12 +745,18 @@ static void register_zebra_rnh(struct bgp_nexthop_cache *bnc,
 			       int is_bgp_import_route)
 {
 	/* Check if we have already registered */
-	if (bnc->flags & BGP_NEXTHOP_REGISTERED)
+	if (CHECK_FLAG(bnc->flags, BGP_NEXTHOP_REGISTERED
+					   | BGP_NEXTHOP_REGISTER_PENDING))
 		return;
-	if (is_bgp_import_route)
-		sendmsg_zebra_rnh(bnc, ZEBRA_IMPORT_ROUTE_REGISTER);
-	else
-		sendmsg_zebra_rnh(bnc, ZEBRA_NEXTHOP_REGISTER);
+
+	/* the command is picked at flush time from BGP_STATIC_ROUTE */
+	assert(!is_bgp_import_route
+	       || CHECK_FLAG(bnc->flags, BGP_STATIC_ROUTE));
+
+	SET_FLAG(bnc->flags, BGP_NEXTHOP_REGISTER_PENDING);
+	bgp_nht_reg_add_tail(&bgp_nht_reg_pending, bnc);
+	thread_add_event(bm->master, bgp_nht_reg_flush, NULL, 0,
+			 &t_bgp_nht_reg);
 }
 
 /**
@@ -671,6 +769,12 @@ static void register_zebra_rnh(struct bgp_nexthop_cache *bnc,
 static void unregister_zebra_rnh(struct bgp_nexthop_cache *bnc,
 				 int is_bgp_import_route)
 {
+	/* Not sent yet, nothing to take back */
+	if (CHECK_FLAG(bnc->flags, BGP_NEXTHOP_REGISTER_PENDING)) {
+		bgp_nht_reg_del(&bgp_nht_reg_pending, bnc);
+		UNSET_FLAG(bnc->flags, BGP_NEXTHOP_REGISTER_PENDING);
+	}
+
 	/* Check if we have already registered */
 	if (!CHECK_FLAG(bnc->flags, BGP_NEXTHOP_REGISTERED))
 		return;
@@ -681,112 +785,245 @@ static void unregister_zebra_rnh(struct bgp_nexthop_cache *bnc,
 		sendmsg_zebra_rnh(bnc, ZEBRA_NEXTHOP_UNREGISTER);
 }
 
-/**
- * evaluate_paths - Evaluate the paths/nets associated with a nexthop.
- * ARGUMENTS:
- *   struct bgp_nexthop_cache *bnc -- the nexthop structure.
- * RETURNS:
- *   void.
+void bgp_nht_bnc_cancel(struct bgp_nexthop_cache *bnc)
+{
+	if (CHECK_FLAG(bnc->flags, BGP_NEXTHOP_REGISTER_PENDING)) {
+		bgp_nht_reg_del(&bgp_nht_reg_pending, bnc);
+		UNSET_FLAG(bnc->flags, BGP_NEXTHOP_REGISTER_PENDING);
+	}
+	THREAD_OFF(bnc->t_evaluate);
+	bnc->evaluate_next = NULL;
+	bnc->evaluate_left = 0;
+}
+
+/*
+ * Whether the dest of path needs best-path run again after an update to
+ * its nexthop.  Paths whose validity flips always do.  A selected or
+ * multipath path does whenever the metric or the resolving nexthops
+ * changed, for the install into zebra if nothing else.  Other paths only
+ * matter when their metric improved, as a worse metric cannot make a
+ * losing path win; with more than two paths on the dest that does not
+ * hold for the order dependent pairwise comparison, so those are redone
+ * regardless.
  */
-static void evaluate_paths(struct bgp_nexthop_cache *bnc)
+static bool bgp_nht_path_affected(struct bgp_path_info *path,
+				  uint16_t change_flags, bool valid_changed,
+				  uint32_t old_metric, uint32_t new_metric)
+{
+	struct bgp_path_info *pi;
+	unsigned int count = 0;
+	bool selected = false;
+
+	if (valid_changed)
+		return true;
+	if (!CHECK_FLAG(path->flags, BGP_PATH_VALID))
+		return false;
+
+	if (CHECK_FLAG(path->flags, BGP_PATH_SELECTED | BGP_PATH_MULTIPATH))
+		return old_metric != new_metric
+		       || CHECK_FLAG(change_flags,
+				     BGP_NEXTHOP_CHANGED
+					     | BGP_NEXTHOP_METRIC_CHANGED);
+
+	if (old_metric == new_metric)
+		return false;
+	if (new_metric < old_metric)
+		return true;
+
+	for (pi = bgp_node_get_bgp_path_info(path->net); pi; pi = pi->next) {
+		count++;
+		if (CHECK_FLAG(pi->flags, BGP_PATH_SELECTED))
+			selected = true;
+	}
+	return !selected || count > 2;
+}
+
+/* Apply bnc's state to one path, returns whether its dest was queued. */
+static bool evaluate_path(struct bgp_nexthop_cache *bnc,
+			  struct bgp_path_info *path, uint16_t change_flags)
 {
 	struct bgp_node *rn;
-	struct bgp_path_info *path;
 	int afi;
-	struct peer *peer = (struct peer *)bnc->nht_info;
 	struct bgp_table *table;
 	safi_t safi;
 	struct bgp *bgp_path;
+	uint32_t old_metric, new_metric;
+	bool valid_changed;
 
-	if (BGP_DEBUG(nht, NHT)) {
-		char buf[PREFIX2STR_BUFFER];
-		bnc_str(bnc, buf, PREFIX2STR_BUFFER);
-		zlog_debug(
-			"NH update for %s - flags 0x%x chgflags 0x%x - evaluate paths",
-			buf, bnc->flags, bnc->change_flags);
-	}
+	if (!(path->type == ZEBRA_ROUTE_BGP
+	      && ((path->sub_type == BGP_ROUTE_NORMAL)
+		  || (path->sub_type == BGP_ROUTE_STATIC)
+		  || (path->sub_type == BGP_ROUTE_IMPORTED))))
+		return false;
 
-	LIST_FOREACH (path, &(bnc->paths), nh_thread) {
-		if (!(path->type == ZEBRA_ROUTE_BGP
-		      && ((path->sub_type == BGP_ROUTE_NORMAL)
-			  || (path->sub_type == BGP_ROUTE_STATIC)
-			  || (path->sub_type == BGP_ROUTE_IMPORTED))))
-			continue;
+	rn = path->net;
+	assert(rn && bgp_node_table(rn));
+	afi = family2afi(rn->p.family);
+	table = bgp_node_table(rn);
+	safi = table->safi;
+
+	/*
+	 * handle routes from other VRFs (they can have a
+	 * nexthop in THIS VRF). bgp_path is the bgp instance
+	 * that owns the route referencing this nexthop.
+	 */
+	bgp_path = table->bgp;
 
-		rn = path->net;
-		assert(rn && bgp_node_table(rn));
-		afi = family2afi(rn->p.family);
-		table = bgp_node_table(rn);
-		safi = table->safi;
+	/*
+	 * Path becomes valid/invalid depending on whether the nexthop
+	 * reachable/unreachable.
+	 *
+	 * In case of unicast routes that were imported from vpn
+	 * and that have labels, they are valid only if there are
+	 * nexthops with labels
+	 */
 
-		/*
-		 * handle routes from other VRFs (they can have a
-		 * nexthop in THIS VRF). bgp_path is the bgp instance
-		 * that owns the route referencing this nexthop.
-		 */
-		bgp_path = table->bgp;
-
-		/*
-		 * Path becomes valid/invalid depending on whether the nexthop
-		 * reachable/unreachable.
-		 *
-		 * In case of unicast routes that were imported from vpn
-		 * and that have labels, they are valid only if there are
-		 * nexthops with labels
-		 */
+	int bnc_is_valid_nexthop = 0;
+
+	if (safi == SAFI_UNICAST &&
+		path->sub_type == BGP_ROUTE_IMPORTED &&
+		path->extra &&
+		path->extra->num_labels) {
+
+		bnc_is_valid_nexthop =
+			bgp_isvalid_labeled_nexthop(bnc) ? 1 : 0;
+	} else {
+		bnc_is_valid_nexthop =
+			bgp_isvalid_nexthop(bnc) ? 1 : 0;
+	}
 
-		int bnc_is_valid_nexthop = 0;
+	if (BGP_DEBUG(nht, NHT)) {
+		char buf[PREFIX_STRLEN];
 
-		if (safi == SAFI_UNICAST &&
-			path->sub_type == BGP_ROUTE_IMPORTED &&
-			path->extra &&
-			path->extra->num_labels) {
+		prefix2str(&rn->p, buf, PREFIX_STRLEN);
+		zlog_debug("%s: prefix %s (vrf %s) %svalid",
+			__func__, buf, bgp_path->name,
+			(bnc_is_valid_nexthop ? "" : "not "));
+	}
 
-			bnc_is_valid_nexthop =
-				bgp_isvalid_labeled_nexthop(bnc) ? 1 : 0;
+	valid_changed = (CHECK_FLAG(path->flags, BGP_PATH_VALID) ? 1 : 0)
+			!= bnc_is_valid_nexthop;
+	if (valid_changed) {
+		if (CHECK_FLAG(path->flags, BGP_PATH_VALID)) {
+			bgp_aggregate_decrement(bgp_path, &rn->p,
+						path, afi, safi);
+			bgp_path_info_unset_flag(rn, path,
+						 BGP_PATH_VALID);
 		} else {
-			bnc_is_valid_nexthop =
-				bgp_isvalid_nexthop(bnc) ? 1 : 0;
+			bgp_path_info_set_flag(rn, path,
+					       BGP_PATH_VALID);
+			bgp_aggregate_increment(bgp_path, &rn->p,
+						path, afi, safi);
 		}
+	}
 
-		if (BGP_DEBUG(nht, NHT)) {
-			char buf[PREFIX_STRLEN];
+	/* Copy the metric to the path. Will be used for bestpath
+	 * computation */
+	old_metric = path->extra ? path->extra->igpmetric : 0;
+	if (bgp_isvalid_nexthop(bnc) && bnc->metric)
+		(bgp_path_info_extra_get(path))->igpmetric =
+			bnc->metric;
+	else if (path->extra)
+		path->extra->igpmetric = 0;
+	new_metric = path->extra ? path->extra->igpmetric : 0;
+
+	if (!bgp_nht_path_affected(path, change_flags, valid_changed,
+				   old_metric, new_metric))
+		return false;
+
+	if (CHECK_FLAG(change_flags, BGP_NEXTHOP_METRIC_CHANGED)
+	    || CHECK_FLAG(change_flags, BGP_NEXTHOP_CHANGED))
+		SET_FLAG(path->flags, BGP_PATH_IGP_CHANGED);
+
+	bgp_process(bgp_path, rn, afi, safi);
+	return true;
+}
 
-			prefix2str(&rn->p, buf, PREFIX_STRLEN);
-			zlog_debug("%s: prefix %s (vrf %s) %svalid",
-				__func__, buf, bgp_path->name,
-				(bnc_is_valid_nexthop ? "" : "not "));
-		}
+/* Paths looked at per run of evaluate_paths_batch() */
+#define BGP_NHT_EVALUATE_BATCH 10000
 
-		if ((CHECK_FLAG(path->flags, BGP_PATH_VALID) ? 1 : 0)
-		    != bnc_is_valid_nexthop) {
-			if (CHECK_FLAG(path->flags, BGP_PATH_VALID)) {
-				bgp_aggregate_decrement(bgp_path, &rn->p,
-							path, afi, safi);
-				bgp_path_info_unset_flag(rn, path,
-							 BGP_PATH_VALID);
-			} else {
-				bgp_path_info_set_flag(rn, path,
-						       BGP_PATH_VALID);
-				bgp_aggregate_increment(bgp_path, &rn->p,
-							path, afi, safi);
-			}
-		}
+static int evaluate_paths_batch(struct thread *t)
+{
+	struct bgp_nexthop_cache *bnc = THREAD_ARG(t);
+	struct bgp_path_info *path;
+	unsigned int n;
+
+	for (n = 0; n < BGP_NHT_EVALUATE_BATCH; n++) {
+		/* Paths may have gone away since the lap started */
+		if (bnc->evaluate_left > bnc->path_count)
+			bnc->evaluate_left = bnc->path_count;
+		if (!bnc->evaluate_left)
+			break;
+
+		/* Laps start part way down the list, and wrap around */
+		path = bnc->evaluate_next;
+		if (!path)
+			path = LIST_FIRST(&bnc->paths);
+
+		/* path_nh_map() moves this on should the next path go away */
+		bnc->evaluate_next = LIST_NEXT(path, nh_thread);
+		bnc->evaluate_left--;
+
+		bnc->evaluated++;
+		if (evaluate_path(bnc, path, bnc->evaluate_flags))
+			bnc->reprocessed++;
+	}
 
-		/* Copy the metric to the path. Will be used for bestpath
-		 * computation */
-		if (bgp_isvalid_nexthop(bnc) && bnc->metric)
-			(bgp_path_info_extra_get(path))->igpmetric =
-				bnc->metric;
-		else if (path->extra)
-			path->extra->igpmetric = 0;
+	if (bnc->evaluate_left) {
+		thread_add_event(bm->master, evaluate_paths_batch, bnc, 0,
+				 &bnc->t_evaluate);
+		return 0;
+	}
+
+	bnc->evaluate_next = NULL;
 
-		if (CHECK_FLAG(bnc->change_flags, BGP_NEXTHOP_METRIC_CHANGED)
-		    || CHECK_FLAG(bnc->change_flags, BGP_NEXTHOP_CHANGED))
-			SET_FLAG(path->flags, BGP_PATH_IGP_CHANGED);
+	if (BGP_DEBUG(nht, NHT)) {
+		char buf[PREFIX2STR_BUFFER];
 
-		bgp_process(bgp_path, rn, afi, safi);
+		bnc_str(bnc, buf, PREFIX2STR_BUFFER);
+		zlog_debug("NH update for %s - best-path re-run for %u of %u paths",
+			   buf, bnc->reprocessed, bnc->evaluated);
 	}
+	bnc->evaluate_flags = 0;
+	return 0;
+}
+
+/**
+ * evaluate_paths - Evaluate the paths/nets associated with a nexthop.
+ * ARGUMENTS:
+ *   struct bgp_nexthop_cache *bnc -- the nexthop structure.
+ * RETURNS:
+ *   void.
+ *
+ * Runs over the paths in batches, the first one right away.  An update
+ * arriving while a previous one is still being worked through starts a
+ * new lap, with the combined change flags, from where the last one had
+ * got to: so a stream of updates can't keep paths further down the list
+ * from ever being looked at.
+ */
+static void evaluate_paths(struct bgp_nexthop_cache *bnc)
+{
+	struct peer *peer = (struct peer *)bnc->nht_info;
+
+	if (BGP_DEBUG(nht, NHT)) {
+		char buf[PREFIX2STR_BUFFER];
+		bnc_str(bnc, buf, PREFIX2STR_BUFFER);
+		zlog_debug(
+			"NH update for %s - flags 0x%x chgflags 0x%x - evaluate paths",
+			buf, bnc->flags, bnc->change_flags);
+	}
+
+	THREAD_OFF(bnc->t_evaluate);
+	if (!bnc->evaluate_left) {
+		bnc->evaluate_flags = 0;
+		bnc->evaluate_next = LIST_FIRST(&bnc->paths);
+	}
+	bnc->evaluate_flags |= bnc->change_flags;
+	bnc->evaluate_left = bnc->path_count;
+	bnc->evaluated = bnc->reprocessed = 0;
+
+	if (bnc->evaluate_left)
+		thread_execute(bm->master, evaluate_paths_batch, bnc, 0);
 
 	if (peer && !CHECK_FLAG(bnc->flags, BGP_NEXTHOP_PEER_NOTIFIED)) {
 		if (BGP_DEBUG(nht, NHT))
@@ -811,6 +1048,9 @@ void path_nh_map(struct bgp_path_info *path, struct bgp_nexthop_cache *bnc,
 		 bool make)
 {
 	if (path->nexthop) {
+		if (path->nexthop->evaluate_next == path)
+			path->nexthop->evaluate_next =
+				LIST_NEXT(path, nh_thread);
 		LIST_REMOVE(path, nh_thread);
 		path->nexthop->path_count--;
 		path->nexthop = NULL;
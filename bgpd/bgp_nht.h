@@ -81,6 +81,12 @@ extern void bgp_cleanup_nexthops(struct bgp *bgp);
  */
 extern void path_nh_map(struct bgp_path_info *path,
 			struct bgp_nexthop_cache *bnc, bool make);
+/*
+ * Stop anything still pending for a nexthop cache entry that is about to
+ * be freed.
+ */
+extern void bgp_nht_bnc_cancel(struct bgp_nexthop_cache *bnc);
+
 /*
  * When we actually have the connection to
  * the zebra daemon, we need to reregister
@@ -63,6 +63,7 @@
 #include "bgpd/bgp_io.h"
 #include "bgpd/bgp_keepalives.h"
 #include "bgpd/bgp_flowspec.h"
+#include "bgpd/bgp_pipeline.h"
 
 DEFINE_HOOK(bgp_packet_dump,
 		(struct peer *peer, uint8_t type, bgp_size_t size,
@@ -408,6 +409,8 @@ int bgp_generate_updgrp_packets(struct thread *thread)
 	if (peer->bgp->main_peers_update_hold)
 		return 0;
 
+	subgroup_build_packets_parallel(peer);
+
 	do {
 		s = NULL;
 		FOREACH_AFI_SAFI (afi, safi) {
@@ -1393,9 +1396,11 @@ static int bgp_keepalive_receive(struct peer *peer, bgp_size_t size)
  *
  * @param peer
  * @param size size of the packet
+ * @param dec NLRI decoded by a parse pthread, or NULL
  * @return as in summary
  */
-static int bgp_update_receive(struct peer *peer, bgp_size_t size)
+static int bgp_update_receive(struct peer *peer, bgp_size_t size,
+			      const struct bgp_update_decoded *dec)
 {
 	int ret, nlri_ret;
 	uint8_t *end;
@@ -1590,12 +1595,13 @@ static int bgp_update_receive(struct peer *peer, bgp_size_t size)
 		switch (i) {
 		case NLRI_UPDATE:
 		case NLRI_MP_UPDATE:
-			nlri_ret = bgp_nlri_parse(peer, NLRI_ATTR_ARG,
-						  &nlris[i], 0);
+			nlri_ret = bgp_pipeline_nlri_parse(peer, NLRI_ATTR_ARG,
+							   &nlris[i], 0, dec);
 			break;
 		case NLRI_WITHDRAW:
 		case NLRI_MP_WITHDRAW:
-			nlri_ret = bgp_nlri_parse(peer, &attr, &nlris[i], 1);
+			nlri_ret = bgp_pipeline_nlri_parse(peer, &attr,
+							   &nlris[i], 1, dec);
 			break;
 		default:
 			nlri_ret = BGP_NLRI_PARSE_ERROR;
@@ -2131,6 +2137,7 @@ static int bgp_capability_msg_parse(struct peer *peer, uint8_t *pnt,
 					peer->afc_nego[afi][safi] = 1;
 					bgp_announce_route(peer, afi, safi);
 				}
+				bgp_pipeline_peer_state(peer);
 			} else {
 				peer->afc_recv[afi][safi] = 0;
 				peer->afc_nego[afi][safi] = 0;
@@ -2233,9 +2240,13 @@ int bgp_process_packet(struct thread *thread)
 		uint8_t type = 0;
 		bgp_size_t size;
 		char notify_data_length[2];
+		struct bgp_update_decoded *dec = NULL;
 
 		frr_with_mutex(&peer->io_mtx) {
 			peer->curr = stream_fifo_pop(peer->ibuf);
+			if (peer->curr)
+				dec = bgp_pipeline_decoded_pop(peer,
+							       peer->curr);
 		}
 
 		if (peer->curr == NULL) // no packets to process, hmm...
@@ -2271,7 +2282,7 @@ int bgp_process_packet(struct thread *thread)
 			atomic_fetch_add_explicit(&peer->update_in, 1,
 						  memory_order_relaxed);
 			peer->readtime = monotime(NULL);
-			mprc = bgp_update_receive(peer, size);
+			mprc = bgp_update_receive(peer, size, dec);
 			if (mprc == BGP_Stop)
 				flog_err(
 					EC_BGP_UPDATE_RCV,
@@ -2334,6 +2345,8 @@ int bgp_process_packet(struct thread *thread)
 		}
 
 		/* delete processed packet */
+		if (dec)
+			bgp_pipeline_decoded_free(dec);
 		stream_free(peer->curr);
 		peer->curr = NULL;
 		processed++;
@@ -0,0 +1,490 @@
+/* BGP inbound UPDATE pipeline.
+ * Decodes received UPDATE NLRI ahead of the main pthread.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#include <zebra.h>
+
+#include "command.h"
+#include "frr_pthread.h"
+#include "jhash.h"
+#include "lib/json.h"
+#include "linklist.h"
+#include "memory.h"
+#include "monotime.h"
+#include "stream.h"
+#include "thread.h"
+
+#include "bgpd/bgpd.h"
+#include "bgpd/bgp_attr.h"
+#include "bgpd/bgp_packet.h"
+#include "bgpd/bgp_pipeline.h"
+
+/* Most packets a parse task takes off one peer at a time */
+#define BGP_PARSE_PACKET_MAX 64U
+
+/* peer->parse_state: Established, and per decodable AFI/SAFI, whether it
+ * was negotiated and whether its NLRI carry ADDPATH IDs
+ */
+#define BGP_PARSE_ESTABLISHED (1U << 0)
+#define BGP_PARSE_AF(afi, safi)                                                \
+	(1U << (1 + ((afi) == AFI_IP6) * 2 + ((safi) == SAFI_MULTICAST)))
+#define BGP_PARSE_ADDPATH(afi, safi) (BGP_PARSE_AF(afi, safi) << 4)
+
+/* Parse pthread statistics */
+struct bgp_parse_stats {
+	_Atomic uint64_t packets;
+	_Atomic uint64_t updates;
+	_Atomic uint64_t prefixes;
+	_Atomic uint64_t usecs;
+};
+
+static struct bgp_parse_stats parse_stats[BGP_PARSE_WORKERS_MAX];
+
+/* NLRI streams applied from a decoded record, or parsed again; these are
+ * only touched by the main pthread.
+ */
+static uint64_t decoded_hits;
+static uint64_t decoded_fallbacks;
+
+static int bgp_pipeline_parse(struct thread *thread);
+
+static unsigned int bgp_pipeline_worker(const struct peer *peer)
+{
+	return jhash(&peer, sizeof(peer), 0) % bm->parse_workers;
+}
+
+void bgp_pipeline_schedule(struct peer *peer)
+{
+	struct frr_pthread *fpt = bgp_pth_parse[bgp_pipeline_worker(peer)];
+
+	thread_add_event(fpt->master, bgp_pipeline_parse, peer, 0,
+			 &peer->t_parse);
+}
+
+void bgp_pipeline_peer_off(struct peer *peer)
+{
+	struct frr_pthread *fpt;
+
+	if (!bm->parse_workers)
+		return;
+
+	fpt = bgp_pth_parse[bgp_pipeline_worker(peer)];
+	if (fpt->running)
+		thread_cancel_async(fpt->master, &peer->t_parse, NULL);
+}
+
+void bgp_pipeline_peer_state(struct peer *peer)
+{
+	uint32_t state = 0;
+	afi_t afi;
+	safi_t safi;
+
+	if (peer->status == Established) {
+		state = BGP_PARSE_ESTABLISHED;
+		for (afi = AFI_IP; afi <= AFI_IP6; afi++)
+			for (safi = SAFI_UNICAST; safi <= SAFI_MULTICAST;
+			     safi++) {
+				if (!peer->afc[afi][safi])
+					continue;
+
+				state |= BGP_PARSE_AF(afi, safi);
+				if (CHECK_FLAG(peer->af_cap[afi][safi],
+					       PEER_CAP_ADDPATH_AF_RX_ADV)
+				    && CHECK_FLAG(peer->af_cap[afi][safi],
+						  PEER_CAP_ADDPATH_AF_TX_RCV))
+					state |= BGP_PARSE_ADDPATH(afi, safi);
+			}
+	}
+
+	atomic_store_explicit(&peer->parse_state, state, memory_order_relaxed);
+}
+
+void bgp_pipeline_decoded_free(struct bgp_update_decoded *dec)
+{
+	unsigned int i;
+
+	for (i = 0; i < dec->count; i++)
+		bgp_nlri_decoded_fini(&dec->nlri[i]);
+
+	XFREE(MTYPE_BGP_UPDATE_DECODED, dec);
+}
+
+void bgp_pipeline_flush(struct peer *peer)
+{
+	struct bgp_update_decoded *dec;
+
+	if (peer->ibuf_parse)
+		stream_fifo_clean(peer->ibuf_parse);
+
+	while ((dec = bgp_decoded_list_pop(&peer->decoded)))
+		bgp_pipeline_decoded_free(dec);
+}
+
+void bgp_pipeline_xfer(struct peer *peer, struct peer *from_peer)
+{
+	struct bgp_update_decoded *dec;
+
+	while ((dec = bgp_decoded_list_pop(&from_peer->decoded)))
+		bgp_decoded_list_add_tail(&peer->decoded, dec);
+
+	while (from_peer->ibuf_parse->head)
+		stream_fifo_push(peer->ibuf,
+				 stream_fifo_pop(from_peer->ibuf_parse));
+}
+
+struct bgp_update_decoded *bgp_pipeline_decoded_pop(struct peer *peer,
+						    const struct stream *s)
+{
+	struct bgp_update_decoded *dec;
+
+	/* Records are queued in packet order, but not every packet has one */
+	dec = bgp_decoded_list_first(&peer->decoded);
+	if (!dec || dec->s != s)
+		return NULL;
+
+	return bgp_decoded_list_pop(&peer->decoded);
+}
+
+int bgp_pipeline_nlri_parse(struct peer *peer, struct attr *attr,
+			    struct bgp_nlri *packet, int mp_withdraw,
+			    const struct bgp_update_decoded *dec)
+{
+	unsigned int i;
+
+	if (dec
+	    && (packet->safi == SAFI_UNICAST
+		|| packet->safi == SAFI_MULTICAST)) {
+		for (i = 0; i < dec->count; i++) {
+			if (!bgp_nlri_decoded_match(peer, &dec->nlri[i],
+						    packet))
+				continue;
+
+			decoded_hits++;
+			return bgp_nlri_apply_ip(peer, mp_withdraw ? NULL : attr,
+						 &dec->nlri[i]);
+		}
+		decoded_fallbacks++;
+	}
+
+	return bgp_nlri_parse(peer, attr, packet, mp_withdraw);
+}
+
+/* Decode one NLRI stream of an UPDATE into its record */
+static void bgp_pipeline_decode_nlri(struct peer *peer, uint32_t state,
+				     struct bgp_update_decoded **dec,
+				     struct stream *s, afi_t afi,
+				     safi_t safi, size_t offset,
+				     bgp_size_t length)
+{
+	struct bgp_nlri packet;
+
+	/* bgp_update_receive() skips these */
+	if (!length || !(state & BGP_PARSE_AF(afi, safi)))
+		return;
+
+	if (!*dec) {
+		*dec = XCALLOC(MTYPE_BGP_UPDATE_DECODED, sizeof(**dec));
+		(*dec)->s = s;
+	}
+	if ((*dec)->count == BGP_UPDATE_DECODED_NLRI_MAX)
+		return;
+
+	packet.afi = afi;
+	packet.safi = safi;
+	packet.nlri = STREAM_DATA(s) + offset;
+	packet.length = length;
+	bgp_nlri_decode_ip(peer, &packet,
+			   !!(state & BGP_PARSE_ADDPATH(afi, safi)),
+			   &(*dec)->nlri[(*dec)->count++]);
+}
+
+/* Decode an MP_REACH_NLRI or MP_UNREACH_NLRI attribute value */
+static void bgp_pipeline_decode_mp(struct peer *peer, uint32_t state,
+				   struct bgp_update_decoded **dec,
+				   struct stream *s, uint8_t type,
+				   size_t offset, bgp_size_t length)
+{
+	iana_afi_t pkt_afi;
+	iana_safi_t pkt_safi;
+	afi_t afi;
+	safi_t safi;
+	size_t hdrlen;
+
+	/* AFI, SAFI and, for MP_REACH, nexthop length and reserved octet */
+	hdrlen = type == BGP_ATTR_MP_REACH_NLRI ? 5 : 3;
+	if (length < hdrlen)
+		return;
+
+	pkt_afi = stream_getw_from(s, offset);
+	pkt_safi = stream_getc_from(s, offset + 2);
+	if (type == BGP_ATTR_MP_REACH_NLRI)
+		hdrlen += stream_getc_from(s, offset + 3);
+	if (length < hdrlen)
+		return;
+
+	if (bgp_map_afi_safi_iana2int(pkt_afi, pkt_safi, &afi, &safi))
+		return;
+	if ((afi != AFI_IP && afi != AFI_IP6)
+	    || (safi != SAFI_UNICAST && safi != SAFI_MULTICAST))
+		return;
+
+	bgp_pipeline_decode_nlri(peer, state, dec, s, afi, safi,
+				 offset + hdrlen, length - hdrlen);
+}
+
+/*
+ * Decode the prefixes of an UPDATE. Only the framing needed to find the
+ * NLRI is checked here; everything else, and any error, is left to
+ * bgp_update_receive() on the main pthread, which parses anything not
+ * covered by the returned record itself.
+ */
+static struct bgp_update_decoded *bgp_pipeline_decode(struct peer *peer,
+						      uint32_t state,
+						      struct stream *s)
+{
+	struct bgp_update_decoded *dec = NULL;
+	size_t end = stream_get_endp(s);
+	size_t offset = BGP_HEADER_SIZE;
+	size_t attr_end;
+	bgp_size_t withdraw_len, attribute_len;
+
+	if (end < BGP_HEADER_SIZE
+	    || stream_getc_from(s, BGP_MARKER_SIZE + 2) != BGP_MSG_UPDATE)
+		return NULL;
+
+	/* Status is rechecked on the main pthread; this only saves work */
+	if (!(state & BGP_PARSE_ESTABLISHED))
+		return NULL;
+
+	if (offset + 2 > end)
+		return NULL;
+	withdraw_len = stream_getw_from(s, offset);
+	offset += 2;
+	if (offset + withdraw_len + 2 > end)
+		return NULL;
+
+	bgp_pipeline_decode_nlri(peer, state, &dec, s, AFI_IP, SAFI_UNICAST,
+				 offset, withdraw_len);
+	offset += withdraw_len;
+
+	attribute_len = stream_getw_from(s, offset);
+	offset += 2;
+	attr_end = offset + attribute_len;
+	if (attr_end > end)
+		return dec;
+
+	while (offset + 3 <= attr_end) {
+		uint8_t flags = stream_getc_from(s, offset);
+		uint8_t type = stream_getc_from(s, offset + 1);
+		bgp_size_t length;
+
+		if (CHECK_FLAG(flags, BGP_ATTR_FLAG_EXTLEN)) {
+			if (offset + 4 > attr_end)
+				break;
+			length = stream_getw_from(s, offset + 2);
+			offset += 4;
+		} else {
+			length = stream_getc_from(s, offset + 2);
+			offset += 3;
+		}
+		if (offset + length > attr_end)
+			break;
+
+		if (type == BGP_ATTR_MP_REACH_NLRI
+		    || type == BGP_ATTR_MP_UNREACH_NLRI)
+			bgp_pipeline_decode_mp(peer, state, &dec, s, type,
+					       offset, length);
+		offset += length;
+	}
+
+	bgp_pipeline_decode_nlri(peer, state, &dec, s, AFI_IP, SAFI_UNICAST,
+				 attr_end, end - attr_end);
+
+	return dec;
+}
+
+/*
+ * Parse pthread task: decode a batch of the peer's packets and hand them to
+ * the main pthread.
+ */
+static int bgp_pipeline_parse(struct thread *thread)
+{
+	struct peer *peer = THREAD_ARG(thread);
+	struct bgp_parse_stats *stats;
+	struct stream *pkts[BGP_PARSE_PACKET_MAX];
+	struct bgp_update_decoded *decs[BGP_PARSE_PACKET_MAX];
+	struct timeval start;
+	uint32_t state;
+	unsigned int count = 0, updates = 0, prefixes = 0;
+	unsigned int i, j;
+	bool more;
+
+	stats = &parse_stats[bgp_pipeline_worker(peer)];
+
+	/* One snapshot of the session for the whole batch */
+	frr_with_mutex(&peer->io_mtx) {
+		while (count < BGP_PARSE_PACKET_MAX && peer->ibuf_parse->head)
+			pkts[count++] = stream_fifo_pop(peer->ibuf_parse);
+		state = atomic_load_explicit(&peer->parse_state,
+					     memory_order_relaxed);
+	}
+
+	if (!count)
+		return 0;
+
+	monotime(&start);
+	for (i = 0; i < count; i++) {
+		decs[i] = bgp_pipeline_decode(peer, state, pkts[i]);
+		if (!decs[i])
+			continue;
+
+		updates++;
+		for (j = 0; j < decs[i]->count; j++)
+			prefixes += decs[i]->nlri[j].count;
+	}
+
+	atomic_fetch_add_explicit(&stats->packets, count, memory_order_relaxed);
+	atomic_fetch_add_explicit(&stats->updates, updates,
+				  memory_order_relaxed);
+	atomic_fetch_add_explicit(&stats->prefixes, prefixes,
+				  memory_order_relaxed);
+	atomic_fetch_add_explicit(&stats->usecs, monotime_since(&start, NULL),
+				  memory_order_relaxed);
+
+	frr_with_mutex(&peer->io_mtx) {
+		for (i = 0; i < count; i++) {
+			stream_fifo_push(peer->ibuf, pkts[i]);
+			if (decs[i])
+				bgp_decoded_list_add_tail(&peer->decoded,
+							  decs[i]);
+		}
+		more = peer->ibuf_parse->head != NULL;
+	}
+
+	thread_add_timer_msec(bm->master, bgp_process_packet, peer, 0,
+			      &peer->t_process_packet);
+	if (more)
+		thread_add_event(thread->master, bgp_pipeline_parse, peer, 0,
+				 &peer->t_parse);
+
+	return 0;
+}
+
+DEFUN (show_bgp_inbound_pipeline,
+       show_bgp_inbound_pipeline_cmd,
+       "show bgp inbound-pipeline [json]",
+       SHOW_STR
+       BGP_STR
+       "Inbound UPDATE parse pipeline\n"
+       JSON_STR)
+{
+	bool uj = use_json(argc, argv);
+	uint64_t queued[BGP_PARSE_WORKERS_MAX] = {};
+	uint64_t parse_depth = 0, process_depth = 0, decoded = 0;
+	struct listnode *node, *pnode;
+	struct bgp *bgp;
+	struct peer *peer;
+	json_object *json = NULL, *json_workers = NULL;
+	unsigned int i;
+
+	for (ALL_LIST_ELEMENTS_RO(bm->bgp, node, bgp)) {
+		for (ALL_LIST_ELEMENTS_RO(bgp->peer, pnode, peer)) {
+			frr_with_mutex(&peer->io_mtx) {
+				process_depth += peer->ibuf->count;
+				decoded += bgp_decoded_list_count(
+					&peer->decoded);
+				parse_depth += peer->ibuf_parse->count;
+				if (bm->parse_workers)
+					queued[bgp_pipeline_worker(peer)] +=
+						peer->ibuf_parse->count;
+			}
+		}
+	}
+
+	if (uj) {
+		json = json_object_new_object();
+		json_workers = json_object_new_array();
+		json_object_int_add(json, "parseWorkers", bm->parse_workers);
+		json_object_int_add(json, "parseQueueDepth", parse_depth);
+		json_object_int_add(json, "processQueueDepth", process_depth);
+		json_object_int_add(json, "decodedQueueDepth", decoded);
+		json_object_int_add(json, "decodedHits", decoded_hits);
+		json_object_int_add(json, "decodedFallbacks",
+				    decoded_fallbacks);
+	} else {
+		vty_out(vty, "Parse pthreads: %u%s\n", bm->parse_workers,
+			bm->parse_workers ? "" : " (parsing on main pthread)");
+		vty_out(vty, "Packets waiting for parse: %" PRIu64 "\n",
+			parse_depth);
+		vty_out(vty, "Packets waiting for processing: %" PRIu64
+			     " (%" PRIu64 " decoded)\n",
+			process_depth, decoded);
+		vty_out(vty, "Decoded NLRI used: %" PRIu64
+			     ", parsed again: %" PRIu64 "\n",
+			decoded_hits, decoded_fallbacks);
+		if (bm->parse_workers)
+			vty_out(vty, "\n%-8s %10s %12s %12s %12s %10s\n",
+				"Worker", "Queued", "Packets", "Updates",
+				"Prefixes", "Avg usecs");
+	}
+
+	for (i = 0; i < bm->parse_workers; i++) {
+		struct bgp_parse_stats *stats = &parse_stats[i];
+		uint64_t packets, updates, prefixes, usecs, avg;
+
+		packets = atomic_load_explicit(&stats->packets,
+					       memory_order_relaxed);
+		updates = atomic_load_explicit(&stats->updates,
+					       memory_order_relaxed);
+		prefixes = atomic_load_explicit(&stats->prefixes,
+						memory_order_relaxed);
+		usecs = atomic_load_explicit(&stats->usecs,
+					     memory_order_relaxed);
+		avg = packets ? usecs / packets : 0;
+
+		if (uj) {
+			json_object *json_worker = json_object_new_object();
+
+			json_object_int_add(json_worker, "queued", queued[i]);
+			json_object_int_add(json_worker, "packets", packets);
+			json_object_int_add(json_worker, "updates", updates);
+			json_object_int_add(json_worker, "prefixes", prefixes);
+			json_object_int_add(json_worker, "usecsPerPacket",
+					    avg);
+			json_object_array_add(json_workers, json_worker);
+		} else
+			vty_out(vty,
+				"%-8u %10" PRIu64 " %12" PRIu64 " %12" PRIu64
+				" %12" PRIu64 " %10" PRIu64 "\n",
+				i, queued[i], packets, updates, prefixes, avg);
+	}
+
+	if (uj) {
+		json_object_object_add(json, "workers", json_workers);
+		vty_out(vty, "%s\n", json_object_to_json_string_ext(
+					     json, JSON_C_TO_STRING_PRETTY));
+		json_object_free(json);
+	}
+
+	return CMD_SUCCESS;
+}
+
+void bgp_pipeline_init(void)
+{
+	install_element(VIEW_NODE, &show_bgp_inbound_pipeline_cmd);
+}
@@ -0,0 +1,119 @@
+/* BGP inbound UPDATE pipeline.
+ * Decodes received UPDATE NLRI ahead of the main pthread.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; see the file COPYING; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor, Boston,
+ * MA 02110-1301 USA
+ */
+
+#ifndef _FRR_BGP_PIPELINE_H
+#define _FRR_BGP_PIPELINE_H
+
+#include "bgpd/bgpd.h"
+#include "bgpd/bgp_route.h"
+
+/*
+ * When parse pthreads are configured (bgpd -W), the I/O pthread hands
+ * framed packets to peer->ibuf_parse instead of peer->ibuf. A parse
+ * pthread, chosen per peer, decodes the withdrawn, NLRI, MP_REACH and
+ * MP_UNREACH prefix lists of each UPDATE and moves the packets, in order,
+ * on to peer->ibuf along with one bgp_update_decoded record per UPDATE.
+ *
+ * The main pthread still parses attributes and applies every prefix; it
+ * only skips re-decoding NLRI which a record covers. Anything the parse
+ * pthread did not decode falls back to bgp_nlri_parse().
+ *
+ * This only covers part of what the pipeline is meant to do: attributes
+ * are still parsed, and interned, on the main pthread. Interning would be
+ * safe here, the intern tables being lib/chash. But bgp_attr_parse() is
+ * not a pure function of the packet: it reads its input from peer->curr,
+ * reads peer and instance configuration (enforce-first-as, local AS,
+ * confederation, peer sort) and the session's interface for link-local
+ * nexthops, and sends NOTIFYs directly, e.g. from bgp_attr_malformed().
+ * Moving it here first needs it split into a parser working from a
+ * snapshot of that state, and the session actions left to the main
+ * pthread.
+ *
+ * Parse pthreads never read peer->status, peer->afc or peer->af_cap
+ * directly. They use peer->parse_state, which the main pthread publishes with
+ * bgp_pipeline_peer_state() whenever the session state changes. A stale
+ * snapshot only costs work: the main pthread checks both again and
+ * decodes whatever the record does not cover.
+ */
+
+/* Withdrawn routes, NLRI, MP_REACH_NLRI and MP_UNREACH_NLRI */
+#define BGP_UPDATE_DECODED_NLRI_MAX 4
+
+struct bgp_update_decoded {
+	struct bgp_decoded_list_item item;
+
+	/* Packet on peer->ibuf this record belongs to */
+	const struct stream *s;
+
+	unsigned int count;
+	struct bgp_nlri_decoded nlri[BGP_UPDATE_DECODED_NLRI_MAX];
+};
+
+DECLARE_LIST(bgp_decoded_list, struct bgp_update_decoded, item)
+
+/**
+ * Queue a peer for its parse pthread, after packets have been pushed onto
+ * peer->ibuf_parse. Called from the I/O pthread.
+ */
+extern void bgp_pipeline_schedule(struct peer *peer);
+
+/**
+ * Cancel any pending parse task for the peer. Blocks until the parse
+ * pthread has acknowledged the cancellation.
+ */
+extern void bgp_pipeline_peer_off(struct peer *peer);
+
+/**
+ * Drop packets waiting to be parsed and all decoded records of the peer.
+ * peer->io_mtx must be held.
+ */
+extern void bgp_pipeline_flush(struct peer *peer);
+
+/**
+ * Move packets and decoded records from one peer to another on connection
+ * transfer; from_peer's pending packets are appended to peer->ibuf. Both
+ * peers' io_mtx must be held.
+ */
+extern void bgp_pipeline_xfer(struct peer *peer, struct peer *from_peer);
+
+/**
+ * Take the decoded record for packet 's', just popped off peer->ibuf, if
+ * there is one. peer->io_mtx must be held.
+ */
+extern struct bgp_update_decoded *
+bgp_pipeline_decoded_pop(struct peer *peer, const struct stream *s);
+
+extern void bgp_pipeline_decoded_free(struct bgp_update_decoded *dec);
+
+/**
+ * bgp_nlri_parse(), using the prefixes in 'dec' when they cover 'packet'.
+ */
+extern int bgp_pipeline_nlri_parse(struct peer *peer, struct attr *attr,
+				   struct bgp_nlri *packet, int mp_withdraw,
+				   const struct bgp_update_decoded *dec);
+
+/**
+ * Publish the peer's session state, negotiated AFI/SAFIs and their ADDPATH
+ * receive capability to the parse pthreads. Called from the main pthread.
+ */
+extern void bgp_pipeline_peer_state(struct peer *peer);
+
+extern void bgp_pipeline_init(void);
+
+#endif /* _FRR_BGP_PIPELINE_H */
@@ -35,16 +35,13 @@
 
    (^|[,{}() ]|$) */
 
-regex_t *bgp_regcomp(const char *regstr)
+static char *bgp_regex_expand(const char *regstr)
 {
-	/* Convert _ character to generic regular expression. */
 	int i, j;
 	int len;
 	int magic = 0;
 	char *magic_str;
 	char magic_regexp[] = "(^|[,{}() ]|$)";
-	int ret;
-	regex_t *regex;
 
 	len = strlen(regstr);
 	for (i = 0; i < len; i++)
@@ -63,6 +60,17 @@ regex_t *bgp_regcomp(const char *regstr)
 	}
 	magic_str[j] = '\0';
 
+	return magic_str;
+}
+
+regex_t *bgp_regcomp(const char *regstr)
+{
+	char *magic_str;
+	int ret;
+	regex_t *regex;
+
+	magic_str = bgp_regex_expand(regstr);
+
 	regex = XMALLOC(MTYPE_BGP_REGEXP, sizeof(regex_t));
 
 	ret = regcomp(regex, magic_str, REG_EXTENDED | REG_NOSUB);
@@ -87,3 +95,590 @@ void bgp_regex_free(regex_t *regex)
 	regfree(regex);
 	XFREE(MTYPE_BGP_REGEXP, regex);
 }
+
+/*
+ * Compiled matcher for the regexps of as-path access-lists and expanded
+ * community-lists.
+ *
+ * The pattern, after the `_' expansion above, is turned into an NFA and
+ * then into a DFA over byte classes, built completely at configuration
+ * time.  The DFA decides the same thing regexec() would (whether the
+ * pattern matches anywhere in the string) with one table lookup per input
+ * byte, and since it is never modified after compilation it may be used
+ * from any pthread.
+ *
+ * For AS paths the bytes are produced from the binary segments in the
+ * format aspath_make_str_count() renders, so aspath->str is never looked
+ * at.  Patterns using syntax the compiler does not handle identically to
+ * regcomp() (intervals, character classes, escapes inside brackets, ...)
+ * or growing beyond the limits below are rejected, and the caller keeps
+ * using regexec() for them.
+ */
+#define BGP_REGEX_LEN_MAX 1024
+#define BGP_REGEX_DFA_MAX 512
+
+enum bgp_regex_op {
+	RE_NOP,
+	RE_SPLIT,
+	RE_CHAR,
+	RE_BOL,
+	RE_EOL,
+	RE_MATCH,
+};
+
+struct bgp_regex_nfa_state {
+	uint8_t op;
+	int cset;
+	int out;
+	int out1;
+};
+
+struct bgp_regex_nfa {
+	struct bgp_regex_nfa_state *st;
+	int n;
+	int max;
+	int start;
+
+	uint64_t (*cset)[4];
+	int ncset;
+
+	const char *p;
+	int depth;
+	bool error;
+};
+
+struct bgp_regex_frag {
+	int start;
+	int end;
+};
+
+#define DFA_ACCEPT 0x01
+#define DFA_ACCEPT_EOL 0x02
+
+struct bgp_regex_dfa {
+	uint16_t nstates;
+	uint16_t nclasses;
+	uint8_t classmap[256];
+
+	/* DFA_* flags and nclasses transitions per state, state 0 is the
+	 * start state */
+	uint8_t *flags;
+	uint16_t *trans;
+};
+
+/* c may be a plain char, negative for bytes >= 0x80 */
+#define CSET_SET(set, c)                                                       \
+	((set)[(uint8_t)(c) / 64] |= 1ULL << ((uint8_t)(c) % 64))
+#define CSET_HAS(set, c)                                                       \
+	((set)[(uint8_t)(c) / 64] & (1ULL << ((uint8_t)(c) % 64)))
+#define BITS_SET(bits, i) ((bits)[(i) / 64] |= 1ULL << ((i) % 64))
+#define BITS_HAS(bits, i) ((bits)[(i) / 64] & (1ULL << ((i) % 64)))
+
+static int re_state(struct bgp_regex_nfa *nfa, uint8_t op, int out, int out1)
+{
+	struct bgp_regex_nfa_state *st;
+
+	if (nfa->n == nfa->max) {
+		nfa->error = true;
+		return 0;
+	}
+	st = &nfa->st[nfa->n];
+	st->op = op;
+	st->cset = -1;
+	st->out = out;
+	st->out1 = out1;
+	return nfa->n++;
+}
+
+static struct bgp_regex_frag re_frag(struct bgp_regex_nfa *nfa, uint8_t op)
+{
+	struct bgp_regex_frag f;
+
+	f.end = re_state(nfa, RE_NOP, -1, -1);
+	f.start = re_state(nfa, op, f.end, -1);
+	return f;
+}
+
+static struct bgp_regex_frag re_frag_cset(struct bgp_regex_nfa *nfa,
+					  const uint64_t set[4])
+{
+	struct bgp_regex_frag f;
+
+	f = re_frag(nfa, RE_CHAR);
+	if (!nfa->error) {
+		memcpy(nfa->cset[nfa->ncset], set, sizeof(nfa->cset[0]));
+		nfa->st[f.start].cset = nfa->ncset++;
+	}
+	return f;
+}
+
+/* After the opening bracket.  Backslashes, collating elements and
+ * character classes are where POSIX and PCRE disagree or where the
+ * locale matters, leave those to regcomp(). */
+static void re_parse_bracket(struct bgp_regex_nfa *nfa, uint64_t set[4])
+{
+	const char *p = nfa->p;
+	bool negate = false, first = true;
+	unsigned char lo, hi;
+	int c, i;
+
+	if (*p == '^') {
+		negate = true;
+		p++;
+	}
+	while (*p && (*p != ']' || first)) {
+		first = false;
+		lo = hi = *p++;
+		if (lo == '\\' || (lo == '[' && strchr(":.=", *p))) {
+			nfa->error = true;
+			return;
+		}
+		if (p[0] == '-' && p[1] && p[1] != ']') {
+			hi = p[1];
+			p += 2;
+			if (hi == '\\' || hi == '[' || hi < lo) {
+				nfa->error = true;
+				return;
+			}
+		}
+		for (c = lo; c <= hi; c++)
+			CSET_SET(set, c);
+	}
+	if (*p != ']') {
+		nfa->error = true;
+		return;
+	}
+	nfa->p = p + 1;
+
+	if (negate)
+		for (i = 0; i < 4; i++)
+			set[i] = ~set[i];
+}
+
+static struct bgp_regex_frag re_parse_alt(struct bgp_regex_nfa *nfa);
+
+static struct bgp_regex_frag re_parse_atom(struct bgp_regex_nfa *nfa,
+					   bool *anchor)
+{
+	struct bgp_regex_frag f;
+	uint64_t set[4] = {};
+	char c = *nfa->p++;
+
+	*anchor = false;
+	switch (c) {
+	case '(':
+		if (++nfa->depth > 64) {
+			nfa->error = true;
+			return re_frag(nfa, RE_NOP);
+		}
+		f = re_parse_alt(nfa);
+		nfa->depth--;
+		if (*nfa->p != ')')
+			nfa->error = true;
+		else
+			nfa->p++;
+		return f;
+	case '^':
+		*anchor = true;
+		return re_frag(nfa, RE_BOL);
+	case '$':
+		*anchor = true;
+		return re_frag(nfa, RE_EOL);
+	case '.':
+		memset(set, 0xff, sizeof(set));
+		break;
+	case '[':
+		re_parse_bracket(nfa, set);
+		break;
+	case '\\':
+		c = *nfa->p++;
+		if (!c || isalnum((unsigned char)c))
+			nfa->error = true;
+		else
+			CSET_SET(set, c);
+		break;
+	case '{':
+	case '*':
+	case '+':
+	case '?':
+		nfa->error = true;
+		break;
+	default:
+		CSET_SET(set, c);
+		break;
+	}
+	return re_frag_cset(nfa, set);
+}
+
+static struct bgp_regex_frag re_parse_concat(struct bgp_regex_nfa *nfa)
+{
+	struct bgp_regex_frag f, a;
+	bool anchor;
+	int s, e;
+
+	f = re_frag(nfa, RE_NOP);
+	while (!nfa->error && *nfa->p && *nfa->p != '|' && *nfa->p != ')') {
+		a = re_parse_atom(nfa, &anchor);
+
+		while (*nfa->p == '*' || *nfa->p == '+' || *nfa->p == '?') {
+			if (anchor) {
+				nfa->error = true;
+				break;
+			}
+			e = re_state(nfa, RE_NOP, -1, -1);
+			s = re_state(nfa, RE_SPLIT, a.start, e);
+			switch (*nfa->p++) {
+			case '*':
+				nfa->st[a.end].out = s;
+				a.start = s;
+				break;
+			case '+':
+				nfa->st[a.end].out = s;
+				break;
+			case '?':
+				nfa->st[a.end].out = e;
+				a.start = s;
+				break;
+			}
+			a.end = e;
+		}
+
+		nfa->st[f.end].out = a.start;
+		f.end = a.end;
+	}
+	return f;
+}
+
+static struct bgp_regex_frag re_parse_alt(struct bgp_regex_nfa *nfa)
+{
+	struct bgp_regex_frag f, g;
+	int s, e;
+
+	f = re_parse_concat(nfa);
+	while (!nfa->error && *nfa->p == '|') {
+		nfa->p++;
+		g = re_parse_concat(nfa);
+		e = re_state(nfa, RE_NOP, -1, -1);
+		s = re_state(nfa, RE_SPLIT, f.start, g.start);
+		nfa->st[f.end].out = e;
+		nfa->st[g.end].out = e;
+		f.start = s;
+		f.end = e;
+	}
+	return f;
+}
+
+/* Add everything reachable from state i without consuming input to set.
+ * Only the states that matter for the DFA are recorded in set, seen
+ * tracks the rest. */
+static void re_closure(const struct bgp_regex_nfa *nfa, int i, bool bol,
+		       bool eol, uint64_t *set, uint64_t *seen, int *stack)
+{
+	const struct bgp_regex_nfa_state *st;
+	int sp = 0;
+
+	if (i < 0 || BITS_HAS(seen, i))
+		return;
+	BITS_SET(seen, i);
+	stack[sp++] = i;
+
+#define PUSH(j)                                                                \
+	do {                                                                   \
+		if ((j) >= 0 && !BITS_HAS(seen, (j))) {                        \
+			BITS_SET(seen, (j));                                   \
+			stack[sp++] = (j);                                     \
+		}                                                              \
+	} while (0)
+
+	while (sp) {
+		i = stack[--sp];
+		st = &nfa->st[i];
+
+		switch (st->op) {
+		case RE_NOP:
+			PUSH(st->out);
+			break;
+		case RE_SPLIT:
+			PUSH(st->out);
+			PUSH(st->out1);
+			break;
+		case RE_BOL:
+			if (bol)
+				PUSH(st->out);
+			break;
+		case RE_EOL:
+			BITS_SET(set, i);
+			if (eol)
+				PUSH(st->out);
+			break;
+		case RE_CHAR:
+		case RE_MATCH:
+			BITS_SET(set, i);
+			break;
+		}
+	}
+#undef PUSH
+}
+
+static bool re_has_match(const struct bgp_regex_nfa *nfa, const uint64_t *set)
+{
+	int i;
+
+	for (i = 0; i < nfa->n; i++)
+		if (BITS_HAS(set, i) && nfa->st[i].op == RE_MATCH)
+			return true;
+	return false;
+}
+
+/* Partition the byte values into classes no transition can tell apart. */
+static void re_classes(struct bgp_regex_dfa *dfa,
+		       const struct bgp_regex_nfa *nfa, uint8_t *rep)
+{
+	int map[256], split[512], renum[512];
+	int n = 1, i, c;
+
+	memset(map, 0, sizeof(map));
+	for (i = 0; i <= nfa->ncset; i++) {
+		if (i < nfa->ncset) {
+			for (c = 0; c < n; c++)
+				split[c] = -1;
+			for (c = 0; c < 256; c++) {
+				if (!CSET_HAS(nfa->cset[i], c))
+					continue;
+				if (split[map[c]] < 0)
+					split[map[c]] = n++;
+				map[c] = split[map[c]];
+			}
+		}
+
+		/* splitting off whole classes leaves gaps */
+		for (c = 0; c < n; c++)
+			renum[c] = -1;
+		n = 0;
+		for (c = 0; c < 256; c++) {
+			if (renum[map[c]] < 0) {
+				renum[map[c]] = n;
+				rep[n++] = c;
+			}
+			map[c] = renum[map[c]];
+		}
+	}
+
+	for (c = 0; c < 256; c++)
+		dfa->classmap[c] = map[c];
+	dfa->nclasses = n;
+}
+
+static bool re_subset(struct bgp_regex_dfa *dfa,
+		      const struct bgp_regex_nfa *nfa)
+{
+	int words = (nfa->n + 63) / 64;
+	size_t setsize = words * sizeof(uint64_t);
+	uint64_t *sets, *next, *seen, *tmp;
+	int *stack;
+	uint8_t rep[256];
+	int s, c, i, t;
+	bool ok = true;
+
+	re_classes(dfa, nfa, rep);
+
+	sets = XCALLOC(MTYPE_TMP, BGP_REGEX_DFA_MAX * setsize);
+	next = XCALLOC(MTYPE_TMP, setsize);
+	seen = XCALLOC(MTYPE_TMP, setsize);
+	tmp = XCALLOC(MTYPE_TMP, setsize);
+	stack = XCALLOC(MTYPE_TMP, nfa->n * sizeof(int));
+	dfa->flags = XCALLOC(MTYPE_BGP_REGEXP, BGP_REGEX_DFA_MAX);
+	dfa->trans = XCALLOC(MTYPE_BGP_REGEXP, BGP_REGEX_DFA_MAX
+						       * dfa->nclasses
+						       * sizeof(uint16_t));
+
+	/* only the start state is at the beginning of the line, so it is
+	 * never merged with any other state */
+	re_closure(nfa, nfa->start, true, false, sets, seen, stack);
+	dfa->nstates = 1;
+
+	for (s = 0; s < dfa->nstates; s++) {
+		uint64_t *set = sets + s * words;
+
+		if (re_has_match(nfa, set)) {
+			dfa->flags[s] = DFA_ACCEPT | DFA_ACCEPT_EOL;
+			for (c = 0; c < dfa->nclasses; c++)
+				dfa->trans[s * dfa->nclasses + c] = s;
+			continue;
+		}
+
+		memset(tmp, 0, setsize);
+		memset(seen, 0, setsize);
+		for (i = 0; i < nfa->n; i++)
+			if (BITS_HAS(set, i) && nfa->st[i].op == RE_EOL)
+				re_closure(nfa, nfa->st[i].out, s == 0, true,
+					   tmp, seen, stack);
+		if (re_has_match(nfa, tmp))
+			dfa->flags[s] = DFA_ACCEPT_EOL;
+
+		for (c = 0; c < dfa->nclasses; c++) {
+			memset(next, 0, setsize);
+			memset(seen, 0, setsize);
+			for (i = 0; i < nfa->n; i++)
+				if (BITS_HAS(set, i)
+				    && nfa->st[i].op == RE_CHAR
+				    && CSET_HAS(nfa->cset[nfa->st[i].cset],
+						rep[c]))
+					re_closure(nfa, nfa->st[i].out, false,
+						   false, next, seen, stack);
+			/* unanchored search, a match may start anywhere */
+			re_closure(nfa, nfa->start, false, false, next, seen,
+				   stack);
+
+			for (t = 1; t < dfa->nstates; t++)
+				if (!memcmp(sets + t * words, next, setsize))
+					break;
+			if (t == dfa->nstates) {
+				if (t == BGP_REGEX_DFA_MAX) {
+					ok = false;
+					goto out;
+				}
+				memcpy(sets + t * words, next, setsize);
+				dfa->nstates++;
+			}
+			dfa->trans[s * dfa->nclasses + c] = t;
+		}
+	}
+
+	dfa->flags = XREALLOC(MTYPE_BGP_REGEXP, dfa->flags, dfa->nstates);
+	dfa->trans = XREALLOC(MTYPE_BGP_REGEXP, dfa->trans,
+			      dfa->nstates * dfa->nclasses * sizeof(uint16_t));
+out:
+	XFREE(MTYPE_TMP, sets);
+	XFREE(MTYPE_TMP, next);
+	XFREE(MTYPE_TMP, seen);
+	XFREE(MTYPE_TMP, tmp);
+	XFREE(MTYPE_TMP, stack);
+	return ok;
+}
+
+struct bgp_regex_dfa *bgp_regex_dfa_compile(const char *regstr)
+{
+	struct bgp_regex_nfa nfa = {};
+	struct bgp_regex_dfa *dfa = NULL;
+	struct bgp_regex_frag f;
+	char *str;
+	int len;
+
+	str = bgp_regex_expand(regstr);
+	len = strlen(str);
+	if (len > BGP_REGEX_LEN_MAX)
+		goto out;
+
+	nfa.max = 6 * len + 8;
+	nfa.st = XCALLOC(MTYPE_TMP, nfa.max * sizeof(*nfa.st));
+	nfa.cset = XCALLOC(MTYPE_TMP, (len + 1) * sizeof(*nfa.cset));
+	nfa.p = str;
+
+	f = re_parse_alt(&nfa);
+	if (*nfa.p)
+		nfa.error = true;
+	nfa.start = f.start;
+	nfa.st[f.end].out = re_state(&nfa, RE_MATCH, -1, -1);
+
+	if (!nfa.error) {
+		dfa = XCALLOC(MTYPE_BGP_REGEXP, sizeof(*dfa));
+		if (!re_subset(dfa, &nfa)) {
+			bgp_regex_dfa_free(dfa);
+			dfa = NULL;
+		}
+	}
+
+	XFREE(MTYPE_TMP, nfa.st);
+	XFREE(MTYPE_TMP, nfa.cset);
+out:
+	XFREE(MTYPE_TMP, str);
+	return dfa;
+}
+
+void bgp_regex_dfa_free(struct bgp_regex_dfa *dfa)
+{
+	XFREE(MTYPE_BGP_REGEXP, dfa->flags);
+	XFREE(MTYPE_BGP_REGEXP, dfa->trans);
+	XFREE(MTYPE_BGP_REGEXP, dfa);
+}
+
+#define DFA_STEP(dfa, s, c)                                                    \
+	do {                                                                   \
+		s = (dfa)->trans[(s) * (dfa)->nclasses                         \
+				 + (dfa)->classmap[(uint8_t)(c)]];             \
+		if ((dfa)->flags[s] & DFA_ACCEPT)                              \
+			return true;                                           \
+	} while (0)
+
+bool bgp_regex_dfa_str(const struct bgp_regex_dfa *dfa, const char *str)
+{
+	unsigned int s = 0;
+
+	if (dfa->flags[s] & DFA_ACCEPT)
+		return true;
+	for (; *str; str++)
+		DFA_STEP(dfa, s, *str);
+	return dfa->flags[s] & DFA_ACCEPT_EOL;
+}
+
+/* Walks the segments in the format of aspath_make_str_count(). */
+bool bgp_regex_dfa_aspath(const struct bgp_regex_dfa *dfa,
+			  const struct aspath *aspath)
+{
+	const struct assegment *seg;
+	unsigned int s = 0;
+	char digits[10];
+	char sep, end;
+	as_t asn;
+	int i, n;
+
+	if (dfa->flags[s] & DFA_ACCEPT)
+		return true;
+
+	for (seg = aspath->segments; seg; seg = seg->next) {
+		switch (seg->type) {
+		case AS_SEQUENCE:
+			sep = ' ';
+			end = '\0';
+			break;
+		case AS_SET:
+			DFA_STEP(dfa, s, '{');
+			sep = ',';
+			end = '}';
+			break;
+		case AS_CONFED_SEQUENCE:
+			DFA_STEP(dfa, s, '(');
+			sep = ' ';
+			end = ')';
+			break;
+		case AS_CONFED_SET:
+			DFA_STEP(dfa, s, '[');
+			sep = ',';
+			end = ']';
+			break;
+		default:
+			/* such a path has no string either */
+			return false;
+		}
+
+		for (i = 0; i < seg->length; i++) {
+			if (i)
+				DFA_STEP(dfa, s, sep);
+			asn = seg->as[i];
+			n = 0;
+			do {
+				digits[n++] = '0' + asn % 10;
+				asn /= 10;
+			} while (asn);
+			while (n)
+				DFA_STEP(dfa, s, digits[--n]);
+		}
+
+		if (end)
+			DFA_STEP(dfa, s, end);
+		if (seg->next)
+			DFA_STEP(dfa, s, ' ');
+	}
+	return dfa->flags[s] & DFA_ACCEPT_EOL;
+}
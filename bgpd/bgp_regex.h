@@ -33,4 +33,14 @@ extern void bgp_regex_free(regex_t *regex);
 extern regex_t *bgp_regcomp(const char *str);
 extern int bgp_regexec(regex_t *regex, struct aspath *aspath);
 
+/* DFA for the common subset of the above, NULL if the pattern is not in it */
+struct bgp_regex_dfa;
+
+extern struct bgp_regex_dfa *bgp_regex_dfa_compile(const char *str);
+extern void bgp_regex_dfa_free(struct bgp_regex_dfa *dfa);
+extern bool bgp_regex_dfa_str(const struct bgp_regex_dfa *dfa,
+			      const char *str);
+extern bool bgp_regex_dfa_aspath(const struct bgp_regex_dfa *dfa,
+				 const struct aspath *aspath);
+
 #endif /* _QUAGGA_BGP_REGEX_H */
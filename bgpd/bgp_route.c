@@ -38,6 +38,7 @@
 #include "workqueue.h"
 #include "queue.h"
 #include "memory.h"
+#include "frr_pthread.h"
 #include "lib/json.h"
 #include "lib_errors.h"
 
@@ -246,6 +247,199 @@ struct bgp_path_info_extra *bgp_path_info_extra_get(struct bgp_path_info *pi)
 	return pi->extra;
 }
 
+/*
+ * Path arena.
+ *
+ * bgp_path_info is by far the most numerous object in bgpd, so rather than
+ * malloc'ing each one they are carved out of fixed size chunks, which drops
+ * the per-allocation malloc overhead.  A new path goes into the chunk of
+ * its dest's first path if that has room; this is only a placement hint,
+ * the paths of a dest are still a linked list and need not be adjacent.
+ * Freed slots go onto a per-chunk free list and a chunk is handed back
+ * once it is empty.
+ *
+ * Paths are only ever created and destroyed on the main thread.
+ */
+#define BGP_PATH_CHUNK_PATHS 1024
+#define BGP_PATH_CHUNK_MAX UINT16_MAX
+
+PREDECL_DLIST(bgp_path_chunks)
+
+struct bgp_path_chunk {
+	struct bgp_path_chunks_item item;
+
+	/* free slots, linked through ->next */
+	struct bgp_path_info *free;
+	/* slots handed out at least once, the rest are untouched */
+	unsigned int carved;
+	unsigned int live;
+	uint16_t id;
+
+	struct bgp_path_info paths[BGP_PATH_CHUNK_PATHS];
+};
+
+DECLARE_DLIST(bgp_path_chunks, struct bgp_path_chunk, item)
+
+static struct {
+	/* chunks with at least one free slot */
+	struct bgp_path_chunks_head partial;
+	/* indexed by bgp_path_info->arena, slot 0 is unused */
+	struct bgp_path_chunk **chunks;
+	unsigned int nchunks, alloc, cursor;
+	/* one empty chunk is kept around (and counted in nchunks) to avoid
+	 * churning when the path count hovers at a chunk boundary
+	 */
+	struct bgp_path_chunk *spare;
+	unsigned long count, single;
+} path_arena = {
+	.partial = INIT_DLIST(path_arena.partial),
+};
+
+static struct bgp_path_chunk *bgp_path_chunk_new(void)
+{
+	struct bgp_path_chunk *chunk;
+	unsigned int id;
+
+	if (path_arena.spare) {
+		chunk = path_arena.spare;
+		path_arena.spare = NULL;
+		return chunk;
+	}
+
+	if (path_arena.nchunks + 1 >= BGP_PATH_CHUNK_MAX)
+		return NULL;
+
+	if (path_arena.nchunks + 1 >= path_arena.alloc) {
+		unsigned int alloc = MAX(path_arena.alloc * 2, 16U);
+
+		path_arena.chunks =
+			XREALLOC(MTYPE_BGP_ROUTE_CHUNK, path_arena.chunks,
+				 alloc * sizeof(*path_arena.chunks));
+		memset(path_arena.chunks + path_arena.alloc, 0,
+		       (alloc - path_arena.alloc)
+			       * sizeof(*path_arena.chunks));
+		path_arena.alloc = alloc;
+	}
+
+	id = path_arena.cursor;
+	do {
+		if (++id >= path_arena.alloc)
+			id = 1;
+	} while (path_arena.chunks[id]);
+	path_arena.cursor = id;
+
+	chunk = XMALLOC(MTYPE_BGP_ROUTE_CHUNK, sizeof(*chunk));
+	chunk->free = NULL;
+	chunk->carved = 0;
+	chunk->live = 0;
+	chunk->id = id;
+	path_arena.chunks[id] = chunk;
+	path_arena.nchunks++;
+	return chunk;
+}
+
+static void bgp_path_chunk_free(struct bgp_path_chunk *chunk)
+{
+	if (!path_arena.spare) {
+		chunk->free = NULL;
+		chunk->carved = 0;
+		path_arena.spare = chunk;
+		return;
+	}
+
+	path_arena.chunks[chunk->id] = NULL;
+	path_arena.nchunks--;
+	XFREE(MTYPE_BGP_ROUTE_CHUNK, chunk);
+}
+
+/* Allocate a zeroed path, preferably next to the ones already on rn. */
+struct bgp_path_info *bgp_path_info_alloc(struct bgp_node *rn)
+{
+	struct bgp_path_chunk *chunk = NULL;
+	struct bgp_path_info *path, *first;
+
+	first = rn ? bgp_node_get_bgp_path_info(rn) : NULL;
+	if (first && first->arena) {
+		chunk = path_arena.chunks[first->arena];
+		if (chunk->live == BGP_PATH_CHUNK_PATHS)
+			chunk = NULL;
+	}
+	if (!chunk)
+		chunk = bgp_path_chunks_first(&path_arena.partial);
+	if (!chunk) {
+		chunk = bgp_path_chunk_new();
+		if (!chunk) {
+			path_arena.count++;
+			path_arena.single++;
+			return XCALLOC(MTYPE_BGP_ROUTE,
+				       sizeof(struct bgp_path_info));
+		}
+		bgp_path_chunks_add_head(&path_arena.partial, chunk);
+	}
+
+	if (chunk->free) {
+		path = chunk->free;
+		chunk->free = path->next;
+	} else
+		path = &chunk->paths[chunk->carved++];
+
+	if (++chunk->live == BGP_PATH_CHUNK_PATHS)
+		bgp_path_chunks_del(&path_arena.partial, chunk);
+
+	memset(path, 0, sizeof(*path));
+	path->arena = chunk->id;
+	path_arena.count++;
+	return path;
+}
+
+void bgp_path_info_release(struct bgp_path_info *path)
+{
+	struct bgp_path_chunk *chunk;
+
+	path_arena.count--;
+	if (!path->arena) {
+		path_arena.single--;
+		XFREE(MTYPE_BGP_ROUTE, path);
+		return;
+	}
+
+	chunk = path_arena.chunks[path->arena];
+	if (chunk->live-- == BGP_PATH_CHUNK_PATHS)
+		bgp_path_chunks_add_tail(&path_arena.partial, chunk);
+
+	if (!chunk->live) {
+		bgp_path_chunks_del(&path_arena.partial, chunk);
+		bgp_path_chunk_free(chunk);
+		return;
+	}
+
+	path->next = chunk->free;
+	chunk->free = path;
+}
+
+unsigned long bgp_path_info_count(void)
+{
+	return path_arena.count;
+}
+
+/* Memory held for paths, including unused arena slots. */
+size_t bgp_path_info_memory(void)
+{
+	return path_arena.nchunks * sizeof(struct bgp_path_chunk)
+	       + path_arena.single * sizeof(struct bgp_path_info);
+}
+
+static void bgp_path_arena_finish(void)
+{
+	if (path_arena.spare) {
+		path_arena.chunks[path_arena.spare->id] = NULL;
+		path_arena.nchunks--;
+		XFREE(MTYPE_BGP_ROUTE_CHUNK, path_arena.spare);
+	}
+	XFREE(MTYPE_BGP_ROUTE_CHUNK, path_arena.chunks);
+	path_arena.alloc = 0;
+}
+
 /* Free bgp route information. */
 static void bgp_path_info_free(struct bgp_path_info *path)
 {
@@ -261,7 +455,7 @@ static void bgp_path_info_free(struct bgp_path_info *path)
 
 	peer_unlock(path->peer); /* bgp_path_info peer reference */
 
-	XFREE(MTYPE_BGP_ROUTE, path);
+	bgp_path_info_release(path);
 }
 
 struct bgp_path_info *bgp_path_info_lock(struct bgp_path_info *path)
@@ -310,6 +504,7 @@ void bgp_path_info_add(struct bgp_node *rn, struct bgp_path_info *pi)
 	bgp_path_info_lock(pi);
 	bgp_lock_node(rn);
 	peer_lock(pi->peer); /* bgp_path_info peer reference */
+	SET_FLAG(rn->flags, BGP_NODE_SELECTION_STALE);
 }
 
 /* Do the actual removal of info from RIB, for use by bgp_process
@@ -325,6 +520,7 @@ void bgp_path_info_reap(struct bgp_node *rn, struct bgp_path_info *pi)
 
 	bgp_path_info_mpath_dequeue(pi);
 	bgp_path_info_unlock(pi);
+	SET_FLAG(rn->flags, BGP_NODE_SELECTION_STALE);
 	bgp_unlock_node(rn);
 }
 
@@ -1287,7 +1483,12 @@ static int bgp_input_modifier(struct peer *peer, struct prefix *p,
 		SET_FLAG(peer->rmap_type, PEER_RMAP_TYPE_IN);
 
 		/* Apply BGP route map to the attribute. */
-		ret = route_map_apply(rmap, p, RMAP_BGP, &rmap_path);
+		if (rmap_name)
+			ret = route_map_apply(rmap, p, RMAP_BGP, &rmap_path);
+		else
+			ret = bgp_route_map_apply_cached(
+				&peer->rmap_cache[afi][safi], rmap, p,
+				&rmap_path);
 
 		peer->rmap_type = 0;
 
@@ -1818,9 +2019,13 @@ int subgroup_announce_check(struct bgp_node *rn, struct bgp_path_info *pi,
 		if (pi->extra && pi->extra->suppress)
 			ret = route_map_apply(UNSUPPRESS_MAP(filter), p,
 					      RMAP_BGP, &rmap_path);
-		else
+		else if (rmap_path.attr != attr)
 			ret = route_map_apply(ROUTE_MAP_OUT(filter), p,
 					      RMAP_BGP, &rmap_path);
+		else
+			ret = bgp_route_map_apply_cached(&subgrp->rmap_cache,
+							 ROUTE_MAP_OUT(filter),
+							 p, &rmap_path);
 
 		peer->rmap_type = 0;
 
@@ -1957,23 +2162,34 @@ int subgroup_announce_check(struct bgp_node *rn, struct bgp_path_info *pi,
 	return 1;
 }
 
-void bgp_best_selection(struct bgp *bgp, struct bgp_node *rn,
-			struct bgp_maxpaths_cfg *mpath_cfg,
-			struct bgp_path_info_pair *result, afi_t afi,
-			safi_t safi)
+/* Best path selection, split in two steps; see bgp_process_batch() */
+struct bgp_best_sel {
+	struct bgp_path_info *old;
+	struct bgp_path_info *new;
+	struct list mp_list;
+};
+
+/*
+ * Find the best path of rn and the paths which qualify as multipaths.
+ * This only touches rn and its paths, so it can run for different nodes
+ * on several pthreads at once.
+ */
+static void bgp_best_selection_compute(struct bgp *bgp, struct bgp_node *rn,
+				       struct bgp_maxpaths_cfg *mpath_cfg,
+				       struct bgp_best_sel *sel, afi_t afi,
+				       safi_t safi)
 {
 	struct bgp_path_info *new_select;
 	struct bgp_path_info *old_select;
 	struct bgp_path_info *pi;
 	struct bgp_path_info *pi1;
 	struct bgp_path_info *pi2;
-	struct bgp_path_info *nextpi = NULL;
 	int paths_eq, do_mpath, debug;
-	struct list mp_list;
+	struct list *mp_list = &sel->mp_list;
 	char pfx_buf[PREFIX2STR_BUFFER];
 	char path_buf[PATH_ADDPATH_STR_BUFFER];
 
-	bgp_mp_list_init(&mp_list);
+	bgp_mp_list_init(mp_list);
 	do_mpath =
 		(mpath_cfg->maxpaths_ebgp > 1 || mpath_cfg->maxpaths_ibgp > 1);
 
@@ -2059,19 +2275,14 @@ void bgp_best_selection(struct bgp *bgp, struct bgp_node *rn,
 	/* Check old selected route and new selected route. */
 	old_select = NULL;
 	new_select = NULL;
-	for (pi = bgp_node_get_bgp_path_info(rn);
-	     (pi != NULL) && (nextpi = pi->next, 1); pi = nextpi) {
+	for (pi = bgp_node_get_bgp_path_info(rn); pi; pi = pi->next) {
 		if (CHECK_FLAG(pi->flags, BGP_PATH_SELECTED))
 			old_select = pi;
 
 		if (BGP_PATH_HOLDDOWN(pi)) {
-			/* reap REMOVED routes, if needs be
-			 * selected route must stay for a while longer though
+			/* REMOVED routes are reaped in
+			 * bgp_best_selection_apply()
 			 */
-			if (CHECK_FLAG(pi->flags, BGP_PATH_REMOVED)
-			    && (pi != old_select))
-				bgp_path_info_reap(rn, pi);
-
 			if (debug)
 				zlog_debug("%s: pi %p in holddown", __func__,
 					   pi);
@@ -2124,8 +2335,7 @@ void bgp_best_selection(struct bgp *bgp, struct bgp_node *rn,
 	}
 
 	if (do_mpath && new_select) {
-		for (pi = bgp_node_get_bgp_path_info(rn);
-		     (pi != NULL) && (nextpi = pi->next, 1); pi = nextpi) {
+		for (pi = bgp_node_get_bgp_path_info(rn); pi; pi = pi->next) {
 
 			if (debug)
 				bgp_path_info_path_with_addpath_rx_str(
@@ -2136,7 +2346,7 @@ void bgp_best_selection(struct bgp *bgp, struct bgp_node *rn,
 					zlog_debug(
 						"%s: %s is the bestpath, add to the multipath list",
 						pfx_buf, path_buf);
-				bgp_mp_list_add(&mp_list, pi);
+				bgp_mp_list_add(mp_list, pi);
 				continue;
 			}
 
@@ -2166,22 +2376,58 @@ void bgp_best_selection(struct bgp *bgp, struct bgp_node *rn,
 					zlog_debug(
 						"%s: %s is equivalent to the bestpath, add to the multipath list",
 						pfx_buf, path_buf);
-				bgp_mp_list_add(&mp_list, pi);
+				bgp_mp_list_add(mp_list, pi);
 			}
 		}
 	}
 
-	bgp_path_info_mpath_update(rn, new_select, old_select, &mp_list,
+	sel->old = old_select;
+	sel->new = new_select;
+}
+
+/*
+ * Apply a selection made by bgp_best_selection_compute(): reap removed
+ * paths and update multipath and addpath state.
+ */
+static void bgp_best_selection_apply(struct bgp *bgp, struct bgp_node *rn,
+				     struct bgp_maxpaths_cfg *mpath_cfg,
+				     struct bgp_best_sel *sel,
+				     struct bgp_path_info_pair *result,
+				     afi_t afi, safi_t safi)
+{
+	struct bgp_path_info *pi;
+	struct bgp_path_info *nextpi = NULL;
+
+	/* reap REMOVED routes, if needs be
+	 * selected route must stay for a while longer though
+	 */
+	for (pi = bgp_node_get_bgp_path_info(rn);
+	     (pi != NULL) && (nextpi = pi->next, 1); pi = nextpi)
+		if (BGP_PATH_HOLDDOWN(pi)
+		    && CHECK_FLAG(pi->flags, BGP_PATH_REMOVED)
+		    && pi != sel->old)
+			bgp_path_info_reap(rn, pi);
+
+	bgp_path_info_mpath_update(rn, sel->new, sel->old, &sel->mp_list,
 				   mpath_cfg);
-	bgp_path_info_mpath_aggregate_update(new_select, old_select);
-	bgp_mp_list_clear(&mp_list);
+	bgp_path_info_mpath_aggregate_update(sel->new, sel->old);
+	bgp_mp_list_clear(&sel->mp_list);
 
 	bgp_addpath_update_ids(bgp, rn, afi, safi);
 
-	result->old = old_select;
-	result->new = new_select;
+	result->old = sel->old;
+	result->new = sel->new;
+}
 
-	return;
+void bgp_best_selection(struct bgp *bgp, struct bgp_node *rn,
+			struct bgp_maxpaths_cfg *mpath_cfg,
+			struct bgp_path_info_pair *result, afi_t afi,
+			safi_t safi)
+{
+	struct bgp_best_sel sel;
+
+	bgp_best_selection_compute(bgp, rn, mpath_cfg, &sel, afi, safi);
+	bgp_best_selection_apply(bgp, rn, mpath_cfg, &sel, result, afi, safi);
 }
 
 /*
@@ -2316,7 +2562,8 @@ struct bgp_process_queue {
  *     is being removed.
  */
 static void bgp_process_main_one(struct bgp *bgp, struct bgp_node *rn,
-				 afi_t afi, safi_t safi)
+				 struct bgp_best_sel *sel, afi_t afi,
+				 safi_t safi)
 {
 	struct bgp_path_info *new_select;
 	struct bgp_path_info *old_select;
@@ -2325,6 +2572,8 @@ static void bgp_process_main_one(struct bgp *bgp, struct bgp_node *rn,
 	int debug = 0;
 
 	if (bgp_flag_check(bgp, BGP_FLAG_DELETE_IN_PROGRESS)) {
+		if (sel)
+			bgp_mp_list_clear(&sel->mp_list);
 		if (rn)
 			debug = bgp_debug_bestpath(&rn->p);
 		if (debug) {
@@ -2360,9 +2609,22 @@ static void bgp_process_main_one(struct bgp *bgp, struct bgp_node *rn,
 			   afi2str(afi), safi2str(safi));
 	}
 
-	/* Best path selection. */
-	bgp_best_selection(bgp, rn, &bgp->maxpaths[afi][safi], &old_and_new,
-			   afi, safi);
+	/* Best path selection, unless a best-path pthread already did it and
+	 * the paths of rn did not change since.
+	 */
+	if (sel && CHECK_FLAG(rn->flags, BGP_NODE_SELECTION_STALE)) {
+		if (debug)
+			zlog_debug("%s: p=%s paths changed, selecting again",
+				   __func__, pfx_buf);
+		bgp_mp_list_clear(&sel->mp_list);
+		sel = NULL;
+	}
+	if (sel)
+		bgp_best_selection_apply(bgp, rn, &bgp->maxpaths[afi][safi],
+					 sel, &old_and_new, afi, safi);
+	else
+		bgp_best_selection(bgp, rn, &bgp->maxpaths[afi][safi],
+				   &old_and_new, afi, safi);
 	old_select = old_and_new.old;
 	new_select = old_and_new.new;
 
@@ -2583,10 +2845,147 @@ static void bgp_process_main_one(struct bgp *bgp, struct bgp_node *rn,
 	if (old_select && CHECK_FLAG(old_select->flags, BGP_PATH_REMOVED))
 		bgp_path_info_reap(rn, old_select);
 
-	UNSET_FLAG(rn->flags, BGP_NODE_PROCESS_SCHEDULED);
+	UNSET_FLAG(rn->flags,
+		   BGP_NODE_PROCESS_SCHEDULED | BGP_NODE_SELECTION_STALE);
 	return;
 }
 
+/*
+ * Best-path selection for a batch of queued nodes, shared between the
+ * main pthread and the best-path pthreads.  Nodes are handed out in chunks
+ * of BGP_BESTPATH_CHUNK; the results are applied in bgp_process_batch().
+ */
+struct bgp_bestpath_batch {
+	struct bgp *bgp;
+	struct bgp_node **rns;
+	struct bgp_best_sel *sel;
+	unsigned int count;
+	_Atomic unsigned int next;
+
+	pthread_mutex_t mtx;
+	pthread_cond_t cond;
+	unsigned int running; /* best-path pthreads still working */
+};
+
+/* Fewer queued nodes than this are not worth waking up the pthreads */
+#define BGP_BESTPATH_BATCH_MIN 64
+#define BGP_BESTPATH_CHUNK 32
+
+static void bgp_bestpath_batch_run(struct bgp_bestpath_batch *batch)
+{
+	struct bgp_table *table;
+	unsigned int i, end;
+
+	while ((i = atomic_fetch_add_explicit(&batch->next, BGP_BESTPATH_CHUNK,
+					      memory_order_relaxed))
+	       < batch->count) {
+		end = MIN(i + BGP_BESTPATH_CHUNK, batch->count);
+		for (; i < end; i++) {
+			table = bgp_node_table(batch->rns[i]);
+			bgp_best_selection_compute(
+				batch->bgp, batch->rns[i],
+				&batch->bgp->maxpaths[table->afi][table->safi],
+				&batch->sel[i], table->afi, table->safi);
+		}
+	}
+}
+
+static int bgp_bestpath_work(struct thread *thread)
+{
+	struct bgp_bestpath_batch *batch = THREAD_ARG(thread);
+
+	bgp_bestpath_batch_run(batch);
+
+	frr_with_mutex(&batch->mtx) {
+		if (--batch->running == 0)
+			pthread_cond_signal(&batch->cond);
+	}
+	return 0;
+}
+
+/*
+ * peer_sort() caches its result in the peer; make sure the cache is
+ * current so the best-path pthreads only ever read it.
+ */
+static void bgp_bestpath_peer_sort_refresh(void)
+{
+	struct listnode *node, *nnode;
+	struct bgp *bgp;
+	struct peer *peer;
+
+	for (ALL_LIST_ELEMENTS_RO(bm->bgp, node, bgp)) {
+		peer_sort(bgp->peer_self);
+		for (ALL_LIST_ELEMENTS_RO(bgp->peer, nnode, peer))
+			peer_sort(peer);
+	}
+}
+
+/*
+ * Select the best paths of all nodes queued in pqnode on the best-path
+ * pthreads, then apply the results on the main pthread in queue order.
+ * Nodes whose paths change while the results are applied are marked
+ * BGP_NODE_SELECTION_STALE and selected again by bgp_process_main_one().
+ */
+static void bgp_process_batch(struct bgp_process_queue *pqnode)
+{
+	struct bgp_bestpath_batch batch = {};
+	struct bgp_table *table;
+	struct bgp_node *rn;
+	unsigned int i, count = 0;
+
+	STAILQ_FOREACH (rn, &pqnode->pqueue, pq)
+		count++;
+
+	batch.bgp = pqnode->bgp;
+	batch.rns = XMALLOC(MTYPE_BGP_BESTPATH_BATCH,
+			    count * sizeof(*batch.rns));
+	batch.sel = XCALLOC(MTYPE_BGP_BESTPATH_BATCH,
+			    count * sizeof(*batch.sel));
+
+	/* nodes stay BGP_NODE_PROCESS_SCHEDULED until applied */
+	while (!STAILQ_EMPTY(&pqnode->pqueue)) {
+		rn = STAILQ_FIRST(&pqnode->pqueue);
+		STAILQ_REMOVE_HEAD(&pqnode->pqueue, pq);
+		STAILQ_NEXT(rn, pq) = NULL; /* complete unlink */
+		UNSET_FLAG(rn->flags, BGP_NODE_SELECTION_STALE);
+		batch.rns[batch.count++] = rn;
+	}
+
+	bgp_bestpath_peer_sort_refresh();
+
+	pthread_mutex_init(&batch.mtx, NULL);
+	pthread_cond_init(&batch.cond, NULL);
+	batch.running = bm->bestpath_workers;
+
+	for (i = 0; i < bm->bestpath_workers; i++)
+		thread_add_event(bgp_pth_bestpath[i]->master, bgp_bestpath_work,
+				 &batch, 0, NULL);
+
+	bgp_bestpath_batch_run(&batch);
+
+	frr_with_mutex(&batch.mtx) {
+		while (batch.running)
+			pthread_cond_wait(&batch.cond, &batch.mtx);
+	}
+
+	pthread_cond_destroy(&batch.cond);
+	pthread_mutex_destroy(&batch.mtx);
+
+	for (i = 0; i < batch.count; i++) {
+		rn = batch.rns[i];
+		table = bgp_node_table(rn);
+		/* note, new RNs may be added as part of processing */
+		bgp_process_main_one(batch.bgp, rn, &batch.sel[i], table->afi,
+				     table->safi);
+
+		bgp_unlock_node(rn);
+		bgp_table_unlock(table);
+	}
+
+	XFREE(MTYPE_BGP_BESTPATH_BATCH, batch.sel);
+	XFREE(MTYPE_BGP_BESTPATH_BATCH, batch.rns);
+}
+
 static wq_item_status bgp_process_wq(struct work_queue *wq, void *data)
 {
 	struct bgp_process_queue *pqnode = data;
@@ -2596,19 +2995,25 @@ static wq_item_status bgp_process_wq(struct work_queue *wq, void *data)
 
 	/* eoiu marker */
 	if (CHECK_FLAG(pqnode->flags, BGP_PROCESS_QUEUE_EOIU_MARKER)) {
-		bgp_process_main_one(bgp, NULL, 0, 0);
+		bgp_process_main_one(bgp, NULL, NULL, 0, 0);
 		/* should always have dedicated wq call */
 		assert(STAILQ_FIRST(&pqnode->pqueue) == NULL);
 		return WQ_SUCCESS;
 	}
 
+	if (bm->bestpath_workers
+	    && pqnode->queued >= BGP_BESTPATH_BATCH_MIN
+	    && !bgp_flag_check(bgp, BGP_FLAG_DELETE_IN_PROGRESS))
+		bgp_process_batch(pqnode);
+
+	/* nodes queued while the batch was applied are handled here */
 	while (!STAILQ_EMPTY(&pqnode->pqueue)) {
 		rn = STAILQ_FIRST(&pqnode->pqueue);
 		STAILQ_REMOVE_HEAD(&pqnode->pqueue, pq);
 		STAILQ_NEXT(rn, pq) = NULL; /* complete unlink */
 		table = bgp_node_table(rn);
 		/* note, new RNs may be added as part of processing */
-		bgp_process_main_one(bgp, rn, table->afi, table->safi);
+		bgp_process_main_one(bgp, rn, NULL, table->afi, table->safi);
 
 		bgp_unlock_node(rn);
 		bgp_table_unlock(table);
@@ -2661,9 +3066,13 @@ void bgp_process(struct bgp *bgp, struct bgp_node *rn, afi_t afi, safi_t safi)
 	struct bgp_process_queue *pqnode;
 	int pqnode_reuse = 0;
 
-	/* already scheduled for processing? */
-	if (CHECK_FLAG(rn->flags, BGP_NODE_PROCESS_SCHEDULED))
+	/* already scheduled for processing?  If its best path was already
+	 * selected in a batch, it has to be selected again.
+	 */
+	if (CHECK_FLAG(rn->flags, BGP_NODE_PROCESS_SCHEDULED)) {
+		SET_FLAG(rn->flags, BGP_NODE_SELECTION_STALE);
 		return;
+	}
 
 	if (wq == NULL)
 		return;
@@ -2893,7 +3302,7 @@ struct bgp_path_info *info_make(int type, int sub_type, unsigned short instance,
 	struct bgp_path_info *new;
 
 	/* Make new BGP info. */
-	new = XCALLOC(MTYPE_BGP_ROUTE, sizeof(struct bgp_path_info));
+	new = bgp_path_info_alloc(rn);
 	new->type = type;
 	new->instance = instance;
 	new->sub_type = sub_type;
@@ -3924,16 +4333,17 @@ static void bgp_soft_reconfig_table(struct peer *peer, afi_t afi, safi_t safi,
 {
 	int ret;
 	struct bgp_node *rn;
-	struct bgp_adj_in *ain;
+	struct bgp_adj_in ain;
+
+	/* nothing stored for this peer, no need to walk the table */
+	if (!peer->adj_in[afi][safi])
+		return;
 
 	if (!table)
 		table = peer->bgp->rib[afi][safi];
 
 	for (rn = bgp_table_top(table); rn; rn = bgp_route_next(rn))
-		for (ain = rn->adj_in; ain; ain = ain->next) {
-			if (ain->peer != peer)
-				continue;
-
+		for (ALL_ADJ_IN_ENTRIES(peer, rn, ain)) {
 			struct bgp_path_info *pi =
 				bgp_node_get_bgp_path_info(rn);
 			uint32_t num_labels = 0;
@@ -3950,8 +4360,8 @@ static void bgp_soft_reconfig_table(struct peer *peer, afi_t afi, safi_t safi,
 			else
 				memset(&evpn, 0, sizeof(evpn));
 
-			ret = bgp_update(peer, &rn->p, ain->addpath_rx_id,
-					 ain->attr, afi, safi, ZEBRA_ROUTE_BGP,
+			ret = bgp_update(peer, &rn->p, ain.addpath_rx_id,
+					 ain.attr, afi, safi, ZEBRA_ROUTE_BGP,
 					 BGP_ROUTE_NORMAL, prd, label_pnt,
 					 num_labels, 1, &evpn);
 
@@ -4100,8 +4510,6 @@ static void bgp_clear_route_table(struct peer *peer, afi_t afi, safi_t safi,
 
 	for (rn = bgp_table_top(table); rn; rn = bgp_route_next(rn)) {
 		struct bgp_path_info *pi, *next;
-		struct bgp_adj_in *ain;
-		struct bgp_adj_in *ain_next;
 
 		/* XXX:TODO: This is suboptimal, every non-empty route_node is
 		 * queued for every clearing peer, regardless of whether it is
@@ -4134,22 +4542,9 @@ static void bgp_clear_route_table(struct peer *peer, afi_t afi, safi_t safi,
 		 * this may actually be achievable. It doesn't seem to be a huge
 		 * problem at this time,
 		 *
-		 * It is possible that we have multiple paths for a prefix from
-		 * a peer
-		 * if that peer is using AddPath.
+		 * The peer's adj-in index (2) is dropped as a whole by
+		 * bgp_clear_route() rather than node by node here.
 		 */
-		ain = rn->adj_in;
-		while (ain) {
-			ain_next = ain->next;
-
-			if (ain->peer == peer) {
-				bgp_adj_in_remove(rn, ain);
-				bgp_unlock_node(rn);
-			}
-
-			ain = ain_next;
-		}
-
 		for (pi = bgp_node_get_bgp_path_info(rn); pi; pi = next) {
 			next = pi->next;
 			if (pi->peer != peer)
@@ -4203,6 +4598,11 @@ void bgp_clear_route(struct peer *peer, afi_t afi, safi_t safi)
 	if (!peer->clear_node_queue->thread)
 		peer_lock(peer);
 
+	bgp_clear_adj_in(peer, afi, safi);
+
+	/* Cached route-map results hold on to attrs from this session */
+	bgp_rmap_cache_free(&peer->rmap_cache[afi][safi]);
+
 	if (safi != SAFI_MPLS_VPN && safi != SAFI_ENCAP && safi != SAFI_EVPN)
 		bgp_clear_route_table(peer, afi, safi, NULL);
 	else
@@ -4233,34 +4633,6 @@ void bgp_clear_route_all(struct peer *peer)
 #endif
 }
 
-void bgp_clear_adj_in(struct peer *peer, afi_t afi, safi_t safi)
-{
-	struct bgp_table *table;
-	struct bgp_node *rn;
-	struct bgp_adj_in *ain;
-	struct bgp_adj_in *ain_next;
-
-	table = peer->bgp->rib[afi][safi];
-
-	/* It is possible that we have multiple paths for a prefix from a peer
-	 * if that peer is using AddPath.
-	 */
-	for (rn = bgp_table_top(table); rn; rn = bgp_route_next(rn)) {
-		ain = rn->adj_in;
-
-		while (ain) {
-			ain_next = ain->next;
-
-			if (ain->peer == peer) {
-				bgp_adj_in_remove(rn, ain);
-				bgp_unlock_node(rn);
-			}
-
-			ain = ain_next;
-		}
-	}
-}
-
 void bgp_clear_stale_route(struct peer *peer, afi_t afi, safi_t safi)
 {
 	struct bgp_node *rn;
@@ -4425,10 +4797,16 @@ static int bgp_addpath_encode_rx(struct peer *peer, afi_t afi, safi_t safi)
 			      PEER_CAP_ADDPATH_AF_TX_RCV));
 }
 
-/* Parse NLRI stream.  Withdraw NLRI is recognized by NULL attr
-   value. */
-int bgp_nlri_parse_ip(struct peer *peer, struct attr *attr,
-		      struct bgp_nlri *packet)
+/* Callback for each prefix found by bgp_nlri_walk_ip() */
+typedef int (*bgp_nlri_prefix_cb)(struct peer *peer, struct prefix *p,
+				  uint32_t addpath_id, void *arg);
+
+/* Walk an IPv4/IPv6 NLRI stream, checking it and calling 'cb' for each
+   usable prefix. Returns BGP_NLRI_PARSE_OK, a parse error, or the
+   first error returned by 'cb'. */
+static int bgp_nlri_walk_ip(struct peer *peer, const struct bgp_nlri *packet,
+			    int addpath_encoded, bgp_nlri_prefix_cb cb,
+			    void *arg)
 {
 	uint8_t *pnt;
 	uint8_t *lim;
@@ -4437,7 +4815,6 @@ int bgp_nlri_parse_ip(struct peer *peer, struct attr *attr,
 	int ret;
 	afi_t afi;
 	safi_t safi;
-	int addpath_encoded;
 	uint32_t addpath_id;
 
 	pnt = packet->nlri;
@@ -4445,7 +4822,6 @@ int bgp_nlri_parse_ip(struct peer *peer, struct attr *attr,
 	afi = packet->afi;
 	safi = packet->safi;
 	addpath_id = 0;
-	addpath_encoded = bgp_addpath_encode_rx(peer, afi, safi);
 
 	/* RFC4771 6.3 The NLRI field in the UPDATE message is checked for
 	   syntactic validity.  If the field is syntactically incorrect,
@@ -4552,25 +4928,9 @@ int bgp_nlri_parse_ip(struct peer *peer, struct attr *attr,
 			}
 		}
 
-		/* Normal process. */
-		if (attr)
-			ret = bgp_update(peer, &p, addpath_id, attr, afi, safi,
-					 ZEBRA_ROUTE_BGP, BGP_ROUTE_NORMAL,
-					 NULL, NULL, 0, 0, NULL);
-		else
-			ret = bgp_withdraw(peer, &p, addpath_id, attr, afi,
-					   safi, ZEBRA_ROUTE_BGP,
-					   BGP_ROUTE_NORMAL, NULL, NULL, 0,
-					   NULL);
-
-		/* Do not send BGP notification twice when maximum-prefix count
-		 * overflow. */
-		if (CHECK_FLAG(peer->sflags, PEER_STATUS_PREFIX_OVERFLOW))
-			return BGP_NLRI_PARSE_ERROR_PREFIX_OVERFLOW;
-
-		/* Address family configuration mismatch. */
-		if (ret < 0)
-			return BGP_NLRI_PARSE_ERROR_ADDRESS_FAMILY;
+		ret = cb(peer, &p, addpath_id, arg);
+		if (ret != BGP_NLRI_PARSE_OK)
+			return ret;
 	}
 
 	/* Packet length consistency check. */
@@ -4585,6 +4945,130 @@ int bgp_nlri_parse_ip(struct peer *peer, struct attr *attr,
 	return BGP_NLRI_PARSE_OK;
 }
 
+struct bgp_nlri_update_arg {
+	struct attr *attr;
+	afi_t afi;
+	safi_t safi;
+};
+
+/* Update or withdraw one prefix from an NLRI stream */
+static int bgp_nlri_update_prefix(struct peer *peer, struct prefix *p,
+				  uint32_t addpath_id, void *arg)
+{
+	struct bgp_nlri_update_arg *ua = arg;
+	int ret;
+
+	/* Normal process. */
+	if (ua->attr)
+		ret = bgp_update(peer, p, addpath_id, ua->attr, ua->afi,
+				 ua->safi, ZEBRA_ROUTE_BGP, BGP_ROUTE_NORMAL,
+				 NULL, NULL, 0, 0, NULL);
+	else
+		ret = bgp_withdraw(peer, p, addpath_id, ua->attr, ua->afi,
+				   ua->safi, ZEBRA_ROUTE_BGP, BGP_ROUTE_NORMAL,
+				   NULL, NULL, 0, NULL);
+
+	/* Do not send BGP notification twice when maximum-prefix count
+	 * overflow. */
+	if (CHECK_FLAG(peer->sflags, PEER_STATUS_PREFIX_OVERFLOW))
+		return BGP_NLRI_PARSE_ERROR_PREFIX_OVERFLOW;
+
+	/* Address family configuration mismatch. */
+	if (ret < 0)
+		return BGP_NLRI_PARSE_ERROR_ADDRESS_FAMILY;
+
+	return BGP_NLRI_PARSE_OK;
+}
+
+/* Parse NLRI stream.  Withdraw NLRI is recognized by NULL attr
+   value. */
+int bgp_nlri_parse_ip(struct peer *peer, struct attr *attr,
+		      struct bgp_nlri *packet)
+{
+	struct bgp_nlri_update_arg ua = {
+		.attr = attr, .afi = packet->afi, .safi = packet->safi,
+	};
+
+	return bgp_nlri_walk_ip(
+		peer, packet,
+		bgp_addpath_encode_rx(peer, packet->afi, packet->safi),
+		bgp_nlri_update_prefix, &ua);
+}
+
+/* Collect one prefix into a decoded NLRI stream */
+static int bgp_nlri_decode_prefix(struct peer *peer, struct prefix *p,
+				  uint32_t addpath_id, void *arg)
+{
+	struct bgp_nlri_decoded *dec = arg;
+
+	if (dec->count == dec->size) {
+		dec->size = dec->size ? dec->size * 2 : 16;
+		dec->prefixes = XREALLOC(MTYPE_BGP_NLRI_DECODED, dec->prefixes,
+					 dec->size * sizeof(*dec->prefixes));
+	}
+
+	dec->prefixes[dec->count].p = *p;
+	dec->prefixes[dec->count].addpath_id = addpath_id;
+	dec->count++;
+
+	return BGP_NLRI_PARSE_OK;
+}
+
+/* Decode an IPv4/IPv6 NLRI stream ahead of time, without touching any
+   routing or session state; this is safe to call outside the main
+   pthread, with the caller saying whether the peer sends ADDPATH IDs.
+   The result is applied later by bgp_nlri_apply_ip(). */
+void bgp_nlri_decode_ip(struct peer *peer, const struct bgp_nlri *packet,
+			int addpath_encoded, struct bgp_nlri_decoded *dec)
+{
+	dec->nlri = *packet;
+	dec->addpath_encoded = addpath_encoded;
+	dec->count = 0;
+	dec->ret = bgp_nlri_walk_ip(peer, packet, dec->addpath_encoded,
+				    bgp_nlri_decode_prefix, dec);
+}
+
+/* Check that a decoded NLRI stream can stand in for 'packet' */
+bool bgp_nlri_decoded_match(struct peer *peer,
+			    const struct bgp_nlri_decoded *dec,
+			    const struct bgp_nlri *packet)
+{
+	return dec->nlri.nlri == packet->nlri
+	       && dec->nlri.length == packet->length
+	       && dec->nlri.afi == packet->afi
+	       && dec->nlri.safi == packet->safi
+	       && dec->addpath_encoded
+			  == bgp_addpath_encode_rx(peer, packet->afi,
+						   packet->safi);
+}
+
+/* Update or withdraw the prefixes of a decoded NLRI stream; returns what
+   bgp_nlri_parse_ip() would have. */
+int bgp_nlri_apply_ip(struct peer *peer, struct attr *attr,
+		      const struct bgp_nlri_decoded *dec)
+{
+	struct bgp_nlri_update_arg ua = {
+		.attr = attr, .afi = dec->nlri.afi, .safi = dec->nlri.safi,
+	};
+	uint32_t i;
+	int ret;
+
+	for (i = 0; i < dec->count; i++) {
+		ret = bgp_nlri_update_prefix(peer, &dec->prefixes[i].p,
+					     dec->prefixes[i].addpath_id, &ua);
+		if (ret != BGP_NLRI_PARSE_OK)
+			return ret;
+	}
+
+	return dec->ret;
+}
+
+void bgp_nlri_decoded_fini(struct bgp_nlri_decoded *dec)
+{
+	XFREE(MTYPE_BGP_NLRI_DECODED, dec->prefixes);
+	dec->count = dec->size = 0;
+}
+
 static struct bgp_static *bgp_static_new(void)
 {
 	return XCALLOC(MTYPE_BGP_STATIC, sizeof(struct bgp_static));
@@ -9150,28 +9634,60 @@ static int bgp_show_community(struct vty *vty, struct bgp *bgp,
 			      safi_t safi, bool use_json);
 
 
-static int bgp_show_table(struct vty *vty, struct bgp *bgp, safi_t safi,
-			  struct bgp_table *table, enum bgp_show_type type,
-			  void *output_arg, bool use_json, char *rd,
-			  int is_last, unsigned long *output_cum,
-			  unsigned long *total_cum,
-			  unsigned long *json_header_depth)
-{
-	struct bgp_path_info *pi;
+/*
+ * One table walk of bgp_show_table(), kept around between the pieces of a
+ * streamed show, see bgp_show_stream().
+ */
+struct bgp_show_walk {
+	struct bgp *bgp;
+	struct bgp_table *table;
+	safi_t safi;
+	enum bgp_show_type type;
+	void *output_arg;
+	bool use_json;
+	char *rd;
+
+	/* next node to show, locked */
 	struct bgp_node *rn;
-	int header = 1;
-	int display;
-	unsigned long output_count = 0;
-	unsigned long total_count = 0;
-	struct prefix *p;
-	char buf2[BUFSIZ];
-	json_object *json_paths = NULL;
-	int first = 1;
 
-	if (output_cum && *output_cum != 0)
-		header = 0;
+	int header;
+	bool first;
+	unsigned long output_count;
+	unsigned long total_count;
+	unsigned long json_header_depth;
+
+	/* stop once this many prefixes were displayed, 0 for no limit */
+	unsigned long page_size;
+	/* last prefix of a page that has more after it */
+	bool page_more;
+	struct prefix page_last;
+};
+
+/* Prefixes looked at per piece of a streamed show */
+#define BGP_SHOW_STREAM_CHUNK 1000
 
-	if (use_json && !*json_header_depth) {
+static void bgp_show_walk_init(struct bgp_show_walk *walk, struct bgp *bgp,
+			       safi_t safi, struct bgp_table *table,
+			       enum bgp_show_type type, void *output_arg,
+			       bool use_json, char *rd)
+{
+	memset(walk, 0, sizeof(*walk));
+	walk->bgp = bgp;
+	walk->table = table;
+	walk->safi = safi;
+	walk->type = type;
+	walk->output_arg = output_arg;
+	walk->use_json = use_json;
+	walk->rd = rd;
+	walk->header = 1;
+	walk->first = true;
+}
+
+static void bgp_show_table_begin(struct vty *vty, struct bgp_show_walk *walk)
+{
+	struct bgp *bgp = walk->bgp;
+
+	if (walk->use_json && !walk->json_header_depth) {
 		vty_out(vty,
 			"{\n \"vrfId\": %d,\n \"vrfName\": \"%s\",\n \"tableVersion\": %" PRId64
 			",\n \"routerId\": \"%s\",\n \"defaultLocPrf\": %u,\n"
@@ -9180,300 +9696,389 @@ static int bgp_show_table(struct vty *vty, struct bgp *bgp, safi_t safi,
 			bgp->inst_type == BGP_INSTANCE_TYPE_DEFAULT
 						? VRF_DEFAULT_NAME
 						: bgp->name,
-			table->version, inet_ntoa(bgp->router_id),
+			walk->table->version, inet_ntoa(bgp->router_id),
 			bgp->default_local_pref, bgp->as);
-		*json_header_depth = 2;
-		if (rd) {
+		walk->json_header_depth = 2;
+		if (walk->rd) {
 			vty_out(vty, " \"routeDistinguishers\" : {");
-			++*json_header_depth;
+			++walk->json_header_depth;
 		}
 	}
 
-	if (use_json && rd) {
-		vty_out(vty, " \"%s\" : { ", rd);
+	if (walk->use_json && walk->rd) {
+		vty_out(vty, " \"%s\" : { ", walk->rd);
 	}
+}
 
-	/* Start processing of routes. */
-	for (rn = bgp_table_top(table); rn; rn = bgp_route_next(rn)) {
-		pi = bgp_node_get_bgp_path_info(rn);
-		if (pi == NULL)
-			continue;
+/* Returns whether any path of rn was displayed. */
+static bool bgp_show_node(struct vty *vty, struct bgp_show_walk *walk,
+			  struct bgp_node *rn)
+{
+	struct bgp *bgp = walk->bgp;
+	struct bgp_table *table = walk->table;
+	enum bgp_show_type type = walk->type;
+	void *output_arg = walk->output_arg;
+	bool use_json = walk->use_json;
+	safi_t safi = walk->safi;
+	char *rd = walk->rd;
+	struct bgp_path_info *pi;
+	int display;
+	struct prefix *p;
+	char buf2[BUFSIZ];
+	json_object *json_paths = NULL;
 
-		display = 0;
-		if (use_json)
-			json_paths = json_object_new_array();
-		else
-			json_paths = NULL;
-
-		for (; pi; pi = pi->next) {
-			total_count++;
-			if (type == bgp_show_type_flap_statistics
-			    || type == bgp_show_type_flap_neighbor
-			    || type == bgp_show_type_dampend_paths
-			    || type == bgp_show_type_damp_neighbor) {
-				if (!(pi->extra && pi->extra->damp_info))
-					continue;
-			}
-			if (type == bgp_show_type_regexp) {
-				regex_t *regex = output_arg;
+	pi = bgp_node_get_bgp_path_info(rn);
+	if (pi == NULL)
+		return false;
 
-				if (bgp_regexec(regex, pi->attr->aspath)
-				    == REG_NOMATCH)
-					continue;
-			}
-			if (type == bgp_show_type_prefix_list) {
-				struct prefix_list *plist = output_arg;
+	display = 0;
+	if (use_json)
+		json_paths = json_object_new_array();
+	else
+		json_paths = NULL;
+
+	for (; pi; pi = pi->next) {
+		walk->total_count++;
+		if (type == bgp_show_type_flap_statistics
+		    || type == bgp_show_type_flap_neighbor
+		    || type == bgp_show_type_dampend_paths
+		    || type == bgp_show_type_damp_neighbor) {
+			if (!(pi->extra && pi->extra->damp_info))
+				continue;
+		}
+		if (type == bgp_show_type_regexp) {
+			regex_t *regex = output_arg;
 
-				if (prefix_list_apply(plist, &rn->p)
-				    != PREFIX_PERMIT)
-					continue;
-			}
-			if (type == bgp_show_type_filter_list) {
-				struct as_list *as_list = output_arg;
+			if (bgp_regexec(regex, pi->attr->aspath)
+			    == REG_NOMATCH)
+				continue;
+		}
+		if (type == bgp_show_type_prefix_list) {
+			struct prefix_list *plist = output_arg;
 
-				if (as_list_apply(as_list, pi->attr->aspath)
-				    != AS_FILTER_PERMIT)
-					continue;
-			}
-			if (type == bgp_show_type_route_map) {
-				struct route_map *rmap = output_arg;
-				struct bgp_path_info path;
-				struct attr dummy_attr;
-				route_map_result_t ret;
+			if (prefix_list_apply(plist, &rn->p)
+			    != PREFIX_PERMIT)
+				continue;
+		}
+		if (type == bgp_show_type_filter_list) {
+			struct as_list *as_list = output_arg;
 
-				bgp_attr_dup(&dummy_attr, pi->attr);
+			if (as_list_apply(as_list, pi->attr->aspath)
+			    != AS_FILTER_PERMIT)
+				continue;
+		}
+		if (type == bgp_show_type_route_map) {
+			struct route_map *rmap = output_arg;
+			struct bgp_path_info path;
+			struct attr dummy_attr;
+			route_map_result_t ret;
 
-				path.peer = pi->peer;
-				path.attr = &dummy_attr;
+			bgp_attr_dup(&dummy_attr, pi->attr);
 
-				ret = route_map_apply(rmap, &rn->p, RMAP_BGP,
-						      &path);
-				if (ret == RMAP_DENYMATCH)
-					continue;
-			}
-			if (type == bgp_show_type_neighbor
-			    || type == bgp_show_type_flap_neighbor
-			    || type == bgp_show_type_damp_neighbor) {
-				union sockunion *su = output_arg;
-
-				if (pi->peer == NULL
-				    || pi->peer->su_remote == NULL
-				    || !sockunion_same(pi->peer->su_remote, su))
-					continue;
-			}
-			if (type == bgp_show_type_cidr_only) {
-				uint32_t destination;
+			path.peer = pi->peer;
+			path.attr = &dummy_attr;
 
-				destination = ntohl(rn->p.u.prefix4.s_addr);
-				if (IN_CLASSC(destination)
-				    && rn->p.prefixlen == 24)
-					continue;
-				if (IN_CLASSB(destination)
-				    && rn->p.prefixlen == 16)
-					continue;
-				if (IN_CLASSA(destination)
-				    && rn->p.prefixlen == 8)
-					continue;
-			}
-			if (type == bgp_show_type_prefix_longer) {
-				p = output_arg;
-				if (!prefix_match(p, &rn->p))
-					continue;
-			}
-			if (type == bgp_show_type_community_all) {
-				if (!pi->attr->community)
-					continue;
-			}
-			if (type == bgp_show_type_community) {
-				struct community *com = output_arg;
+			ret = route_map_apply(rmap, &rn->p, RMAP_BGP,
+					      &path);
+			if (ret == RMAP_DENYMATCH)
+				continue;
+		}
+		if (type == bgp_show_type_neighbor
+		    || type == bgp_show_type_flap_neighbor
+		    || type == bgp_show_type_damp_neighbor) {
+			union sockunion *su = output_arg;
 
-				if (!pi->attr->community
-				    || !community_match(pi->attr->community,
-							com))
-					continue;
-			}
-			if (type == bgp_show_type_community_exact) {
-				struct community *com = output_arg;
+			if (pi->peer == NULL
+			    || pi->peer->su_remote == NULL
+			    || !sockunion_same(pi->peer->su_remote, su))
+				continue;
+		}
+		if (type == bgp_show_type_cidr_only) {
+			uint32_t destination;
 
-				if (!pi->attr->community
-				    || !community_cmp(pi->attr->community, com))
-					continue;
-			}
-			if (type == bgp_show_type_community_list) {
-				struct community_list *list = output_arg;
+			destination = ntohl(rn->p.u.prefix4.s_addr);
+			if (IN_CLASSC(destination)
+			    && rn->p.prefixlen == 24)
+				continue;
+			if (IN_CLASSB(destination)
+			    && rn->p.prefixlen == 16)
+				continue;
+			if (IN_CLASSA(destination)
+			    && rn->p.prefixlen == 8)
+				continue;
+		}
+		if (type == bgp_show_type_prefix_longer) {
+			p = output_arg;
+			if (!prefix_match(p, &rn->p))
+				continue;
+		}
+		if (type == bgp_show_type_community_all) {
+			if (!pi->attr->community)
+				continue;
+		}
+		if (type == bgp_show_type_community) {
+			struct community *com = output_arg;
 
-				if (!community_list_match(pi->attr->community,
-							  list))
-					continue;
-			}
-			if (type == bgp_show_type_community_list_exact) {
-				struct community_list *list = output_arg;
+			if (!pi->attr->community
+			    || !community_match(pi->attr->community,
+						com))
+				continue;
+		}
+		if (type == bgp_show_type_community_exact) {
+			struct community *com = output_arg;
 
-				if (!community_list_exact_match(
-					    pi->attr->community, list))
-					continue;
-			}
-			if (type == bgp_show_type_lcommunity) {
-				struct lcommunity *lcom = output_arg;
+			if (!pi->attr->community
+			    || !community_cmp(pi->attr->community, com))
+				continue;
+		}
+		if (type == bgp_show_type_community_list) {
+			struct community_list *list = output_arg;
 
-				if (!pi->attr->lcommunity
-				    || !lcommunity_match(pi->attr->lcommunity,
-							 lcom))
-					continue;
-			}
+			if (!community_list_match(pi->attr->community,
+						  list))
+				continue;
+		}
+		if (type == bgp_show_type_community_list_exact) {
+			struct community_list *list = output_arg;
 
-			if (type == bgp_show_type_lcommunity_exact) {
-				struct lcommunity *lcom = output_arg;
+			if (!community_list_exact_match(
+				    pi->attr->community, list))
+				continue;
+		}
+		if (type == bgp_show_type_lcommunity) {
+			struct lcommunity *lcom = output_arg;
 
-				if (!pi->attr->lcommunity
-				    || !lcommunity_cmp(pi->attr->lcommunity,
-						      lcom))
-					continue;
-			}
-			if (type == bgp_show_type_lcommunity_list) {
-				struct community_list *list = output_arg;
+			if (!pi->attr->lcommunity
+			    || !lcommunity_match(pi->attr->lcommunity,
+						 lcom))
+				continue;
+		}
 
-				if (!lcommunity_list_match(pi->attr->lcommunity,
-							   list))
-					continue;
-			}
-			if (type
-			    == bgp_show_type_lcommunity_list_exact) {
-				struct community_list *list = output_arg;
+		if (type == bgp_show_type_lcommunity_exact) {
+			struct lcommunity *lcom = output_arg;
 
-				if (!lcommunity_list_exact_match(
-					    pi->attr->lcommunity, list))
-					continue;
-			}
-			if (type == bgp_show_type_lcommunity_all) {
-				if (!pi->attr->lcommunity)
-					continue;
-			}
-			if (type == bgp_show_type_dampend_paths
-			    || type == bgp_show_type_damp_neighbor) {
-				if (!CHECK_FLAG(pi->flags, BGP_PATH_DAMPED)
-				    || CHECK_FLAG(pi->flags, BGP_PATH_HISTORY))
-					continue;
-			}
+			if (!pi->attr->lcommunity
+			    || !lcommunity_cmp(pi->attr->lcommunity,
+					      lcom))
+				continue;
+		}
+		if (type == bgp_show_type_lcommunity_list) {
+			struct community_list *list = output_arg;
 
-			if (!use_json && header) {
-				vty_out(vty, "BGP table version is %" PRIu64
-					", local router ID is %s, vrf id ",
-					table->version,
-					inet_ntoa(bgp->router_id));
-				if (bgp->vrf_id == VRF_UNKNOWN)
-					vty_out(vty, "%s", VRFID_NONE_STR);
-				else
-					vty_out(vty, "%u", bgp->vrf_id);
-				vty_out(vty, "\n");
-				vty_out(vty, "Default local pref %u, ",
-					bgp->default_local_pref);
-				vty_out(vty, "local AS %u\n", bgp->as);
-				vty_out(vty, BGP_SHOW_SCODE_HEADER);
-				vty_out(vty, BGP_SHOW_NCODE_HEADER);
-				vty_out(vty, BGP_SHOW_OCODE_HEADER);
-				if (type == bgp_show_type_dampend_paths
-				    || type == bgp_show_type_damp_neighbor)
-					vty_out(vty, BGP_SHOW_DAMP_HEADER);
-				else if (type == bgp_show_type_flap_statistics
-					 || type == bgp_show_type_flap_neighbor)
-					vty_out(vty, BGP_SHOW_FLAP_HEADER);
-				else
-					vty_out(vty, BGP_SHOW_HEADER);
-				header = 0;
-			}
-			if (rd != NULL && !display && !output_count) {
-				if (!use_json)
-					vty_out(vty,
-						"Route Distinguisher: %s\n",
-						rd);
-			}
+			if (!lcommunity_list_match(pi->attr->lcommunity,
+						   list))
+				continue;
+		}
+		if (type
+		    == bgp_show_type_lcommunity_list_exact) {
+			struct community_list *list = output_arg;
+
+			if (!lcommunity_list_exact_match(
+				    pi->attr->lcommunity, list))
+				continue;
+		}
+		if (type == bgp_show_type_lcommunity_all) {
+			if (!pi->attr->lcommunity)
+				continue;
+		}
+		if (type == bgp_show_type_dampend_paths
+		    || type == bgp_show_type_damp_neighbor) {
+			if (!CHECK_FLAG(pi->flags, BGP_PATH_DAMPED)
+			    || CHECK_FLAG(pi->flags, BGP_PATH_HISTORY))
+				continue;
+		}
+
+		if (!use_json && walk->header) {
+			vty_out(vty, "BGP table version is %" PRIu64
+				", local router ID is %s, vrf id ",
+				table->version,
+				inet_ntoa(bgp->router_id));
+			if (bgp->vrf_id == VRF_UNKNOWN)
+				vty_out(vty, "%s", VRFID_NONE_STR);
+			else
+				vty_out(vty, "%u", bgp->vrf_id);
+			vty_out(vty, "\n");
+			vty_out(vty, "Default local pref %u, ",
+				bgp->default_local_pref);
+			vty_out(vty, "local AS %u\n", bgp->as);
+			vty_out(vty, BGP_SHOW_SCODE_HEADER);
+			vty_out(vty, BGP_SHOW_NCODE_HEADER);
+			vty_out(vty, BGP_SHOW_OCODE_HEADER);
 			if (type == bgp_show_type_dampend_paths
 			    || type == bgp_show_type_damp_neighbor)
-				damp_route_vty_out(vty, &rn->p, pi, display,
-						   safi, use_json, json_paths);
+				vty_out(vty, BGP_SHOW_DAMP_HEADER);
 			else if (type == bgp_show_type_flap_statistics
 				 || type == bgp_show_type_flap_neighbor)
-				flap_route_vty_out(vty, &rn->p, pi, display,
-						   safi, use_json, json_paths);
+				vty_out(vty, BGP_SHOW_FLAP_HEADER);
 			else
-				route_vty_out(vty, &rn->p, pi, display, safi,
-					      json_paths);
-			display++;
+				vty_out(vty, BGP_SHOW_HEADER);
+			walk->header = 0;
 		}
-
-		if (display) {
-			output_count++;
+		if (rd != NULL && !display && !walk->output_count) {
 			if (!use_json)
-				continue;
+				vty_out(vty,
+					"Route Distinguisher: %s\n",
+					rd);
+		}
+		if (type == bgp_show_type_dampend_paths
+		    || type == bgp_show_type_damp_neighbor)
+			damp_route_vty_out(vty, &rn->p, pi, display,
+					   safi, use_json, json_paths);
+		else if (type == bgp_show_type_flap_statistics
+			 || type == bgp_show_type_flap_neighbor)
+			flap_route_vty_out(vty, &rn->p, pi, display,
+					   safi, use_json, json_paths);
+		else
+			route_vty_out(vty, &rn->p, pi, display, safi,
+				      json_paths);
+		display++;
+	}
 
-			p = &rn->p;
-			/* encode prefix */
-			if (p->family == AF_FLOWSPEC) {
-				char retstr[BGP_FLOWSPEC_STRING_DISPLAY_MAX];
-
-				bgp_fs_nlri_get_string((unsigned char *)
-						       p->u.prefix_flowspec.ptr,
-						       p->u.prefix_flowspec
-						       .prefixlen,
-						       retstr,
-						       NLRI_STRING_FORMAT_MIN,
-						       NULL);
-				if (first)
-					vty_out(vty, "\"%s/%d\": ",
-						retstr,
-						p->u.prefix_flowspec.prefixlen);
-				else
-					vty_out(vty, ",\"%s/%d\": ",
-						retstr,
-						p->u.prefix_flowspec.prefixlen);
-			} else {
-				prefix2str(p, buf2, sizeof(buf2));
-				if (first)
-					vty_out(vty, "\"%s\": ", buf2);
-				else
-					vty_out(vty, ",\"%s\": ", buf2);
-			}
-			vty_out(vty, "%s",
-				json_object_to_json_string(json_paths));
-			json_object_free(json_paths);
-			json_paths = NULL;
-			first = 0;
+	if (display) {
+		walk->output_count++;
+		if (!use_json)
+			return true;
+
+		p = &rn->p;
+		/* encode prefix */
+		if (p->family == AF_FLOWSPEC) {
+			char retstr[BGP_FLOWSPEC_STRING_DISPLAY_MAX];
+
+			bgp_fs_nlri_get_string((unsigned char *)
+					       p->u.prefix_flowspec.ptr,
+					       p->u.prefix_flowspec
+					       .prefixlen,
+					       retstr,
+					       NLRI_STRING_FORMAT_MIN,
+					       NULL);
+			if (walk->first)
+				vty_out(vty, "\"%s/%d\": ",
+					retstr,
+					p->u.prefix_flowspec.prefixlen);
+			else
+				vty_out(vty, ",\"%s/%d\": ",
+					retstr,
+					p->u.prefix_flowspec.prefixlen);
+		} else {
+			prefix2str(p, buf2, sizeof(buf2));
+			if (walk->first)
+				vty_out(vty, "\"%s\": ", buf2);
+			else
+				vty_out(vty, ",\"%s\": ", buf2);
 		}
+		vty_out(vty, "%s",
+			json_object_to_json_string(json_paths));
+		json_object_free(json_paths);
+		json_paths = NULL;
+		walk->first = false;
 	}
 
-	if (output_cum) {
-		output_count += *output_cum;
-		*output_cum = output_count;
-	}
-	if (total_cum) {
-		total_count += *total_cum;
-		*total_cum = total_count;
+	if (json_paths)
+		json_object_free(json_paths);
+	return display != 0;
+}
+
+/*
+ * Show up to max nodes (all if 0) starting at walk->rn, returns whether the
+ * walk is done.
+ */
+static bool bgp_show_walk_run(struct vty *vty, struct bgp_show_walk *walk,
+			      unsigned long max)
+{
+	struct bgp_node *rn;
+	unsigned long count = 0;
+
+	while (walk->rn) {
+		if (max && count++ == max)
+			return false;
+
+		rn = walk->rn;
+		if (bgp_show_node(vty, walk, rn) && walk->page_size
+		    && walk->output_count == walk->page_size) {
+			/* page is full */
+			prefix_copy(&walk->page_last, &rn->p);
+			walk->rn = bgp_route_next(rn);
+			if (walk->rn) {
+				walk->page_more = true;
+				bgp_unlock_node(walk->rn);
+				walk->rn = NULL;
+			}
+			break;
+		}
+		walk->rn = bgp_route_next(rn);
 	}
-	if (use_json) {
-		if (rd) {
+	return true;
+}
+
+static void bgp_show_table_end(struct vty *vty, struct bgp_show_walk *walk,
+			       int is_last)
+{
+	char buf[PREFIX2STR_BUFFER];
+	unsigned long i;
+
+	if (walk->use_json) {
+		if (walk->rd) {
 			vty_out(vty, " }%s ", (is_last ? "" : ","));
 		}
 		if (is_last) {
-			unsigned long i;
-			for (i = 0; i < *json_header_depth; ++i)
+			for (i = 0; i < walk->json_header_depth; ++i) {
 				vty_out(vty, " } ");
+				/* goes next to "routes" */
+				if (i == 0 && walk->page_more)
+					vty_out(vty,
+						", \"nextStartAfter\": \"%s\"",
+						prefix2str(&walk->page_last,
+							   buf, sizeof(buf)));
+			}
 			vty_out(vty, "\n");
 		}
 	} else {
 		if (is_last) {
 			/* No route is displayed */
-			if (output_count == 0) {
-				if (type == bgp_show_type_normal)
+			if (walk->output_count == 0) {
+				if (walk->type == bgp_show_type_normal)
 					vty_out(vty,
 						"No BGP prefixes displayed, %ld exist\n",
-						total_count);
+						walk->total_count);
 			} else
 				vty_out(vty,
 					"\nDisplayed  %ld routes and %ld total paths\n",
-					output_count, total_count);
+					walk->output_count, walk->total_count);
 		}
 	}
+}
+
+static int bgp_show_table(struct vty *vty, struct bgp *bgp, safi_t safi,
+			  struct bgp_table *table, enum bgp_show_type type,
+			  void *output_arg, bool use_json, char *rd,
+			  int is_last, unsigned long *output_cum,
+			  unsigned long *total_cum,
+			  unsigned long *json_header_depth)
+{
+	struct bgp_show_walk walk;
+
+	bgp_show_walk_init(&walk, bgp, safi, table, type, output_arg, use_json,
+			   rd);
+	if (output_cum && *output_cum != 0)
+		walk.header = 0;
+
+	walk.json_header_depth = *json_header_depth;
+	bgp_show_table_begin(vty, &walk);
+	*json_header_depth = walk.json_header_depth;
+
+	/* Start processing of routes. */
+	walk.rn = bgp_table_top(table);
+	bgp_show_walk_run(vty, &walk, 0);
+
+	if (output_cum) {
+		walk.output_count += *output_cum;
+		*output_cum = walk.output_count;
+	}
+	if (total_cum) {
+		walk.total_count += *total_cum;
+		*total_cum = walk.total_count;
+	}
+	bgp_show_table_end(vty, &walk, is_last);
 
 	return CMD_SUCCESS;
 }
@@ -9559,6 +10164,80 @@ static int bgp_show(struct vty *vty, struct bgp *bgp, afi_t afi, safi_t safi,
 			      NULL, 1, NULL, NULL, &json_header_depth);
 }
 
+static int bgp_show_stream_piece(struct vty *vty, void *arg)
+{
+	struct bgp_show_walk *walk = arg;
+
+	if (!bgp_show_walk_run(vty, walk, BGP_SHOW_STREAM_CHUNK))
+		return CMD_SUSPEND;
+
+	bgp_show_table_end(vty, walk, 1);
+	return CMD_SUCCESS;
+}
+
+static void bgp_show_stream_free(void *arg)
+{
+	struct bgp_show_walk *walk = arg;
+
+	if (walk->rn)
+		bgp_unlock_node(walk->rn);
+	bgp_table_unlock(walk->table);
+	bgp_unlock(walk->bgp);
+	XFREE(MTYPE_BGP_SHOW_WALK, walk);
+}
+
+/*
+ * bgp_show() for the shows without a filter argument, i.e. the ones that
+ * dump whole tables.  The table is walked a piece at a time in between
+ * other events, see vty_stream_start(), so neither the output queued on
+ * the vty nor the time spent away from peers grows with the table size.
+ *
+ * With a page_size only that many prefixes are shown, starting after
+ * start_after if that is given; JSON output then has "nextStartAfter" for
+ * the next page unless this was the last one.
+ */
+static int bgp_show_stream(struct vty *vty, struct bgp *bgp, afi_t afi,
+			   safi_t safi, enum bgp_show_type type, bool use_json,
+			   unsigned long page_size, struct prefix *start_after)
+{
+	struct bgp_show_walk *walk;
+	struct bgp_table *table;
+
+	if (bgp == NULL)
+		bgp = bgp_get_default();
+
+	/* 2-level tables and flowspec are left to bgp_show() */
+	if (bgp == NULL || safi == SAFI_MPLS_VPN || safi == SAFI_ENCAP
+	    || safi == SAFI_EVPN || safi == SAFI_FLOWSPEC) {
+		if (bgp && page_size) {
+			vty_out(vty,
+				"%% Paging is not supported for this address family\n");
+			return CMD_WARNING;
+		}
+		return bgp_show(vty, bgp, afi, safi, type, NULL, use_json);
+	}
+
+	/* labeled-unicast routes live in the unicast table */
+	if (safi == SAFI_LABELED_UNICAST)
+		safi = SAFI_UNICAST;
+	table = bgp->rib[afi][safi];
+
+	walk = XCALLOC(MTYPE_BGP_SHOW_WALK, sizeof(*walk));
+	bgp_show_walk_init(walk, bgp_lock(bgp), safi, table, type, NULL,
+			   use_json, NULL);
+	bgp_table_lock(table);
+	walk->page_size = page_size;
+
+	bgp_show_table_begin(vty, walk);
+	if (start_after)
+		walk->rn = bgp_table_get_next(table, start_after);
+	else
+		walk->rn = bgp_table_top(table);
+
+	return vty_stream_start(vty, bgp_show_stream_piece, walk,
+				bgp_show_stream_free);
+}
+
 static void bgp_show_all_instances_routes_vty(struct vty *vty, afi_t afi,
 					      safi_t safi, bool use_json)
 {
@@ -10183,7 +10862,8 @@ DEFUN (show_ip_bgp,
 
 	if (argv_find(argv, argc, "dampening", &idx)) {
 		if (argv_find(argv, argc, "parameters", &idx))
-			return bgp_show_dampening_parameters(vty, afi, safi);
+			return bgp_show_dampening_parameters(vty, bgp, afi,
+							     safi);
 	}
 
 	if (argv_find(argv, argc, "prefix-list", &idx))
@@ -10276,17 +10956,18 @@ DEFUN (show_ip_bgp_json,
 		return CMD_WARNING;
 
 	if (argv_find(argv, argc, "cidr-only", &idx))
-		return bgp_show(vty, bgp, afi, safi, bgp_show_type_cidr_only,
-				NULL, uj);
+		return bgp_show_stream(vty, bgp, afi, safi,
+				       bgp_show_type_cidr_only, uj, 0, NULL);
 
 	if (argv_find(argv, argc, "dampening", &idx)) {
 		if (argv_find(argv, argc, "dampened-paths", &idx))
-			return bgp_show(vty, bgp, afi, safi,
-					bgp_show_type_dampend_paths, NULL, uj);
+			return bgp_show_stream(vty, bgp, afi, safi,
+					       bgp_show_type_dampend_paths, uj,
+					       0, NULL);
 		else if (argv_find(argv, argc, "flap-statistics", &idx))
-			return bgp_show(vty, bgp, afi, safi,
-					bgp_show_type_flap_statistics, NULL,
-					uj);
+			return bgp_show_stream(vty, bgp, afi, safi,
+					       bgp_show_type_flap_statistics,
+					       uj, 0, NULL);
 	}
 
 	if (argv_find(argv, argc, "community", &idx)) {
@@ -10311,12 +10992,58 @@ DEFUN (show_ip_bgp_json,
 			return bgp_show_community(vty, bgp, community,
 						  exact_match, afi, safi, uj);
 		else
-			return (bgp_show(vty, bgp, afi, safi,
-					 bgp_show_type_community_all, NULL,
-					 uj));
+			return bgp_show_stream(vty, bgp, afi, safi,
+					       bgp_show_type_community_all, uj,
+					       0, NULL);
 	}
 
-	return bgp_show(vty, bgp, afi, safi, sh_type, NULL, uj);
+	return bgp_show_stream(vty, bgp, afi, safi, sh_type, uj, 0, NULL);
+}
+
+DEFUN (show_ip_bgp_json_page,
+       show_ip_bgp_json_page_cmd,
+       "show [ip] bgp [<view|vrf> VIEWVRFNAME] ["BGP_AFI_CMD_STR" ["BGP_SAFI_WITH_LABEL_CMD_STR"]] json page-size (1-4294967295) [start-after <A.B.C.D/M|X:X::X:X/M>]",
+       SHOW_STR
+       IP_STR
+       BGP_STR
+       BGP_INSTANCE_HELP_STR
+       BGP_AFI_HELP_STR
+       BGP_SAFI_WITH_LABEL_HELP_STR
+       JSON_STR
+       "Display only part of the prefixes\n"
+       "Number of prefixes\n"
+       "Start after a prefix, the \"nextStartAfter\" of the previous page\n"
+       "IPv4 prefix\n"
+       "IPv6 prefix\n")
+{
+	afi_t afi = AFI_IP6;
+	safi_t safi = SAFI_UNICAST;
+	struct bgp *bgp = NULL;
+	struct prefix start_after;
+	unsigned long page_size;
+	int idx = 0;
+
+	bgp_vty_find_and_parse_afi_safi_bgp(vty, argv, argc, &idx, &afi, &safi,
+					    &bgp, true);
+	if (!idx)
+		return CMD_WARNING;
+
+	argv_find(argv, argc, "page-size", &idx);
+	page_size = strtoul(argv[idx + 1]->arg, NULL, 10);
+
+	if (!argv_find(argv, argc, "start-after", &idx))
+		return bgp_show_stream(vty, bgp, afi, safi,
+				       bgp_show_type_normal, true, page_size,
+				       NULL);
+
+	if (!str2prefix(argv[idx + 1]->arg, &start_after)
+	    || family2afi(start_after.family) != afi) {
+		vty_out(vty, "%% Malformed prefix for this address family\n");
+		return CMD_WARNING;
+	}
+	apply_mask(&start_after);
+	return bgp_show_stream(vty, bgp, afi, safi, bgp_show_type_normal, true,
+			       page_size, &start_after);
 }
 
 DEFUN (show_ip_bgp_route,
@@ -10878,7 +11605,7 @@ static const char *pcount_strs[] = {
 
 struct peer_pcounts {
 	unsigned int count[PCOUNT_MAX];
-	const struct peer *peer;
+	struct peer *peer;
 	const struct bgp_table *table;
 };
 
@@ -10886,15 +11613,14 @@ static int bgp_peer_count_walker(struct thread *t)
 {
 	struct bgp_node *rn;
 	struct peer_pcounts *pc = THREAD_ARG(t);
-	const struct peer *peer = pc->peer;
+	struct peer *peer = pc->peer;
 
 	for (rn = bgp_table_top(pc->table); rn; rn = bgp_route_next(rn)) {
-		struct bgp_adj_in *ain;
+		struct bgp_adj_in ain;
 		struct bgp_path_info *pi;
 
-		for (ain = rn->adj_in; ain; ain = ain->next)
-			if (ain->peer == peer)
-				pc->count[PCOUNT_ADJ_IN]++;
+		for (ALL_ADJ_IN_ENTRIES(peer, rn, ain))
+			pc->count[PCOUNT_ADJ_IN]++;
 
 		for (pi = bgp_node_get_bgp_path_info(rn); pi; pi = pi->next) {
 
@@ -11157,8 +11883,8 @@ static void show_adj_route(struct vty *vty, struct peer *peer, afi_t afi,
 			   json_object *json)
 {
 	struct bgp_table *table;
-	struct bgp_adj_in *ain;
-	struct bgp_adj_out *adj;
+	struct bgp_adj_in ain;
+	struct bgp_adj_out *adj, compact;
 	unsigned long output_count;
 	unsigned long filtered_count;
 	struct bgp_node *rn;
@@ -11258,8 +11984,8 @@ static void show_adj_route(struct vty *vty, struct peer *peer, afi_t afi,
 	for (rn = bgp_table_top(table); rn; rn = bgp_route_next(rn)) {
 		if (type == bgp_show_adj_route_received
 		    || type == bgp_show_adj_route_filtered) {
-			for (ain = rn->adj_in; ain; ain = ain->next) {
-				if (ain->peer != peer || !ain->attr)
+			for (ALL_ADJ_IN_ENTRIES(peer, rn, ain)) {
+				if (!ain.attr)
 					continue;
 
 				if (header1) {
@@ -11315,7 +12041,7 @@ static void show_adj_route(struct vty *vty, struct peer *peer, afi_t afi,
 					header2 = 0;
 				}
 
-				bgp_attr_dup(&attr, ain->attr);
+				bgp_attr_dup(&attr, ain.attr);
 				route_filtered = false;
 
 				/* Filter prefix using distribute list,
@@ -11331,7 +12057,7 @@ static void show_adj_route(struct vty *vty, struct peer *peer, afi_t afi,
 
 				if (type == bgp_show_adj_route_filtered &&
 					!route_filtered && ret != RMAP_DENY) {
-					bgp_attr_undup(&attr, ain->attr);
+					bgp_attr_undup(&attr, ain.attr);
 					continue;
 				}
 
@@ -11341,11 +12067,11 @@ static void show_adj_route(struct vty *vty, struct peer *peer, afi_t afi,
 
 				route_vty_out_tmp(vty, &rn->p, &attr, safi,
 						  use_json, json_ar);
-				bgp_attr_undup(&attr, ain->attr);
+				bgp_attr_undup(&attr, ain.attr);
 				output_count++;
 			}
 		} else if (type == bgp_show_adj_route_advertised) {
-			RB_FOREACH (adj, bgp_adj_out_rb, &rn->adj_out)
+			RN_FOREACH_ADJ_OUT (rn, adj, &compact)
 				SUBGRP_FOREACH_PEER (adj->subgroup, paf) {
 					if (paf->peer != peer || !adj->attr)
 						continue;
@@ -12271,7 +12997,15 @@ DEFUN (clear_ip_bgp_dampening,
        BGP_STR
        "Clear route flap dampening information\n")
 {
-	bgp_damp_info_clean();
+	struct listnode *node;
+	struct bgp *bgp;
+	afi_t afi;
+	safi_t safi;
+
+	for (ALL_LIST_ELEMENTS_RO(bm->bgp, node, bgp))
+		FOREACH_AFI_SAFI (afi, safi)
+			if (bgp->damp[afi][safi])
+				bgp_damp_info_clean(bgp->damp[afi][safi]);
 	return CMD_SUCCESS;
 }
 
@@ -12632,6 +13366,7 @@ void bgp_route_init(void)
 	install_element(VIEW_NODE, &show_ip_bgp_instance_all_cmd);
 	install_element(VIEW_NODE, &show_ip_bgp_cmd);
 	install_element(VIEW_NODE, &show_ip_bgp_json_cmd);
+	install_element(VIEW_NODE, &show_ip_bgp_json_page_cmd);
 	install_element(VIEW_NODE, &show_ip_bgp_route_cmd);
 	install_element(VIEW_NODE, &show_ip_bgp_regexp_cmd);
 
@@ -12717,6 +13452,12 @@ void bgp_route_init(void)
 	install_element(BGP_IPV4M_NODE, &bgp_damp_set_cmd);
 	install_element(BGP_IPV4M_NODE, &bgp_damp_unset_cmd);
 
+	/* IPv6 */
+	install_element(BGP_IPV6_NODE, &bgp_damp_set_cmd);
+	install_element(BGP_IPV6_NODE, &bgp_damp_unset_cmd);
+	install_element(BGP_IPV6M_NODE, &bgp_damp_set_cmd);
+	install_element(BGP_IPV6M_NODE, &bgp_damp_unset_cmd);
+
 	/* Large Communities */
 	install_element(VIEW_NODE, &show_ip_bgp_large_community_list_cmd);
 	install_element(VIEW_NODE, &show_ip_bgp_large_community_cmd);
@@ -12736,4 +13477,6 @@ void bgp_route_finish(void)
 		bgp_table_unlock(bgp_distance_table[afi][safi]);
 		bgp_distance_table[afi][safi] = NULL;
 	}
+
+	bgp_path_arena_finish();
 }
@@ -78,6 +78,27 @@ enum bgp_show_adj_route_type {
  */
 #define BGP_MAX_LABELS 2
 
+/* One prefix decoded from an NLRI stream ahead of its processing */
+struct bgp_nlri_prefix {
+	struct prefix p;
+	uint32_t addpath_id;
+};
+
+/* An IPv4/IPv6 NLRI stream decoded by bgp_nlri_decode_ip(), possibly on
+ * another pthread, to be applied later by bgp_nlri_apply_ip().
+ */
+struct bgp_nlri_decoded {
+	/* The stream this was decoded from */
+	struct bgp_nlri nlri;
+	int addpath_encoded;
+
+	/* bgp_nlri_parse_ip() result for the stream */
+	int ret;
+
+	uint32_t count, size;
+	struct bgp_nlri_prefix *prefixes;
+};
+
 /* Error codes for handling NLRI */
 #define BGP_NLRI_PARSE_OK 0
 #define BGP_NLRI_PARSE_ERROR_PREFIX_OVERFLOW -1
@@ -176,38 +197,30 @@ struct bgp_path_info_extra {
 	struct list *bgp_fs_iprule;
 };
 
+/*
+ * The list pointers, attr, peer, extra, net, flags, type, lock and uptime
+ * come first, so they share a cache line; nexthop tracking, multipath and
+ * addpath state follow.  The reordering does not change the size of the
+ * struct.  Anything only some paths need belongs in bgp_path_info_extra
+ * rather than here.  Paths are carved out of the path arena, see
+ * bgp_path_info_alloc().
+ */
 struct bgp_path_info {
 	/* For linked list. */
 	struct bgp_path_info *next;
 	struct bgp_path_info *prev;
 
-	/* For nexthop linked list */
-	LIST_ENTRY(bgp_path_info) nh_thread;
-
-	/* Back pointer to the prefix node */
-	struct bgp_node *net;
-
-	/* Back pointer to the nexthop structure */
-	struct bgp_nexthop_cache *nexthop;
+	/* Attribute structure.  */
+	struct attr *attr;
 
 	/* Peer structure.  */
 	struct peer *peer;
 
-	/* Attribute structure.  */
-	struct attr *attr;
-
 	/* Extra information */
 	struct bgp_path_info_extra *extra;
 
-
-	/* Multipath information */
-	struct bgp_path_info_mpath *mpath;
-
-	/* Uptime.  */
-	time_t uptime;
-
-	/* reference count */
-	int lock;
+	/* Back pointer to the prefix node */
+	struct bgp_node *net;
 
 	/* BGP information status.  */
 	uint16_t flags;
@@ -242,11 +255,30 @@ struct bgp_path_info {
 #endif
 #define BGP_ROUTE_IMPORTED     5        /* from another bgp instance/safi */
 
-	unsigned short instance;
+	/* reference count */
+	int lock;
+
+	/* Uptime, in bgp_clock() seconds.  */
+	uint32_t uptime;
 
 	/* Addpath identifiers */
 	uint32_t addpath_rx_id;
+
+	/* Multipath information */
+	struct bgp_path_info_mpath *mpath;
+
+	/* Back pointer to the nexthop structure */
+	struct bgp_nexthop_cache *nexthop;
+
+	/* For nexthop linked list */
+	LIST_ENTRY(bgp_path_info) nh_thread;
+
 	struct bgp_addpath_info_data tx_addpath;
+
+	unsigned short instance;
+
+	/* Path arena chunk this was carved from, 0 if allocated on its own */
+	uint16_t arena;
 };
 
 /* Structure used in BGP path selection */
@@ -473,7 +505,6 @@ extern void bgp_default_originate(struct peer *, afi_t, safi_t, int);
 extern void bgp_soft_reconfig_in(struct peer *, afi_t, safi_t);
 extern void bgp_clear_route(struct peer *, afi_t, safi_t);
 extern void bgp_clear_route_all(struct peer *);
-extern void bgp_clear_adj_in(struct peer *, afi_t, safi_t);
 extern void bgp_clear_stale_route(struct peer *, afi_t, safi_t);
 extern int bgp_outbound_policy_exists(struct peer *, struct bgp_filter *);
 extern int bgp_inbound_policy_exists(struct peer *, struct bgp_filter *);
@@ -481,6 +512,10 @@ extern int bgp_inbound_policy_exists(struct peer *, struct bgp_filter *);
 extern struct bgp_node *bgp_afi_node_get(struct bgp_table *table, afi_t afi,
 					 safi_t safi, struct prefix *p,
 					 struct prefix_rd *prd);
+extern struct bgp_path_info *bgp_path_info_alloc(struct bgp_node *rn);
+extern void bgp_path_info_release(struct bgp_path_info *path);
+extern unsigned long bgp_path_info_count(void);
+extern size_t bgp_path_info_memory(void);
 extern struct bgp_path_info *bgp_path_info_lock(struct bgp_path_info *path);
 extern struct bgp_path_info *bgp_path_info_unlock(struct bgp_path_info *path);
 extern void bgp_path_info_add(struct bgp_node *rn, struct bgp_path_info *pi);
@@ -497,6 +532,15 @@ extern void bgp_path_info_path_with_addpath_rx_str(struct bgp_path_info *pi,
 						   char *buf);
 
 extern int bgp_nlri_parse_ip(struct peer *, struct attr *, struct bgp_nlri *);
+extern void bgp_nlri_decode_ip(struct peer *peer, const struct bgp_nlri *packet,
+			       int addpath_encoded,
+			       struct bgp_nlri_decoded *dec);
+extern bool bgp_nlri_decoded_match(struct peer *peer,
+				   const struct bgp_nlri_decoded *dec,
+				   const struct bgp_nlri *packet);
+extern int bgp_nlri_apply_ip(struct peer *peer, struct attr *attr,
+			     const struct bgp_nlri_decoded *dec);
+extern void bgp_nlri_decoded_fini(struct bgp_nlri_decoded *dec);
 
 extern int bgp_maximum_prefix_overflow(struct peer *, afi_t, safi_t, int);
 
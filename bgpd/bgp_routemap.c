@@ -39,6 +39,7 @@
 #include "hash.h"
 #include "queue.h"
 #include "frrstr.h"
+#include "jhash.h"
 
 #include "bgpd/bgpd.h"
 #include "bgpd/bgp_table.h"
@@ -646,7 +647,9 @@ static void route_match_ip_address_prefix_list_free(void *rule)
 struct route_map_rule_cmd route_match_ip_address_prefix_list_cmd = {
 	"ip address prefix-list", route_match_ip_address_prefix_list,
 	route_match_ip_address_prefix_list_compile,
-	route_match_ip_address_prefix_list_free};
+	route_match_ip_address_prefix_list_free,
+	.match_plist_afi = AFI_IP,
+};
 
 /* `match ip next-hop prefix-list PREFIX_LIST' */
 
@@ -1145,6 +1148,7 @@ struct rmap_community {
 	char *name;
 	uint32_t name_hash;
 	int exact;
+	struct community_list_cache cache;
 };
 
 /* Match function for community match. */
@@ -1160,9 +1164,9 @@ route_match_community(void *rule, const struct prefix *prefix,
 		path = object;
 		rcom = rule;
 
-		list = community_list_lookup(bgp_clist, rcom->name,
-					     rcom->name_hash,
-					     COMMUNITY_LIST_MASTER);
+		list = community_list_lookup_cached(
+			bgp_clist, rcom->name, rcom->name_hash,
+			COMMUNITY_LIST_MASTER, &rcom->cache);
 		if (!list)
 			return RMAP_NOMATCH;
 
@@ -1244,9 +1248,9 @@ route_match_lcommunity(void *rule, const struct prefix *prefix,
 	if (type == RMAP_BGP) {
 		path = object;
 
-		list = community_list_lookup(bgp_clist, rcom->name,
-					     rcom->name_hash,
-					     LARGE_COMMUNITY_LIST_MASTER);
+		list = community_list_lookup_cached(
+			bgp_clist, rcom->name, rcom->name_hash,
+			LARGE_COMMUNITY_LIST_MASTER, &rcom->cache);
 		if (!list)
 			return RMAP_NOMATCH;
 
@@ -1317,9 +1321,9 @@ route_match_ecommunity(void *rule, const struct prefix *prefix,
 	if (type == RMAP_BGP) {
 		path = object;
 
-		list = community_list_lookup(bgp_clist, rcom->name,
-					     rcom->name_hash,
-					     EXTCOMMUNITY_LIST_MASTER);
+		list = community_list_lookup_cached(
+			bgp_clist, rcom->name, rcom->name_hash,
+			EXTCOMMUNITY_LIST_MASTER, &rcom->cache);
 		if (!list)
 			return RMAP_NOMATCH;
 
@@ -2123,9 +2127,9 @@ route_set_lcommunity_delete(void *rule, const struct prefix *pfx,
 			return RMAP_OKAY;
 
 		path = object;
-		list = community_list_lookup(bgp_clist, rcom->name,
-					     rcom->name_hash,
-					     LARGE_COMMUNITY_LIST_MASTER);
+		list = community_list_lookup_cached(
+			bgp_clist, rcom->name, rcom->name_hash,
+			LARGE_COMMUNITY_LIST_MASTER, &rcom->cache);
 		old = path->attr->lcommunity;
 
 		if (list && old) {
@@ -2213,9 +2217,9 @@ route_set_community_delete(void *rule, const struct prefix *prefix,
 			return RMAP_OKAY;
 
 		path = object;
-		list = community_list_lookup(bgp_clist, rcom->name,
-					     rcom->name_hash,
-					     COMMUNITY_LIST_MASTER);
+		list = community_list_lookup_cached(
+			bgp_clist, rcom->name, rcom->name_hash,
+			COMMUNITY_LIST_MASTER, &rcom->cache);
 		old = path->attr->community;
 
 		if (list && old) {
@@ -2677,7 +2681,9 @@ static void route_match_ipv6_address_prefix_list_free(void *rule)
 struct route_map_rule_cmd route_match_ipv6_address_prefix_list_cmd = {
 	"ipv6 address prefix-list", route_match_ipv6_address_prefix_list,
 	route_match_ipv6_address_prefix_list_compile,
-	route_match_ipv6_address_prefix_list_free};
+	route_match_ipv6_address_prefix_list_free,
+	.match_plist_afi = AFI_IP6,
+};
 
 /* `match ipv6 next-hop type <TYPE>' */
 
@@ -5138,6 +5144,212 @@ DEFUN (no_set_originator_id,
 }
 
 
+/*
+ * Memoized route-map results.
+ *
+ * Route-maps whose rules only look at the path attributes (and the peer,
+ * which is fixed for a given cache) give the same result for the same
+ * attributes, e.g. for the many prefixes of a full table sharing an attr.
+ * For those, the result of applying the route-map to an interned attr is
+ * kept, as an interned attr or NULL for a deny.  A cache serves a single
+ * route-map and empties itself when that route-map's version changes,
+ * which route_map_mark_updated() and any change to the route-map do.
+ */
+#define BGP_RMAP_CACHE_MAX 65536
+
+struct bgp_rmap_cache_entry {
+	struct attr *in;
+	struct attr *out;
+};
+
+struct bgp_rmap_cache {
+	struct route_map *map;
+	uint32_t version;
+	bool usable;
+
+	struct hash *hash;
+};
+
+static bool bgp_rmap_cache_rule_ok(const struct route_map_rule_cmd *cmd,
+				   void *value, bool set, void *arg)
+{
+	static const struct route_map_rule_cmd *const match_ok[] = {
+		&route_match_aspath_cmd,     &route_match_community_cmd,
+		&route_match_lcommunity_cmd, &route_match_ecommunity_cmd,
+		&route_match_local_pref_cmd, &route_match_metric_cmd,
+		&route_match_origin_cmd,     &route_match_tag_cmd,
+	};
+	static const struct route_map_rule_cmd *const set_ok[] = {
+		&route_set_aspath_prepend_cmd,
+		&route_set_aspath_exclude_cmd,
+		&route_set_origin_cmd,
+		&route_set_atomic_aggregate_cmd,
+		&route_set_aggregator_as_cmd,
+		&route_set_community_cmd,
+		&route_set_lcommunity_cmd,
+		&route_set_ecommunity_rt_cmd,
+		&route_set_ecommunity_soo_cmd,
+		&route_set_originator_id_cmd,
+		&route_set_tag_cmd,
+		&route_set_distance_cmd,
+		&route_set_ipv6_nexthop_global_cmd,
+		&route_set_ipv6_nexthop_prefer_global_cmd,
+		&route_set_ipv6_nexthop_local_cmd,
+	};
+	struct rmap_value *rv = value;
+	size_t i;
+
+	if (!set) {
+		for (i = 0; i < array_size(match_ok); i++)
+			if (cmd == match_ok[i])
+				return true;
+		return false;
+	}
+
+	/* Unless they are relative to the peer's RTT. */
+	if (cmd == &route_set_local_pref_cmd || cmd == &route_set_weight_cmd
+	    || cmd == &route_set_metric_cmd)
+		return rv->variable == 0;
+
+	for (i = 0; i < array_size(set_ok); i++)
+		if (cmd == set_ok[i])
+			return true;
+	return false;
+}
+
+static bool bgp_rmap_cache_usable(struct route_map *map)
+{
+	struct route_map_index *index;
+
+	/* Called route-maps can change without this one changing. */
+	for (index = map->head; index; index = index->next)
+		if (index->nextrm)
+			return false;
+
+	return route_map_rules_all(map, bgp_rmap_cache_rule_ok, NULL);
+}
+
+/* Can attr be interned as a key without taking over parts of it that
+ * the caller doesn't own?
+ */
+static bool bgp_rmap_cache_keyable(const struct attr *attr)
+{
+	if ((attr->aspath && !attr->aspath->refcnt)
+	    || (attr->community && !attr->community->refcnt)
+	    || (attr->ecommunity && !attr->ecommunity->refcnt)
+	    || (attr->lcommunity && !attr->lcommunity->refcnt)
+	    || (attr->cluster && !attr->cluster->refcnt)
+	    || (attr->transit && !attr->transit->refcnt)
+	    || (attr->encap_subtlvs && !attr->encap_subtlvs->refcnt))
+		return false;
+#if ENABLE_BGP_VNC
+	if (attr->vnc_subtlvs && !attr->vnc_subtlvs->refcnt)
+		return false;
+#endif
+	return true;
+}
+
+static unsigned int bgp_rmap_cache_hash_key(const void *p)
+{
+	const struct bgp_rmap_cache_entry *e = p;
+
+	return jhash_1word(e->in->id, 0);
+}
+
+static bool bgp_rmap_cache_hash_cmp(const void *p1, const void *p2)
+{
+	const struct bgp_rmap_cache_entry *e1 = p1;
+	const struct bgp_rmap_cache_entry *e2 = p2;
+
+	return e1->in == e2->in;
+}
+
+static void bgp_rmap_cache_entry_free(void *arg)
+{
+	struct bgp_rmap_cache_entry *e = arg;
+
+	bgp_attr_unintern(&e->in);
+	if (e->out)
+		bgp_attr_unintern(&e->out);
+	XFREE(MTYPE_BGP_RMAP_CACHE, e);
+}
+
+static void bgp_rmap_cache_flush(struct bgp_rmap_cache *cache)
+{
+	if (cache->hash)
+		hash_clean(cache->hash, bgp_rmap_cache_entry_free);
+}
+
+void bgp_rmap_cache_free(struct bgp_rmap_cache **cachep)
+{
+	struct bgp_rmap_cache *cache = *cachep;
+
+	if (!cache)
+		return;
+
+	bgp_rmap_cache_flush(cache);
+	if (cache->hash)
+		hash_free(cache->hash);
+	XFREE(MTYPE_BGP_RMAP_CACHE, *cachep);
+}
+
+/*
+ * route_map_apply() for a path, with the result memoized in *cachep where
+ * possible.  Like route_map_apply(), path->attr is modified according to
+ * the route-map's set rules.
+ */
+route_map_result_t bgp_route_map_apply_cached(struct bgp_rmap_cache **cachep,
+					      struct route_map *map,
+					      const struct prefix *p,
+					      struct bgp_path_info *path)
+{
+	struct bgp_rmap_cache *cache = *cachep;
+	struct bgp_rmap_cache_entry lookup, *e;
+	route_map_result_t ret;
+
+	if (!cache)
+		cache = *cachep = XCALLOC(MTYPE_BGP_RMAP_CACHE,
+					  sizeof(struct bgp_rmap_cache));
+
+	if (cache->map != map || cache->version != map->version) {
+		bgp_rmap_cache_flush(cache);
+		cache->map = map;
+		cache->version = map->version;
+		cache->usable = bgp_rmap_cache_usable(map);
+	}
+
+	if (!cache->usable || !bgp_rmap_cache_keyable(path->attr))
+		return route_map_apply(map, p, RMAP_BGP, path);
+
+	if (!cache->hash)
+		cache->hash = hash_create(bgp_rmap_cache_hash_key,
+					  bgp_rmap_cache_hash_cmp,
+					  "BGP route-map result cache");
+
+	lookup.in = bgp_attr_intern(path->attr);
+	e = hash_lookup(cache->hash, &lookup);
+	if (e) {
+		bgp_attr_unintern(&lookup.in);
+		if (!e->out)
+			return RMAP_DENYMATCH;
+		bgp_attr_dup(path->attr, e->out);
+		return RMAP_PERMITMATCH;
+	}
+
+	ret = route_map_apply(map, p, RMAP_BGP, path);
+
+	if (cache->hash->count >= BGP_RMAP_CACHE_MAX)
+		bgp_rmap_cache_flush(cache);
+
+	e = XCALLOC(MTYPE_BGP_RMAP_CACHE, sizeof(*e));
+	e->in = lookup.in;
+	if (ret == RMAP_PERMITMATCH)
+		e->out = bgp_attr_intern(path->attr);
+	hash_get(cache->hash, e, hash_alloc_intern);
+
+	return ret;
+}
+
 /* Initialization of route map. */
 void bgp_route_map_init(void)
 {
@@ -413,27 +413,31 @@ static int bgpd_sync_callback(struct thread *thread)
 static void revalidate_bgp_node(struct bgp_node *bgp_node, afi_t afi,
 				safi_t safi)
 {
-	struct bgp_adj_in *ain;
-
-	for (ain = bgp_node->adj_in; ain; ain = ain->next) {
-		int ret;
-		struct bgp_path_info *path =
-			bgp_node_get_bgp_path_info(bgp_node);
-		mpls_label_t *label = NULL;
-		uint32_t num_labels = 0;
-
-		if (path && path->extra) {
-			label = path->extra->label;
-			num_labels = path->extra->num_labels;
-		}
-		ret = bgp_update(ain->peer, &bgp_node->p, ain->addpath_rx_id,
-				 ain->attr, afi, safi, ZEBRA_ROUTE_BGP,
-				 BGP_ROUTE_NORMAL, NULL, label, num_labels, 1,
-				 NULL);
+	struct bgp *bgp = bgp_node_table(bgp_node)->bgp;
+	struct listnode *node;
+	struct peer *peer;
+	struct bgp_adj_in ain;
+
+	for (ALL_LIST_ELEMENTS_RO(bgp->peer, node, peer))
+		for (ALL_ADJ_IN_ENTRIES(peer, bgp_node, ain)) {
+			int ret;
+			struct bgp_path_info *path =
+				bgp_node_get_bgp_path_info(bgp_node);
+			mpls_label_t *label = NULL;
+			uint32_t num_labels = 0;
+
+			if (path && path->extra) {
+				label = path->extra->label;
+				num_labels = path->extra->num_labels;
+			}
+			ret = bgp_update(peer, &bgp_node->p, ain.addpath_rx_id,
+					 ain.attr, afi, safi, ZEBRA_ROUTE_BGP,
+					 BGP_ROUTE_NORMAL, NULL, label,
+					 num_labels, 1, NULL);
 
-		if (ret < 0)
-			return;
-	}
+			if (ret < 0)
+				return;
+		}
 }
 
 static void revalidate_all_routes(void)
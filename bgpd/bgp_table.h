@@ -79,8 +79,7 @@ struct bgp_node {
 	ROUTE_NODE_FIELDS
 
 	struct bgp_adj_out_rb adj_out;
-
-	struct bgp_adj_in *adj_in;
+	struct bgp_adj_out_bits *adj_bits;
 
 	struct bgp_node *prn;
 
@@ -95,6 +94,7 @@ struct bgp_node {
 #define BGP_NODE_USER_CLEAR             (1 << 1)
 #define BGP_NODE_LABEL_CHANGED          (1 << 2)
 #define BGP_NODE_REGISTERED_FOR_LABEL   (1 << 3)
+#define BGP_NODE_SELECTION_STALE        (1 << 4)
 
 	struct bgp_addpath_node_data tx_addpath;
 
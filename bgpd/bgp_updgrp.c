@@ -623,6 +623,9 @@ static int update_group_show_walkcb(struct update_group *updgrp, void *arg)
 		vty_out(vty, "    Packet queue high watermark: %d\n",
 			bpacket_queue_hwm_length(SUBGRP_PKTQ(subgrp)));
 		vty_out(vty, "    Adj-out list count: %u\n", subgrp->adj_count);
+		if (subgrp->adj_bits_count)
+			vty_out(vty, "    Adj-out compact count: %u\n",
+				subgrp->adj_bits_count);
 		vty_out(vty, "    Advertise list: %s\n",
 			advertise_list_is_empty(subgrp) ? "empty"
 							: "not empty");
@@ -768,9 +771,12 @@ static struct update_subgroup *
 update_subgroup_create(struct update_group *updgrp)
 {
 	struct update_subgroup *subgrp;
+	struct bgp *bgp = UPDGRP_INST(updgrp);
 
 	subgrp = XCALLOC(MTYPE_BGP_UPD_SUBGRP, sizeof(struct update_subgroup));
 	update_subgroup_checkin(subgrp, updgrp);
+	subgrp->adj_bit = vector_empty_slot(bgp->adj_out_subgrps);
+	vector_set_index(bgp->adj_out_subgrps, subgrp->adj_bit, subgrp);
 	subgrp->v_coalesce = (UPDGRP_INST(updgrp))->coalesce_time;
 	sync_init(subgrp);
 	bpacket_queue_init(SUBGRP_PKTQ(subgrp));
@@ -803,6 +809,10 @@ static void update_subgroup_delete(struct update_subgroup *subgrp)
 
 	bpacket_queue_cleanup(SUBGRP_PKTQ(subgrp));
 	subgroup_clear_table(subgrp);
+	if (subgrp->update_group)
+		vector_unset(
+			UPDGRP_INST(subgrp->update_group)->adj_out_subgrps,
+			subgrp->adj_bit);
 
 	if (subgrp->t_coalesce)
 		THREAD_TIMER_OFF(subgrp->t_coalesce);
@@ -814,6 +824,7 @@ static void update_subgroup_delete(struct update_subgroup *subgrp)
 
 	update_group_remove_subgroup(subgrp->update_group, subgrp);
 
+	bgp_rmap_cache_free(&subgrp->rmap_cache);
 	XFREE(MTYPE_BGP_UPD_SUBGRP, subgrp);
 }
 
@@ -1184,6 +1195,7 @@ static void update_subgroup_copy_adj_out(struct update_subgroup *source,
 		aout_copy->attr =
 			aout->attr ? bgp_attr_intern(aout->attr) : NULL;
 	}
+	subgroup_copy_adj_bits(source, dest);
 
 	dest->scount = source->scount;
 }
@@ -1551,6 +1563,7 @@ void update_bgp_group_init(struct bgp *bgp)
 		bgp->update_groups[afid] =
 			hash_create(updgrp_hash_key_make, updgrp_hash_cmp,
 				    "BGP Update Group Hash");
+	bgp->adj_out_subgrps = vector_init(1);
 }
 
 void update_bgp_group_free(struct bgp *bgp)
@@ -1563,6 +1576,10 @@ void update_bgp_group_free(struct bgp *bgp)
 			bgp->update_groups[afid] = NULL;
 		}
 	}
+	if (bgp->adj_out_subgrps) {
+		vector_free(bgp->adj_out_subgrps);
+		bgp->adj_out_subgrps = NULL;
+	}
 }
 
 void update_group_show(struct bgp *bgp, afi_t afi, safi_t safi, struct vty *vty,
@@ -1576,6 +1593,26 @@ void update_group_show(struct bgp *bgp, afi_t afi, safi_t safi, struct vty *vty,
 	update_group_af_walk(bgp, afi, safi, update_group_show_walkcb, &ctx);
 }
 
+static int update_group_show_build_walkcb(struct update_group *updgrp,
+					  void *arg)
+{
+	struct vty *vty = arg;
+	struct update_subgroup *subgrp;
+
+	UPDGRP_FOREACH_SUBGRP (updgrp, subgrp) {
+		vty_out(vty, "  u%" PRIu64 ":s%" PRIu64 " %s %s: %u packets",
+			updgrp->id, subgrp->id,
+			afi2str(updgrp->afi), safi2str(updgrp->safi),
+			subgrp->packets_built);
+		if (subgrp->packets_built)
+			vty_out(vty, ", %" PRIu64 " usecs (%" PRIu64 " avg)",
+				subgrp->build_usec,
+				subgrp->build_usec / subgrp->packets_built);
+		vty_out(vty, "\n");
+	}
+	return UPDWALK_CONTINUE;
+}
+
 /*
  * update_group_show_stats
  *
@@ -1604,6 +1641,10 @@ void update_group_show_stats(struct bgp *bgp, struct vty *vty)
 		bgp->update_group_stats.peer_refreshes_combined);
 	vty_out(vty, "Merge checks triggered: %u\n",
 		bgp->update_group_stats.merge_checks_triggered);
+	vty_out(vty, "Parallel packet builds: %u\n",
+		bgp->update_group_stats.parallel_builds);
+	vty_out(vty, "Subgroup packet build time:\n");
+	update_group_walk(bgp, update_group_show_build_walkcb, vty);
 }
 
 /*
@@ -213,6 +213,13 @@ struct update_subgroup {
 	/* announcement attribute hash */
 	struct hash *hash;
 
+	/* Memoized results of the outbound route-map */
+	struct bgp_rmap_cache *rmap_cache;
+
+	/* UPDATEs built, and the time spent encoding them */
+	uint32_t packets_built;
+	uint64_t build_usec;
+
 	struct thread *t_coalesce;
 	uint32_t v_coalesce;
 
@@ -251,6 +258,11 @@ struct update_subgroup {
 
 	uint64_t id;
 
+	/* Index into the instance's adj_out_subgrps and bgp_adj_out_bits. */
+	int adj_bit;
+	/* How many of adj_count are bits rather than bgp_adj_outs. */
+	uint32_t adj_bits_count;
+
 	uint16_t sflags;
 
 	/* Subgroup flags, see below  */
@@ -358,6 +370,14 @@ struct updwalk_context {
 #define SUBGRP_FOREACH_ADJ_SAFE(subgrp, adj, adj_temp)                         \
 	TAILQ_FOREACH_SAFE (adj, &(subgrp->adjq), subgrp_adj_train, adj_temp)
 
+/*
+ * Walk all adj-outs of a route node, read-only. Compact ones are handed out
+ * filled into *compact, which the caller provides.
+ */
+#define RN_FOREACH_ADJ_OUT(rn, adj, compact)                                   \
+	for ((adj) = bgp_adj_out_next((rn), NULL, (compact)); (adj);           \
+	     (adj) = bgp_adj_out_next((rn), (adj), (compact)))
+
 /* Prototypes.  */
 /* bgp_updgrp.c */
 extern void update_bgp_group_init(struct bgp *);
@@ -413,6 +433,7 @@ extern void bpacket_queue_show_vty(struct bpacket_queue *q, struct vty *vty);
 int subgroup_packets_to_build(struct update_subgroup *subgrp);
 extern struct bpacket *subgroup_update_packet(struct update_subgroup *s);
 extern struct bpacket *subgroup_withdraw_packet(struct update_subgroup *s);
+extern void subgroup_build_packets_parallel(struct peer *peer);
 extern struct stream *bpacket_reformat_for_peer(struct bpacket *pkt,
 						struct peer_af *paf);
 extern void bpacket_attr_vec_arr_reset(struct bpacket_attr_vec_arr *vecarr);
@@ -460,6 +481,13 @@ extern void bgp_adj_out_set_subgroup(struct bgp_node *rn,
 extern void bgp_adj_out_unset_subgroup(struct bgp_node *rn,
 				       struct update_subgroup *subgrp,
 				       char withdraw, uint32_t addpath_tx_id);
+extern void bgp_adj_out_compact(struct update_subgroup *subgrp,
+				struct bgp_adj_out *adj);
+extern struct bgp_adj_out *bgp_adj_out_next(struct bgp_node *rn,
+					    struct bgp_adj_out *adj,
+					    struct bgp_adj_out *compact);
+extern void subgroup_copy_adj_bits(struct update_subgroup *source,
+				   struct update_subgroup *dest);
 void subgroup_announce_table(struct update_subgroup *subgrp,
 			     struct bgp_table *table);
 extern void subgroup_trigger_write(struct update_subgroup *subgrp);
@@ -68,6 +68,80 @@ static int bgp_adj_out_compare(const struct bgp_adj_out *o1,
 }
 RB_GENERATE(bgp_adj_out_rb, bgp_adj_out, adj_entry, bgp_adj_out_compare);
 
+#define ADJ_BITS_WORD(i) ((i) / 64)
+#define ADJ_BITS_MASK(i) (1ULL << ((i) % 64))
+
+static inline bool adj_bits_test(struct bgp_node *rn,
+				 struct update_subgroup *subgrp)
+{
+	struct bgp_adj_out_bits *bits = rn->adj_bits;
+	unsigned int i = subgrp->adj_bit;
+
+	return bits && ADJ_BITS_WORD(i) < bits->words
+	       && (bits->bits[ADJ_BITS_WORD(i)] & ADJ_BITS_MASK(i));
+}
+
+/*
+ * Set the subgroup's bit on rn. attr must be the one already kept there, if
+ * any. The bits hold one lock on rn and one reference to attr.
+ */
+static void adj_bits_set(struct bgp_node *rn, struct update_subgroup *subgrp,
+			 struct attr *attr)
+{
+	struct bgp_adj_out_bits *bits = rn->adj_bits;
+	unsigned int i = subgrp->adj_bit;
+	uint32_t words = ADJ_BITS_WORD(i) + 1;
+
+	if (!bits) {
+		bits = XCALLOC(MTYPE_BGP_ADJ_OUT_BITS,
+			       sizeof(*bits) + words * sizeof(bits->bits[0]));
+		bits->words = words;
+		bits->attr = bgp_attr_intern(attr);
+		bgp_lock_node(rn);
+	} else if (bits->words < words) {
+		bits = XREALLOC(MTYPE_BGP_ADJ_OUT_BITS, bits,
+				sizeof(*bits) + words * sizeof(bits->bits[0]));
+		memset(&bits->bits[bits->words], 0,
+		       (words - bits->words) * sizeof(bits->bits[0]));
+		bits->words = words;
+	}
+	rn->adj_bits = bits;
+
+	bits->bits[ADJ_BITS_WORD(i)] |= ADJ_BITS_MASK(i);
+	bits->count++;
+	subgrp->adj_bits_count++;
+	SUBGRP_INCR_STAT(subgrp, adj_count);
+}
+
+/* May release the last lock on rn. */
+static void adj_bits_clear(struct bgp_node *rn, struct update_subgroup *subgrp)
+{
+	struct bgp_adj_out_bits *bits = rn->adj_bits;
+	unsigned int i = subgrp->adj_bit;
+
+	bits->bits[ADJ_BITS_WORD(i)] &= ~ADJ_BITS_MASK(i);
+	subgrp->adj_bits_count--;
+	SUBGRP_DECR_STAT(subgrp, adj_count);
+
+	if (--bits->count)
+		return;
+
+	bgp_attr_unintern(&bits->attr);
+	XFREE(MTYPE_BGP_ADJ_OUT_BITS, rn->adj_bits);
+	bgp_unlock_node(rn);
+}
+
+/* Table whose nodes carry the subgroup's adj-outs. */
+static struct bgp_table *subgrp_adj_table(struct update_subgroup *subgrp)
+{
+	safi_t safi = SUBGRP_SAFI(subgrp);
+
+	if (safi == SAFI_LABELED_UNICAST)
+		safi = SAFI_UNICAST;
+
+	return SUBGRP_INST(subgrp)->rib[SUBGRP_AFI(subgrp)][safi];
+}
+
 static inline struct bgp_adj_out *adj_lookup(struct bgp_node *rn,
 					     struct update_subgroup *subgrp,
 					     uint32_t addpath_tx_id)
@@ -96,6 +170,12 @@ static inline struct bgp_adj_out *adj_lookup(struct bgp_node *rn,
 				return adj;
 		} else
 			return adj;
+	} else if (adj_bits_test(rn, subgrp)) {
+		/* about to change, turn it back into a full adj-out */
+		adj = bgp_adj_out_alloc(subgrp, rn, addpath_tx_id);
+		adj->attr = bgp_attr_intern(rn->adj_bits->attr);
+		adj_bits_clear(rn, subgrp);
+		return adj;
 	}
 	return NULL;
 }
@@ -224,6 +304,10 @@ static int group_announce_route_walkcb(struct update_group *updgrp, void *arg)
 								adj->addpath_tx_id);
 						}
 					}
+					if (adj_bits_test(ctx->rn, subgrp))
+						subgroup_process_announce_selected(
+							subgrp, NULL, ctx->rn,
+							0);
 				}
 			}
 		}
@@ -236,7 +320,7 @@ static void subgrp_show_adjq_vty(struct update_subgroup *subgrp,
 				 struct vty *vty, uint8_t flags)
 {
 	struct bgp_table *table;
-	struct bgp_adj_out *adj;
+	struct bgp_adj_out *adj, compact;
 	unsigned long output_count;
 	struct bgp_node *rn;
 	int header1 = 1;
@@ -252,7 +336,7 @@ static void subgrp_show_adjq_vty(struct update_subgroup *subgrp,
 	output_count = 0;
 
 	for (rn = bgp_table_top(table); rn; rn = bgp_route_next(rn))
-		RB_FOREACH (adj, bgp_adj_out_rb, &rn->adj_out)
+		RN_FOREACH_ADJ_OUT (rn, adj, &compact)
 			if (adj->subgroup == subgrp) {
 				if (header1) {
 					vty_out(vty,
@@ -586,6 +670,114 @@ void bgp_adj_out_remove_subgroup(struct bgp_node *rn, struct bgp_adj_out *adj,
 	adj_free(adj);
 }
 
+/*
+ * Fold a settled adj-out into the bits of its route node, if the instance
+ * asked for compact adj-outs and the bits there are for the same attribute.
+ * adj must not be used afterwards if that happened.
+ */
+void bgp_adj_out_compact(struct update_subgroup *subgrp,
+			 struct bgp_adj_out *adj)
+{
+	struct bgp_node *rn = adj->rn;
+	safi_t safi = SUBGRP_SAFI(subgrp);
+
+	if (!bgp_flag_check(SUBGRP_INST(subgrp), BGP_FLAG_ADJ_OUT_COMPACT))
+		return;
+
+	if (!rn || adj->adv || !adj->attr)
+		return;
+
+	/* the bits have no room for addpath ids, and the two level vpn/evpn
+	 * tables would have to be walked when a subgroup goes away
+	 */
+	if (safi != SAFI_UNICAST && safi != SAFI_MULTICAST
+	    && safi != SAFI_LABELED_UNICAST)
+		return;
+	if (bgp_addpath_encode_tx(SUBGRP_PEER(subgrp), SUBGRP_AFI(subgrp),
+				  safi))
+		return;
+
+	if (rn->adj_bits && rn->adj_bits->attr != adj->attr)
+		return;
+
+	adj_bits_set(rn, subgrp, adj->attr);
+
+	bgp_attr_unintern(&adj->attr);
+	RB_REMOVE(bgp_adj_out_rb, &rn->adj_out, adj);
+	adj_free(adj);
+	bgp_unlock_node(rn);
+}
+
+/*
+ * Next adj-out of rn after adj, or the first one if adj is NULL. The bits are
+ * handed out after the full adj-outs, one subgroup at a time, by filling in
+ * *compact. See RN_FOREACH_ADJ_OUT.
+ */
+struct bgp_adj_out *bgp_adj_out_next(struct bgp_node *rn,
+				     struct bgp_adj_out *adj,
+				     struct bgp_adj_out *compact)
+{
+	struct bgp_adj_out_bits *bits = rn->adj_bits;
+	unsigned int i = 0;
+	vector subgrps;
+
+	if (adj != compact) {
+		if (adj)
+			adj = RB_NEXT(bgp_adj_out_rb, adj);
+		else
+			adj = RB_MIN(bgp_adj_out_rb, &rn->adj_out);
+		if (adj)
+			return adj;
+	} else
+		i = compact->subgroup->adj_bit + 1;
+
+	if (!bits)
+		return NULL;
+
+	subgrps = bgp_node_table(rn)->bgp->adj_out_subgrps;
+	for (; ADJ_BITS_WORD(i) < bits->words; i++) {
+		if (!bits->bits[ADJ_BITS_WORD(i)]) {
+			i |= 63;
+			continue;
+		}
+		if (!(bits->bits[ADJ_BITS_WORD(i)] & ADJ_BITS_MASK(i)))
+			continue;
+
+		memset(compact, 0, sizeof(*compact));
+		compact->subgroup = vector_slot(subgrps, i);
+		compact->rn = rn;
+		compact->attr = bits->attr;
+		return compact;
+	}
+	return NULL;
+}
+
+/*
+ * Give dest the bits source has. Cheaper than copying full adj-outs, though
+ * it means a walk over the table.
+ */
+void subgroup_copy_adj_bits(struct update_subgroup *source,
+			    struct update_subgroup *dest)
+{
+	struct bgp_table *table;
+	struct bgp_node *rn;
+	uint32_t left = source->adj_bits_count;
+
+	if (!left)
+		return;
+	table = subgrp_adj_table(source);
+	if (!table)
+		return;
+
+	for (rn = bgp_table_top(table); rn && left; rn = bgp_route_next(rn))
+		if (adj_bits_test(rn, source)) {
+			adj_bits_set(rn, dest, rn->adj_bits->attr);
+			left--;
+		}
+	if (rn)
+		bgp_unlock_node(rn);
+}
+
 /*
  * Go through all the routes and clean up the adj/adv structures corresponding
  * to the subgroup.
@@ -593,12 +785,27 @@ void bgp_adj_out_remove_subgroup(struct bgp_node *rn, struct bgp_adj_out *adj,
 void subgroup_clear_table(struct update_subgroup *subgrp)
 {
 	struct bgp_adj_out *aout, *taout;
+	struct bgp_table *table;
+	struct bgp_node *rn;
 
 	SUBGRP_FOREACH_ADJ_SAFE (subgrp, aout, taout) {
 		struct bgp_node *rn = aout->rn;
 		bgp_adj_out_remove_subgroup(rn, aout, subgrp);
 		bgp_unlock_node(rn);
 	}
+
+	if (!subgrp->adj_bits_count)
+		return;
+	table = subgrp_adj_table(subgrp);
+	if (!table)
+		return;
+
+	for (rn = bgp_table_top(table); rn && subgrp->adj_bits_count;
+	     rn = bgp_route_next(rn))
+		if (adj_bits_test(rn, subgrp))
+			adj_bits_clear(rn, subgrp);
+	if (rn)
+		bgp_unlock_node(rn);
 }
 
 /*
@@ -43,6 +43,8 @@
 #include "hash.h"
 #include "queue.h"
 #include "mpls.h"
+#include "monotime.h"
+#include "frr_pthread.h"
 
 #include "bgpd/bgpd.h"
 #include "bgpd/bgp_debug.h"
@@ -686,11 +688,49 @@ int subgroup_packets_to_build(struct update_subgroup *subgrp)
 	return 0;
 }
 
-/* Make BGP update packet.  */
-struct bpacket *subgroup_update_packet(struct update_subgroup *subgrp)
-{
+/*
+ * An UPDATE encoded by subgroup_update_packet_encode() and the
+ * advertisements it carries.  These are already unlinked from the
+ * subgroup's FIFO and attribute lists, releasing them is left to
+ * subgroup_update_packet_commit().
+ */
+struct subgroup_update_built {
+	/* NULL if the advertisements could not be sent at all */
+	struct stream *packet;
 	struct bpacket_attr_vec_arr vecarr;
-	struct bpacket *pkt;
+
+	struct bgp_adv_fifo_head advs;
+};
+
+/*
+ * Move adv from the update FIFO to the built packet and return the next
+ * advertisement with the same attributes, the first half of
+ * bgp_advertise_clean_subgroup().
+ */
+static struct bgp_advertise *
+subgroup_update_adv_take(struct update_subgroup *subgrp,
+			 struct bgp_advertise *adv,
+			 struct subgroup_update_built *built)
+{
+	struct bgp_advertise_attr *baa = adv->baa;
+
+	bgp_advertise_delete(baa, adv);
+	bgp_adv_fifo_del(&subgrp->sync->update, adv);
+	bgp_adv_fifo_add_tail(&built->advs, adv);
+
+	return baa->adv;
+}
+
+/*
+ * Encode the next UPDATE of the subgroup into built.  This only reads
+ * the routes and attributes being advertised and only modifies the
+ * subgroup itself, so subgroups can be encoded on several pthreads at
+ * once.  Returns false if there is nothing to send.
+ */
+static bool subgroup_update_packet_encode(struct update_subgroup *subgrp,
+					  struct subgroup_update_built *built)
+{
+	struct bpacket_attr_vec_arr *vecarr = &built->vecarr;
 	struct peer *peer;
 	struct stream *s;
 	struct stream *snlri;
@@ -717,11 +757,8 @@ struct bpacket *subgroup_update_packet(struct update_subgroup *subgrp)
 	mpls_label_t label = MPLS_INVALID_LABEL, *label_pnt = NULL;
 	uint32_t num_labels = 0;
 
-	if (!subgrp)
-		return NULL;
-
-	if (bpacket_queue_is_full(SUBGRP_INST(subgrp), SUBGRP_PKTQ(subgrp)))
-		return NULL;
+	built->packet = NULL;
+	bgp_adv_fifo_init(&built->advs);
 
 	peer = SUBGRP_PEER(subgrp);
 	afi = SUBGRP_AFI(subgrp);
@@ -731,7 +768,7 @@ struct bpacket *subgroup_update_packet(struct update_subgroup *subgrp)
 	snlri = subgrp->scratch;
 	stream_reset(snlri);
 
-	bpacket_attr_vec_arr_reset(&vecarr);
+	bpacket_attr_vec_arr_reset(vecarr);
 
 	addpath_encode = bgp_addpath_encode_tx(peer, afi, safi);
 	addpath_overhead = addpath_encode ? BGP_ADDPATH_ID_LEN : 0;
@@ -786,7 +823,7 @@ struct bpacket *subgroup_update_packet(struct update_subgroup *subgrp)
 			/* 5: Encode all the attributes, except MP_REACH_NLRI
 			 * attr. */
 			total_attr_len = bgp_packet_attribute(
-				NULL, peer, s, adv->baa->attr, &vecarr, NULL,
+				NULL, peer, s, adv->baa->attr, vecarr, NULL,
 				afi, safi, from, NULL, NULL, 0, 0, 0);
 
 			space_remaining =
@@ -808,9 +845,9 @@ struct bpacket *subgroup_update_packet(struct update_subgroup *subgrp)
 
 				/* Flush the FIFO update queue */
 				while (adv)
-					adv = bgp_advertise_clean_subgroup(
-						subgrp, adj);
-				return NULL;
+					adv = subgroup_update_adv_take(
+						subgrp, adv, built);
+				return true;
 			}
 
 			if (BGP_DEBUG(update, UPDATE_OUT)
@@ -843,7 +880,7 @@ struct bpacket *subgroup_update_packet(struct update_subgroup *subgrp)
 
 			if (stream_empty(snlri))
 				mpattrlen_pos = bgp_packet_mpattr_start(
-					snlri, peer, afi, safi, &vecarr,
+					snlri, peer, afi, safi, vecarr,
 					adv->baa->attr);
 
 			bgp_packet_mpattr_prefix(snlri, afi, safi, &rn->p, prd,
@@ -887,15 +924,7 @@ struct bpacket *subgroup_update_packet(struct update_subgroup *subgrp)
 				   pfx_buf);
 		}
 
-		/* Synchnorize attribute.  */
-		if (adj->attr)
-			bgp_attr_unintern(&adj->attr);
-		else
-			subgrp->scount++;
-
-		adj->attr = bgp_attr_intern(adv->baa->attr);
-
-		adv = bgp_advertise_clean_subgroup(subgrp, adj);
+		adv = subgroup_update_adv_take(subgrp, adv, built);
 	}
 
 	if (!stream_empty(s)) {
@@ -909,7 +938,7 @@ struct bpacket *subgroup_update_packet(struct update_subgroup *subgrp)
 
 		if (!stream_empty(snlri)) {
 			packet = stream_dupcat(s, snlri, mpattr_pos);
-			bpacket_attr_vec_arr_update(&vecarr, mpattr_pos);
+			bpacket_attr_vec_arr_update(vecarr, mpattr_pos);
 		} else
 			packet = stream_dup(s);
 		bgp_packet_set_size(packet);
@@ -920,12 +949,278 @@ struct bpacket *subgroup_update_packet(struct update_subgroup *subgrp)
 				   (stream_get_endp(packet)
 				    - stream_get_getp(packet)),
 				   num_pfx);
-		pkt = bpacket_queue_add(SUBGRP_PKTQ(subgrp), packet, &vecarr);
+		built->packet = packet;
 		stream_reset(s);
 		stream_reset(snlri);
-		return pkt;
+		return true;
 	}
-	return NULL;
+	return false;
+}
+
+/*
+ * Release the advertisements of a packet built by
+ * subgroup_update_packet_encode(), record what was sent in the adj-out and
+ * queue the packet.  Main pthread only.
+ */
+static struct bpacket *
+subgroup_update_packet_commit(struct update_subgroup *subgrp,
+			      struct subgroup_update_built *built)
+{
+	struct bgp_advertise *adv;
+	struct bgp_adj_out *adj;
+
+	while ((adv = bgp_adv_fifo_pop(&built->advs))) {
+		adj = adv->adj;
+
+		/* Synchnorize attribute.  */
+		if (built->packet) {
+			if (adj->attr)
+				bgp_attr_unintern(&adj->attr);
+			else
+				subgrp->scount++;
+
+			adj->attr = bgp_attr_intern(adv->baa->attr);
+		}
+
+		bgp_advertise_unintern(subgrp->hash, adv->baa);
+		bgp_advertise_free(adv);
+		adj->adv = NULL;
+		bgp_adj_out_compact(subgrp, adj);
+	}
+	bgp_adv_fifo_fini(&built->advs);
+
+	if (!built->packet)
+		return NULL;
+
+	return bpacket_queue_add(SUBGRP_PKTQ(subgrp), built->packet,
+				 &built->vecarr);
+}
+
+/* Make BGP update packet.  */
+struct bpacket *subgroup_update_packet(struct update_subgroup *subgrp)
+{
+	struct subgroup_update_built built;
+	struct bpacket *pkt;
+	struct timeval start;
+
+	if (!subgrp)
+		return NULL;
+
+	if (bpacket_queue_is_full(SUBGRP_INST(subgrp), SUBGRP_PKTQ(subgrp)))
+		return NULL;
+
+	monotime(&start);
+	if (!subgroup_update_packet_encode(subgrp, &built))
+		return NULL;
+	pkt = subgroup_update_packet_commit(subgrp, &built);
+
+	/* Encoding may have ended up with nothing to send */
+	if (pkt)
+		subgrp->packets_built++;
+	subgrp->build_usec += monotime_since(&start, NULL);
+	return pkt;
+}
+
+
+
+/*
+ * Building the UPDATEs of many subgroups on the best-path pthreads.  The
+ * packets are encoded there, and queued and recorded in the adj-outs on
+ * the main pthread afterwards.
+ */
+struct subgroup_build_job {
+	struct update_subgroup *subgrp;
+
+	/* room left in the packet queue, built packets */
+	unsigned int room;
+	unsigned int count;
+	struct subgroup_update_built *built;
+
+	int64_t usec;
+};
+
+struct subgroup_build_batch {
+	struct subgroup_build_job *jobs;
+	unsigned int count;
+	unsigned int alloc;
+	_Atomic unsigned int next;
+
+	pthread_mutex_t mtx;
+	pthread_cond_t cond;
+	unsigned int running; /* pthreads still working */
+};
+
+/* Fewer subgroups than this are built serially, as peers ask for them */
+#define SUBGRP_BUILD_BATCH_MIN 4
+
+/* Has the peer sent everything queued for it, so that it waits for more? */
+static bool subgroup_build_paf_waiting(struct peer_af *paf)
+{
+	return paf->peer->status == Established
+	       && (!paf->next_pkt_to_send || !paf->next_pkt_to_send->buffer);
+}
+
+/*
+ * Is it worth building the subgroup's pending UPDATEs now?  Only if one
+ * of its peers is waiting for them; peers with packets still queued will
+ * have them built serially once they get there.
+ */
+static bool subgroup_build_wanted(struct update_subgroup *subgrp)
+{
+	struct peer_af *paf;
+
+	if (bgp_adv_fifo_count(&subgrp->sync->withdraw)
+	    || !bgp_adv_fifo_count(&subgrp->sync->update))
+		return false;
+	if (bpacket_queue_is_full(SUBGRP_INST(subgrp), SUBGRP_PKTQ(subgrp)))
+		return false;
+
+	SUBGRP_FOREACH_PEER (subgrp, paf)
+		if (subgroup_build_paf_waiting(paf))
+			return true;
+	return false;
+}
+
+static int subgroup_build_batch_walkcb(struct update_group *updgrp, void *arg)
+{
+	struct subgroup_build_batch *batch = arg;
+	struct update_subgroup *subgrp;
+	struct subgroup_build_job *job;
+	struct bpacket_queue *q;
+
+	UPDGRP_FOREACH_SUBGRP (updgrp, subgrp) {
+		if (!subgroup_build_wanted(subgrp))
+			continue;
+
+		if (batch->count == batch->alloc) {
+			batch->alloc = MAX(2 * batch->alloc, 64);
+			batch->jobs = XREALLOC(MTYPE_BGP_UPD_BUILD, batch->jobs,
+					       batch->alloc
+						       * sizeof(*batch->jobs));
+		}
+		q = SUBGRP_PKTQ(subgrp);
+		job = &batch->jobs[batch->count++];
+		memset(job, 0, sizeof(*job));
+		job->subgrp = subgrp;
+		job->room = updgrp->bgp->default_subgroup_pkt_queue_max
+			    - q->curr_count;
+	}
+	return UPDWALK_CONTINUE;
+}
+
+static void subgroup_build_batch_run(struct subgroup_build_batch *batch)
+{
+	struct subgroup_build_job *job;
+	struct timeval start;
+	unsigned int i;
+
+	while ((i = atomic_fetch_add_explicit(&batch->next, 1,
+					      memory_order_relaxed))
+	       < batch->count) {
+		job = &batch->jobs[i];
+
+		monotime(&start);
+		while (job->count < job->room
+		       && subgroup_update_packet_encode(
+			       job->subgrp, &job->built[job->count]))
+			job->count++;
+		job->usec = monotime_since(&start, NULL);
+	}
+}
+
+static int subgroup_build_work(struct thread *thread)
+{
+	struct subgroup_build_batch *batch = THREAD_ARG(thread);
+
+	subgroup_build_batch_run(batch);
+
+	frr_with_mutex(&batch->mtx) {
+		if (--batch->running == 0)
+			pthread_cond_signal(&batch->cond);
+	}
+	return 0;
+}
+
+static bool subgroup_build_peer_wants(struct peer *peer)
+{
+	struct peer_af *paf;
+	afi_t afi;
+	safi_t safi;
+
+	FOREACH_AFI_SAFI (afi, safi) {
+		paf = peer_af_find(peer, afi, safi);
+		if (!paf || !PAF_SUBGRP(paf))
+			continue;
+		if (!subgroup_build_paf_waiting(paf))
+			continue;
+		if (subgroup_build_wanted(PAF_SUBGRP(paf)))
+			return true;
+	}
+	return false;
+}
+
+/*
+ * Called before peer pulls its next packets.  If the peer has to wait for
+ * an UPDATE to be built, build the pending UPDATEs of the instance's
+ * subgroups that have a peer waiting for them, up to their packet queue
+ * limit, with the best-path pthreads.  Subgroups with withdraws pending are
+ * left to the serial path, which sends those first.
+ */
+void subgroup_build_packets_parallel(struct peer *peer)
+{
+	struct subgroup_build_batch batch = {};
+	struct subgroup_build_job *job;
+	struct bgp *bgp = peer->bgp;
+	unsigned int i, j;
+
+	if (!bm->bestpath_workers || !subgroup_build_peer_wants(peer))
+		return;
+
+	update_group_walk(bgp, subgroup_build_batch_walkcb, &batch);
+	if (batch.count < SUBGRP_BUILD_BATCH_MIN) {
+		XFREE(MTYPE_BGP_UPD_BUILD, batch.jobs);
+		return;
+	}
+
+	for (i = 0; i < batch.count; i++)
+		batch.jobs[i].built = XMALLOC(
+			MTYPE_BGP_UPD_BUILD,
+			batch.jobs[i].room * sizeof(*batch.jobs[i].built));
+
+	pthread_mutex_init(&batch.mtx, NULL);
+	pthread_cond_init(&batch.cond, NULL);
+	batch.running = bm->bestpath_workers;
+
+	for (i = 0; i < bm->bestpath_workers; i++)
+		thread_add_event(bgp_pth_bestpath[i]->master,
+				 subgroup_build_work, &batch, 0, NULL);
+
+	subgroup_build_batch_run(&batch);
+
+	frr_with_mutex(&batch.mtx) {
+		while (batch.running)
+			pthread_cond_wait(&batch.cond, &batch.mtx);
+	}
+
+	pthread_cond_destroy(&batch.cond);
+	pthread_mutex_destroy(&batch.mtx);
+
+	for (i = 0; i < batch.count; i++) {
+		job = &batch.jobs[i];
+
+		for (j = 0; j < job->count; j++)
+			if (subgroup_update_packet_commit(job->subgrp,
+							  &job->built[j]))
+				job->subgrp->packets_built++;
+
+		job->subgrp->build_usec += job->usec;
+		XFREE(MTYPE_BGP_UPD_BUILD, job->built);
+
+		subgroup_trigger_write(job->subgrp);
+	}
+	bgp->update_group_stats.parallel_builds++;
+
+	XFREE(MTYPE_BGP_UPD_BUILD, batch.jobs);
 }
 
 /* Make BGP withdraw packet.  */
@@ -2457,6 +2457,32 @@ DEFUN (no_bgp_default_show_hostname,
 	return CMD_SUCCESS;
 }
 
+/* "bgp adj-rib-out compact" configuration.  */
+DEFUN (bgp_adj_rib_out_compact,
+       bgp_adj_rib_out_compact_cmd,
+       "bgp adj-rib-out compact",
+       "BGP specific commands\n"
+       "Routes advertised to peers\n"
+       "Keep them as per-prefix bitmaps of update subgroups\n")
+{
+	VTY_DECLVAR_CONTEXT(bgp, bgp);
+	bgp_flag_set(bgp, BGP_FLAG_ADJ_OUT_COMPACT);
+	return CMD_SUCCESS;
+}
+
+DEFUN (no_bgp_adj_rib_out_compact,
+       no_bgp_adj_rib_out_compact_cmd,
+       "no bgp adj-rib-out compact",
+       NO_STR
+       "BGP specific commands\n"
+       "Routes advertised to peers\n"
+       "Keep them as per-prefix bitmaps of update subgroups\n")
+{
+	VTY_DECLVAR_CONTEXT(bgp, bgp);
+	bgp_flag_unset(bgp, BGP_FLAG_ADJ_OUT_COMPACT);
+	return CMD_SUCCESS;
+}
+
 /* "bgp network import-check" configuration.  */
 DEFUN (bgp_network_import_check,
        bgp_network_import_check_cmd,
@@ -7731,10 +7757,13 @@ DEFUN (show_bgp_memory,
 		mtype_memstr(memstrbuf, sizeof(memstrbuf),
 			     count * sizeof(struct bgp_node)));
 
-	count = mtype_stats_alloc(MTYPE_BGP_ROUTE);
+	count = bgp_path_info_count();
 	vty_out(vty, "%ld BGP routes, using %s of memory\n", count,
 		mtype_memstr(memstrbuf, sizeof(memstrbuf),
-			     count * sizeof(struct bgp_path_info)));
+			     bgp_path_info_memory()));
+	if (count)
+		vty_out(vty, "  %zu bytes held per route, including free arena slots\n",
+			bgp_path_info_memory() / count);
 	if ((count = mtype_stats_alloc(MTYPE_BGP_ROUTE_EXTRA)))
 		vty_out(vty, "%ld BGP route ancillaries, using %s of memory\n",
 			count,
@@ -7753,14 +7782,21 @@ DEFUN (show_bgp_memory,
 				     count * sizeof(struct bpacket)));
 
 	/* Adj-In/Out */
-	if ((count = mtype_stats_alloc(MTYPE_BGP_ADJ_IN)))
+	if ((count = bgp_adj_in_count()))
 		vty_out(vty, "%ld Adj-In entries, using %s of memory\n", count,
 			mtype_memstr(memstrbuf, sizeof(memstrbuf),
-				     count * sizeof(struct bgp_adj_in)));
+				     bgp_adj_in_memory()));
 	if ((count = mtype_stats_alloc(MTYPE_BGP_ADJ_OUT)))
 		vty_out(vty, "%ld Adj-Out entries, using %s of memory\n", count,
 			mtype_memstr(memstrbuf, sizeof(memstrbuf),
 				     count * sizeof(struct bgp_adj_out)));
+	if ((count = mtype_stats_alloc(MTYPE_BGP_ADJ_OUT_BITS)))
+		vty_out(vty,
+			"%ld Adj-Out compact entries, using at least %s of memory\n",
+			count,
+			mtype_memstr(memstrbuf, sizeof(memstrbuf),
+				     count * (sizeof(struct bgp_adj_out_bits)
+					      + sizeof(uint64_t))));
 
 	if ((count = mtype_stats_alloc(MTYPE_BGP_NEXTHOP_CACHE)))
 		vty_out(vty, "%ld Nexthop cache entries, using %s of memory\n",
@@ -9383,6 +9419,7 @@ static void bgp_show_peer(struct vty *vty, struct peer *p, bool use_json,
 	uint8_t *msg;
 	json_object *json_neigh = NULL;
 	time_t epoch_tbuf;
+	uint64_t write_calls, write_bytes;
 
 	bgp = p->bgp;
 
@@ -10646,6 +10683,11 @@ static void bgp_show_peer(struct vty *vty, struct peer *p, bool use_json,
 						p->t_gr_stale));
 		}
 	}
+	write_calls = atomic_load_explicit(&p->write_calls,
+					   memory_order_relaxed);
+	write_bytes = atomic_load_explicit(&p->write_bytes,
+					   memory_order_relaxed);
+
 	if (use_json) {
 		json_object *json_stat = NULL;
 		json_stat = json_object_new_object();
@@ -10691,6 +10733,10 @@ static void bgp_show_peer(struct vty *vty, struct peer *p, bool use_json,
 							 memory_order_relaxed));
 		json_object_int_add(json_stat, "totalSent", PEER_TOTAL_TX(p));
 		json_object_int_add(json_stat, "totalRecv", PEER_TOTAL_RX(p));
+		json_object_int_add(json_stat, "writeCalls", write_calls);
+		json_object_int_add(json_stat, "writeBytes", write_bytes);
+		json_object_int_add(json_stat, "bytesPerWrite",
+				    write_calls ? write_bytes / write_calls : 0);
 		json_object_object_add(json_neigh, "messageStats", json_stat);
 	} else {
 		/* Packet counts. */
@@ -10731,6 +10777,11 @@ static void bgp_show_peer(struct vty *vty, struct peer *p, bool use_json,
 					     memory_order_relaxed));
 		vty_out(vty, "    Total:         %10d %10d\n", PEER_TOTAL_TX(p),
 			PEER_TOTAL_RX(p));
+		vty_out(vty,
+			"    Socket writes %" PRIu64 ", bytes %" PRIu64
+			" (%" PRIu64 " bytes per write)\n",
+			write_calls, write_bytes,
+			write_calls ? write_bytes / write_calls : 0);
 	}
 
 	if (use_json) {
@@ -11382,12 +11433,11 @@ DEFUN (show_ip_bgp_paths,
 
 #include "hash.h"
 
-static void community_show_all_iterator(struct hash_bucket *bucket,
-					struct vty *vty)
+static void community_show_all_iterator(void *data, void *arg)
 {
-	struct community *com;
+	struct community *com = data;
+	struct vty *vty = arg;
 
-	com = (struct community *)bucket->data;
 	vty_out(vty, "[%p] (%ld) %s\n", (void *)com, com->refcnt,
 		community_str(com, false));
 }
@@ -11403,20 +11453,16 @@ DEFUN (show_ip_bgp_community_info,
 {
 	vty_out(vty, "Address Refcnt Community\n");
 
-	hash_iterate(community_hash(),
-		     (void (*)(struct hash_bucket *,
-			       void *))community_show_all_iterator,
-		     vty);
+	chash_iterate(community_hash(), community_show_all_iterator, vty);
 
 	return CMD_SUCCESS;
 }
 
-static void lcommunity_show_all_iterator(struct hash_bucket *bucket,
-					 struct vty *vty)
+static void lcommunity_show_all_iterator(void *data, void *arg)
 {
-	struct lcommunity *lcom;
+	struct lcommunity *lcom = data;
+	struct vty *vty = arg;
 
-	lcom = (struct lcommunity *)bucket->data;
 	vty_out(vty, "[%p] (%ld) %s\n", (void *)lcom, lcom->refcnt,
 		lcommunity_str(lcom, false));
 }
@@ -11432,10 +11478,7 @@ DEFUN (show_ip_bgp_lcommunity_info,
 {
 	vty_out(vty, "Address Refcnt Large-community\n");
 
-	hash_iterate(lcommunity_hash(),
-		     (void (*)(struct hash_bucket *,
-			       void *))lcommunity_show_all_iterator,
-		     vty);
+	chash_iterate(lcommunity_hash(), lcommunity_show_all_iterator, vty);
 
 	return CMD_SUCCESS;
 }
@@ -13191,6 +13234,10 @@ void bgp_vty_init(void)
 	install_element(BGP_NODE, &bgp_default_subgroup_pkt_queue_max_cmd);
 	install_element(BGP_NODE, &no_bgp_default_subgroup_pkt_queue_max_cmd);
 
+	/* "bgp adj-rib-out compact" commands. */
+	install_element(BGP_NODE, &bgp_adj_rib_out_compact_cmd);
+	install_element(BGP_NODE, &no_bgp_adj_rib_out_compact_cmd);
+
 	/* bgp ibgp-allow-policy-mods command */
 	install_element(BGP_NODE, &bgp_rr_allow_outbound_policy_cmd);
 	install_element(BGP_NODE, &no_bgp_rr_allow_outbound_policy_cmd);
@@ -2704,13 +2704,16 @@ static int bgp_ifp_create(struct interface *ifp)
 
 void bgp_zebra_init(struct thread_master *master, unsigned short instance)
 {
+	struct zclient_options opt = {.receive_notify = false,
+				      .route_bulk = true};
+
 	zclient_num_connects = 0;
 
 	if_zapi_callbacks(bgp_ifp_create, bgp_ifp_up,
 			  bgp_ifp_down, bgp_ifp_destroy);
 
 	/* Set default values. */
-	zclient = zclient_new(master, &zclient_options_default);
+	zclient = zclient_new(master, &opt);
 	zclient_init(zclient, ZEBRA_ROUTE_BGP, 0, &bgpd_privs);
 	zclient->zebra_connected = bgp_zebra_connected;
 	zclient->router_id_update = bgp_router_id_update;
@@ -88,6 +88,7 @@
 #include "bgpd/bgp_addpath.h"
 #include "bgpd/bgp_evpn_private.h"
 #include "bgpd/bgp_mac.h"
+#include "bgpd/bgp_pipeline.h"
 
 DEFINE_MTYPE_STATIC(BGPD, PEER_TX_SHUTDOWN_MSG, "Peer shutdown message (TX)");
 DEFINE_MTYPE_STATIC(BGPD, BGP_EVPN_INFO, "BGP EVPN instance information");
@@ -1049,8 +1050,12 @@ static inline bgp_peer_sort_t peer_calc_sort(struct peer *peer)
 /* Calculate and cache the peer "sort" */
 bgp_peer_sort_t peer_sort(struct peer *peer)
 {
-	peer->sort = peer_calc_sort(peer);
-	return peer->sort;
+	bgp_peer_sort_t sort = peer_calc_sort(peer);
+
+	/* only store on change, best-path pthreads call this concurrently */
+	if (peer->sort != sort)
+		peer->sort = sort;
+	return sort;
 }
 
 static void peer_free(struct peer *peer)
@@ -1133,6 +1138,7 @@ static void peer_free(struct peer *peer)
 		for (safi = SAFI_UNICAST; safi < SAFI_MAX; safi++) {
 			bgp_addpath_set_peer_type(peer, afi, safi,
 						 BGP_ADDPATH_NONE);
+			bgp_rmap_cache_free(&peer->rmap_cache[afi][safi]);
 		}
 	}
 
@@ -1231,6 +1237,8 @@ struct peer *peer_new(struct bgp *bgp)
 	/* Create buffers.  */
 	peer->ibuf = stream_fifo_new();
 	peer->obuf = stream_fifo_new();
+	peer->ibuf_parse = stream_fifo_new();
+	bgp_decoded_list_init(&peer->decoded);
 	pthread_mutex_init(&peer->io_mtx, NULL);
 
 	/* We use a larger buffer for peer->obuf_work in the event that:
@@ -2295,6 +2303,14 @@ int peer_delete(struct peer *peer)
 	}
 
 	/* Buffers.  */
+	bgp_pipeline_flush(peer);
+	bgp_decoded_list_fini(&peer->decoded);
+
+	if (peer->ibuf_parse) {
+		stream_fifo_free(peer->ibuf_parse);
+		peer->ibuf_parse = NULL;
+	}
+
 	if (peer->ibuf) {
 		stream_fifo_free(peer->ibuf);
 		peer->ibuf = NULL;
@@ -3295,6 +3311,7 @@ int bgp_delete(struct bgp *bgp)
 	struct listnode *node, *next;
 	struct vrf *vrf;
 	afi_t afi;
+	safi_t safi;
 	int i;
 
 	assert(bgp);
@@ -3327,6 +3344,10 @@ int bgp_delete(struct bgp *bgp)
 	vpn_leak_zebra_vrf_label_withdraw(bgp, AFI_IP);
 	vpn_leak_zebra_vrf_label_withdraw(bgp, AFI_IP6);
 
+	/* Drop dampening state while the paths it refers to are intact */
+	FOREACH_AFI_SAFI (afi, safi)
+		bgp_damp_disable(bgp, afi, safi);
+
 	/* Stop timers. */
 	if (bgp->t_rmap_def_originate_eval) {
 		BGP_TIMER_OFF(bgp->t_rmap_def_originate_eval);
@@ -7479,6 +7500,11 @@ static void bgp_config_write_family(struct vty *vty, struct bgp *bgp, afi_t afi,
 
 	bgp_config_write_redistribute(vty, bgp, afi, safi);
 
+	/* ipv4 unicast dampening is written with the instance */
+	if (CHECK_FLAG(bgp->af_flags[afi][safi], BGP_CONFIG_DAMPENING)
+	    && !(afi == AFI_IP && safi == SAFI_UNICAST))
+		bgp_config_write_damp(vty, bgp, afi, safi);
+
 	for (ALL_LIST_ELEMENTS(bgp->group, node, nnode, group))
 		bgp_config_write_peer_af(vty, bgp, group->conf, afi, safi);
 
@@ -7691,6 +7717,9 @@ int bgp_config_write(struct vty *vty)
 		if (bgp_flag_check(bgp, BGP_FLAG_GRACEFUL_SHUTDOWN))
 			vty_out(vty, " bgp graceful-shutdown\n");
 
+		if (bgp_flag_check(bgp, BGP_FLAG_ADJ_OUT_COMPACT))
+			vty_out(vty, " bgp adj-rib-out compact\n");
+
 		/* BGP graceful-restart Preserve State F bit. */
 		if (bgp_flag_check(bgp, BGP_FLAG_GR_PRESERVE_FWD))
 			vty_out(vty,
@@ -7740,7 +7769,7 @@ int bgp_config_write(struct vty *vty)
 		/* BGP flag dampening. */
 		if (CHECK_FLAG(bgp->af_flags[AFI_IP][SAFI_UNICAST],
 			       BGP_CONFIG_DAMPENING))
-			bgp_config_write_damp(vty);
+			bgp_config_write_damp(vty, bgp, AFI_IP, SAFI_UNICAST);
 
 		/* BGP timers configuration. */
 		if (bgp->default_keepalive != BGP_DEFAULT_KEEPALIVE
@@ -7925,6 +7954,8 @@ static const struct cmd_variable_handler bgp_viewvrf_var_handlers[] = {
 
 struct frr_pthread *bgp_pth_io;
 struct frr_pthread *bgp_pth_ka;
+struct frr_pthread *bgp_pth_parse[BGP_PARSE_WORKERS_MAX];
+struct frr_pthread *bgp_pth_bestpath[BGP_BESTPATH_WORKERS_MAX];
 
 static void bgp_pthreads_init(void)
 {
@@ -7941,16 +7972,50 @@ static void bgp_pthreads_init(void)
 	};
 	bgp_pth_io = frr_pthread_new(&io, "BGP I/O thread", "bgpd_io");
 	bgp_pth_ka = frr_pthread_new(&ka, "BGP Keepalives thread", "bgpd_ka");
+
+	for (unsigned int i = 0; i < bm->parse_workers; i++) {
+		struct frr_pthread_attr parse = {
+			.start = frr_pthread_attr_default.start,
+			.stop = frr_pthread_attr_default.stop,
+		};
+		char name[32], os_name[OS_THREAD_NAMELEN];
+
+		snprintf(name, sizeof(name), "BGP parse thread %u", i);
+		snprintf(os_name, sizeof(os_name), "bgpd_parse%u", i);
+		bgp_pth_parse[i] = frr_pthread_new(&parse, name, os_name);
+	}
+
+	for (unsigned int i = 0; i < bm->bestpath_workers; i++) {
+		struct frr_pthread_attr bestpath = {
+			.start = frr_pthread_attr_default.start,
+			.stop = frr_pthread_attr_default.stop,
+		};
+		char name[32], os_name[OS_THREAD_NAMELEN];
+
+		snprintf(name, sizeof(name), "BGP bestpath thread %u", i);
+		snprintf(os_name, sizeof(os_name), "bgpd_bestpath%u", i);
+		bgp_pth_bestpath[i] = frr_pthread_new(&bestpath, name, os_name);
+	}
 }
 
 void bgp_pthreads_run(void)
 {
+	unsigned int i;
+
 	frr_pthread_run(bgp_pth_io, NULL);
 	frr_pthread_run(bgp_pth_ka, NULL);
+	for (i = 0; i < bm->parse_workers; i++)
+		frr_pthread_run(bgp_pth_parse[i], NULL);
+	for (i = 0; i < bm->bestpath_workers; i++)
+		frr_pthread_run(bgp_pth_bestpath[i], NULL);
 
 	/* Wait until threads are ready. */
 	frr_pthread_wait_running(bgp_pth_io);
 	frr_pthread_wait_running(bgp_pth_ka);
+	for (i = 0; i < bm->parse_workers; i++)
+		frr_pthread_wait_running(bgp_pth_parse[i]);
+	for (i = 0; i < bm->bestpath_workers; i++)
+		frr_pthread_wait_running(bgp_pth_bestpath[i]);
 }
 
 void bgp_pthreads_finish(void)
@@ -7990,6 +8055,7 @@ void bgp_init(unsigned short instance)
 #endif
 	bgp_ethernetvpn_init();
 	bgp_flowspec_vty_init();
+	bgp_pipeline_init();
 
 	/* Access list initialize. */
 	access_list_init();
@@ -33,9 +33,11 @@
 
 /* For union sockunion.  */
 #include "queue.h"
+#include "typesafe.h"
 #include "sockunion.h"
 #include "routemap.h"
 #include "linklist.h"
+#include "vector.h"
 #include "defaults.h"
 #include "bgp_memory.h"
 #include "bitfield.h"
@@ -52,6 +54,7 @@
 struct update_subgroup;
 struct bpacket;
 struct bgp_pbr_config;
+struct bgp_adj_in_table;
 
 /*
  * Allow the neighbor XXXX remote-as to take internal or external
@@ -107,6 +110,14 @@ enum bgp_af_index {
 extern struct frr_pthread *bgp_pth_io;
 extern struct frr_pthread *bgp_pth_ka;
 
+/* Most UPDATE parse pthreads that can be configured */
+#define BGP_PARSE_WORKERS_MAX 16
+extern struct frr_pthread *bgp_pth_parse[BGP_PARSE_WORKERS_MAX];
+
+/* Most best-path selection pthreads that can be configured */
+#define BGP_BESTPATH_WORKERS_MAX 16
+extern struct frr_pthread *bgp_pth_bestpath[BGP_BESTPATH_WORKERS_MAX];
+
 /* BGP master for system wide configurations and variables.  */
 struct bgp_master {
 	/* BGP instance list.  */
@@ -157,6 +168,14 @@ struct bgp_master {
 	struct bgp* bgp_evpn;
 
 	bool terminating;	/* global flag that sigint terminate seen */
+
+	/* Number of UPDATE parse pthreads, 0 to parse on the main pthread */
+	unsigned int parse_workers;
+
+	/* Number of best-path selection pthreads, 0 to select on the main
+	 * pthread only
+	 */
+	unsigned int bestpath_workers;
 	QOBJ_FIELDS
 };
 DECLARE_QOBJ_TYPE(bgp_master)
@@ -263,6 +282,9 @@ struct bgp {
 
 	struct hash *update_groups[BGP_AF_MAX];
 
+	/* Update subgroups by adj_bit, see struct bgp_adj_out_bits */
+	vector adj_out_subgrps;
+
 	/*
 	 * Global statistics for update groups.
 	 */
@@ -280,6 +302,9 @@ struct bgp {
 		uint32_t updgrps_deleted;
 		uint32_t subgrps_created;
 		uint32_t subgrps_deleted;
+
+		/* subgroup_build_packets_parallel() runs */
+		uint32_t parallel_builds;
 	} update_group_stats;
 
 	/* BGP configuration.  */
@@ -364,6 +389,7 @@ struct bgp {
 #define BGP_FLAG_GR_PRESERVE_FWD          (1 << 20)
 #define BGP_FLAG_GRACEFUL_SHUTDOWN        (1 << 21)
 #define BGP_FLAG_DELETE_IN_PROGRESS       (1 << 22)
+#define BGP_FLAG_ADJ_OUT_COMPACT          (1 << 23)
 
 	/* BGP Per AF flags */
 	uint16_t af_flags[AFI_MAX][SAFI_MAX];
@@ -380,6 +406,9 @@ struct bgp {
 #define BGP_CONFIG_VRF_TO_VRF_IMPORT			(1 << 7)
 #define BGP_CONFIG_VRF_TO_VRF_EXPORT			(1 << 8)
 
+	/* Flap dampening of each AF with BGP_CONFIG_DAMPENING */
+	struct bgp_damp_config *damp[AFI_MAX][SAFI_MAX];
+
 	/* BGP per AF peer count */
 	uint32_t af_peer_count[AFI_MAX][SAFI_MAX];
 
@@ -714,6 +743,9 @@ struct peer_af {
 	int afid;
 };
 
+/* UPDATEs decoded ahead of time by a parse pthread, see bgp_pipeline.h */
+PREDECL_LIST(bgp_decoded_list)
+
 /* BGP neighbor structure. */
 struct peer {
 	/* BGP structure.  */
@@ -752,9 +784,12 @@ struct peer {
 	struct in_addr local_id;
 
 	/* Packet receive and send buffer. */
-	pthread_mutex_t io_mtx;   // guards ibuf, obuf
+	pthread_mutex_t io_mtx;   // guards ibuf, obuf, ibuf_parse, decoded
 	struct stream_fifo *ibuf; // packets waiting to be processed
 	struct stream_fifo *obuf; // packets waiting to be written
+	struct stream_fifo *ibuf_parse; // packets waiting for a parse pthread
+	struct bgp_decoded_list_head decoded; // UPDATEs on ibuf pre-decoded
+	_Atomic uint32_t parse_state; // session state seen by parse pthreads
 
 	struct ringbuf *ibuf_work; // WiP buffer used by bgp_read() only
 	struct stream *obuf_work;  // WiP buffer used to construct packets
@@ -1035,6 +1070,7 @@ struct peer {
 	struct thread *t_gr_stale;
 	struct thread *t_generate_updgrp_packets;
 	struct thread *t_process_packet;
+	struct thread *t_parse;
 
 	/* Thread flags. */
 	_Atomic uint32_t thread_flags;
@@ -1082,6 +1118,8 @@ struct peer {
 	_Atomic uint32_t refresh_out;     /* Route Refresh output count */
 	_Atomic uint32_t dynamic_cap_in;  /* Dynamic Capability input count.  */
 	_Atomic uint32_t dynamic_cap_out; /* Dynamic Capability output count. */
+	_Atomic uint64_t write_calls;     /* Socket writes */
+	_Atomic uint64_t write_bytes;     /* Bytes written to the socket */
 
 	uint32_t stat_pfx_filter;
 	uint32_t stat_pfx_aspath_loop;
@@ -1101,6 +1139,9 @@ struct peer {
 
 	/* Syncronization list and time.  */
 	struct bgp_synchronize *sync[AFI_MAX][SAFI_MAX];
+
+	/* Adj-RIB-In (soft-reconfiguration inbound), see bgp_advertise.c */
+	struct bgp_adj_in_table *adj_in[AFI_MAX][SAFI_MAX];
 	time_t synctime;
 	/* timestamp when the last UPDATE msg was written */
 	_Atomic time_t last_write;
@@ -1116,6 +1157,9 @@ struct peer {
 	/* Filter structure. */
 	struct bgp_filter filter[AFI_MAX][SAFI_MAX];
 
+	/* Memoized results of the inbound route-maps */
+	struct bgp_rmap_cache *rmap_cache[AFI_MAX][SAFI_MAX];
+
 	/*
 	 * Parallel array to filter that indicates whether each filter
 	 * originates from a peer-group or if it is config that is specific to
@@ -1735,6 +1779,13 @@ extern int peer_tx_shutdown_message_unset(struct peer *);
 extern int bgp_route_map_update_timer(struct thread *thread);
 extern void bgp_route_map_terminate(void);
 
+struct bgp_rmap_cache;
+struct bgp_path_info;
+extern route_map_result_t bgp_route_map_apply_cached(
+	struct bgp_rmap_cache **cachep, struct route_map *map,
+	const struct prefix *p, struct bgp_path_info *path);
+extern void bgp_rmap_cache_free(struct bgp_rmap_cache **cachep);
+
 extern int peer_cmp(struct peer *p1, struct peer *p2);
 
 extern int bgp_map_afi_safi_iana2int(iana_afi_t pkt_afi, iana_safi_t pkt_safi,
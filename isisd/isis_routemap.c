@@ -109,7 +109,9 @@ static void route_match_ip_address_prefix_list_free(void *rule)
 struct route_map_rule_cmd route_match_ip_address_prefix_list_cmd = {
 	"ip address prefix-list", route_match_ip_address_prefix_list,
 	route_match_ip_address_prefix_list_compile,
-	route_match_ip_address_prefix_list_free};
+	route_match_ip_address_prefix_list_free,
+	.match_plist_afi = AFI_IP,
+};
 
 /* ------------------------------------------------------------*/
 
@@ -174,7 +176,9 @@ static void route_match_ipv6_address_prefix_list_free(void *rule)
 struct route_map_rule_cmd route_match_ipv6_address_prefix_list_cmd = {
 	"ipv6 address prefix-list", route_match_ipv6_address_prefix_list,
 	route_match_ipv6_address_prefix_list_compile,
-	route_match_ipv6_address_prefix_list_free};
+	route_match_ipv6_address_prefix_list_free,
+	.match_plist_afi = AFI_IP6,
+};
 
 /* ------------------------------------------------------------*/
 
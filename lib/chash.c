@@ -0,0 +1,388 @@
+/* Concurrent reference-counted intern hash table.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; see the file COPYING; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <zebra.h>
+
+#include "chash.h"
+#include "memory.h"
+
+DEFINE_MTYPE_STATIC(LIB, CHASH, "Concurrent hash")
+DEFINE_MTYPE_STATIC(LIB, CHASH_ARRAY, "Concurrent hash array")
+
+/* Smallest array, in slots; always a power of 2 */
+#define CHASH_MIN_SIZE 64U
+
+/* Slots of an outgrown array moved to its successor per insert/removal */
+#define CHASH_MOVE_STEP 16U
+
+/*
+ * Slot contents besides entries: NULL ends a probe sequence, deleted slots
+ * are skipped and may be reused, moved slots are skipped and only found in
+ * an array that is being emptied into ->next.
+ */
+static const char chash_deleted_mark, chash_moved_mark;
+#define CHASH_DELETED ((void *)&chash_deleted_mark)
+#define CHASH_MOVED ((void *)&chash_moved_mark)
+
+struct chash_slot {
+	_Atomic uint32_t hashval;
+	void *_Atomic data;
+};
+
+struct chash_array {
+	struct rcu_head rcu_head;
+
+	/* array replacing this one; set once, kept until this is freed */
+	struct chash_array *_Atomic next;
+
+	uint32_t size;
+
+	/* slots that are no longer NULL; only used by writers */
+	uint32_t used;
+
+	struct chash_slot slots[];
+};
+
+static inline bool chash_is_entry(const void *data)
+{
+	return data && data != CHASH_DELETED && data != CHASH_MOVED;
+}
+
+static struct chash_array *chash_array_new(uint32_t size)
+{
+	struct chash_array *a;
+
+	a = XCALLOC(MTYPE_CHASH_ARRAY,
+		    sizeof(*a) + size * sizeof(struct chash_slot));
+	a->size = size;
+	return a;
+}
+
+struct chash *chash_create(unsigned int (*hash_key)(const void *),
+			   bool (*hash_cmp)(const void *, const void *),
+			   size_t refcnt_offset, const char *name)
+{
+	struct chash *h;
+
+	h = XCALLOC(MTYPE_CHASH, sizeof(*h));
+	h->hash_key = hash_key;
+	h->hash_cmp = hash_cmp;
+	h->refcnt_offset = refcnt_offset;
+	h->name = name ? XSTRDUP(MTYPE_CHASH, name) : NULL;
+	pthread_mutex_init(&h->mtx, NULL);
+	atomic_store_explicit(&h->arr, chash_array_new(CHASH_MIN_SIZE),
+			      memory_order_release);
+	return h;
+}
+
+void chash_free(struct chash *h, void (*free_func)(void *))
+{
+	struct chash_array *a, *next;
+	uint32_t i;
+	void *data;
+
+	a = atomic_load_explicit(&h->arr, memory_order_relaxed);
+	for (; a; a = next) {
+		next = atomic_load_explicit(&a->next, memory_order_relaxed);
+		for (i = 0; i < a->size; i++) {
+			data = atomic_load_explicit(&a->slots[i].data,
+						    memory_order_relaxed);
+			if (chash_is_entry(data) && free_func)
+				free_func(data);
+		}
+		XFREE(MTYPE_CHASH_ARRAY, a);
+	}
+
+	pthread_mutex_destroy(&h->mtx);
+	XFREE(MTYPE_CHASH, h->name);
+	XFREE(MTYPE_CHASH, h);
+}
+
+/* Lock-free probe of one array */
+static void *chash_array_find(struct chash *h, struct chash_array *a,
+			      uint32_t hashval, const void *key)
+{
+	uint32_t mask = a->size - 1;
+	uint32_t i = hashval & mask;
+	uint32_t n;
+	void *data;
+
+	for (n = 0; n < a->size; n++, i = (i + 1) & mask) {
+		data = atomic_load_explicit(&a->slots[i].data,
+					    memory_order_acquire);
+		if (!data)
+			break;
+		if (!chash_is_entry(data))
+			continue;
+		if (atomic_load_explicit(&a->slots[i].hashval,
+					 memory_order_relaxed)
+			    == hashval
+		    && h->hash_cmp(data, key))
+			return data;
+	}
+	return NULL;
+}
+
+/*
+ * An entry being moved is stored in ->next before it is marked moved here,
+ * so walking from the oldest array to the newest cannot miss it.
+ */
+static void *chash_find(struct chash *h, uint32_t hashval, const void *key)
+{
+	struct chash_array *a;
+	void *data;
+
+	a = atomic_load_explicit(&h->arr, memory_order_acquire);
+	for (; a; a = atomic_load_explicit(&a->next, memory_order_acquire)) {
+		data = chash_array_find(h, a, hashval, key);
+		if (data)
+			return data;
+	}
+	return NULL;
+}
+
+/* Mutex held: store an entry in the first free slot of its probe sequence */
+static void chash_array_insert(struct chash_array *a, uint32_t hashval,
+			       void *data)
+{
+	uint32_t mask = a->size - 1;
+	uint32_t i = hashval & mask;
+	void *cur;
+
+	for (;; i = (i + 1) & mask) {
+		cur = atomic_load_explicit(&a->slots[i].data,
+					   memory_order_relaxed);
+		if (!cur || cur == CHASH_DELETED)
+			break;
+	}
+
+	if (!cur)
+		a->used++;
+	atomic_store_explicit(&a->slots[i].hashval, hashval,
+			      memory_order_relaxed);
+	atomic_store_explicit(&a->slots[i].data, data, memory_order_release);
+}
+
+/*
+ * Mutex held: move up to 'step' slots of an outgrown array to its successor,
+ * and retire it once it is empty.
+ */
+static void chash_move(struct chash *h, uint32_t step)
+{
+	struct chash_array *a, *next;
+	struct chash_slot *slot;
+	void *data;
+
+	a = atomic_load_explicit(&h->arr, memory_order_relaxed);
+	next = atomic_load_explicit(&a->next, memory_order_relaxed);
+	if (!next)
+		return;
+
+	for (; step && h->move_pos < a->size; step--, h->move_pos++) {
+		slot = &a->slots[h->move_pos];
+		data = atomic_load_explicit(&slot->data, memory_order_relaxed);
+		if (!chash_is_entry(data))
+			continue;
+
+		chash_array_insert(next,
+				   atomic_load_explicit(&slot->hashval,
+							memory_order_relaxed),
+				   data);
+		atomic_store_explicit(&slot->data, CHASH_MOVED,
+				      memory_order_release);
+	}
+
+	if (h->move_pos < a->size)
+		return;
+
+	atomic_store_explicit(&h->arr, next, memory_order_release);
+	h->move_pos = 0;
+	rcu_free(MTYPE_CHASH_ARRAY, a, rcu_head);
+}
+
+/*
+ * Mutex held: start moving entries to a new array, sized for the current
+ * entries plus whatever can be inserted before the move completes.
+ */
+static void chash_grow(struct chash *h)
+{
+	struct chash_array *a;
+	uint32_t size = CHASH_MIN_SIZE;
+	uint32_t want;
+
+	/* one move at a time; this only happens under heavy churn */
+	a = atomic_load_explicit(&h->arr, memory_order_relaxed);
+	if (atomic_load_explicit(&a->next, memory_order_relaxed)) {
+		chash_move(h, UINT32_MAX);
+		a = atomic_load_explicit(&h->arr, memory_order_relaxed);
+	}
+
+	want = 2 * (chash_count(h) + 1) + a->size / 8;
+	while (size < want)
+		size <<= 1;
+
+	h->move_pos = 0;
+	atomic_store_explicit(&a->next, chash_array_new(size),
+			      memory_order_release);
+}
+
+/* Mutex held: add a new entry to the newest array */
+static void chash_insert(struct chash *h, uint32_t hashval, void *data)
+{
+	struct chash_array *a, *next;
+
+	a = atomic_load_explicit(&h->arr, memory_order_relaxed);
+	next = atomic_load_explicit(&a->next, memory_order_relaxed);
+	if (next)
+		a = next;
+
+	/* deleted slots count as used, so this also sheds tombstones */
+	if (a->used + 1 > a->size / 4 * 3) {
+		chash_grow(h);
+		a = atomic_load_explicit(&h->arr, memory_order_relaxed);
+		a = atomic_load_explicit(&a->next, memory_order_relaxed);
+	}
+
+	chash_array_insert(a, hashval, data);
+	atomic_fetch_add_explicit(&h->count, 1, memory_order_relaxed);
+	atomic_fetch_add_explicit(&h->inserted, 1, memory_order_relaxed);
+}
+
+/* Mutex held: take an entry out of whichever array holds it */
+static bool chash_remove(struct chash *h, uint32_t hashval, void *data)
+{
+	struct chash_array *a;
+	uint32_t mask, i, n;
+	void *cur;
+
+	a = atomic_load_explicit(&h->arr, memory_order_relaxed);
+	for (; a; a = atomic_load_explicit(&a->next, memory_order_relaxed)) {
+		mask = a->size - 1;
+		i = hashval & mask;
+		for (n = 0; n < a->size; n++, i = (i + 1) & mask) {
+			cur = atomic_load_explicit(&a->slots[i].data,
+						   memory_order_relaxed);
+			if (!cur)
+				break;
+			if (cur != data)
+				continue;
+
+			atomic_store_explicit(&a->slots[i].data,
+					      CHASH_DELETED,
+					      memory_order_release);
+			atomic_fetch_sub_explicit(&h->count, 1,
+						  memory_order_relaxed);
+			return true;
+		}
+	}
+	return false;
+}
+
+void *chash_intern(struct chash *h, void *data, void *(*alloc_func)(void *))
+{
+	uint32_t hashval = h->hash_key(data);
+	_Atomic unsigned long *refcnt;
+	unsigned long cnt;
+	void *find;
+
+	/* Fast path: the value is already interned and alive */
+	find = chash_find(h, hashval, data);
+	if (find) {
+		refcnt = chash_refcnt(h, find);
+		cnt = atomic_load_explicit(refcnt, memory_order_relaxed);
+
+		/* at zero, a release is waiting for the mutex to remove it;
+		 * only the locked path below may take it back
+		 */
+		while (cnt)
+			if (atomic_compare_exchange_weak_explicit(
+				    refcnt, &cnt, cnt + 1, memory_order_acquire,
+				    memory_order_relaxed))
+				return find;
+	}
+
+	pthread_mutex_lock(&h->mtx);
+
+	chash_move(h, CHASH_MOVE_STEP);
+
+	find = chash_find(h, hashval, data);
+	if (find)
+		atomic_fetch_add_explicit(chash_refcnt(h, find), 1,
+					  memory_order_relaxed);
+	else {
+		find = alloc_func(data);
+		atomic_store_explicit(chash_refcnt(h, find), 1,
+				      memory_order_relaxed);
+		chash_insert(h, hashval, find);
+	}
+
+	pthread_mutex_unlock(&h->mtx);
+
+	return find;
+}
+
+bool chash_release(struct chash *h, void *data)
+{
+	_Atomic unsigned long *refcnt = chash_refcnt(h, data);
+	unsigned long prev;
+	bool removed = false;
+
+	prev = atomic_fetch_sub_explicit(refcnt, 1, memory_order_acq_rel);
+	assert(prev > 0);
+	if (prev > 1)
+		return false;
+
+	pthread_mutex_lock(&h->mtx);
+
+	/* It may have been interned again since, and maybe released and
+	 * removed by someone else too; RCU keeps 'data' valid meanwhile.
+	 */
+	if (atomic_load_explicit(refcnt, memory_order_relaxed) == 0)
+		removed = chash_remove(h, h->hash_key(data), data);
+	if (removed)
+		chash_move(h, CHASH_MOVE_STEP);
+
+	pthread_mutex_unlock(&h->mtx);
+
+	return removed;
+}
+
+void *chash_lookup(struct chash *h, const void *data)
+{
+	return chash_find(h, h->hash_key(data), data);
+}
+
+void chash_iterate(struct chash *h, void (*func)(void *data, void *arg),
+		   void *arg)
+{
+	struct chash_array *a;
+	uint32_t i;
+	void *data;
+
+	pthread_mutex_lock(&h->mtx);
+
+	a = atomic_load_explicit(&h->arr, memory_order_relaxed);
+	for (; a; a = atomic_load_explicit(&a->next, memory_order_relaxed))
+		for (i = 0; i < a->size; i++) {
+			data = atomic_load_explicit(&a->slots[i].data,
+						    memory_order_relaxed);
+			if (chash_is_entry(data))
+				func(data, arg);
+		}
+
+	pthread_mutex_unlock(&h->mtx);
+}
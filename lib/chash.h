@@ -0,0 +1,139 @@
+/* Concurrent reference-counted intern hash table.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; see the file COPYING; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef _FRR_CHASH_H
+#define _FRR_CHASH_H
+
+#include <pthread.h>
+
+#include "frratomic.h"
+#include "frrcu.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * An intern table maps values to one shared, reference counted copy, like
+ * lib/hash.c tables used through hash_get() do, but may be used from any
+ * number of pthreads at once.
+ *
+ * - Lookups, and interning a value that is already in the table, take no
+ *   lock.  They rely on RCU, which FRR pthreads hold while running tasks.
+ * - Inserting and removing entries is serialized by a per-table mutex.
+ * - Entries live in an open addressing array.  When it fills up, a larger
+ *   one is allocated and entries are moved over a few slots per write,
+ *   instead of rehashing the whole table at once.
+ * - Entries carry an _Atomic unsigned long reference count, at the offset
+ *   given to chash_create().  An entry is removed when the last reference
+ *   is dropped with chash_release(); its memory must then be freed through
+ *   RCU (rcu_free()/rcu_call()) since lookups may still be looking at it.
+ *
+ * This is not built on the typesafe HASH from typesafe.h because readers
+ * there cannot run next to a writer: items chain through plain next
+ * pointers that deletion rewrites in place, and growing rehashes every
+ * item at once.  The lock-free containers in atomlist.h are sorted lists
+ * with linear lookups.  Neither fits an intern table hit for every
+ * received UPDATE.
+ */
+
+struct chash_array;
+
+struct chash {
+	/* oldest array still holding entries; ->next while growing */
+	struct chash_array *_Atomic arr;
+
+	/* serializes inserts, removals and growth */
+	pthread_mutex_t mtx;
+
+	/* next slot of arr to move into arr->next */
+	uint32_t move_pos;
+
+	_Atomic uint32_t count;
+
+	/* entries inserted since creation, i.e. chash_intern() misses */
+	_Atomic uint64_t inserted;
+
+	unsigned int (*hash_key)(const void *data);
+	bool (*hash_cmp)(const void *a, const void *b);
+	size_t refcnt_offset;
+
+	char *name;
+};
+
+#define chash_refcnt(h, data)                                                  \
+	((_Atomic unsigned long *)((char *)(data) + (h)->refcnt_offset))
+
+/*
+ * Create a table.  'refcnt_offset' is offsetof() the entries' reference
+ * count, e.g. offsetof(struct attr, refcnt).
+ */
+extern struct chash *chash_create(unsigned int (*hash_key)(const void *),
+				  bool (*hash_cmp)(const void *, const void *),
+				  size_t refcnt_offset, const char *name);
+
+/*
+ * Free the table.  Any entries left are freed with 'free_func' right away,
+ * so no other pthread may be using the table anymore.
+ */
+extern void chash_free(struct chash *h, void (*free_func)(void *));
+
+/*
+ * Return the entry equal to 'data', taking a reference on it; or, if there
+ * is none, insert alloc_func(data) with a reference count of 1.  alloc_func
+ * may return 'data' itself.  It is called with the table mutex held and
+ * must not use the table.
+ */
+extern void *chash_intern(struct chash *h, void *data,
+			  void *(*alloc_func)(void *));
+
+/*
+ * Drop a reference taken by chash_intern().  Returns true if that was the
+ * last one and the entry has been removed from the table; the caller then
+ * owns it and must free it through RCU.
+ */
+extern bool chash_release(struct chash *h, void *data);
+
+/*
+ * Find the entry equal to 'data' without taking a reference.  The result
+ * is only valid until the caller's RCU read section ends.
+ */
+extern void *chash_lookup(struct chash *h, const void *data);
+
+/*
+ * Call 'func' on every entry.  Inserts and removals on other pthreads wait
+ * until this returns; 'func' itself must not intern or release entries of
+ * this table.
+ */
+extern void chash_iterate(struct chash *h, void (*func)(void *data, void *arg),
+			  void *arg);
+
+static inline unsigned long chash_count(struct chash *h)
+{
+	return atomic_load_explicit(&h->count, memory_order_relaxed);
+}
+
+static inline uint64_t chash_inserted(struct chash *h)
+{
+	return atomic_load_explicit(&h->inserted, memory_order_relaxed);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _FRR_CHASH_H */
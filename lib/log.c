@@ -1093,6 +1093,8 @@ static const struct zebra_desc_table command_types[] = {
 	DESC_ENTRY(ZEBRA_VXLAN_SG_ADD),
 	DESC_ENTRY(ZEBRA_VXLAN_SG_DEL),
 	DESC_ENTRY(ZEBRA_VXLAN_SG_REPLAY),
+	DESC_ENTRY(ZEBRA_ROUTE_ADD_BULK),
+	DESC_ENTRY(ZEBRA_ROUTE_DELETE_BULK),
 };
 #undef DESC_ENTRY
 
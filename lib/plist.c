@@ -108,6 +108,9 @@ static struct prefix_master prefix_master_orf_v6 = {
 	{NULL, NULL}, {NULL, NULL}, 1, NULL, NULL, NULL, PLC_MAXLEVELV6,
 };
 
+/* Bumped on every change to any prefix-list, see prefix_list_generation() */
+static uint32_t prefix_list_gen;
+
 static struct prefix_master *prefix_master_get(afi_t afi, int orf)
 {
 	if (afi == AFI_IP)
@@ -117,6 +120,11 @@ static struct prefix_master *prefix_master_get(afi_t afi, int orf)
 	return NULL;
 }
 
+uint32_t prefix_list_generation(void)
+{
+	return prefix_list_gen;
+}
+
 const char *prefix_list_name(struct prefix_list *plist)
 {
 	return plist->name;
@@ -214,6 +222,7 @@ static struct prefix_list *prefix_list_insert(afi_t afi, int orf,
 	plist->master = master;
 	plist->trie =
 		XCALLOC(MTYPE_PREFIX_LIST_TRIE, sizeof(struct pltrie_table));
+	prefix_list_gen++;
 
 	/* If name is made by all digit character.  We treat it as
 	   number. */
@@ -301,6 +310,8 @@ static void prefix_list_delete(struct prefix_list *plist)
 	struct prefix_list_entry *pentry;
 	struct prefix_list_entry *next;
 
+	prefix_list_gen++;
+
 	/* If prefix-list contain prefix_list_entry free all of it. */
 	for (pentry = plist->head; pentry; pentry = next) {
 		next = pentry->next;
@@ -508,6 +519,7 @@ static void prefix_list_entry_delete(struct prefix_list *plist,
 	if (plist == NULL || pentry == NULL)
 		return;
 
+	prefix_list_gen++;
 	prefix_list_trie_del(plist, pentry);
 
 	if (pentry->prev)
@@ -631,6 +643,7 @@ static void prefix_list_entry_add(struct prefix_list *plist,
 
 	/* Increment count. */
 	plist->count++;
+	prefix_list_gen++;
 
 	/* Run hook function. */
 	if (plist->master->add_hook)
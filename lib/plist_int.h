@@ -72,6 +72,11 @@ struct prefix_list_entry {
 	struct prefix_list_entry *next_best;
 };
 
+/* Changes whenever a prefix-list or one of its entries is added or
+ * removed, so that users caching lookups or entries know to refresh them.
+ */
+extern uint32_t prefix_list_generation(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -31,6 +31,9 @@
 #include "hash.h"
 #include "libfrr.h"
 #include "lib_errors.h"
+#include "table.h"
+#include "plist.h"
+#include "plist_int.h"
 
 DEFINE_MTYPE_STATIC(LIB, ROUTE_MAP, "Route map")
 DEFINE_MTYPE(LIB, ROUTE_MAP_NAME, "Route map name")
@@ -40,6 +43,7 @@ DEFINE_MTYPE_STATIC(LIB, ROUTE_MAP_RULE_STR, "Route map rule str")
 DEFINE_MTYPE(LIB, ROUTE_MAP_COMPILED, "Route map compiled")
 DEFINE_MTYPE_STATIC(LIB, ROUTE_MAP_DEP, "Route map dependency")
 DEFINE_MTYPE_STATIC(LIB, ROUTE_MAP_DEP_DATA, "Route map dependency data")
+DEFINE_MTYPE_STATIC(LIB, ROUTE_MAP_PLAN, "Route map evaluation plan")
 
 DEFINE_QOBJ_TYPE(route_map_index)
 DEFINE_QOBJ_TYPE(route_map)
@@ -623,6 +627,11 @@ struct route_map_list {
 
 /* Master list of route map. */
 static struct route_map_list route_map_master = {NULL, NULL, NULL, NULL, NULL};
+
+/* Last version handed out to a route-map; never reused, so that a version
+ * also identifies the route-map it was given to.
+ */
+static uint32_t route_map_version_seq;
 struct hash *route_map_master_hash = NULL;
 
 static unsigned int route_map_hash_key_make(const void *p)
@@ -649,6 +658,67 @@ static bool route_map_hash_cmp(const void *p1, const void *p2)
 	return false;
 }
 
+/*
+ * Evaluation plan of a route-map.
+ *
+ * The match rules of each sequence are flattened into arrays, and the
+ * prefix-lists used by rules whose command sets match_plist_afi, e.g.
+ * "match ip address prefix-list", are looked up once.  Those rules are a
+ * plain prefix_list_apply() on the route's prefix, so a sequence using one
+ * can only match prefixes covered by a permit entry of the list.  The permit
+ * entries of all sequences go into a per address-family table, and a
+ * route only needs to be run through the sequences found on its path in
+ * that table, plus the ones that have no such rule.
+ *
+ * The plan is dropped whenever the route-map changes and rebuilt on its
+ * next use; a change to any prefix-list does the same.
+ */
+/* Larger route-maps are evaluated without the prefix index. */
+#define RMAP_PLAN_SEQ_MAX 4096
+#define RMAP_PLAN_WORDS(n) (((n) + 63) / 64)
+
+struct route_map_plan_match {
+	struct route_map_rule_cmd *cmd;
+	void *value;
+
+	/* Address family and list of a prefix-list rule. */
+	uint8_t family;
+	struct prefix_list *plist;
+};
+
+struct route_map_plan_seq {
+	struct route_map_index *index;
+
+	unsigned int nmatch;
+	struct route_map_plan_match *match;
+};
+
+/* Positions of the sequences using a prefix-list entry. */
+struct route_map_plan_node {
+	unsigned int count;
+	unsigned int pos[];
+};
+
+struct route_map_plan {
+	uint32_t plist_gen;
+
+	unsigned int nseq;
+	struct route_map_plan_seq *seq;
+
+	/* Prefix index for AF_INET and AF_INET6, words is 0 if not built */
+	unsigned int words;
+	struct route_table *pfx[2];
+	uint64_t *unfiltered[2];
+	unsigned int indexed[2];
+
+	/* Times each sequence was skipped by the prefix index, kept as
+	 * differences so a skipped run costs two updates: seq[i] was skipped
+	 * skipped[0] + ... + skipped[i] times.  Added to the sequences'
+	 * applied counters by route_map_plan_count().
+	 */
+	int64_t *skipped;
+};
+
 enum route_map_upd8_type {
 	ROUTE_MAP_ADD = 1,
 	ROUTE_MAP_DEL,
@@ -693,6 +763,241 @@ static bool rmap_debug;
 
 static void route_map_index_delete(struct route_map_index *, int);
 
+static int route_map_plan_afidx(uint8_t family)
+{
+	switch (family) {
+	case AF_INET:
+		return 0;
+	case AF_INET6:
+		return 1;
+	}
+	return -1;
+}
+
+/* Count the sequences skipped by the prefix index as applied. */
+static void route_map_plan_count(struct route_map_plan *plan)
+{
+	int64_t skipped = 0;
+	unsigned int i;
+
+	if (!plan || !plan->skipped)
+		return;
+
+	for (i = 0; i < plan->nseq; i++) {
+		skipped += plan->skipped[i];
+		plan->seq[i].index->applied += skipped;
+	}
+	memset(plan->skipped, 0, (plan->nseq + 1) * sizeof(plan->skipped[0]));
+}
+
+static void route_map_plan_free(struct route_map *map)
+{
+	struct route_map_plan *plan = map->plan;
+	struct route_node *rn;
+	unsigned int i;
+
+	if (!plan)
+		return;
+
+	route_map_plan_count(plan);
+	XFREE(MTYPE_ROUTE_MAP_PLAN, plan->skipped);
+
+	for (i = 0; i < plan->nseq; i++)
+		XFREE(MTYPE_ROUTE_MAP_PLAN, plan->seq[i].match);
+	XFREE(MTYPE_ROUTE_MAP_PLAN, plan->seq);
+
+	for (i = 0; i < array_size(plan->pfx); i++) {
+		if (!plan->pfx[i])
+			continue;
+		for (rn = route_top(plan->pfx[i]); rn; rn = route_next(rn))
+			XFREE(MTYPE_ROUTE_MAP_PLAN, rn->info);
+		route_table_finish(plan->pfx[i]);
+		XFREE(MTYPE_ROUTE_MAP_PLAN, plan->unfiltered[i]);
+	}
+
+	XFREE(MTYPE_ROUTE_MAP_PLAN, map->plan);
+}
+
+/* Drop what was derived from the route-map and give it a new version. */
+static void route_map_changed(struct route_map *map)
+{
+	route_map_plan_free(map);
+	map->version = ++route_map_version_seq;
+}
+
+/* Add the permit entries of a sequence's prefix-list to the index. */
+static void route_map_plan_index(struct route_map_plan *plan, int afidx,
+				 unsigned int pos, struct prefix_list *plist)
+{
+	struct prefix_list_entry *pentry;
+	struct route_map_plan_node *pn;
+	struct route_node *rn;
+
+	/* A missing list never matches. */
+	if (!plist)
+		return;
+
+	/* An empty one matches everything. */
+	if (!plist->count) {
+		plan->unfiltered[afidx][pos / 64] |= 1ULL << (pos % 64);
+		return;
+	}
+
+	plan->indexed[afidx]++;
+	for (pentry = plist->head; pentry; pentry = pentry->next) {
+		if (pentry->type != PREFIX_PERMIT)
+			continue;
+
+		rn = route_node_get(plan->pfx[afidx], &pentry->prefix);
+		pn = rn->info;
+		if (pn) {
+			route_unlock_node(rn);
+			if (pn->pos[pn->count - 1] == pos)
+				continue;
+		}
+
+		pn = XREALLOC(MTYPE_ROUTE_MAP_PLAN, pn,
+			      sizeof(*pn)
+				      + (pn ? pn->count + 1 : 1)
+						* sizeof(pn->pos[0]));
+		if (!rn->info)
+			pn->count = 0;
+		pn->pos[pn->count++] = pos;
+		rn->info = pn;
+	}
+}
+
+static struct route_map_plan *route_map_plan_build(struct route_map *map)
+{
+	struct route_map_plan *plan;
+	struct route_map_plan_seq *seq;
+	struct route_map_plan_match *match;
+	struct route_map_plan_match *filter[2];
+	struct route_map_index *index;
+	struct route_map_rule *rule;
+	unsigned int i, j;
+	afi_t afi;
+	int f;
+
+	plan = XCALLOC(MTYPE_ROUTE_MAP_PLAN, sizeof(*plan));
+	plan->plist_gen = prefix_list_generation();
+
+	for (index = map->head; index; index = index->next)
+		plan->nseq++;
+	plan->seq = XCALLOC(MTYPE_ROUTE_MAP_PLAN,
+			    plan->nseq * sizeof(plan->seq[0]));
+
+	if (plan->nseq <= RMAP_PLAN_SEQ_MAX) {
+		plan->words = RMAP_PLAN_WORDS(plan->nseq);
+		plan->skipped = XCALLOC(MTYPE_ROUTE_MAP_PLAN,
+					(plan->nseq + 1)
+						* sizeof(plan->skipped[0]));
+		for (f = 0; f < 2; f++) {
+			plan->pfx[f] = route_table_init();
+			plan->unfiltered[f] =
+				XCALLOC(MTYPE_ROUTE_MAP_PLAN,
+					plan->words * sizeof(uint64_t));
+		}
+	}
+
+	for (i = 0, index = map->head; index; i++, index = index->next) {
+		seq = &plan->seq[i];
+		seq->index = index;
+
+		for (rule = index->match_list.head; rule; rule = rule->next)
+			seq->nmatch++;
+		seq->match = XCALLOC(MTYPE_ROUTE_MAP_PLAN,
+				     seq->nmatch * sizeof(seq->match[0]));
+
+		filter[0] = filter[1] = NULL;
+		for (j = 0, rule = index->match_list.head; rule;
+		     j++, rule = rule->next) {
+			match = &seq->match[j];
+			match->cmd = rule->cmd;
+			match->value = rule->value;
+
+			afi = rule->cmd->match_plist_afi;
+			if (afi != AFI_IP && afi != AFI_IP6)
+				continue;
+
+			match->family = afi2family(afi);
+			match->plist = prefix_list_lookup(afi, rule->rule_str);
+			f = route_map_plan_afidx(match->family);
+			if (!filter[f])
+				filter[f] = match;
+		}
+
+		if (!plan->words)
+			continue;
+
+		for (f = 0; f < 2; f++) {
+			if (filter[f])
+				route_map_plan_index(plan, f, i,
+						     filter[f]->plist);
+			else
+				plan->unfiltered[f][i / 64] |= 1ULL
+							       << (i % 64);
+		}
+	}
+
+	if (rmap_debug)
+		zlog_debug("Route-map %s compiled: %u sequences, %u/%u indexed by IPv4/IPv6 prefix",
+			   map->name, plan->nseq, plan->indexed[0],
+			   plan->indexed[1]);
+
+	return plan;
+}
+
+/* Fill in the sequences a prefix can possibly match, false if all can. */
+static bool route_map_plan_candidates(struct route_map_plan *plan,
+				      const struct prefix *prefix,
+				      uint64_t *cand)
+{
+	struct route_map_plan_node *pn;
+	struct route_node *match, *rn;
+	unsigned int i;
+	int f;
+
+	f = route_map_plan_afidx(prefix->family);
+	if (f < 0 || !plan->words || !plan->indexed[f])
+		return false;
+
+	memcpy(cand, plan->unfiltered[f], plan->words * sizeof(uint64_t));
+
+	match = route_node_match(plan->pfx[f], prefix);
+	if (!match)
+		return true;
+
+	for (rn = match; rn; rn = rn->parent) {
+		pn = rn->info;
+		if (!pn)
+			continue;
+		for (i = 0; i < pn->count; i++)
+			cand[pn->pos[i] / 64] |= 1ULL << (pn->pos[i] % 64);
+	}
+	route_unlock_node(match);
+	return true;
+}
+
+/* First candidate sequence at or after pos, nseq if there is none. */
+static unsigned int route_map_plan_next(const struct route_map_plan *plan,
+					const uint64_t *cand, unsigned int pos)
+{
+	unsigned int w = pos / 64;
+	uint64_t bits;
+
+	if (pos >= plan->nseq)
+		return plan->nseq;
+
+	bits = cand[w] & (~0ULL << (pos % 64));
+	while (!bits) {
+		if (++w >= plan->words)
+			return plan->nseq;
+		bits = cand[w];
+	}
+	return w * 64 + __builtin_ctzll(bits);
+}
+
 /* New route map allocation. Please note route map's name must be
    specified. */
 static struct route_map *route_map_new(const char *name)
@@ -701,6 +1006,7 @@ static struct route_map *route_map_new(const char *name)
 
 	new = XCALLOC(MTYPE_ROUTE_MAP, sizeof(struct route_map));
 	new->name = XSTRDUP(MTYPE_ROUTE_MAP_NAME, name);
+	new->version = ++route_map_version_seq;
 	QOBJ_REG(new, route_map);
 	return new;
 }
@@ -764,6 +1070,8 @@ static void route_map_free_map(struct route_map *map)
 	if (rmap_debug)
 		zlog_debug("Deleting route-map %s", map->name);
 
+	route_map_plan_free(map);
+
 	list = &route_map_master;
 
 	QOBJ_UNREG(map);
@@ -862,6 +1170,7 @@ int route_map_mark_updated(const char *name)
 
 	if (map) {
 		map->to_be_processed = true;
+		map->version = ++route_map_version_seq;
 		ret = 0;
 	}
 
@@ -971,9 +1280,21 @@ static void vty_show_route_map_entry(struct vty *vty, struct route_map *map)
 {
 	struct route_map_index *index;
 	struct route_map_rule *rule;
+	uint64_t applied = map->applied - map->applied_clear;
+	uint64_t nsec = map->eval_nsec - map->eval_nsec_clear;
+
+	route_map_plan_count(map->plan);
 
 	vty_out(vty, "route-map: %s Invoked: %" PRIu64 "\n",
-		map->name, map->applied - map->applied_clear);
+		map->name, applied);
+	vty_out(vty, " Processing time: %" PRIu64 " usecs, %" PRIu64
+		" nsecs per invocation\n",
+		nsec / 1000, applied ? nsec / applied : 0);
+	if (map->plan && map->plan->words)
+		vty_out(vty,
+			" Prefix index: %u IPv4, %u IPv6 of %u sequences\n",
+			map->plan->indexed[0], map->plan->indexed[1],
+			map->plan->nseq);
 
 	for (index = map->head; index; index = index->next) {
 		vty_out(vty, " %s, sequence %d Invoked %" PRIu64 "\n",
@@ -1107,6 +1428,8 @@ static void route_map_index_delete(struct route_map_index *index, int notify)
 		zlog_debug("Deleting route-map %s sequence %d",
 			   index->map->name, index->pref);
 
+	route_map_changed(index->map);
+
 	/* Free route match. */
 	while ((rule = index->match_list.head) != NULL)
 		route_map_rule_delete(&index->match_list, rule);
@@ -1165,6 +1488,8 @@ route_map_index_add(struct route_map *map, enum route_map_type type, int pref)
 	index->type = type;
 	index->pref = pref;
 
+	route_map_changed(map);
+
 	/* Compare preference. */
 	for (point = map->head; point; point = point->next)
 		if (point->pref >= pref)
@@ -1451,6 +1776,8 @@ enum rmap_compile_rets route_map_add_match(struct route_map_index *index,
 		}
 	}
 
+	route_map_changed(index->map);
+
 	/* Add new route map match rule. */
 	rule = route_map_rule_new();
 	rule->cmd = cmd;
@@ -1509,6 +1836,7 @@ enum rmap_compile_rets route_map_delete_match(struct route_map_index *index,
 				route_map_upd8_dependency(type, rule_key,
 						index->map->name);
 
+			route_map_changed(index->map);
 			route_map_rule_delete(&index->match_list, rule);
 			return RMAP_COMPILE_SUCCESS;
 		}
@@ -1547,6 +1875,8 @@ enum rmap_compile_rets route_map_add_set(struct route_map_index *index,
 			route_map_rule_delete(&index->set_list, rule);
 	}
 
+	route_map_changed(index->map);
+
 	/* Add new route map match rule. */
 	rule = route_map_rule_new();
 	rule->cmd = cmd;
@@ -1583,6 +1913,7 @@ enum rmap_compile_rets route_map_delete_set(struct route_map_index *index,
 	for (rule = index->set_list.head; rule; rule = rule->next)
 		if ((rule->cmd == cmd) && (rulecmp(rule->rule_str, set_arg) == 0
 					   || set_arg == NULL)) {
+			route_map_changed(index->map);
 			route_map_rule_delete(&index->set_list, rule);
 			/* Execute event hook. */
 			if (route_map_master.event_hook) {
@@ -1598,21 +1929,23 @@ enum rmap_compile_rets route_map_delete_set(struct route_map_index *index,
 }
 
 static enum route_map_cmd_result_t
-route_map_apply_match(struct route_map_rule_list *match_list,
+route_map_apply_match(struct route_map_plan_seq *seq,
 		      const struct prefix *prefix, route_map_object_t type,
 		      void *object)
 {
 	enum route_map_cmd_result_t ret = RMAP_NOMATCH;
-	struct route_map_rule *match;
+	struct route_map_plan_match *match;
+	unsigned int i;
 	bool is_matched = false;
 
 
 	/* Check all match rule and if there is no match rule, go to the
 	   set statement. */
-	if (!match_list->head)
+	if (!seq->nmatch)
 		ret = RMAP_MATCH;
 	else {
-		for (match = match_list->head; match; match = match->next) {
+		for (i = 0; i < seq->nmatch; i++) {
+			match = &seq->match[i];
 			/*
 			 * Try each match statement. If any match does not
 			 * return RMAP_MATCH or RMAP_NOOP, return.
@@ -1623,8 +1956,14 @@ route_map_apply_match(struct route_map_rule_list *match_list,
 			 * MATCH/NOOP, then also end-result is a match)
 			 * If all result in NOOP, end-result is NOOP.
 			 */
-			ret = (*match->cmd->func_apply)(match->value, prefix,
-							type, object);
+			if (match->plist && match->family == prefix->family)
+				ret = prefix_list_apply(match->plist, prefix)
+						== PREFIX_DENY
+					? RMAP_NOMATCH
+					: RMAP_MATCH;
+			else
+				ret = (*match->cmd->func_apply)(
+					match->value, prefix, type, object);
 
 			/*
 			 * If the consolidated result of func_apply is:
@@ -1675,6 +2014,14 @@ route_map_apply_match(struct route_map_rule_list *match_list,
 	return ret;
 }
 
+static uint64_t route_map_time_nsec(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
 /* Apply route map's each index to the object.
 
    The matrix for a route-map looks like this:
@@ -1728,8 +2075,13 @@ route_map_result_t route_map_apply(struct route_map *map,
 	static int recursion = 0;
 	enum route_map_cmd_result_t match_ret = RMAP_NOMATCH;
 	route_map_result_t ret = RMAP_PERMITMATCH;
+	struct route_map_plan *plan;
 	struct route_map_index *index;
 	struct route_map_rule *set;
+	uint64_t cand[RMAP_PLAN_WORDS(RMAP_PLAN_SEQ_MAX)];
+	bool indexed;
+	unsigned int i, next;
+	uint64_t start = 0;
 	char buf[PREFIX_STRLEN];
 
 	if (recursion > RMAP_RECURSION_LIMIT) {
@@ -1746,12 +2098,44 @@ route_map_result_t route_map_apply(struct route_map *map,
 		goto route_map_apply_end;
 	}
 
+	start = route_map_time_nsec();
 	map->applied++;
-	for (index = map->head; index; index = index->next) {
+
+	if (!map->plan || map->plan->plist_gen != prefix_list_generation()) {
+		route_map_plan_free(map);
+		map->plan = route_map_plan_build(map);
+	}
+	plan = map->plan;
+	indexed = route_map_plan_candidates(plan, prefix, cand);
+
+	for (i = 0; i < plan->nseq; i++) {
+		/*
+		 * Sequences the prefix index rules out would all have been
+		 * 'no match', so skip them with the same result.
+		 */
+		if (indexed) {
+			next = route_map_plan_next(plan, cand, i);
+			if (next != i) {
+				if (rmap_debug)
+					zlog_debug("Route-map: %s, prefix: %s, %u sequences skipped by prefix index",
+						   map->name,
+						   prefix2str(prefix, buf,
+							      sizeof(buf)),
+						   next - i);
+				ret = RMAP_DENYMATCH;
+				plan->skipped[i]++;
+				plan->skipped[next]--;
+				i = next;
+				if (i == plan->nseq)
+					break;
+			}
+		}
+
 		/* Apply this index. */
+		index = plan->seq[i].index;
 		index->applied++;
-		match_ret = route_map_apply_match(&index->match_list, prefix,
-						  type, object);
+		match_ret = route_map_apply_match(&plan->seq[i], prefix, type,
+						  object);
 
 		if (rmap_debug) {
 			zlog_debug("Route-map: %s, sequence: %d, prefix: %s, result: %s",
@@ -1839,15 +2223,13 @@ route_map_result_t route_map_apply(struct route_map *map,
 					continue;
 				case RMAP_GOTO: {
 					/* Find the next clause to jump to */
-					struct route_map_index *next =
-						index->next;
 					int nextpref = index->nextpref;
 
-					while (next && next->pref < nextpref) {
-						index = next;
-						next = next->next;
-					}
-					if (next == NULL) {
+					while (i + 1 < plan->nseq
+					       && plan->seq[i + 1].index->pref
+							  < nextpref)
+						i++;
+					if (i + 1 == plan->nseq) {
 						/* No clauses match! */
 						goto route_map_apply_end;
 					}
@@ -1863,6 +2245,9 @@ route_map_result_t route_map_apply(struct route_map *map,
 	}
 
 route_map_apply_end:
+	if (start)
+		map->eval_nsec += route_map_time_nsec() - start;
+
 	if (rmap_debug) {
 		zlog_debug("Route-map: %s, prefix: %s, result: %s",
 			   (map ? map->name : "null"),
@@ -1873,6 +2258,25 @@ route_map_apply_end:
 	return (ret);
 }
 
+bool route_map_rules_all(struct route_map *map,
+			 bool (*func)(const struct route_map_rule_cmd *cmd,
+				      void *value, bool set, void *arg),
+			 void *arg)
+{
+	struct route_map_index *index;
+	struct route_map_rule *rule;
+
+	for (index = map->head; index; index = index->next) {
+		for (rule = index->match_list.head; rule; rule = rule->next)
+			if (!func(rule->cmd, rule->value, false, arg))
+				return false;
+		for (rule = index->set_list.head; rule; rule = rule->next)
+			if (!func(rule->cmd, rule->value, true, arg))
+				return false;
+	}
+	return true;
+}
+
 void route_map_add_hook(void (*func)(const char *))
 {
 	route_map_master.add_hook = func;
@@ -2978,6 +3382,7 @@ DEFUN (rmap_onmatch_next,
 			return CMD_WARNING_CONFIG_FAILED;
 		}
 		index->exitpolicy = RMAP_NEXT;
+		route_map_changed(index->map);
 	}
 	return CMD_SUCCESS;
 }
@@ -2991,8 +3396,10 @@ DEFUN (no_rmap_onmatch_next,
 {
 	struct route_map_index *index = VTY_GET_CONTEXT(route_map_index);
 
-	if (index)
+	if (index) {
 		index->exitpolicy = RMAP_EXIT;
+		route_map_changed(index->map);
+	}
 
 	return CMD_SUCCESS;
 }
@@ -3032,6 +3439,7 @@ DEFUN (rmap_onmatch_goto,
 		} else {
 			index->exitpolicy = RMAP_GOTO;
 			index->nextpref = d;
+			route_map_changed(index->map);
 		}
 	}
 	return CMD_SUCCESS;
@@ -3046,8 +3454,10 @@ DEFUN (no_rmap_onmatch_goto,
 {
 	struct route_map_index *index = VTY_GET_CONTEXT(route_map_index);
 
-	if (index)
+	if (index) {
 		index->exitpolicy = RMAP_EXIT;
+		route_map_changed(index->map);
+	}
 
 	return CMD_SUCCESS;
 }
@@ -3079,6 +3489,8 @@ static void clear_route_map_helper(struct route_map *map)
 	struct route_map_index *index;
 
 	map->applied_clear = map->applied;
+	map->eval_nsec_clear = map->eval_nsec;
+	route_map_plan_count(map->plan);
 	for (index = map->head; index; index = index->next)
 		index->applied_clear = index->applied;
 }
@@ -3161,6 +3573,7 @@ DEFUN (rmap_call,
 		XFREE(MTYPE_ROUTE_MAP_NAME, index->nextrm);
 	}
 	index->nextrm = XSTRDUP(MTYPE_ROUTE_MAP_NAME, rmap);
+	route_map_changed(index->map);
 
 	/* Execute event hook. */
 	route_map_upd8_dependency(RMAP_EVENT_CALL_ADDED, index->nextrm,
@@ -3181,6 +3594,7 @@ DEFUN (no_rmap_call,
 					  index->nextrm, index->map->name);
 		XFREE(MTYPE_ROUTE_MAP_NAME, index->nextrm);
 		index->nextrm = NULL;
+		route_map_changed(index->map);
 	}
 
 	return CMD_SUCCESS;
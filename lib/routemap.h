@@ -126,6 +126,13 @@ struct route_map_rule_cmd {
 
 	/** To get the rule key after Compilation **/
 	void *(*func_get_rmap_rule_key)(void *val);
+
+	/* Set by match rules that do nothing but look up the prefix-list
+	 * named by the rule, of this AFI, and apply it to the route's
+	 * prefix; a missing list never matches.  The route-map code may then
+	 * apply the list itself, and index the route-map by its entries.
+	 */
+	afi_t match_plist_afi;
 };
 
 /* Route map apply error. */
@@ -182,6 +189,8 @@ struct route_map_index {
 };
 DECLARE_QOBJ_TYPE(route_map_index)
 
+struct route_map_plan;
+
 /* Route map list structure. */
 struct route_map {
 	/* Name of route map. */
@@ -203,6 +212,18 @@ struct route_map {
 	uint64_t applied;
 	uint64_t applied_clear;
 
+	/* Time spent applying this route-map, in nanoseconds */
+	uint64_t eval_nsec;
+	uint64_t eval_nsec_clear;
+
+	/* Evaluation plan, built on first use after a change */
+	struct route_map_plan *plan;
+
+	/* Changes with every update to this route-map or what it depends
+	 * on, see route_map_mark_updated()
+	 */
+	uint32_t version;
+
 	/* Counter to track active usage of this route-map */
 	uint16_t use_count;
 
@@ -271,6 +292,17 @@ extern route_map_result_t route_map_apply(struct route_map *map,
 					  route_map_object_t object_type,
 					  void *object);
 
+/*
+ * Call func on each match and set rule of map, until it returns false.
+ * Returns false if func did.  Route-maps reached through "call" are not
+ * visited.
+ */
+extern bool
+route_map_rules_all(struct route_map *map,
+		    bool (*func)(const struct route_map_rule_cmd *cmd,
+				 void *value, bool set, void *arg),
+		    void *arg);
+
 extern void route_map_add_hook(void (*func)(const char *));
 extern void route_map_delete_hook(void (*func)(const char *));
 
@@ -30,6 +30,7 @@
 
 DEFINE_MTYPE_STATIC(LIB, ROUTE_TABLE, "Route table")
 DEFINE_MTYPE(LIB, ROUTE_NODE, "Route node")
+DEFINE_MTYPE_STATIC(LIB, ROUTE_TABLE_INDEX, "Route table index")
 
 static void route_table_free(struct route_table *);
 
@@ -41,6 +42,213 @@ static int route_table_hash_cmp(const struct route_node *a,
 
 DECLARE_HASH(rn_hash_node, struct route_node, nodehash, route_table_hash_cmp,
 	     prefix_hash_key)
+
+/*
+ * Multibit index.
+ *
+ * The binary tree below is deep for full Internet tables, and every lookup
+ * starting at the root chases the same dozen or more pointers at the top
+ * before it gets anywhere.  Once an IPv4 or IPv6 table has grown past
+ * ROUTE_INDEX_MIN nodes it gets an 8+8 bit stride index: for each 16-bit
+ * slot of the address space it holds the deepest node of at most /16
+ * that covers the slot.  Every node on the way from the root to that node
+ * covers the slot too, so match/get/get_next for prefixes of /16 or longer
+ * can start their descent right there.  Second level blocks are only
+ * allocated under top level slots which have nodes between /9 and /16.
+ *
+ * The index holds node pointers only, nodes stay where they are, so
+ * handles and the walk functions are not affected.  A table holding more
+ * than one address family drops its index for good.
+ */
+#define ROUTE_INDEX_BITS 16
+#define ROUTE_INDEX_MIN 1024
+
+struct route_index_slot {
+	struct route_node *node;
+	struct route_node **sub;
+};
+
+struct route_table_index {
+	uint8_t family;
+	unsigned int blocks;
+	struct route_index_slot slots[256];
+};
+
+static inline unsigned int route_index_key(const struct prefix *p)
+{
+	const uint8_t *b = &p->u.prefix;
+
+	return (b[0] << 8) | b[1];
+}
+
+static inline void route_index_set(struct route_node **entry,
+				   struct route_node *node, bool del,
+				   struct route_node *parent)
+{
+	if (del) {
+		if (*entry == node)
+			*entry = parent;
+	} else if (!*entry || (*entry)->p.prefixlen < node->p.prefixlen)
+		*entry = node;
+}
+
+/*
+ * Point the entries covered by node (a /16 or shorter) at it, or when
+ * deleting, hand the ones pointing at it back to its parent.
+ */
+static void route_index_update(struct route_table_index *idx,
+			       struct route_node *node, bool del,
+			       struct route_node *parent)
+{
+	struct route_index_slot *slot;
+	unsigned int key, len = node->p.prefixlen;
+	unsigned int t, s, n;
+
+	key = route_index_key(&node->p);
+	key &= len ? (0xffffU << (ROUTE_INDEX_BITS - len)) & 0xffffU : 0;
+
+	if (len <= 8) {
+		n = 1U << (8 - len);
+		for (t = key >> 8; t < (key >> 8) + n; t++) {
+			slot = &idx->slots[t];
+			route_index_set(&slot->node, node, del, parent);
+			if (!slot->sub)
+				continue;
+			for (s = 0; s < 256; s++)
+				route_index_set(&slot->sub[s], node, del,
+						parent);
+		}
+		return;
+	}
+
+	slot = &idx->slots[key >> 8];
+	if (!slot->sub) {
+		if (del)
+			return;
+		slot->sub = XMALLOC(MTYPE_ROUTE_TABLE_INDEX,
+				    256 * sizeof(*slot->sub));
+		for (s = 0; s < 256; s++)
+			slot->sub[s] = slot->node;
+		idx->blocks++;
+	}
+
+	n = 1U << (ROUTE_INDEX_BITS - len);
+	for (s = key & 0xff; s < (key & 0xff) + n; s++)
+		route_index_set(&slot->sub[s], node, del, parent);
+}
+
+static void route_index_free(struct route_table *table)
+{
+	struct route_table_index *idx = table->index;
+	unsigned int t;
+
+	if (!idx)
+		return;
+
+	for (t = 0; t < array_size(idx->slots); t++)
+		XFREE(MTYPE_ROUTE_TABLE_INDEX, idx->slots[t].sub);
+	XFREE(MTYPE_ROUTE_TABLE_INDEX, table->index);
+}
+
+static void route_index_build(struct route_table *table)
+{
+	struct route_table_index *idx;
+	struct route_node *node = table->top;
+
+	if (!node || (node->p.family != AF_INET && node->p.family != AF_INET6))
+		return;
+
+	idx = XCALLOC(MTYPE_ROUTE_TABLE_INDEX, sizeof(*idx));
+	idx->family = node->p.family;
+	table->index = idx;
+
+	/* preorder walk, nothing deeper than /16 needs to be looked at */
+	while (node) {
+		if (node->p.family != idx->family) {
+			route_index_free(table);
+			table->noindex = true;
+			return;
+		}
+		if (node->p.prefixlen <= ROUTE_INDEX_BITS) {
+			route_index_update(idx, node, false, NULL);
+			if (node->l_left) {
+				node = node->l_left;
+				continue;
+			}
+			if (node->l_right) {
+				node = node->l_right;
+				continue;
+			}
+		}
+		while (node->parent) {
+			if (node->parent->l_left == node
+			    && node->parent->l_right) {
+				node = node->parent->l_right;
+				break;
+			}
+			node = node->parent;
+		}
+		if (!node->parent)
+			break;
+	}
+}
+
+/* A node was linked into the tree. */
+static void route_index_add(struct route_table *table, struct route_node *node)
+{
+	if (!table->index) {
+		if (!table->noindex && table->count >= ROUTE_INDEX_MIN)
+			route_index_build(table);
+		return;
+	}
+
+	if (node->p.family != table->index->family) {
+		route_index_free(table);
+		table->noindex = true;
+		return;
+	}
+
+	if (node->p.prefixlen <= ROUTE_INDEX_BITS)
+		route_index_update(table->index, node, false, NULL);
+}
+
+/* A node is being unlinked, parent is what its index entries fall back to */
+static void route_index_del(struct route_table *table, struct route_node *node,
+			    struct route_node *parent)
+{
+	if (!table->index || node->p.prefixlen > ROUTE_INDEX_BITS)
+		return;
+
+	route_index_update(table->index, node, true, parent);
+}
+
+/* Where to start descending for p, a node that covers p or the root. */
+static inline struct route_node *route_index_start(struct route_table *table,
+						   const struct prefix *p)
+{
+	struct route_table_index *idx = table->index;
+	struct route_index_slot *slot;
+	struct route_node *node;
+	unsigned int key;
+
+	if (!idx || p->family != idx->family
+	    || p->prefixlen < ROUTE_INDEX_BITS)
+		return table->top;
+
+	key = route_index_key(p);
+	slot = &idx->slots[key >> 8];
+	node = slot->sub ? slot->sub[key & 0xff] : slot->node;
+	return node ? node : table->top;
+}
+
+void route_table_set_index(struct route_table *table, bool enable)
+{
+	table->noindex = !enable;
+	if (!enable)
+		route_index_free(table);
+	else if (!table->index)
+		route_index_build(table);
+}
 /*
  * route_table_init_with_delegate
  */
@@ -135,6 +343,7 @@ static void route_table_free(struct route_table *rt)
 
 	assert(rt->count == 0);
 
+	route_index_free(rt);
 	rn_hash_node_fini(&rt->hash);
 	XFREE(MTYPE_ROUTE_TABLE, rt);
 	return;
@@ -195,11 +404,11 @@ struct route_node *route_node_match(struct route_table *table,
 				    union prefixconstptr pu)
 {
 	const struct prefix *p = pu.p;
-	struct route_node *node;
+	struct route_node *node, *start;
 	struct route_node *matched;
 
 	matched = NULL;
-	node = table->top;
+	start = node = route_index_start(table, p);
 
 	/* Walk down tree.  If there is matched route then store it to
 	   matched. */
@@ -214,6 +423,13 @@ struct route_node *route_node_match(struct route_table *table,
 		node = node->link[prefix_bit(&p->u.prefix, node->p.prefixlen)];
 	}
 
+	/* Started below the root, the nodes above cover p as well. */
+	if (!matched && start && start != table->top)
+		for (node = start->parent; node && !matched;
+		     node = node->parent)
+			if (node->info)
+				matched = node;
+
 	/* If matched route found, return it. */
 	if (matched)
 		return route_lock_node(matched);
@@ -284,6 +500,7 @@ struct route_node *route_node_get(struct route_table *table,
 	struct route_node *new;
 	struct route_node *node;
 	struct route_node *match;
+	struct route_node *glue = NULL;
 	uint16_t prefixlen = p->prefixlen;
 	const uint8_t *prefix = &p->u.prefix;
 
@@ -292,7 +509,7 @@ struct route_node *route_node_get(struct route_table *table,
 		return route_lock_node(node);
 
 	match = NULL;
-	node = table->top;
+	node = route_index_start(table, p);
 	while (node && node->p.prefixlen <= prefixlen
 	       && prefix_match(&node->p, p)) {
 		if (node->p.prefixlen == prefixlen)
@@ -322,7 +539,7 @@ struct route_node *route_node_get(struct route_table *table,
 			table->top = new;
 
 		if (new->p.prefixlen != p->prefixlen) {
-			match = new;
+			glue = match = new;
 			new = route_node_set(table, p);
 			set_link(match, new);
 			table->count++;
@@ -331,6 +548,10 @@ struct route_node *route_node_get(struct route_table *table,
 	table->count++;
 	route_lock_node(new);
 
+	if (glue)
+		route_index_add(table, glue);
+	route_index_add(table, new);
+
 	return new;
 }
 
@@ -366,6 +587,7 @@ void route_node_delete(struct route_node *node)
 
 	node->table->count--;
 
+	route_index_del(node->table, node, parent);
 	rn_hash_node_del(&node->table->hash, node);
 
 	/* WARNING: FRAGILE CODE!
@@ -612,7 +834,7 @@ route_table_get_next_internal(struct route_table *table,
 	struct route_node *node, *tmp_node;
 	int cmp;
 
-	node = table->top;
+	node = route_index_start(table, p);
 
 	while (node) {
 		int match;
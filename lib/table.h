@@ -61,11 +61,17 @@ struct route_table_delegate_t_ {
 
 PREDECL_HASH(rn_hash_node)
 
+struct route_table_index;
+
 /* Routing table top structure. */
 struct route_table {
 	struct route_node *top;
 	struct rn_hash_node_head hash;
 
+	/* multibit index over the top of the tree, see lib/table.c */
+	struct route_table_index *index;
+	bool noindex;
+
 	/*
 	 * Delegate that performs certain functions for this table.
 	 */
@@ -220,6 +226,7 @@ ext_pure struct route_node *route_node_match_ipv6(struct route_table *table,
 						  const struct in6_addr *addr);
 
 ext_pure unsigned long route_table_count(struct route_table *table);
+extern void route_table_set_index(struct route_table *table, bool enable);
 
 extern struct route_node *route_node_create(route_table_delegate_t *delegate,
 					    struct route_table *table);
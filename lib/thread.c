@@ -22,6 +22,9 @@
 
 #include <zebra.h>
 #include <sys/resource.h>
+#ifdef HAVE_SYS_EPOLL_H
+#include <sys/epoll.h>
+#endif
 
 #include "thread.h"
 #include "memory.h"
@@ -78,6 +81,35 @@ static pthread_mutex_t masters_mtx = PTHREAD_MUTEX_INITIALIZER;
 static struct list *masters;
 
 static void thread_free(struct thread_master *master, struct thread *thread);
+static void thread_io_init(struct thread_master *m);
+
+/*
+ * I/O event backend.  All hooks except init/show run with m->mtx held;
+ * m->read / m->write have already been updated when add/cancel are called.
+ */
+struct thread_io_ops {
+	const char *name;
+
+	bool (*init)(struct thread_master *m);
+	void (*fini)(struct thread_master *m);
+
+	/* start / stop watching fd for THREAD_READ or THREAD_WRITE */
+	void (*add)(struct thread_master *m, int fd, int dir);
+	void (*cancel)(struct thread_master *m, int fd, int dir);
+
+	/* number of pending I/O tasks; 0 means nothing to wait for */
+	unsigned int (*count)(struct thread_master *m);
+
+	/* block until I/O or timer_wait expires; drops m->mtx meanwhile */
+	int (*wait)(struct thread_master *m, const struct timeval *timer_wait);
+
+	/* move tasks for the num reported fds onto the ready queue */
+	void (*process)(struct thread_master *m, unsigned int num);
+
+	void (*show)(struct vty *vty, struct thread_master *m);
+};
+
+static const struct thread_io_ops *thread_io_default;
 
 /* CLI start ---------------------------------------------------------------- */
 static unsigned int cpu_record_hash_key(const struct cpu_thread_history *a)
@@ -318,41 +350,14 @@ static void show_thread_poll_helper(struct vty *vty, struct thread_master *m)
 {
 	const char *name = m->name ? m->name : "main";
 	char underline[strlen(name) + 1];
-	struct thread *thread;
-	uint32_t i;
 
 	memset(underline, '-', sizeof(underline));
 	underline[sizeof(underline) - 1] = '\0';
 
 	vty_out(vty, "\nShowing poll FD's for %s\n", name);
 	vty_out(vty, "----------------------%s\n", underline);
-	vty_out(vty, "Count: %u/%d\n", (uint32_t)m->handler.pfdcount,
-		m->fd_limit);
-	for (i = 0; i < m->handler.pfdcount; i++) {
-		vty_out(vty, "\t%6d fd:%6d events:%2d revents:%2d\t\t", i,
-			m->handler.pfds[i].fd, m->handler.pfds[i].events,
-			m->handler.pfds[i].revents);
-
-		if (m->handler.pfds[i].events & POLLIN) {
-			thread = m->read[m->handler.pfds[i].fd];
-
-			if (!thread)
-				vty_out(vty, "ERROR ");
-			else
-				vty_out(vty, "%s ", thread->funcname);
-		} else
-			vty_out(vty, " ");
-
-		if (m->handler.pfds[i].events & POLLOUT) {
-			thread = m->write[m->handler.pfds[i].fd];
-
-			if (!thread)
-				vty_out(vty, "ERROR\n");
-			else
-				vty_out(vty, "%s\n", thread->funcname);
-		} else
-			vty_out(vty, "\n");
-	}
+	vty_out(vty, "Backend: %s\n", m->io->name);
+	m->io->show(vty, m);
 }
 
 DEFUN (show_thread_poll,
@@ -471,13 +476,8 @@ struct thread_master *thread_master_create(const char *name)
 	set_nonblocking(rv->io_pipe[0]);
 	set_nonblocking(rv->io_pipe[1]);
 
-	/* Initialize data structures for poll() */
-	rv->handler.pfdsize = rv->fd_limit;
-	rv->handler.pfdcount = 0;
-	rv->handler.pfds = XCALLOC(MTYPE_THREAD_MASTER,
-				   sizeof(struct pollfd) * rv->handler.pfdsize);
-	rv->handler.copy = XCALLOC(MTYPE_THREAD_MASTER,
-				   sizeof(struct pollfd) * rv->handler.pfdsize);
+	/* Initialize I/O event backend */
+	thread_io_init(rv);
 
 	/* add to list of threadmasters */
 	frr_with_mutex(&masters_mtx) {
@@ -584,6 +584,7 @@ void thread_master_free(struct thread_master *m)
 	thread_list_free(m, &m->event);
 	thread_list_free(m, &m->ready);
 	thread_list_free(m, &m->unuse);
+	m->io->fini(m);
 	pthread_mutex_destroy(&m->mtx);
 	pthread_cond_destroy(&m->cancel_cond);
 	close(m->io_pipe[0]);
@@ -596,8 +597,6 @@ void thread_master_free(struct thread_master *m)
 	m->cpu_record = NULL;
 
 	XFREE(MTYPE_THREAD_MASTER, m->name);
-	XFREE(MTYPE_THREAD_MASTER, m->handler.pfds);
-	XFREE(MTYPE_THREAD_MASTER, m->handler.copy);
 	XFREE(MTYPE_THREAD_MASTER, m);
 }
 
@@ -690,8 +689,8 @@ static void thread_free(struct thread_master *master, struct thread *thread)
 	XFREE(MTYPE_THREAD, thread);
 }
 
-static int fd_poll(struct thread_master *m, struct pollfd *pfds, nfds_t pfdsize,
-		   nfds_t count, const struct timeval *timer_wait)
+static int thread_io_timeout(struct thread_master *m,
+			     const struct timeval *timer_wait)
 {
 	/* If timer_wait is null here, that means poll() should block
 	 * indefinitely,
@@ -706,9 +705,6 @@ static int fd_poll(struct thread_master *m, struct pollfd *pfds, nfds_t pfdsize,
 	 * zero, the behavior is default. */
 	int timeout = -1;
 
-	/* number of file descriptors with events */
-	int num;
-
 	if (timer_wait != NULL
 	    && m->selectpoll_timeout == 0) // use the default value
 		timeout = (timer_wait->tv_sec * 1000)
@@ -719,6 +715,17 @@ static int fd_poll(struct thread_master *m, struct pollfd *pfds, nfds_t pfdsize,
 		 < 0) // effect a poll (return immediately)
 		timeout = 0;
 
+	return timeout;
+}
+
+static int fd_poll(struct thread_master *m, struct pollfd *pfds, nfds_t pfdsize,
+		   nfds_t count, const struct timeval *timer_wait)
+{
+	int timeout = thread_io_timeout(m, timer_wait);
+
+	/* number of file descriptors with events */
+	int num;
+
 	rcu_read_unlock();
 	rcu_assert_read_unlocked();
 
@@ -756,53 +763,32 @@ struct thread *funcname_thread_add_read_write(int dir, struct thread_master *m,
 			// thread is already scheduled; don't reschedule
 			break;
 
-		/* default to a new pollfd */
-		nfds_t queuepos = m->handler.pfdcount;
-
 		if (dir == THREAD_READ)
 			thread_array = m->read;
 		else
 			thread_array = m->write;
 
-		/* if we already have a pollfd for our file descriptor, find and
-		 * use it */
-		for (nfds_t i = 0; i < m->handler.pfdcount; i++)
-			if (m->handler.pfds[i].fd == fd) {
-				queuepos = i;
-
 #ifdef DEV_BUILD
-				/*
-				 * What happens if we have a thread already
-				 * created for this event?
-				 */
-				if (thread_array[fd])
-					assert(!"Thread already scheduled for file descriptor");
+		/*
+		 * What happens if we have a thread already
+		 * created for this event?
+		 */
+		if (thread_array[fd])
+			assert(!"Thread already scheduled for file descriptor");
 #endif
-				break;
-			}
-
-		/* make sure we have room for this fd + pipe poker fd */
-		assert(queuepos + 1 < m->handler.pfdsize);
 
 		thread = thread_get(m, dir, func, arg, debugargpass);
 
-		m->handler.pfds[queuepos].fd = fd;
-		m->handler.pfds[queuepos].events |=
-			(dir == THREAD_READ ? POLLIN : POLLOUT);
-
-		if (queuepos == m->handler.pfdcount)
-			m->handler.pfdcount++;
+		frr_with_mutex(&thread->mtx) {
+			thread->u.fd = fd;
+			thread_array[thread->u.fd] = thread;
+		}
 
-		if (thread) {
-			frr_with_mutex(&thread->mtx) {
-				thread->u.fd = fd;
-				thread_array[thread->u.fd] = thread;
-			}
+		m->io->add(m, fd, dir);
 
-			if (t_ptr) {
-				*t_ptr = thread;
-				thread->ref = t_ptr;
-			}
+		if (t_ptr) {
+			*t_ptr = thread;
+			thread->ref = t_ptr;
 		}
 
 		AWAKEN(m);
@@ -1050,11 +1036,9 @@ static void do_thread_cancel(struct thread_master *master)
 		/* Determine the appropriate queue to cancel the thread from */
 		switch (thread->type) {
 		case THREAD_READ:
-			thread_cancel_rw(master, thread->u.fd, POLLIN);
 			thread_array = master->read;
 			break;
 		case THREAD_WRITE:
-			thread_cancel_rw(master, thread->u.fd, POLLOUT);
 			thread_array = master->write;
 			break;
 		case THREAD_TIMER:
@@ -1075,6 +1059,7 @@ static void do_thread_cancel(struct thread_master *master)
 			thread_list_del(list, thread);
 		} else if (thread_array) {
 			thread_array[thread->u.fd] = NULL;
+			master->io->cancel(master, thread->u.fd, thread->type);
 		}
 
 		if (thread->ref)
@@ -1303,6 +1288,445 @@ static void thread_process_io(struct thread_master *m, unsigned int num)
 	}
 }
 
+/* I/O event backends ------------------------------------------------------ */
+
+static bool thread_poll_init(struct thread_master *m)
+{
+	/* Initialize data structures for poll() */
+	m->handler.pfdsize = m->fd_limit;
+	m->handler.pfdcount = 0;
+	m->handler.pfds = XCALLOC(MTYPE_THREAD_MASTER,
+				  sizeof(struct pollfd) * m->handler.pfdsize);
+	m->handler.copy = XCALLOC(MTYPE_THREAD_MASTER,
+				  sizeof(struct pollfd) * m->handler.pfdsize);
+	return true;
+}
+
+static void thread_poll_fini(struct thread_master *m)
+{
+	XFREE(MTYPE_THREAD_MASTER, m->handler.pfds);
+	XFREE(MTYPE_THREAD_MASTER, m->handler.copy);
+}
+
+static void thread_poll_add(struct thread_master *m, int fd, int dir)
+{
+	/* default to a new pollfd */
+	nfds_t queuepos = m->handler.pfdcount;
+
+	/* if we already have a pollfd for our file descriptor, find and
+	 * use it */
+	for (nfds_t i = 0; i < m->handler.pfdcount; i++)
+		if (m->handler.pfds[i].fd == fd) {
+			queuepos = i;
+			break;
+		}
+
+	/* make sure we have room for this fd + pipe poker fd */
+	assert(queuepos + 1 < m->handler.pfdsize);
+
+	m->handler.pfds[queuepos].fd = fd;
+	m->handler.pfds[queuepos].events |=
+		(dir == THREAD_READ ? POLLIN : POLLOUT);
+
+	if (queuepos == m->handler.pfdcount)
+		m->handler.pfdcount++;
+}
+
+static void thread_poll_cancel(struct thread_master *m, int fd, int dir)
+{
+	thread_cancel_rw(m, fd, dir == THREAD_READ ? POLLIN : POLLOUT);
+}
+
+static unsigned int thread_poll_count(struct thread_master *m)
+{
+	return m->handler.pfdcount;
+}
+
+static int thread_poll_wait(struct thread_master *m,
+			    const struct timeval *timer_wait)
+{
+	int num;
+
+	/*
+	 * Copy pollfd array + # active pollfds in it. Not necessary to
+	 * copy the array size as this is fixed.
+	 */
+	m->handler.copycount = m->handler.pfdcount;
+	memcpy(m->handler.copy, m->handler.pfds,
+	       m->handler.copycount * sizeof(struct pollfd));
+
+	pthread_mutex_unlock(&m->mtx);
+	{
+		num = fd_poll(m, m->handler.copy, m->handler.pfdsize,
+			      m->handler.copycount, timer_wait);
+	}
+	pthread_mutex_lock(&m->mtx);
+
+	return num;
+}
+
+static void thread_poll_show(struct vty *vty, struct thread_master *m)
+{
+	struct thread *thread;
+	uint32_t i;
+
+	vty_out(vty, "Count: %u/%d\n", (uint32_t)m->handler.pfdcount,
+		m->fd_limit);
+	for (i = 0; i < m->handler.pfdcount; i++) {
+		vty_out(vty, "\t%6d fd:%6d events:%2d revents:%2d\t\t", i,
+			m->handler.pfds[i].fd, m->handler.pfds[i].events,
+			m->handler.pfds[i].revents);
+
+		if (m->handler.pfds[i].events & POLLIN) {
+			thread = m->read[m->handler.pfds[i].fd];
+
+			if (!thread)
+				vty_out(vty, "ERROR ");
+			else
+				vty_out(vty, "%s ", thread->funcname);
+		} else
+			vty_out(vty, " ");
+
+		if (m->handler.pfds[i].events & POLLOUT) {
+			thread = m->write[m->handler.pfds[i].fd];
+
+			if (!thread)
+				vty_out(vty, "ERROR\n");
+			else
+				vty_out(vty, "%s\n", thread->funcname);
+		} else
+			vty_out(vty, "\n");
+	}
+}
+
+static const struct thread_io_ops thread_io_poll = {
+	.name = "poll",
+	.init = thread_poll_init,
+	.fini = thread_poll_fini,
+	.add = thread_poll_add,
+	.cancel = thread_poll_cancel,
+	.count = thread_poll_count,
+	.wait = thread_poll_wait,
+	.process = thread_process_io,
+	.show = thread_poll_show,
+};
+
+#ifdef HAVE_SYS_EPOLL_H
+/*
+ * epoll backend.
+ *
+ * Unlike poll(), nothing is copied or scanned per wakeup; cost scales with
+ * the number of fds that are actually ready.  fds are armed EPOLLONESHOT,
+ * i.e. the kernel disarms an fd when reporting it, which maps directly onto
+ * our one-shot read/write tasks.  Re-arming is deferred until right before
+ * the next epoll_wait() so that a task re-adding itself for the same fd -
+ * by far the most common pattern - costs a single epoll_ctl().
+ * Cancellation is synced immediately since the fd is often closed next.
+ */
+struct fd_epoll_slot {
+	/* events currently armed in the kernel */
+	uint32_t armed;
+	/* fd is queued on m->epoll.changes */
+	bool changed;
+};
+
+#define THREAD_EPOLL_EVENTS 1024
+
+static void thread_epoll_sync(struct thread_master *m, int fd)
+{
+	struct fd_epoll_slot *slot = &m->epoll.slots[fd];
+	struct epoll_event ev = {};
+	uint32_t wanted = 0;
+	int ret;
+
+	if (m->read[fd])
+		wanted |= EPOLLIN;
+	if (m->write[fd])
+		wanted |= EPOLLOUT;
+
+	if (wanted == slot->armed)
+		return;
+
+	slot->armed = wanted;
+
+	if (!wanted) {
+		/* a closed fd has already dropped out of the epoll set */
+		if (epoll_ctl(m->epoll.epfd, EPOLL_CTL_DEL, fd, NULL) < 0
+		    && errno != ENOENT && errno != EBADF)
+			flog_err(EC_LIB_SYSTEM_CALL,
+				 "%s: epoll_ctl(DEL, fd %d) failed: %s",
+				 __func__, fd, safe_strerror(errno));
+		return;
+	}
+
+	ev.events = wanted | EPOLLONESHOT;
+	ev.data.fd = fd;
+
+	ret = epoll_ctl(m->epoll.epfd, EPOLL_CTL_MOD, fd, &ev);
+	if (ret < 0 && errno == ENOENT)
+		ret = epoll_ctl(m->epoll.epfd, EPOLL_CTL_ADD, fd, &ev);
+	if (ret < 0) {
+		flog_err(EC_LIB_SYSTEM_CALL, "%s: epoll_ctl(fd %d) failed: %s",
+			 __func__, fd, safe_strerror(errno));
+		slot->armed = 0;
+	}
+}
+
+static void thread_epoll_queue_change(struct thread_master *m, int fd)
+{
+	struct fd_epoll_slot *slot = &m->epoll.slots[fd];
+
+	if (slot->changed)
+		return;
+
+	slot->changed = true;
+	m->epoll.changes[m->epoll.changecount++] = fd;
+}
+
+static bool thread_epoll_init(struct thread_master *m)
+{
+	struct epoll_event ev = {};
+
+	m->epoll.epfd = epoll_create1(EPOLL_CLOEXEC);
+	if (m->epoll.epfd < 0) {
+		flog_err(EC_LIB_SYSTEM_CALL, "epoll_create1() failed: %s",
+			 safe_strerror(errno));
+		return false;
+	}
+
+	/* the pipe poker stays armed for the lifetime of the master */
+	ev.events = EPOLLIN;
+	ev.data.fd = m->io_pipe[0];
+	if (epoll_ctl(m->epoll.epfd, EPOLL_CTL_ADD, m->io_pipe[0], &ev) < 0) {
+		flog_err(EC_LIB_SYSTEM_CALL, "epoll_ctl(ADD, pipe) failed: %s",
+			 safe_strerror(errno));
+		close(m->epoll.epfd);
+		return false;
+	}
+
+	m->epoll.eventsize = MIN(m->fd_limit, THREAD_EPOLL_EVENTS);
+	m->epoll.events = XCALLOC(MTYPE_THREAD_POLL,
+				  sizeof(struct epoll_event)
+					  * m->epoll.eventsize);
+	m->epoll.slots = XCALLOC(MTYPE_THREAD_POLL,
+				 sizeof(struct fd_epoll_slot) * m->fd_limit);
+	m->epoll.changes =
+		XCALLOC(MTYPE_THREAD_POLL, sizeof(int) * m->fd_limit);
+	m->epoll.changecount = 0;
+	m->epoll.active = 0;
+	return true;
+}
+
+static void thread_epoll_fini(struct thread_master *m)
+{
+	close(m->epoll.epfd);
+	XFREE(MTYPE_THREAD_POLL, m->epoll.events);
+	XFREE(MTYPE_THREAD_POLL, m->epoll.slots);
+	XFREE(MTYPE_THREAD_POLL, m->epoll.changes);
+}
+
+static void thread_epoll_add(struct thread_master *m, int fd, int dir)
+{
+	/* What we believe is armed may be stale: an fd closed with its task
+	 * still scheduled drops out of the epoll set, and a new fd can get
+	 * the same number.  Forget it, so the next sync goes to the kernel
+	 * (MOD, falling back to ADD).  When a task re-adds itself, the fd
+	 * was disarmed by reporting it anyway, so this costs nothing extra.
+	 */
+	m->epoll.slots[fd].armed = 0;
+
+	m->epoll.active++;
+	thread_epoll_queue_change(m, fd);
+}
+
+static void thread_epoll_cancel(struct thread_master *m, int fd, int dir)
+{
+	m->epoll.active--;
+	thread_epoll_sync(m, fd);
+}
+
+static unsigned int thread_epoll_count(struct thread_master *m)
+{
+	return m->epoll.active;
+}
+
+static int thread_epoll_wait(struct thread_master *m,
+			     const struct timeval *timer_wait)
+{
+	int timeout = thread_io_timeout(m, timer_wait);
+	unsigned int i;
+	int num;
+
+	for (i = 0; i < m->epoll.changecount; i++) {
+		int fd = m->epoll.changes[i];
+
+		m->epoll.slots[fd].changed = false;
+		thread_epoll_sync(m, fd);
+	}
+	m->epoll.changecount = 0;
+
+	pthread_mutex_unlock(&m->mtx);
+	rcu_read_unlock();
+	rcu_assert_read_unlocked();
+
+	num = epoll_wait(m->epoll.epfd, m->epoll.events, m->epoll.eventsize,
+			 timeout);
+
+	rcu_read_lock();
+	pthread_mutex_lock(&m->mtx);
+
+	return num;
+}
+
+static void thread_epoll_ready(struct thread_master *m,
+			       struct thread **thread_array, int fd)
+{
+	struct thread *thread = thread_array[fd];
+
+	thread_array[fd] = NULL;
+	thread_list_add_tail(&m->ready, thread);
+	thread->type = THREAD_READY;
+	m->epoll.active--;
+}
+
+static void thread_epoll_process(struct thread_master *m, unsigned int num)
+{
+	unsigned char trash[64];
+
+	for (unsigned int i = 0; i < num; i++) {
+		struct epoll_event *ev = &m->epoll.events[i];
+		int fd = ev->data.fd;
+
+		if (fd == m->io_pipe[0]) {
+			while (read(fd, &trash, sizeof(trash)) > 0)
+				;
+			continue;
+		}
+
+		/* reporting the fd disarmed it (EPOLLONESHOT) */
+		m->epoll.slots[fd].armed = 0;
+
+		/* errors and hangups are delivered to whoever is waiting,
+		 * the subsequent read()/write() will tell them what's up */
+		if ((ev->events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+		    && m->read[fd])
+			thread_epoll_ready(m, m->read, fd);
+		if ((ev->events & (EPOLLOUT | EPOLLHUP | EPOLLERR))
+		    && m->write[fd])
+			thread_epoll_ready(m, m->write, fd);
+
+		/* a task for the other direction is still waiting */
+		if (m->read[fd] || m->write[fd])
+			thread_epoll_queue_change(m, fd);
+	}
+}
+
+static void thread_epoll_show(struct vty *vty, struct thread_master *m)
+{
+	struct thread *rthread, *wthread;
+	int fd;
+
+	vty_out(vty, "Count: %u/%d\n", m->epoll.active, m->fd_limit);
+	for (fd = 0; fd < m->fd_limit; fd++) {
+		rthread = m->read[fd];
+		wthread = m->write[fd];
+		if (!rthread && !wthread)
+			continue;
+
+		vty_out(vty, "\tfd:%6d armed:%2u\t\t%s %s\n", fd,
+			m->epoll.slots[fd].armed,
+			rthread ? rthread->funcname : "",
+			wthread ? wthread->funcname : "");
+	}
+}
+
+static const struct thread_io_ops thread_io_epoll = {
+	.name = "epoll",
+	.init = thread_epoll_init,
+	.fini = thread_epoll_fini,
+	.add = thread_epoll_add,
+	.cancel = thread_epoll_cancel,
+	.count = thread_epoll_count,
+	.wait = thread_epoll_wait,
+	.process = thread_epoll_process,
+	.show = thread_epoll_show,
+};
+#endif /* HAVE_SYS_EPOLL_H */
+
+static const struct thread_io_ops *const thread_io_backends[] = {
+	&thread_io_poll,
+#ifdef HAVE_SYS_EPOLL_H
+	&thread_io_epoll,
+#endif
+	NULL,
+};
+
+bool thread_io_backend_set(const char *name)
+{
+	const struct thread_io_ops *const *io;
+
+	for (io = thread_io_backends; *io; io++)
+		if (!strcmp((*io)->name, name)) {
+			thread_io_default = *io;
+			return true;
+		}
+	return false;
+}
+
+const char *thread_io_backend_name(const struct thread_master *m)
+{
+	return m->io->name;
+}
+
+/*
+ * Switch a thread_master that has no I/O tasks yet, e.g. one just created
+ * for a pthread that has not been started, to another backend.  Stays on
+ * the current one if the new one is unknown or cannot be initialized.
+ */
+bool thread_master_io_backend_set(struct thread_master *m, const char *name)
+{
+	const struct thread_io_ops *const *io;
+	const struct thread_io_ops *old;
+	bool ret = false;
+
+	frr_with_mutex(&m->mtx) {
+		if (m->io->count(m))
+			break;
+
+		for (io = thread_io_backends; *io; io++)
+			if (!strcmp((*io)->name, name))
+				break;
+		if (!*io || *io == m->io) {
+			ret = (*io != NULL);
+			break;
+		}
+
+		old = m->io;
+		old->fini(m);
+		m->io = *io;
+		ret = m->io->init(m);
+		if (!ret) {
+			m->io = old;
+			m->io->init(m);
+		}
+	}
+
+	return ret;
+}
+
+static void thread_io_init(struct thread_master *m)
+{
+	m->io = thread_io_default ? thread_io_default : &thread_io_poll;
+	if (m->io->init(m))
+		return;
+
+	flog_err(EC_LIB_SYSTEM_CALL,
+		 "%s I/O backend unavailable, falling back to poll",
+		 m->io->name);
+	m->io = &thread_io_poll;
+	m->io->init(m);
+}
+
 /* Add all timers that have popped to the ready list. */
 static unsigned int thread_process_timers(struct thread_timer_list_head *timers,
 					  struct timeval *timenow)
@@ -1401,26 +1825,13 @@ struct thread *thread_fetch(struct thread_master *m, struct thread *fetch)
 				(tw && !timercmp(tw, &zerotime, >)))
 			tw = &zerotime;
 
-		if (!tw && m->handler.pfdcount == 0) { /* die */
+		if (!tw && m->io->count(m) == 0) { /* die */
 			pthread_mutex_unlock(&m->mtx);
 			fetch = NULL;
 			break;
 		}
 
-		/*
-		 * Copy pollfd array + # active pollfds in it. Not necessary to
-		 * copy the array size as this is fixed.
-		 */
-		m->handler.copycount = m->handler.pfdcount;
-		memcpy(m->handler.copy, m->handler.pfds,
-		       m->handler.copycount * sizeof(struct pollfd));
-
-		pthread_mutex_unlock(&m->mtx);
-		{
-			num = fd_poll(m, m->handler.copy, m->handler.pfdsize,
-				      m->handler.copycount, tw);
-		}
-		pthread_mutex_lock(&m->mtx);
+		num = m->io->wait(m, tw);
 
 		/* Handle any errors received in poll() */
 		if (num < 0) {
@@ -1431,8 +1842,8 @@ struct thread *thread_fetch(struct thread_master *m, struct thread *fetch)
 			}
 
 			/* else die */
-			flog_err(EC_LIB_SYSTEM_CALL, "poll() error: %s",
-				 safe_strerror(errno));
+			flog_err(EC_LIB_SYSTEM_CALL, "%s() error: %s",
+				 m->io->name, safe_strerror(errno));
 			pthread_mutex_unlock(&m->mtx);
 			fetch = NULL;
 			break;
@@ -1444,7 +1855,7 @@ struct thread *thread_fetch(struct thread_master *m, struct thread *fetch)
 
 		/* Post I/O to ready queue. */
 		if (num > 0)
-			thread_process_io(m, num);
+			m->io->process(m, num);
 
 		pthread_mutex_unlock(&m->mtx);
 
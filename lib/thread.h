@@ -43,6 +43,10 @@ struct rusage_t {
 PREDECL_LIST(thread_list)
 PREDECL_HEAP(thread_timer_list)
 
+struct epoll_event;
+struct fd_epoll_slot;
+struct thread_io_ops;
+
 struct fd_handler {
 	/* number of pfd that fit in the allocated space of pfds. This is a
 	 * constant
@@ -60,6 +64,26 @@ struct fd_handler {
 	nfds_t copycount;
 };
 
+/* epoll(7) state, only used by the epoll I/O backend */
+struct fd_epoll {
+	/* epoll instance */
+	int epfd;
+
+	/* event array handed to epoll_wait() */
+	struct epoll_event *events;
+	int eventsize;
+
+	/* per-fd armed events, indexed by fd */
+	struct fd_epoll_slot *slots;
+
+	/* fds whose armed events must be synced before the next wait */
+	int *changes;
+	unsigned int changecount;
+
+	/* number of read/write tasks currently scheduled */
+	unsigned int active;
+};
+
 struct cancel_req {
 	struct thread *thread;
 	void *eventobj;
@@ -80,7 +104,9 @@ struct thread_master {
 	struct hash *cpu_record;
 	int io_pipe[2];
 	int fd_limit;
+	const struct thread_io_ops *io;
 	struct fd_handler handler;
+	struct fd_epoll epoll;
 	unsigned long alloc;
 	long selectpoll_timeout;
 	bool spin;
@@ -218,6 +244,13 @@ extern int thread_should_yield(struct thread *);
 /* set yield time for thread */
 extern void thread_set_yield_time(struct thread *, unsigned long);
 
+/* I/O event backend selection; only affects thread_masters created later */
+extern bool thread_io_backend_set(const char *name);
+extern const char *thread_io_backend_name(const struct thread_master *m);
+/* ... or for one thread_master, before any I/O task is added to it */
+extern bool thread_master_io_backend_set(struct thread_master *m,
+					 const char *name);
+
 /* Internal libfrr exports */
 extern void thread_getrusage(RUSAGE_T *);
 extern void thread_cmd_init(void);
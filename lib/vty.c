@@ -64,11 +64,13 @@ enum event {
 #ifdef VTYSH
 	VTYSH_SERV,
 	VTYSH_READ,
-	VTYSH_WRITE
+	VTYSH_WRITE,
+	VTYSH_STREAM
 #endif /* VTYSH */
 };
 
 static void vty_event(enum event, int, struct vty *);
+static void vty_stream_stop(struct vty *vty);
 
 /* Extern host structure from command.c */
 extern struct host host;
@@ -2062,11 +2064,39 @@ static int vtysh_flush(struct vty *vty)
 		return -1;
 		break;
 	case BUFFER_EMPTY:
+		/* output so far is out, time for the next piece */
+		if (vty->stream_fn)
+			vty_event(VTYSH_STREAM, vty->wfd, vty);
 		break;
 	}
 	return 0;
 }
 
+static int vtysh_stream(struct thread *thread)
+{
+	struct vty *vty = THREAD_ARG(thread);
+	uint8_t header[4] = {0, 0, 0, 0};
+	int ret;
+
+	ret = vty->stream_fn(vty, vty->stream_arg);
+	if (ret == CMD_SUSPEND) {
+		if (!vty->t_write)
+			vtysh_flush(vty);
+		return 0;
+	}
+
+	vty_stream_stop(vty);
+
+	/* finish the command like vtysh_read() does */
+	header[3] = ret;
+	buffer_put(vty->obuf, header, 4);
+	if (!vty->t_write && (vtysh_flush(vty) < 0))
+		return 0;
+
+	vty_event(VTYSH_READ, vty->fd, vty);
+	return 0;
+}
+
 static int vtysh_read(struct thread *thread)
 {
 	int ret;
@@ -2130,8 +2160,16 @@ static int vtysh_read(struct thread *thread)
 				 * - other commands in "buf" will be ditched
 				 * - input during pending config-write is
 				 * "unsupported" */
-				if (ret == CMD_SUSPEND)
+				if (ret == CMD_SUSPEND) {
+					/* vty_stream_start(), input is read
+					 * again once the output is done */
+					if (vty->stream_fn) {
+						vty_event(VTYSH_STREAM,
+							  vty->wfd, vty);
+						return 0;
+					}
 					break;
+				}
 
 				/* warning: watchfrr hardcodes this result write
 				 */
@@ -2183,6 +2221,52 @@ static void vty_error_delete(void *arg)
 	XFREE(MTYPE_TMP, ve);
 }
 
+static void vty_stream_stop(struct vty *vty)
+{
+	THREAD_OFF(vty->t_stream);
+	if (vty->stream_free)
+		vty->stream_free(vty->stream_arg);
+	vty->stream_fn = NULL;
+	vty->stream_free = NULL;
+	vty->stream_arg = NULL;
+}
+
+/*
+ * For commands with a lot of output, like full table dumps.  fn prints a
+ * bounded part of the output per call and returns CMD_SUSPEND while there
+ * is more to come, or the command's result once it is done; free_fn (if
+ * given) then releases arg, also when the vty is closed before that.
+ *
+ * On vtysh sessions fn is called from the event loop, each time after the
+ * output of the previous call has been written to the socket, so neither
+ * the output buffer nor the time spent between other events grows with
+ * the size of the output.  Everywhere else fn is just run to completion.
+ * The command returns whatever this returns.
+ */
+int vty_stream_start(struct vty *vty, vty_stream_fn fn, void *arg,
+		     void (*free_fn)(void *arg))
+{
+	int ret;
+
+#ifdef VTYSH
+	/* "| include" is applied per command, it would be gone by then */
+	if (vty->type == VTY_SHELL_SERV && !vty->filter && !vty->stream_fn) {
+		vty->stream_fn = fn;
+		vty->stream_free = free_fn;
+		vty->stream_arg = arg;
+		return CMD_SUSPEND;
+	}
+#endif /* VTYSH */
+
+	do
+		ret = fn(vty, arg);
+	while (ret == CMD_SUSPEND);
+
+	if (free_fn)
+		free_fn(arg);
+	return ret;
+}
+
 /* Close vty interface.  Warning: call this only from functions that
    will be careful not to access the vty afterwards (since it has
    now been freed).  This is safest from top-level functions (called
@@ -2196,6 +2280,7 @@ void vty_close(struct vty *vty)
 	THREAD_OFF(vty->t_read);
 	THREAD_OFF(vty->t_write);
 	THREAD_OFF(vty->t_timeout);
+	vty_stream_stop(vty);
 
 	/* Flush buffer. */
 	buffer_flush_all(vty->obuf, vty->wfd);
@@ -2648,6 +2733,10 @@ static void vty_event(enum event event, int sock, struct vty *vty)
 		thread_add_write(vty_master, vtysh_write, vty, sock,
 				 &vty->t_write);
 		break;
+	case VTYSH_STREAM:
+		thread_add_event(vty_master, vtysh_stream, vty, 0,
+				 &vty->t_stream);
+		break;
 #endif /* VTYSH */
 	case VTY_READ:
 		thread_add_read(vty_master, vty_read, vty, sock, &vty->t_read);
@@ -41,6 +41,11 @@ extern "C" {
 
 #define VTY_MAXCFGCHANGES 8
 
+struct vty;
+
+/* Produces one piece of a command's output, see vty_stream_start() */
+typedef int (*vty_stream_fn)(struct vty *vty, void *arg);
+
 struct vty_error {
 	char error_buf[VTY_BUFSIZ];
 	uint32_t line_num;
@@ -176,6 +181,12 @@ struct vty {
 	struct thread *t_read;
 	struct thread *t_write;
 
+	/* Command output still being produced, see vty_stream_start() */
+	vty_stream_fn stream_fn;
+	void (*stream_free)(void *arg);
+	void *stream_arg;
+	struct thread *t_stream;
+
 	/* Timeout seconds and thread. */
 	unsigned long v_timeout;
 	struct thread *t_timeout;
@@ -306,6 +317,8 @@ extern struct vty *vty_stdio(void (*atclose)(int isexit));
 extern int vty_out(struct vty *, const char *, ...) PRINTFRR(2, 3);
 extern void vty_frame(struct vty *, const char *, ...) PRINTFRR(2, 3);
 extern void vty_endframe(struct vty *, const char *);
+extern int vty_stream_start(struct vty *vty, vty_stream_fn fn, void *arg,
+			    void (*free_fn)(void *arg));
 bool vty_set_include(struct vty *vty, const char *regexp);
 
 extern bool vty_read_config(struct nb_config *config, const char *config_file,
@@ -43,6 +43,15 @@
 DEFINE_MTYPE_STATIC(LIB, ZCLIENT, "Zclient")
 DEFINE_MTYPE_STATIC(LIB, REDIST_INST, "Redistribution instance IDs")
 
+/* Offset of the command in a message header */
+#define ZAPI_HEADER_CMD_OFFSET 8
+
+/*
+ * Offset of the prefix family in an encoded route: type, instance, flags,
+ * message and safi follow the header.
+ */
+#define ZAPI_ROUTE_PREFIX_OFFSET (ZEBRA_HEADER_SIZE + 9)
+
 /* Zebra client events. */
 enum event { ZCLIENT_SCHEDULE, ZCLIENT_READ, ZCLIENT_CONNECT };
 
@@ -76,6 +85,9 @@ struct zclient *zclient_new(struct thread_master *master,
 	zclient->master = master;
 
 	zclient->receive_notify = opt->receive_notify;
+	zclient->route_bulk = opt->route_bulk;
+	if (zclient->route_bulk)
+		zclient->bulk_buf = stream_new(stream_size);
 
 	return zclient;
 }
@@ -93,6 +105,8 @@ void zclient_free(struct zclient *zclient)
 		stream_free(zclient->obuf);
 	if (zclient->wb)
 		buffer_free(zclient->wb);
+	if (zclient->bulk_buf)
+		stream_free(zclient->bulk_buf);
 
 	XFREE(MTYPE_ZCLIENT, zclient);
 }
@@ -156,11 +170,22 @@ void zclient_stop(struct zclient *zclient)
 	THREAD_OFF(zclient->t_read);
 	THREAD_OFF(zclient->t_connect);
 	THREAD_OFF(zclient->t_write);
+	THREAD_OFF(zclient->t_bulk);
 
 	/* Reset streams. */
 	stream_reset(zclient->ibuf);
 	stream_reset(zclient->obuf);
 
+	/*
+	 * Drop any pending bulk route message: clients replay their routes
+	 * on reconnect, and the new zebra has to advertise bulk support
+	 * again before it is used.
+	 */
+	if (zclient->bulk_buf)
+		stream_reset(zclient->bulk_buf);
+	zclient->bulk_count = 0;
+	zclient->route_bulk_supported = false;
+
 	/* Empty the write buffer. */
 	buffer_reset(zclient->wb);
 
@@ -269,13 +294,12 @@ static int zclient_flush_data(struct thread *thread)
 	return 0;
 }
 
-int zclient_send_message(struct zclient *zclient)
+static int zclient_send_stream(struct zclient *zclient, struct stream *s)
 {
 	if (zclient->sock < 0)
 		return -1;
-	switch (buffer_write(zclient->wb, zclient->sock,
-			     STREAM_DATA(zclient->obuf),
-			     stream_get_endp(zclient->obuf))) {
+	switch (buffer_write(zclient->wb, zclient->sock, STREAM_DATA(s),
+			     stream_get_endp(s))) {
 	case BUFFER_ERROR:
 		flog_err(EC_LIB_ZAPI_SOCKET,
 			 "%s: buffer_write failed to zclient fd %d, closing",
@@ -293,6 +317,55 @@ int zclient_send_message(struct zclient *zclient)
 	return 0;
 }
 
+/*
+ * Send the pending bulk route message, if any. A bulk message holding a
+ * single route goes out as the plain add/delete it was encoded from.
+ */
+static int zclient_route_bulk_flush(struct zclient *zclient)
+{
+	struct stream *s = zclient->bulk_buf;
+	uint16_t cmd;
+	int ret;
+
+	if (!s || !stream_get_endp(s))
+		return 0;
+
+	THREAD_OFF(zclient->t_bulk);
+
+	if (zclient->bulk_count) {
+		stream_putw_at(s, zclient->bulk_count_pos, zclient->bulk_count);
+	} else {
+		cmd = stream_getw_from(s, ZAPI_HEADER_CMD_OFFSET);
+		cmd = cmd == ZEBRA_ROUTE_ADD_BULK ? ZEBRA_ROUTE_ADD
+						  : ZEBRA_ROUTE_DELETE;
+		stream_putw_at(s, ZAPI_HEADER_CMD_OFFSET, cmd);
+		stream_set_endp(s, zclient->bulk_count_pos);
+	}
+	stream_putw_at(s, 0, stream_get_endp(s));
+
+	ret = zclient_send_stream(zclient, s);
+	stream_reset(s);
+	zclient->bulk_count = 0;
+	return ret;
+}
+
+static int zclient_route_bulk_event(struct thread *thread)
+{
+	struct zclient *zclient = THREAD_ARG(thread);
+
+	zclient->t_bulk = NULL;
+	return zclient_route_bulk_flush(zclient);
+}
+
+int zclient_send_message(struct zclient *zclient)
+{
+	/* Keep the pending routes ahead of whatever is sent after them */
+	if (zclient_route_bulk_flush(zclient) < 0)
+		return -1;
+
+	return zclient_send_stream(zclient, zclient->obuf);
+}
+
 void zclient_create_header(struct stream *s, uint16_t command, vrf_id_t vrf_id)
 {
 	/* length placeholder, caller can update */
@@ -677,14 +750,28 @@ static int zclient_connect(struct thread *t)
 	return zclient_start(zclient);
 }
 
-int zclient_send_rnh(struct zclient *zclient, int command, struct prefix *p,
-		     bool exact_match, vrf_id_t vrf_id)
+/*
+ * Nexthop (un)registration.  zebra takes any number of nexthops in one
+ * message, so callers with several to send can bundle them: start the
+ * message with zclient_rnh_start(), zclient_rnh_add() each nexthop until
+ * it returns false for lack of room, then zclient_rnh_send().
+ */
+void zclient_rnh_start(struct zclient *zclient, int command, vrf_id_t vrf_id)
 {
-	struct stream *s;
+	struct stream *s = zclient->obuf;
 
-	s = zclient->obuf;
 	stream_reset(s);
 	zclient_create_header(s, command, vrf_id);
+}
+
+bool zclient_rnh_add(struct zclient *zclient, struct prefix *p,
+		     bool exact_match)
+{
+	struct stream *s = zclient->obuf;
+
+	if (STREAM_WRITEABLE(s) < 4 + IPV6_MAX_BYTELEN)
+		return false;
+
 	stream_putc(s, (exact_match) ? 1 : 0);
 
 	stream_putw(s, PREFIX_FAMILY(p));
@@ -699,11 +786,115 @@ int zclient_send_rnh(struct zclient *zclient, int command, struct prefix *p,
 	default:
 		break;
 	}
+	return true;
+}
+
+int zclient_rnh_send(struct zclient *zclient)
+{
+	struct stream *s = zclient->obuf;
+
 	stream_putw_at(s, 0, stream_get_endp(s));
 
 	return zclient_send_message(zclient);
 }
 
+int zclient_send_rnh(struct zclient *zclient, int command, struct prefix *p,
+		     bool exact_match, vrf_id_t vrf_id)
+{
+	zclient_rnh_start(zclient, command, vrf_id);
+	zclient_rnh_add(zclient, p, exact_match);
+
+	return zclient_rnh_send(zclient);
+}
+
+/*
+ * Bulk route messages.
+ *
+ * A ZEBRA_ROUTE_ADD_BULK or ZEBRA_ROUTE_DELETE_BULK message is a complete
+ * route encoding, as zapi_route_encode() writes it, followed by a 2 byte
+ * count of further prefixes and then that many (prefixlen, prefix) pairs.
+ * The further prefixes share the family of the first one and every other
+ * field of the route. Routes with a source prefix are never coalesced.
+ */
+static bool zclient_route_bulk_usable(struct zclient *zclient, uint8_t cmd,
+				      const struct zapi_route *api)
+{
+	if (!zclient->route_bulk_supported || zclient->sock < 0)
+		return false;
+	if (cmd != ZEBRA_ROUTE_ADD && cmd != ZEBRA_ROUTE_DELETE)
+		return false;
+	return !CHECK_FLAG(api->message, ZAPI_MESSAGE_SRCPFX);
+}
+
+/*
+ * Can the route just encoded in obuf join the pending bulk message? Only
+ * the prefix and the header's length and command may differ.
+ */
+static bool zclient_route_bulk_match(struct zclient *zclient, uint16_t bcmd,
+				     const struct zapi_route *api)
+{
+	struct stream *b = zclient->bulk_buf;
+	struct stream *o = zclient->obuf;
+	size_t bend, oend, len;
+	int psize = PSIZE(api->prefix.prefixlen);
+
+	if (!stream_get_endp(b) || stream_getw_from(b, ZAPI_HEADER_CMD_OFFSET)
+					   != bcmd)
+		return false;
+	if (zclient->bulk_count == UINT16_MAX
+	    || stream_get_endp(b) + 1 + psize > ZEBRA_MAX_PACKET_SIZ)
+		return false;
+
+	bend = ZAPI_ROUTE_PREFIX_OFFSET + 2
+	       + PSIZE(stream_getc_from(b, ZAPI_ROUTE_PREFIX_OFFSET + 1));
+	oend = ZAPI_ROUTE_PREFIX_OFFSET + 2 + psize;
+	len = zclient->bulk_count_pos - bend;
+	if (stream_get_endp(o) - oend != len)
+		return false;
+
+	/* marker, version and vrf */
+	if (memcmp(STREAM_DATA(b) + 2, STREAM_DATA(o) + 2, 6))
+		return false;
+	/* type, instance, flags, message, safi and family */
+	if (memcmp(STREAM_DATA(b) + ZEBRA_HEADER_SIZE,
+		   STREAM_DATA(o) + ZEBRA_HEADER_SIZE,
+		   ZAPI_ROUTE_PREFIX_OFFSET + 1 - ZEBRA_HEADER_SIZE))
+		return false;
+	/* nexthops and attributes */
+	return !memcmp(STREAM_DATA(b) + bend, STREAM_DATA(o) + oend, len);
+}
+
+static int zclient_route_bulk_add(struct zclient *zclient, uint8_t cmd,
+				  const struct zapi_route *api)
+{
+	struct stream *b = zclient->bulk_buf;
+	struct stream *o = zclient->obuf;
+	uint16_t bcmd;
+
+	bcmd = cmd == ZEBRA_ROUTE_ADD ? ZEBRA_ROUTE_ADD_BULK
+				      : ZEBRA_ROUTE_DELETE_BULK;
+
+	if (zclient_route_bulk_match(zclient, bcmd, api)) {
+		stream_putc(b, api->prefix.prefixlen);
+		stream_put(b, &api->prefix.u.prefix,
+			   PSIZE(api->prefix.prefixlen));
+		zclient->bulk_count++;
+	} else {
+		if (zclient_route_bulk_flush(zclient) < 0)
+			return -1;
+
+		stream_put(b, STREAM_DATA(o), stream_get_endp(o));
+		stream_putw_at(b, ZAPI_HEADER_CMD_OFFSET, bcmd);
+		zclient->bulk_count_pos = stream_get_endp(b);
+		stream_putw(b, 0);
+	}
+
+	/* Sent once the current task is done queueing routes */
+	thread_add_event(zclient->master, zclient_route_bulk_event, zclient, 0,
+			 &zclient->t_bulk);
+	return 0;
+}
+
 /*
  * "xdr_encode"-like interface that allows daemon (client) to send
  * a message to zebra server for a route that needs to be
@@ -766,6 +957,8 @@ int zclient_route_send(uint8_t cmd, struct zclient *zclient,
 {
 	if (zapi_route_encode(cmd, zclient->obuf, api) < 0)
 		return -1;
+	if (zclient_route_bulk_usable(zclient, cmd, api))
+		return zclient_route_bulk_add(zclient, cmd, api);
 	return zclient_send_message(zclient);
 }
 
@@ -2700,6 +2893,7 @@ static void zclient_capability_decode(ZAPI_CALLBACK_ARGS)
 	struct stream *s = zclient->ibuf;
 	int vrf_backend;
 	uint8_t mpls_enabled;
+	uint8_t route_bulk;
 
 	STREAM_GETL(s, vrf_backend);
 	vrf_configure_backend(vrf_backend);
@@ -2710,6 +2904,14 @@ static void zclient_capability_decode(ZAPI_CALLBACK_ARGS)
 	STREAM_GETL(s, cap.ecmp);
 	STREAM_GETC(s, cap.role);
 
+	/* Not sent by older zebras */
+	if (STREAM_READABLE(s)) {
+		STREAM_GETC(s, route_bulk);
+		cap.route_bulk = !!route_bulk;
+	}
+	zclient->route_bulk_supported =
+		zclient->route_bulk && zclient->bulk_buf && cap.route_bulk;
+
 	if (zclient->zebra_capabilities)
 		(*zclient->zebra_capabilities)(&cap);
 
@@ -178,6 +178,8 @@ typedef enum {
 	ZEBRA_VXLAN_SG_ADD,
 	ZEBRA_VXLAN_SG_DEL,
 	ZEBRA_VXLAN_SG_REPLAY,
+	ZEBRA_ROUTE_ADD_BULK,
+	ZEBRA_ROUTE_DELETE_BULK,
 } zebra_message_types_t;
 
 struct redist_proto {
@@ -189,6 +191,7 @@ struct zclient_capabilities {
 	uint32_t ecmp;
 	bool mpls_enabled;
 	enum mlag_role role;
+	bool route_bulk;
 };
 
 /* Structure for the zebra client. */
@@ -224,6 +227,18 @@ struct zclient {
 	/* Thread to write buffered data to zebra. */
 	struct thread *t_write;
 
+	/*
+	 * Route add/delete coalescing: routes sharing everything but the
+	 * prefix are sent in one ZEBRA_ROUTE_{ADD,DELETE}_BULK message when
+	 * the client asked for it and zebra advertised support.
+	 */
+	bool route_bulk;
+	bool route_bulk_supported;
+	struct stream *bulk_buf;
+	size_t bulk_count_pos;
+	uint16_t bulk_count;
+	struct thread *t_bulk;
+
 	/* Redistribute information. */
 	uint8_t redist_default; /* clients protocol */
 	unsigned short instance;
@@ -486,6 +501,7 @@ enum zebra_neigh_state { ZEBRA_NEIGH_INACTIVE = 0, ZEBRA_NEIGH_ACTIVE = 1 };
 
 struct zclient_options {
 	bool receive_notify;
+	bool route_bulk;
 };
 
 extern struct zclient_options zclient_options_default;
@@ -656,6 +672,11 @@ extern int zclient_route_send(uint8_t, struct zclient *, struct zapi_route *);
 extern int zclient_send_rnh(struct zclient *zclient, int command,
 			    struct prefix *p, bool exact_match,
 			    vrf_id_t vrf_id);
+extern void zclient_rnh_start(struct zclient *zclient, int command,
+			      vrf_id_t vrf_id);
+extern bool zclient_rnh_add(struct zclient *zclient, struct prefix *p,
+			    bool exact_match);
+extern int zclient_rnh_send(struct zclient *zclient);
 extern int zapi_route_encode(uint8_t, struct stream *, struct zapi_route *);
 extern int zapi_route_decode(struct stream *, struct zapi_route *);
 bool zapi_route_notify_decode(struct stream *s, struct prefix *p,
@@ -1390,6 +1390,7 @@ struct route_map_rule_cmd ospf6_routemap_rule_match_address_prefixlist_cmd = {
 	ospf6_routemap_rule_match_address_prefixlist,
 	ospf6_routemap_rule_match_address_prefixlist_compile,
 	ospf6_routemap_rule_match_address_prefixlist_free,
+	.match_plist_afi = AFI_IP6,
 };
 
 /* `match interface IFNAME' */
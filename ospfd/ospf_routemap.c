@@ -315,7 +315,9 @@ static void route_match_ip_address_prefix_list_free(void *rule)
 struct route_map_rule_cmd route_match_ip_address_prefix_list_cmd = {
 	"ip address prefix-list", route_match_ip_address_prefix_list,
 	route_match_ip_address_prefix_list_compile,
-	route_match_ip_address_prefix_list_free};
+	route_match_ip_address_prefix_list_free,
+	.match_plist_afi = AFI_IP,
+};
 
 /* `match interface IFNAME' */
 /* Match function should return 1 if match is success else return
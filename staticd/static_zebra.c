@@ -465,7 +465,8 @@ extern void static_zebra_route_add(struct route_node *rn,
 
 void static_zebra_init(void)
 {
-	struct zclient_options opt = { .receive_notify = true };
+	struct zclient_options opt = { .receive_notify = true,
+				       .route_bulk = true };
 
 	if_zapi_callbacks(static_ifp_create, static_ifp_up,
 			  static_ifp_down, static_ifp_destroy);
@@ -0,0 +1,297 @@
+/*
+ * AS path regexp matcher test and benchmark
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; see the file COPYING; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Checks bgp_regex_dfa_aspath() and bgp_regex_dfa_str() against
+ * bgp_regexec()/regexec() for a set of typical as-path and community-list
+ * expressions, then times both on generated paths.
+ *
+ *   test_aspath_regex [-n PATHS] [-r ROUNDS]
+ */
+
+#include <zebra.h>
+
+#include "qobj.h"
+#include "vty.h"
+#include "stream.h"
+#include "privs.h"
+#include "memory.h"
+#include "queue.h"
+#include "filter.h"
+#include "monotime.h"
+
+#include "bgpd/bgpd.h"
+#include "bgpd/bgp_aspath.h"
+#include "bgpd/bgp_attr.h"
+#include "bgpd/bgp_regex.h"
+
+/* need these to link in libbgp */
+struct thread_master *master = NULL;
+struct zebra_privs_t bgpd_privs = {
+	.user = NULL,
+	.group = NULL,
+	.vty_group = NULL,
+};
+
+static const char *const regex_tests[] = {
+	"_65001_",
+	"^65001_",
+	"_65001$",
+	"^65001$",
+	"^$",
+	".*",
+	"_",
+	"^65001 65002$",
+	"^65001_65002_",
+	"_6450[0-9]_",
+	"_6450[^0-4]_",
+	"^(65001_)+$",
+	"^65001_([0-9]+_)*65010$",
+	"_(65001|65002|174)_",
+	"^[0-9]+$",
+	"^[0-9]+_[0-9]+$",
+	"^1.*",
+	"_3356_.*_174_",
+	"\\{",
+	"[{}]",
+	"_\\(65010_",
+	"[,]",
+	"^(65001|)$",
+	"65001?0",
+	"^6500[12] ",
+	"4294967295",
+	"_0_",
+	/* bytes >= 0x80, negative as plain char */
+	"\xc3\xa9",
+	"[\xa0-\xff]",
+	NULL,
+};
+
+/* not taken by the DFA, regexec() has to be used */
+static const char *const fallback_tests[] = {
+	"[[:digit:]]+",
+	"^[0-9]{5}$",
+	"\\d",
+	NULL,
+};
+
+static const char *const path_tests[] = {
+	"",
+	"65001",
+	"65001 65002",
+	"65001 65002 65010",
+	"65002 65001",
+	"65001 65001 65001",
+	"174 3356 64500",
+	"3356 1299 174 64505",
+	"65001 {64500,64507}",
+	"(65010 65011) 65001 65002",
+	"[65010,65011] 1",
+	"1 2 3",
+	"12 3",
+	"0",
+	"4294967295",
+	"65001 {65010}",
+	NULL,
+};
+
+static const char *const str_tests[] = {
+	"",
+	"65001:100",
+	"65001:100 65001:200 no-export",
+	"174:3356 65001:65010",
+	"65001:1:2 65002:3:4",
+	"rt 65001:100 soo 64500:1",
+	"caf\xc3\xa9 65001:100",
+	NULL,
+};
+
+static void check(const char *name, bool ok)
+{
+	printf("%s: %s\n", name, ok ? "OK" : "failed");
+}
+
+static bool check_pattern(const char *pattern, bool want_dfa)
+{
+	struct bgp_regex_dfa *dfa;
+	struct aspath *aspath;
+	regex_t *regex;
+	bool ok = true;
+	int i;
+
+	regex = bgp_regcomp(pattern);
+	dfa = bgp_regex_dfa_compile(pattern);
+	if (!regex || !dfa != !want_dfa) {
+		printf("%s: compiled regex %d dfa %d\n", pattern, !!regex,
+		       !!dfa);
+		ok = false;
+		goto out;
+	}
+	if (!dfa)
+		goto out;
+
+	for (i = 0; path_tests[i]; i++) {
+		aspath = aspath_str2aspath(path_tests[i]);
+		assert(aspath);
+		if (bgp_regex_dfa_aspath(dfa, aspath)
+		    != (bgp_regexec(regex, aspath) != REG_NOMATCH)) {
+			printf("%s: differs on path \"%s\"\n", pattern,
+			       aspath->str);
+			ok = false;
+		}
+		aspath_free(aspath);
+	}
+
+	for (i = 0; str_tests[i]; i++) {
+		if (bgp_regex_dfa_str(dfa, str_tests[i])
+		    != (regexec(regex, str_tests[i], 0, NULL, 0) == 0)) {
+			printf("%s: differs on \"%s\"\n", pattern,
+			       str_tests[i]);
+			ok = false;
+		}
+	}
+
+out:
+	if (regex)
+		bgp_regex_free(regex);
+	if (dfa)
+		bgp_regex_dfa_free(dfa);
+	return ok;
+}
+
+/* Paths of 1 to 10 hops, every 16th one ends in an AS_SET. */
+static struct aspath **bench_paths(unsigned int count)
+{
+	static const as_t transit[] = {174, 1299, 2914, 3257, 3356, 6453, 6939};
+	struct aspath **paths;
+	char buf[256];
+	unsigned int i, j, len, hops;
+	as_t asn;
+
+	srandom(1);
+	paths = XCALLOC(MTYPE_TMP, count * sizeof(*paths));
+	for (i = 0; i < count; i++) {
+		hops = 1 + random() % 10;
+		len = 0;
+		for (j = 0; j < hops; j++) {
+			if (j && j < hops - 1)
+				asn = transit[random() % array_size(transit)];
+			else
+				asn = 64496 + random() % 1024;
+			len += snprintf(buf + len, sizeof(buf) - len, "%s%u",
+					j ? " " : "", asn);
+		}
+		if (i % 16 == 15)
+			snprintf(buf + len, sizeof(buf) - len, " {%u,%u}",
+				 64496 + i % 1024, 4200000000U + i);
+		paths[i] = aspath_str2aspath(buf);
+		assert(paths[i]);
+	}
+	return paths;
+}
+
+static void bench(unsigned int count, unsigned int rounds)
+{
+	static const char *const patterns[] = {
+		"_65001_", "^64[5-9][0-9][0-9]_", "_3356_.*_174_",
+		"^(64512|64513|64514)_([0-9]+_)*64600$",
+	};
+	struct aspath **paths = bench_paths(count);
+	struct bgp_regex_dfa *dfa;
+	struct timeval start;
+	unsigned int i, p, r, hits_re, hits_dfa;
+	int64_t usec_re, usec_dfa;
+	regex_t *regex;
+
+	for (p = 0; p < array_size(patterns); p++) {
+		regex = bgp_regcomp(patterns[p]);
+		dfa = bgp_regex_dfa_compile(patterns[p]);
+		assert(regex && dfa);
+
+		hits_re = hits_dfa = 0;
+		monotime(&start);
+		for (r = 0; r < rounds; r++)
+			for (i = 0; i < count; i++)
+				if (bgp_regexec(regex, paths[i])
+				    != REG_NOMATCH)
+					hits_re++;
+		usec_re = monotime_since(&start, NULL);
+
+		monotime(&start);
+		for (r = 0; r < rounds; r++)
+			for (i = 0; i < count; i++)
+				if (bgp_regex_dfa_aspath(dfa, paths[i]))
+					hits_dfa++;
+		usec_dfa = monotime_since(&start, NULL);
+
+		printf("%-40s regexec %8" PRId64 " us, dfa %8" PRId64
+		       " us, %u matches%s\n",
+		       patterns[p], usec_re, usec_dfa, hits_dfa / rounds,
+		       hits_re == hits_dfa ? "" : " (differ)");
+
+		bgp_regex_free(regex);
+		bgp_regex_dfa_free(dfa);
+	}
+
+	for (i = 0; i < count; i++)
+		aspath_free(paths[i]);
+	XFREE(MTYPE_TMP, paths);
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int count = 10000, rounds = 1;
+	bool ok;
+	int i, opt;
+
+	while ((opt = getopt(argc, argv, "n:r:")) != -1) {
+		switch (opt) {
+		case 'n':
+			count = strtoul(optarg, NULL, 10);
+			break;
+		case 'r':
+			rounds = strtoul(optarg, NULL, 10);
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-n PATHS] [-r ROUNDS]\n",
+				argv[0]);
+			return 1;
+		}
+	}
+
+	qobj_init();
+	master = thread_master_create(NULL);
+	bgp_master_init(master);
+	bgp_option_set(BGP_OPT_NO_LISTEN);
+	bgp_attr_init();
+
+	ok = true;
+	for (i = 0; regex_tests[i]; i++)
+		ok &= check_pattern(regex_tests[i], true);
+	check("regexp matching", ok);
+
+	ok = true;
+	for (i = 0; fallback_tests[i]; i++)
+		ok &= check_pattern(fallback_tests[i], false);
+	check("regexp fallback", ok);
+
+	if (count && rounds)
+		bench(count, rounds);
+
+	return 0;
+}
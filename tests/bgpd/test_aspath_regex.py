@@ -0,0 +1,7 @@
+import frrtest
+
+class TestAspathRegex(frrtest.TestMultiOut):
+    program = './test_aspath_regex'
+
+TestAspathRegex.okfail("regexp matching")
+TestAspathRegex.okfail("regexp fallback")
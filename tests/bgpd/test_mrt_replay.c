@@ -0,0 +1,1092 @@
+/*
+ * MRT replay harness and convergence benchmark for bgpd
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; see the file COPYING; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Feeds MRT dumps (RFC 6396) through bgp_attr_parse() and bgp_update() as
+ * if received from synthetic peers, without any sockets, then runs the
+ * bgp_process work queue until every prefix has its best path selected.
+ *
+ *   test_mrt_replay [-a ASN] [-B WORKERS] FILE...
+ *
+ * FILE may be "-" for stdin, e.g. "bzcat rib.bz2 | test_mrt_replay -".
+ * TABLE_DUMP_V2 RIB records for IPv4/IPv6 unicast and BGP4MP(_ET) UPDATE
+ * messages are replayed, both also in their ADD-PATH form (RFC 8050);
+ * other records, including BGP4MP state changes, are skipped.  Each file
+ * is reported on after it converged, so a RIB dump followed by update
+ * dumps shows the initial and the incremental convergence separately.
+ *
+ * Without FILE arguments, a small dump is generated, replayed with two
+ * best-path pthreads, and the resulting RIB is checked.
+ */
+
+#include <zebra.h>
+#include <sys/resource.h>
+
+#include "qobj.h"
+#include "vty.h"
+#include "stream.h"
+#include "privs.h"
+#include "memory.h"
+#include "queue.h"
+#include "filter.h"
+#include "hash.h"
+#include "jhash.h"
+#include "monotime.h"
+#include "frr_pthread.h"
+#include "workqueue.h"
+#include "zclient.h"
+
+#include "bgpd/bgpd.h"
+#include "bgpd/bgp_attr.h"
+#include "bgpd/bgp_aspath.h"
+#include "bgpd/bgp_dump.h"
+#include "bgpd/bgp_fsm.h"
+#include "bgpd/bgp_memory.h"
+#include "bgpd/bgp_packet.h"
+#include "bgpd/bgp_route.h"
+#include "bgpd/bgp_table.h"
+
+extern struct zclient *zclient;
+
+/* need these to link in libbgp */
+struct thread_master *master = NULL;
+struct zebra_privs_t bgpd_privs = {
+	.user = NULL,
+	.group = NULL,
+	.vty_group = NULL,
+};
+
+/* MRT values bgp_dump.h does not have */
+#define MRT_TABLE_DUMP_V2 13
+#define TABLE_DUMP_V2_RIB_IPV4_UNICAST_ADDPATH 8
+#define TABLE_DUMP_V2_RIB_IPV6_UNICAST_ADDPATH 10
+#define BGP4MP_MESSAGE_ADDPATH 8
+#define BGP4MP_MESSAGE_AS4_ADDPATH 9
+
+/* Local AS of the replay instance; reserved, so never seen in a dump */
+#define REPLAY_AS_DEFAULT 65535
+
+/* Synthetic peer, by address and AS */
+struct replay_peer {
+	union sockunion su;
+	as_t as;
+	struct peer *peer;
+};
+
+struct replay {
+	struct bgp *bgp;
+	struct hash *peers;
+
+	/* TABLE_DUMP_V2 peer index table */
+	struct peer **index;
+	unsigned int index_count;
+
+	/* current record, and RIB entry attributes rewritten for parsing */
+	struct stream *s;
+	struct stream *attrs;
+
+	uint64_t records;
+	uint64_t skipped;
+	uint64_t errors;
+	uint64_t announced;
+	uint64_t withdrawn;
+};
+
+/* All peers share one interface, for IPv6 link-local nexthops */
+static struct interface replay_ifp;
+
+static unsigned int replay_peer_hash(const void *data)
+{
+	const struct replay_peer *rp = data;
+
+	return jhash_1word(rp->as, sockunion_hash(&rp->su));
+}
+
+static bool replay_peer_cmp(const void *a, const void *b)
+{
+	const struct replay_peer *rpa = a, *rpb = b;
+
+	return rpa->as == rpb->as && sockunion_same(&rpa->su, &rpb->su);
+}
+
+static void *replay_peer_alloc(void *data)
+{
+	struct replay_peer *rp;
+
+	rp = XMALLOC(MTYPE_TMP, sizeof(*rp));
+	*rp = *(struct replay_peer *)data;
+	return rp;
+}
+
+static struct peer *replay_peer_get(struct replay *r, const union sockunion *su,
+				    as_t as, struct in_addr id)
+{
+	struct replay_peer key = {.su = *su, .as = as}, *rp;
+	struct peer *peer;
+	char buf[SU_ADDRSTRLEN];
+	afi_t afi;
+
+	rp = hash_get(r->peers, &key, replay_peer_alloc);
+	if (rp->peer)
+		return rp->peer;
+
+	peer = peer_create_accept(r->bgp);
+	peer->host = XSTRDUP(MTYPE_BGP_PEER_HOST,
+			     sockunion2str(su, buf, sizeof(buf)));
+	peer->su = *su;
+	peer->as = as;
+	peer->as_type = AS_SPECIFIED;
+	peer->local_as = r->bgp->as;
+	peer->remote_id = id;
+	peer->status = Established;
+	peer->nexthop.ifp = &replay_ifp;
+
+	for (afi = AFI_IP; afi <= AFI_IP6; afi++) {
+		peer->afc[afi][SAFI_UNICAST] = 1;
+		peer->afc_nego[afi][SAFI_UNICAST] = 1;
+	}
+	peer_sort(peer);
+
+	rp->peer = peer;
+	return peer;
+}
+
+/* Session capabilities the record was captured with */
+static void replay_peer_caps(struct peer *peer, afi_t afi, bool as4,
+			     bool addpath)
+{
+	if (as4)
+		SET_FLAG(peer->cap, PEER_CAP_AS4_RCV | PEER_CAP_AS4_ADV);
+	else
+		UNSET_FLAG(peer->cap, PEER_CAP_AS4_RCV | PEER_CAP_AS4_ADV);
+
+	if (addpath)
+		SET_FLAG(peer->af_cap[afi][SAFI_UNICAST],
+			 PEER_CAP_ADDPATH_AF_RX_ADV
+				 | PEER_CAP_ADDPATH_AF_TX_RCV);
+	else
+		UNSET_FLAG(peer->af_cap[afi][SAFI_UNICAST],
+			   PEER_CAP_ADDPATH_AF_RX_ADV
+				   | PEER_CAP_ADDPATH_AF_TX_RCV);
+}
+
+/*
+ * A collector keeps the session up after a malformed UPDATE, so the replay
+ * does too: drop the session reset bgp_attr_parse() may have queued.
+ */
+static void replay_peer_error(struct replay *r, struct peer *peer)
+{
+	r->errors++;
+	BGP_EVENT_FLUSH(peer);
+}
+
+/* Number of prefixes in an NLRI field */
+static unsigned int replay_nlri_count(const struct bgp_nlri *nlri,
+				      bool addpath)
+{
+	const uint8_t *pnt = nlri->nlri, *lim = pnt + nlri->length;
+	unsigned int count = 0;
+
+	while (pnt < lim) {
+		if (addpath)
+			pnt += BGP_ADDPATH_ID_LEN;
+		if (pnt >= lim)
+			break;
+		pnt += 1 + PSIZE(*pnt);
+		count++;
+	}
+	return count;
+}
+
+/*
+ * Parse 'length' bytes of attributes at the read pointer of 's' into
+ * 'attr', then pass each NLRI to bgp_nlri_parse().  The attribute part of
+ * bgp_update_receive(), without the session handling.
+ */
+static void replay_nlris(struct replay *r, struct peer *peer, struct stream *s,
+			 bgp_size_t length, struct bgp_nlri *nlris, int count,
+			 bool addpath)
+{
+	enum { NLRI_UPDATE, NLRI_WITHDRAW, NLRI_MP_UPDATE, NLRI_MP_WITHDRAW };
+	bgp_attr_parse_ret_t ret = BGP_ATTR_PARSE_PROCEED;
+	struct attr attr;
+	int i, withdraw;
+
+	memset(&attr, 0, sizeof(attr));
+	attr.label_index = BGP_INVALID_LABEL_INDEX;
+	attr.label = MPLS_INVALID_LABEL;
+
+	peer->curr = s;
+	if (length) {
+		ret = bgp_attr_parse(peer, &attr, length,
+				     &nlris[NLRI_MP_UPDATE],
+				     &nlris[NLRI_MP_WITHDRAW]);
+		if (ret == BGP_ATTR_PARSE_ERROR) {
+			bgp_attr_unintern_sub(&attr);
+			replay_peer_error(r, peer);
+			peer->curr = NULL;
+			return;
+		}
+	}
+
+	for (i = 0; i < count; i++) {
+		if (!nlris[i].nlri || !nlris[i].length)
+			continue;
+		if (!peer->afc[nlris[i].afi][nlris[i].safi]) {
+			r->skipped++;
+			continue;
+		}
+
+		withdraw = (i == NLRI_WITHDRAW || i == NLRI_MP_WITHDRAW);
+		if (withdraw)
+			r->withdrawn += replay_nlri_count(&nlris[i], addpath);
+		else
+			r->announced += replay_nlri_count(&nlris[i], addpath);
+
+		if (bgp_nlri_parse(peer,
+				   ret != BGP_ATTR_PARSE_WITHDRAW ? &attr
+								  : NULL,
+				   &nlris[i], withdraw)
+		    < BGP_NLRI_PARSE_OK)
+			replay_peer_error(r, peer);
+	}
+
+	bgp_attr_unintern_sub(&attr);
+	peer->curr = NULL;
+}
+
+/* BGP4MP(_ET) MESSAGE: replay it if it is an UPDATE */
+static int replay_bgp4mp(struct replay *r, uint16_t subtype)
+{
+	struct stream *s = r->s;
+	struct bgp_nlri nlris[4] = {};
+	union sockunion su = {};
+	struct in_addr id = {};
+	struct peer *peer;
+	bool as4, addpath;
+	uint32_t peer_as, local_as;
+	uint16_t ifindex, afi, length, wlen, alen;
+	uint8_t type;
+	size_t addrlen, end;
+
+	switch (subtype) {
+	case BGP4MP_MESSAGE:
+	case BGP4MP_MESSAGE_AS4:
+	case BGP4MP_MESSAGE_ADDPATH:
+	case BGP4MP_MESSAGE_AS4_ADDPATH:
+		break;
+	default:
+		r->skipped++;
+		return 0;
+	}
+	as4 = (subtype == BGP4MP_MESSAGE_AS4
+	       || subtype == BGP4MP_MESSAGE_AS4_ADDPATH);
+	addpath = (subtype == BGP4MP_MESSAGE_ADDPATH
+		   || subtype == BGP4MP_MESSAGE_AS4_ADDPATH);
+
+	if (as4) {
+		STREAM_GETL(s, peer_as);
+		STREAM_GETL(s, local_as);
+	} else {
+		STREAM_GETW(s, peer_as);
+		STREAM_GETW(s, local_as);
+	}
+	(void)local_as;
+	STREAM_GETW(s, ifindex);
+	(void)ifindex;
+	STREAM_GETW(s, afi);
+	switch (afi) {
+	case AFI_IP:
+		su.sin.sin_family = AF_INET;
+		STREAM_GET(&su.sin.sin_addr, s, IPV4_MAX_BYTELEN);
+		id = su.sin.sin_addr;
+		addrlen = IPV4_MAX_BYTELEN;
+		break;
+	case AFI_IP6:
+		su.sin6.sin6_family = AF_INET6;
+		STREAM_GET(&su.sin6.sin6_addr, s, IPV6_MAX_BYTELEN);
+		addrlen = IPV6_MAX_BYTELEN;
+		break;
+	default:
+		goto stream_failure;
+	}
+
+	/* local address, then the BGP message header */
+	if (STREAM_READABLE(s) < addrlen + BGP_HEADER_SIZE)
+		goto stream_failure;
+	stream_forward_getp(s, addrlen + BGP_MARKER_SIZE);
+
+	STREAM_GETW(s, length);
+	STREAM_GETC(s, type);
+	if (type != BGP_MSG_UPDATE) {
+		r->skipped++;
+		return 0;
+	}
+	if (length < BGP_HEADER_SIZE
+	    || STREAM_READABLE(s) < (size_t)(length - BGP_HEADER_SIZE))
+		goto stream_failure;
+	end = stream_get_getp(s) + length - BGP_HEADER_SIZE;
+
+	STREAM_GETW(s, wlen);
+	if (stream_get_getp(s) + wlen > end)
+		goto stream_failure;
+	nlris[1].afi = AFI_IP;
+	nlris[1].safi = SAFI_UNICAST;
+	nlris[1].nlri = stream_pnt(s);
+	nlris[1].length = wlen;
+	stream_forward_getp(s, wlen);
+
+	STREAM_GETW(s, alen);
+	if (stream_get_getp(s) + alen > end)
+		goto stream_failure;
+
+	nlris[0].afi = AFI_IP;
+	nlris[0].safi = SAFI_UNICAST;
+	nlris[0].nlri = stream_pnt(s) + alen;
+	nlris[0].length = end - stream_get_getp(s) - alen;
+
+	peer = replay_peer_get(r, &su, peer_as, id);
+	replay_peer_caps(peer, AFI_IP, as4, addpath);
+	replay_peer_caps(peer, AFI_IP6, as4, addpath);
+	replay_nlris(r, peer, s, alen, nlris, array_size(nlris), addpath);
+	return 0;
+
+stream_failure:
+	return -1;
+}
+
+/* TABLE_DUMP_V2 PEER_INDEX_TABLE */
+static int replay_peer_index(struct replay *r)
+{
+	struct stream *s = r->s;
+	union sockunion su;
+	struct in_addr id, collector;
+	uint16_t namelen, count, i;
+	uint32_t as;
+	uint8_t type;
+
+	STREAM_GET(&collector, s, IPV4_MAX_BYTELEN);
+	(void)collector;
+	STREAM_GETW(s, namelen);
+	if (STREAM_READABLE(s) < namelen)
+		goto stream_failure;
+	stream_forward_getp(s, namelen);
+	STREAM_GETW(s, count);
+
+	XFREE(MTYPE_TMP, r->index);
+	r->index = XCALLOC(MTYPE_TMP, count * sizeof(*r->index));
+	r->index_count = 0;
+
+	for (i = 0; i < count; i++) {
+		memset(&su, 0, sizeof(su));
+		STREAM_GETC(s, type);
+		STREAM_GET(&id, s, IPV4_MAX_BYTELEN);
+		if (type & TABLE_DUMP_V2_PEER_INDEX_TABLE_IP6) {
+			su.sin6.sin6_family = AF_INET6;
+			STREAM_GET(&su.sin6.sin6_addr, s, IPV6_MAX_BYTELEN);
+		} else {
+			su.sin.sin_family = AF_INET;
+			STREAM_GET(&su.sin.sin_addr, s, IPV4_MAX_BYTELEN);
+		}
+		if (type & TABLE_DUMP_V2_PEER_INDEX_TABLE_AS4) {
+			STREAM_GETL(s, as);
+		} else {
+			STREAM_GETW(s, as);
+		}
+
+		r->index[i] = replay_peer_get(r, &su, as, id);
+		r->index_count++;
+	}
+	return 0;
+
+stream_failure:
+	return -1;
+}
+
+/*
+ * Copy the attributes of a RIB entry to r->attrs, expanding the MP_REACH
+ * attribute, which only holds the nexthop in a dump, to a full one with
+ * the prefix as its NLRI.
+ */
+static int replay_rib_attrs(struct replay *r, uint16_t length,
+			    const uint8_t *nlri, size_t nlri_len)
+{
+	struct stream *s = r->s, *out = r->attrs;
+	size_t end = stream_get_getp(s) + length, lenp;
+	uint8_t flags, type, nhlen;
+	uint16_t len;
+
+	stream_reset(out);
+	while (stream_get_getp(s) < end) {
+		STREAM_GETC(s, flags);
+		STREAM_GETC(s, type);
+		if (CHECK_FLAG(flags, BGP_ATTR_FLAG_EXTLEN)) {
+			STREAM_GETW(s, len);
+		} else {
+			uint8_t len8;
+
+			STREAM_GETC(s, len8);
+			len = len8;
+		}
+		if (stream_get_getp(s) + len > end)
+			goto stream_failure;
+
+		if (type != BGP_ATTR_MP_REACH_NLRI) {
+			if (STREAM_WRITEABLE(out) < 4u + len)
+				goto stream_failure;
+			stream_putc(out, flags | BGP_ATTR_FLAG_EXTLEN);
+			stream_putc(out, type);
+			stream_putw(out, len);
+			stream_put(out, stream_pnt(s), len);
+			stream_forward_getp(s, len);
+			continue;
+		}
+
+		STREAM_GETC(s, nhlen);
+		if (nhlen + 1 != len || STREAM_WRITEABLE(out) < 9u + len + nlri_len)
+			goto stream_failure;
+		stream_putc(out, BGP_ATTR_FLAG_OPTIONAL | BGP_ATTR_FLAG_EXTLEN);
+		stream_putc(out, BGP_ATTR_MP_REACH_NLRI);
+		lenp = stream_get_endp(out);
+		stream_putw(out, 0);
+		stream_putw(out, IANA_AFI_IPV6);
+		stream_putc(out, IANA_SAFI_UNICAST);
+		stream_putc(out, nhlen);
+		stream_put(out, stream_pnt(s), nhlen);
+		stream_forward_getp(s, nhlen);
+		stream_putc(out, 0); /* reserved */
+		stream_put(out, nlri, nlri_len);
+		stream_putw_at(out, lenp, stream_get_endp(out) - lenp - 2);
+	}
+	return 0;
+
+stream_failure:
+	return -1;
+}
+
+/* TABLE_DUMP_V2 RIB_IPV4_UNICAST / RIB_IPV6_UNICAST and ADD-PATH forms */
+static int replay_rib(struct replay *r, afi_t afi, bool addpath)
+{
+	struct stream *s = r->s;
+	uint8_t nlri[BGP_ADDPATH_ID_LEN + 1 + IPV6_MAX_BYTELEN];
+	struct bgp_nlri nlris[4];
+	struct peer *peer;
+	uint32_t seq, originated, path_id = 0;
+	uint16_t count, i, idx, length;
+	uint8_t plen, psize, *pfx;
+	size_t next;
+
+	STREAM_GETL(s, seq);
+	(void)seq;
+	STREAM_GETC(s, plen);
+	if (plen > (afi == AFI_IP ? IPV4_MAX_BITLEN : IPV6_MAX_BITLEN))
+		goto stream_failure;
+	psize = PSIZE(plen);
+	pfx = &nlri[addpath ? BGP_ADDPATH_ID_LEN : 0];
+	pfx[0] = plen;
+	STREAM_GET(&pfx[1], s, psize);
+	STREAM_GETW(s, count);
+
+	for (i = 0; i < count; i++) {
+		STREAM_GETW(s, idx);
+		STREAM_GETL(s, originated);
+		(void)originated;
+		if (addpath) {
+			STREAM_GETL(s, path_id);
+			path_id = htonl(path_id);
+			memcpy(nlri, &path_id, BGP_ADDPATH_ID_LEN);
+		}
+		STREAM_GETW(s, length);
+		if (idx >= r->index_count || STREAM_READABLE(s) < length)
+			goto stream_failure;
+		next = stream_get_getp(s) + length;
+
+		peer = r->index[idx];
+		replay_peer_caps(peer, afi, true, addpath);
+
+		memset(nlris, 0, sizeof(nlris));
+		if (afi == AFI_IP) {
+			nlris[0].afi = AFI_IP;
+			nlris[0].safi = SAFI_UNICAST;
+			nlris[0].nlri = nlri;
+			nlris[0].length = pfx + 1 + psize - nlri;
+			replay_nlris(r, peer, s, length, nlris,
+				     array_size(nlris), addpath);
+		} else if (replay_rib_attrs(r, length, nlri,
+					    pfx + 1 + psize - nlri)
+			   == 0) {
+			replay_nlris(r, peer, r->attrs,
+				     stream_get_endp(r->attrs), nlris,
+				     array_size(nlris), addpath);
+		} else
+			r->errors++;
+
+		stream_set_getp(s, next);
+	}
+	return 0;
+
+stream_failure:
+	return -1;
+}
+
+static int replay_record(struct replay *r, uint16_t type, uint16_t subtype)
+{
+	switch (type) {
+	case MRT_TABLE_DUMP_V2:
+		switch (subtype) {
+		case TABLE_DUMP_V2_PEER_INDEX_TABLE:
+			return replay_peer_index(r);
+		case TABLE_DUMP_V2_RIB_IPV4_UNICAST:
+			return replay_rib(r, AFI_IP, false);
+		case TABLE_DUMP_V2_RIB_IPV6_UNICAST:
+			return replay_rib(r, AFI_IP6, false);
+		case TABLE_DUMP_V2_RIB_IPV4_UNICAST_ADDPATH:
+			return replay_rib(r, AFI_IP, true);
+		case TABLE_DUMP_V2_RIB_IPV6_UNICAST_ADDPATH:
+			return replay_rib(r, AFI_IP6, true);
+		}
+		break;
+	case MSG_PROTOCOL_BGP4MP_ET:
+		/* microsecond timestamp */
+		if (STREAM_READABLE(r->s) < 4)
+			return -1;
+		stream_forward_getp(r->s, 4);
+		/* fallthru */
+	case MSG_PROTOCOL_BGP4MP:
+		return replay_bgp4mp(r, subtype);
+	}
+
+	r->skipped++;
+	return 0;
+}
+
+static int replay_file(struct replay *r, FILE *fp)
+{
+	uint8_t hdr[BGP_DUMP_HEADER_SIZE];
+	uint16_t type, subtype;
+	uint32_t length;
+
+	while (fread(hdr, sizeof(hdr), 1, fp) == 1) {
+		type = (hdr[4] << 8) | hdr[5];
+		subtype = (hdr[6] << 8) | hdr[7];
+		length = ((uint32_t)hdr[8] << 24) | (hdr[9] << 16)
+			 | (hdr[10] << 8) | hdr[11];
+
+		stream_reset(r->s);
+		if (length > STREAM_SIZE(r->s))
+			stream_resize_inplace(&r->s, length);
+		if (length && fread(STREAM_DATA(r->s), length, 1, fp) != 1) {
+			fprintf(stderr, "truncated MRT record\n");
+			return -1;
+		}
+		stream_set_endp(r->s, length);
+
+		r->records++;
+		if (replay_record(r, type, subtype) < 0)
+			r->errors++;
+
+		/* let RCU free the attributes replaced meanwhile */
+		if (r->records % 1024 == 0) {
+			rcu_read_unlock();
+			rcu_read_lock();
+		}
+	}
+	return ferror(fp) ? -1 : 0;
+}
+
+/* Run the event loop until bgp_process() has nothing left to do */
+static void replay_converge(void)
+{
+	struct work_queue *wq = bm->process_main_queue;
+	struct thread thread;
+
+	while (work_queue_item_count(wq) && thread_fetch(master, &thread))
+		thread_call(&thread);
+}
+
+static void replay_report(struct replay *r, const char *name,
+			  int64_t load_us, int64_t converge_us,
+			  uint64_t announced, uint64_t created)
+{
+	struct rusage ru;
+	uint64_t routes = r->announced + r->withdrawn;
+
+	announced = r->announced - announced;
+	created = attr_created_count() - created;
+	getrusage(RUSAGE_SELF, &ru);
+
+	printf("%s: %" PRIu64 " records, %" PRIu64 " skipped, %" PRIu64
+	       " errors\n",
+	       name, r->records, r->skipped, r->errors);
+	printf("  routes:     %" PRIu64 " announced, %" PRIu64
+	       " withdrawn, %.0f routes/s\n",
+	       r->announced, r->withdrawn,
+	       load_us ? routes * 1000000.0 / load_us : 0.0);
+	printf("  best-path:  %lu IPv4 and %lu IPv6 prefixes, %.3f s after load, %.3f s total, %u bestpath workers\n",
+	       bgp_table_count(r->bgp->rib[AFI_IP][SAFI_UNICAST]),
+	       bgp_table_count(r->bgp->rib[AFI_IP6][SAFI_UNICAST]),
+	       converge_us / 1000000.0, (load_us + converge_us) / 1000000.0,
+	       bm->bestpath_workers);
+	printf("  attributes: %lu in use, %" PRIu64 " created, %.1f%% intern hits\n",
+	       attr_count(), created,
+	       announced && created <= announced
+		       ? 100.0 - created * 100.0 / announced
+		       : 0.0);
+	printf("  as-paths:   %lu in use\n", aspath_count());
+	printf("  paths:      %lu in use, %zu bytes held, %zu per path (struct is %zu)\n",
+	       bgp_path_info_count(), bgp_path_info_memory(),
+	       bgp_path_info_count()
+		       ? bgp_path_info_memory() / bgp_path_info_count()
+		       : 0,
+	       sizeof(struct bgp_path_info));
+	printf("  peak RSS:   %ld KiB\n", ru.ru_maxrss);
+}
+
+static int replay_run(struct replay *r, const char *name, FILE *fp)
+{
+	struct timeval start;
+	int64_t load_us, converge_us;
+	uint64_t announced = r->announced;
+	uint64_t created = attr_created_count();
+	int ret;
+
+	monotime(&start);
+	ret = replay_file(r, fp);
+	load_us = monotime_since(&start, NULL);
+
+	replay_converge();
+	converge_us = monotime_since(&start, NULL) - load_us;
+
+	replay_report(r, name, load_us, converge_us, announced, created);
+	return ret;
+}
+
+/*
+ * Self test: a generated dump from four peers
+ */
+#define GEN_V4_PREFIXES 1000
+#define GEN_V6_PREFIXES 200
+#define GEN_WITHDRAWN 100
+#define GEN_ANNOUNCED 100
+
+static const struct {
+	const char *addr;
+	as_t as;
+	const char *id;
+} gen_peers[] = {
+	{"192.0.2.1", 64501, "10.255.0.1"},
+	{"192.0.2.2", 64502, "10.255.0.2"},
+	{"192.0.2.3", 64503, "10.255.0.3"},
+	{"2001:db8::4", 64504, "10.255.0.4"},
+};
+
+static void gen_header(struct stream *s, uint16_t type, uint16_t subtype)
+{
+	stream_reset(s);
+	stream_putl(s, 0); /* timestamp */
+	stream_putw(s, type);
+	stream_putw(s, subtype);
+	stream_putl(s, 0); /* length */
+}
+
+static void gen_write(struct stream *s, FILE *fp)
+{
+	stream_putl_at(s, 8, stream_get_endp(s) - BGP_DUMP_HEADER_SIZE);
+	fwrite(STREAM_DATA(s), stream_get_endp(s), 1, fp);
+}
+
+/* ORIGIN, a 4-byte AS_PATH of 'first' prepended 'prepend' times and 'last' */
+static void gen_attrs(struct stream *s, as_t first, int prepend, as_t last)
+{
+	int i;
+
+	stream_putc(s, BGP_ATTR_FLAG_TRANS);
+	stream_putc(s, BGP_ATTR_ORIGIN);
+	stream_putc(s, 1);
+	stream_putc(s, BGP_ORIGIN_IGP);
+
+	stream_putc(s, BGP_ATTR_FLAG_TRANS);
+	stream_putc(s, BGP_ATTR_AS_PATH);
+	stream_putc(s, 2 + (prepend + 2) * 4);
+	stream_putc(s, AS_SEQUENCE);
+	stream_putc(s, prepend + 2);
+	for (i = 0; i <= prepend; i++)
+		stream_putl(s, first);
+	stream_putl(s, last);
+}
+
+static void gen_nexthop(struct stream *s, const char *addr)
+{
+	struct in_addr nh;
+
+	inet_pton(AF_INET, addr, &nh);
+	stream_putc(s, BGP_ATTR_FLAG_TRANS);
+	stream_putc(s, BGP_ATTR_NEXT_HOP);
+	stream_putc(s, IPV4_MAX_BYTELEN);
+	stream_put_in_addr(s, &nh);
+}
+
+static void gen_table_dump(FILE *fp)
+{
+	struct stream *s = stream_new(BGP_MAX_PACKET_SIZE);
+	struct in6_addr nh6;
+	struct in_addr addr;
+	size_t attrp;
+	unsigned int i, p;
+
+	gen_header(s, MRT_TABLE_DUMP_V2, TABLE_DUMP_V2_PEER_INDEX_TABLE);
+	stream_putl(s, 0); /* collector id */
+	stream_putw(s, 0); /* view name */
+	stream_putw(s, array_size(gen_peers));
+	for (p = 0; p < array_size(gen_peers); p++) {
+		bool v6 = strchr(gen_peers[p].addr, ':') != NULL;
+
+		stream_putc(s, TABLE_DUMP_V2_PEER_INDEX_TABLE_AS4
+				       | (v6 ? TABLE_DUMP_V2_PEER_INDEX_TABLE_IP6
+					     : TABLE_DUMP_V2_PEER_INDEX_TABLE_IP));
+		inet_pton(AF_INET, gen_peers[p].id, &addr);
+		stream_put_in_addr(s, &addr);
+		if (v6) {
+			inet_pton(AF_INET6, gen_peers[p].addr, &nh6);
+			stream_put(s, &nh6, IPV6_MAX_BYTELEN);
+		} else {
+			inet_pton(AF_INET, gen_peers[p].addr, &addr);
+			stream_put_in_addr(s, &addr);
+		}
+		stream_putl(s, gen_peers[p].as);
+	}
+	gen_write(s, fp);
+
+	/* 10.x.y.0/24 from the IPv4 peers, AS_PATH one longer for each */
+	for (i = 0; i < GEN_V4_PREFIXES; i++) {
+		gen_header(s, MRT_TABLE_DUMP_V2,
+			   TABLE_DUMP_V2_RIB_IPV4_UNICAST);
+		stream_putl(s, i);
+		stream_putc(s, 24);
+		stream_putc(s, 10);
+		stream_putc(s, i >> 8);
+		stream_putc(s, i & 0xff);
+		stream_putw(s, 3);
+		for (p = 0; p < 3; p++) {
+			stream_putw(s, p);
+			stream_putl(s, 0);
+			attrp = stream_get_endp(s);
+			stream_putw(s, 0);
+			gen_attrs(s, gen_peers[p].as, p, 65000 + i % 10);
+			gen_nexthop(s, gen_peers[p].addr);
+			stream_putw_at(s, attrp, stream_get_endp(s) - attrp - 2);
+		}
+		gen_write(s, fp);
+	}
+
+	/* 2001:db8:x::/48 from the IPv6 peer */
+	inet_pton(AF_INET6, gen_peers[3].addr, &nh6);
+	for (i = 0; i < GEN_V6_PREFIXES; i++) {
+		gen_header(s, MRT_TABLE_DUMP_V2,
+			   TABLE_DUMP_V2_RIB_IPV6_UNICAST);
+		stream_putl(s, GEN_V4_PREFIXES + i);
+		stream_putc(s, 48);
+		stream_putw(s, 0x2001);
+		stream_putw(s, 0x0db8);
+		stream_putw(s, i);
+		stream_putw(s, 1);
+		stream_putw(s, 3);
+		stream_putl(s, 0);
+		attrp = stream_get_endp(s);
+		stream_putw(s, 0);
+		gen_attrs(s, gen_peers[3].as, 0, 65000 + i % 10);
+		stream_putc(s, BGP_ATTR_FLAG_OPTIONAL);
+		stream_putc(s, BGP_ATTR_MP_REACH_NLRI);
+		stream_putc(s, 1 + IPV6_MAX_BYTELEN);
+		stream_putc(s, IPV6_MAX_BYTELEN);
+		stream_put(s, &nh6, IPV6_MAX_BYTELEN);
+		stream_putw_at(s, attrp, stream_get_endp(s) - attrp - 2);
+		gen_write(s, fp);
+	}
+
+	stream_free(s);
+}
+
+/* BGP4MP_MESSAGE_AS4 header and UPDATE header from an IPv4 peer */
+static size_t gen_bgp4mp_update(struct stream *s, unsigned int p)
+{
+	struct in_addr addr;
+	size_t lenp;
+	int i;
+
+	gen_header(s, MSG_PROTOCOL_BGP4MP, BGP4MP_MESSAGE_AS4);
+	stream_putl(s, gen_peers[p].as);
+	stream_putl(s, REPLAY_AS_DEFAULT);
+	stream_putw(s, 0);
+	stream_putw(s, AFI_IP);
+	inet_pton(AF_INET, gen_peers[p].addr, &addr);
+	stream_put_in_addr(s, &addr);
+	stream_putl(s, 0);
+
+	for (i = 0; i < BGP_MARKER_SIZE; i++)
+		stream_putc(s, 0xff);
+	lenp = stream_get_endp(s);
+	stream_putw(s, 0);
+	stream_putc(s, BGP_MSG_UPDATE);
+	return lenp;
+}
+
+static void gen_updates(FILE *fp)
+{
+	struct stream *s = stream_new(BGP_MAX_PACKET_SIZE);
+	size_t lenp, attrp;
+	unsigned int i;
+
+	/* peer 0 withdraws the first 10.x.y.0/24 */
+	lenp = gen_bgp4mp_update(s, 0);
+	stream_putw(s, GEN_WITHDRAWN * 4);
+	for (i = 0; i < GEN_WITHDRAWN; i++) {
+		stream_putc(s, 24);
+		stream_putc(s, 10);
+		stream_putc(s, i >> 8);
+		stream_putc(s, i & 0xff);
+	}
+	stream_putw(s, 0);
+	stream_putw_at(s, lenp, stream_get_endp(s) - lenp + BGP_MARKER_SIZE);
+	gen_write(s, fp);
+
+	/* peer 1 announces 172.16.x.0/24 */
+	lenp = gen_bgp4mp_update(s, 1);
+	stream_putw(s, 0);
+	attrp = stream_get_endp(s);
+	stream_putw(s, 0);
+	gen_attrs(s, gen_peers[1].as, 0, 65010);
+	gen_nexthop(s, gen_peers[1].addr);
+	stream_putw_at(s, attrp, stream_get_endp(s) - attrp - 2);
+	for (i = 0; i < GEN_ANNOUNCED; i++) {
+		stream_putc(s, 24);
+		stream_putc(s, 172);
+		stream_putc(s, 16);
+		stream_putc(s, i);
+	}
+	stream_putw_at(s, lenp, stream_get_endp(s) - lenp + BGP_MARKER_SIZE);
+	gen_write(s, fp);
+
+	stream_free(s);
+}
+
+static struct bgp_path_info *gen_best(struct bgp *bgp, afi_t afi,
+				      const char *pfx)
+{
+	struct bgp_path_info *pi;
+	struct bgp_node *rn;
+	struct prefix p;
+
+	str2prefix(pfx, &p);
+	rn = bgp_node_lookup(bgp->rib[afi][SAFI_UNICAST], &p);
+	if (!rn)
+		return NULL;
+	bgp_unlock_node(rn);
+
+	for (pi = bgp_node_get_bgp_path_info(rn); pi; pi = pi->next)
+		if (CHECK_FLAG(pi->flags, BGP_PATH_SELECTED))
+			return pi;
+	return NULL;
+}
+
+static bool gen_best_is(struct bgp *bgp, afi_t afi, const char *pfx,
+			unsigned int p)
+{
+	struct bgp_path_info *pi = gen_best(bgp, afi, pfx);
+
+	return pi && pi->peer->as == gen_peers[p].as;
+}
+
+static void gen_check(const char *name, bool ok)
+{
+	printf("%s: %s\n", name, ok ? "OK" : "failed");
+}
+
+static int self_test(struct replay *r)
+{
+	struct bgp_path_info *pi;
+	struct in6_addr nh6;
+	uint64_t created = attr_created_count();
+	char pfx[PREFIX_STRLEN];
+	unsigned int i;
+	bool ok;
+	FILE *fp;
+	int ret = 0;
+
+	fp = tmpfile();
+	gen_table_dump(fp);
+	rewind(fp);
+	ret |= replay_run(r, "generated table dump", fp);
+	fclose(fp);
+
+	ok = r->index_count == array_size(gen_peers);
+	for (i = 0; ok && i < r->index_count; i++)
+		ok = r->index[i]->as == gen_peers[i].as;
+	gen_check("peer index table", ok);
+
+	ok = bgp_table_count(r->bgp->rib[AFI_IP][SAFI_UNICAST])
+	     == GEN_V4_PREFIXES;
+	for (i = 0; ok && i < GEN_V4_PREFIXES; i++) {
+		snprintf(pfx, sizeof(pfx), "10.%u.%u.0/24", i >> 8, i & 0xff);
+		ok = gen_best_is(r->bgp, AFI_IP, pfx, 0);
+	}
+	gen_check("ipv4 table dump", ok);
+
+	inet_pton(AF_INET6, gen_peers[3].addr, &nh6);
+	ok = bgp_table_count(r->bgp->rib[AFI_IP6][SAFI_UNICAST])
+	     == GEN_V6_PREFIXES;
+	for (i = 0; ok && i < GEN_V6_PREFIXES; i++) {
+		snprintf(pfx, sizeof(pfx), "2001:db8:%x::/48", i);
+		pi = gen_best(r->bgp, AFI_IP6, pfx);
+		ok = pi && pi->peer->as == gen_peers[3].as
+		     && IPV6_ADDR_SAME(&pi->attr->mp_nexthop_global, &nh6);
+	}
+	gen_check("ipv6 table dump", ok);
+
+	/* 10 distinct AS_PATHs per peer */
+	gen_check("attribute interning",
+		  attr_created_count() - created == 10 * array_size(gen_peers));
+
+	fp = tmpfile();
+	gen_updates(fp);
+	rewind(fp);
+	ret |= replay_run(r, "generated updates", fp);
+	fclose(fp);
+
+	ok = r->index[0]->pcount[AFI_IP][SAFI_UNICAST]
+	     == GEN_V4_PREFIXES - GEN_WITHDRAWN;
+	for (i = 0; ok && i < GEN_V4_PREFIXES; i++) {
+		snprintf(pfx, sizeof(pfx), "10.%u.%u.0/24", i >> 8, i & 0xff);
+		ok = gen_best_is(r->bgp, AFI_IP, pfx,
+				 i < GEN_WITHDRAWN ? 1 : 0);
+	}
+	gen_check("bgp4mp withdrawals", ok);
+
+	ok = bgp_table_count(r->bgp->rib[AFI_IP][SAFI_UNICAST])
+	     == GEN_V4_PREFIXES + GEN_ANNOUNCED;
+	for (i = 0; ok && i < GEN_ANNOUNCED; i++) {
+		snprintf(pfx, sizeof(pfx), "172.16.%u.0/24", i);
+		ok = gen_best_is(r->bgp, AFI_IP, pfx, 1);
+	}
+	gen_check("bgp4mp announcements", ok);
+
+	gen_check("replay errors", ret == 0 && r->errors == 0);
+	return ret;
+}
+
+static void replay_pthreads_start(unsigned int workers)
+{
+	unsigned int i;
+
+	bm->bestpath_workers = workers;
+	for (i = 0; i < workers; i++) {
+		struct frr_pthread_attr bestpath = {
+			.start = frr_pthread_attr_default.start,
+			.stop = frr_pthread_attr_default.stop,
+		};
+		char name[32], os_name[OS_THREAD_NAMELEN];
+
+		snprintf(name, sizeof(name), "BGP bestpath thread %u", i);
+		snprintf(os_name, sizeof(os_name), "bgpd_bestpath%u", i);
+		bgp_pth_bestpath[i] = frr_pthread_new(&bestpath, name, os_name);
+		frr_pthread_run(bgp_pth_bestpath[i], NULL);
+	}
+	for (i = 0; i < workers; i++)
+		frr_pthread_wait_running(bgp_pth_bestpath[i]);
+}
+
+static void usage(const char *progname)
+{
+	fprintf(stderr,
+		"usage: %s [-a ASN] [-B WORKERS] [FILE...]\n"
+		"  -a  local AS of the replay instance (default %u)\n"
+		"  -B  best-path pthreads, 0 to %u (default 0)\n"
+		"Without FILE, a generated dump is replayed and checked.\n",
+		progname, REPLAY_AS_DEFAULT, BGP_BESTPATH_WORKERS_MAX);
+	exit(1);
+}
+
+int main(int argc, char **argv)
+{
+	struct replay r = {};
+	as_t asn = REPLAY_AS_DEFAULT;
+	int workers = -1, opt, i, ret = 0;
+	FILE *fp;
+
+	while ((opt = getopt(argc, argv, "a:B:")) != -1) {
+		switch (opt) {
+		case 'a':
+			asn = strtoul(optarg, NULL, 10);
+			break;
+		case 'B':
+			workers = atoi(optarg);
+			if (workers < 0 || workers > BGP_BESTPATH_WORKERS_MAX)
+				usage(argv[0]);
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+
+	qobj_init();
+	master = thread_master_create(NULL);
+	zclient = zclient_new(master, &zclient_options_default);
+	bgp_master_init(master);
+	vrf_init(NULL, NULL, NULL, NULL, NULL);
+	bgp_option_set(BGP_OPT_NO_LISTEN);
+	bgp_attr_init();
+	frr_pthread_init();
+
+	/* the self test covers parallel best-path selection too */
+	if (workers < 0)
+		workers = optind < argc ? 0 : 2;
+	replay_pthreads_start(workers);
+
+	if (bgp_get(&r.bgp, &asn, NULL, BGP_INSTANCE_TYPE_DEFAULT)) {
+		fprintf(stderr, "cannot create BGP instance\n");
+		return 1;
+	}
+	r.peers = hash_create(replay_peer_hash, replay_peer_cmp,
+			      "MRT replay peers");
+	r.s = stream_new(BGP_MAX_PACKET_SIZE);
+	r.attrs = stream_new(BGP_MAX_PACKET_SIZE);
+	replay_ifp.ifindex = 0;
+
+	if (optind == argc)
+		ret = self_test(&r);
+
+	for (i = optind; i < argc; i++) {
+		if (strcmp(argv[i], "-"))
+			fp = fopen(argv[i], "r");
+		else
+			fp = stdin;
+		if (!fp) {
+			fprintf(stderr, "%s: %s\n", argv[i],
+				safe_strerror(errno));
+			ret = 1;
+			continue;
+		}
+		if (replay_run(&r, argv[i], fp) < 0)
+			ret = 1;
+		if (fp != stdin)
+			fclose(fp);
+	}
+
+	frr_pthread_stop_all();
+	return ret ? 1 : 0;
+}
@@ -0,0 +1,12 @@
+import frrtest
+
+class TestMrtReplay(frrtest.TestMultiOut):
+    program = './test_mrt_replay'
+
+TestMrtReplay.okfail("peer index table")
+TestMrtReplay.okfail("ipv4 table dump")
+TestMrtReplay.okfail("ipv6 table dump")
+TestMrtReplay.okfail("attribute interning")
+TestMrtReplay.okfail("bgp4mp withdrawals")
+TestMrtReplay.okfail("bgp4mp announcements")
+TestMrtReplay.okfail("replay errors")
@@ -0,0 +1,202 @@
+/*
+ * BGP route-map result cache tests
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; see the file COPYING; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Runs paths through bgp_route_map_apply_cached(), telling cache hits from
+ * misses by whether the route-map itself was applied.
+ */
+
+#include <zebra.h>
+
+#include "command.h"
+#include "frr_pthread.h"
+#include "memory.h"
+#include "northbound.h"
+#include "prefix.h"
+#include "privs.h"
+#include "routemap.h"
+#include "vrf.h"
+#include "vty.h"
+
+#include "bgpd/bgpd.h"
+#include "bgpd/bgp_attr.h"
+#include "bgpd/bgp_aspath.h"
+#include "bgpd/bgp_route.h"
+
+/* need these to link in libbgp */
+struct zebra_privs_t bgpd_privs = {0};
+struct thread_master *master;
+
+static struct vty *vty;
+static int failed;
+
+static void config(const char *cmd)
+{
+	vector vline;
+	int ret;
+
+	vline = cmd_make_strvec(cmd);
+	ret = cmd_execute_command(vline, vty, NULL, 0);
+	cmd_free_strvec(vline);
+
+	if (ret != CMD_SUCCESS) {
+		printf("command \"%s\" failed: %d\n", cmd, ret);
+		failed++;
+	}
+}
+
+static void check(const char *name, bool ok)
+{
+	printf("%s: %s\n", name, ok ? "OK" : "failed");
+	if (!ok)
+		failed++;
+}
+
+/* Apply map to a path with the given local-pref; returns the MED set */
+static route_map_result_t apply(struct bgp_rmap_cache **cache,
+				struct route_map *map, uint32_t local_pref,
+				uint32_t *med)
+{
+	struct bgp_path_info path = {};
+	struct attr attr;
+	struct aspath *aspath;
+	struct prefix p;
+	route_map_result_t ret;
+
+	str2prefix("10.0.0.0/24", &p);
+	bgp_attr_default_set(&attr, BGP_ORIGIN_IGP);
+	attr.local_pref = local_pref;
+	attr.flag |= ATTR_FLAG_BIT(BGP_ATTR_LOCAL_PREF);
+	aspath = attr.aspath;
+	path.attr = &attr;
+
+	ret = bgp_route_map_apply_cached(cache, map, &p, &path);
+
+	*med = attr.med;
+	aspath_unintern(&aspath);
+	return ret;
+}
+
+static void test_cache(void)
+{
+	struct bgp_rmap_cache *cache = NULL;
+	struct route_map *map;
+	uint64_t applied;
+	uint32_t med;
+
+	vty->node = CONFIG_NODE;
+	config("route-map RM-ATTR permit 10");
+	config("match local-preference 100");
+	config("set metric 50");
+
+	map = route_map_lookup_by_name("RM-ATTR");
+	if (!map) {
+		check("route-map created", false);
+		return;
+	}
+
+	applied = map->applied;
+	check("permit miss", apply(&cache, map, 100, &med) == RMAP_PERMITMATCH
+				     && med == 50
+				     && map->applied == applied + 1);
+
+	applied = map->applied;
+	check("permit hit", apply(&cache, map, 100, &med) == RMAP_PERMITMATCH
+				    && med == 50 && map->applied == applied);
+
+	applied = map->applied;
+	check("deny miss", apply(&cache, map, 200, &med) == RMAP_DENYMATCH
+				   && map->applied == applied + 1);
+
+	applied = map->applied;
+	check("deny hit", apply(&cache, map, 200, &med) == RMAP_DENYMATCH
+				  && map->applied == applied);
+
+	/* Any change to the route-map bumps its version */
+	config("set metric 60");
+	applied = map->applied;
+	check("changed route-map",
+	      apply(&cache, map, 100, &med) == RMAP_PERMITMATCH && med == 60
+		      && map->applied == applied + 1);
+
+	/* So does a change to something it uses */
+	route_map_mark_updated("RM-ATTR");
+	applied = map->applied;
+	check("updated route-map",
+	      apply(&cache, map, 100, &med) == RMAP_PERMITMATCH && med == 60
+		      && map->applied == applied + 1);
+
+	bgp_rmap_cache_free(&cache);
+	check("cache freed", cache == NULL);
+}
+
+static void test_uncacheable(void)
+{
+	struct bgp_rmap_cache *cache = NULL;
+	struct route_map *map;
+	uint64_t applied;
+	uint32_t med;
+
+	/* Matches on the prefix give a result per prefix, not per attr */
+	vty->node = CONFIG_NODE;
+	config("ip prefix-list PL seq 5 permit 10.0.0.0/8 le 32");
+	config("route-map RM-PLIST permit 10");
+	config("match ip address prefix-list PL");
+	config("set metric 70");
+
+	map = route_map_lookup_by_name("RM-PLIST");
+	if (!map) {
+		check("route-map created", false);
+		return;
+	}
+
+	applied = map->applied;
+	apply(&cache, map, 100, &med);
+	check("uncacheable rule",
+	      apply(&cache, map, 100, &med) == RMAP_PERMITMATCH && med == 70
+		      && map->applied == applied + 2);
+
+	bgp_rmap_cache_free(&cache);
+}
+
+int main(void)
+{
+	cmd_init(1);
+	openzlog("testbgpd", "NONE", 0, LOG_CONS | LOG_NDELAY | LOG_PID,
+		 LOG_DAEMON);
+	zprivs_preinit(&bgpd_privs);
+	zprivs_init(&bgpd_privs);
+
+	master = thread_master_create(NULL);
+	yang_init();
+	nb_init(master, NULL, 0);
+	bgp_master_init(master);
+	bgp_option_set(BGP_OPT_NO_LISTEN);
+	vrf_init(NULL, NULL, NULL, NULL, NULL);
+	frr_pthread_init();
+	bgp_init(0);
+
+	vty = vty_new();
+	vty->type = VTY_TERM;
+
+	test_cache();
+	test_uncacheable();
+
+	vty_close(vty);
+	return failed ? 1 : 0;
+}
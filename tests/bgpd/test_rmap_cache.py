@@ -0,0 +1,13 @@
+import frrtest
+
+class TestRmapCache(frrtest.TestMultiOut):
+    program = './test_rmap_cache'
+
+TestRmapCache.okfail("permit miss")
+TestRmapCache.okfail("permit hit")
+TestRmapCache.okfail("deny miss")
+TestRmapCache.okfail("deny hit")
+TestRmapCache.okfail("changed route-map")
+TestRmapCache.okfail("updated route-map")
+TestRmapCache.okfail("cache freed")
+TestRmapCache.okfail("uncacheable rule")
@@ -0,0 +1,195 @@
+/*
+ * Test program for the concurrent intern hash table: checks interning and
+ * releasing on one pthread, across several array growths, then hammers a
+ * small set of values from several pthreads at once.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; see the file COPYING; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <zebra.h>
+
+#include "chash.h"
+#include "jhash.h"
+#include "memory.h"
+#include "prng.h"
+
+DEFINE_MGROUP(TEST_CHASH, "chash test")
+DEFINE_MTYPE_STATIC(TEST_CHASH, ITEM, "test item")
+
+#define NVALS 20000
+#define NTHREADS 4
+#define THREAD_OPS 200000
+#define THREAD_VALS 512
+#define THREAD_HELD 64
+
+struct item {
+	uint32_t val;
+	_Atomic unsigned long refcnt;
+	struct rcu_head rcu_head;
+};
+
+static struct chash *table;
+static _Atomic unsigned long allocs;
+
+static unsigned int item_hash(const void *arg)
+{
+	const struct item *item = arg;
+
+	return jhash_1word(item->val, 0x7e57);
+}
+
+static bool item_cmp(const void *a, const void *b)
+{
+	const struct item *ia = a, *ib = b;
+
+	return ia->val == ib->val;
+}
+
+static void *item_alloc(void *arg)
+{
+	struct item *key = arg, *item;
+
+	item = XCALLOC(MTYPE_ITEM, sizeof(*item));
+	item->val = key->val;
+	atomic_fetch_add_explicit(&allocs, 1, memory_order_relaxed);
+	return item;
+}
+
+static void item_free(void *arg)
+{
+	XFREE(MTYPE_ITEM, arg);
+}
+
+static struct item *intern(uint32_t val)
+{
+	struct item key = {.val = val};
+	struct item *item;
+
+	item = chash_intern(table, &key, item_alloc);
+	assert(item->val == val);
+	return item;
+}
+
+static void release(struct item *item)
+{
+	if (chash_release(table, item))
+		rcu_free(MTYPE_ITEM, item, rcu_head);
+}
+
+static void count_iter(void *data, void *arg)
+{
+	(*(unsigned long *)arg)++;
+}
+
+static void single_thread(void)
+{
+	static struct item *items[NVALS];
+	unsigned long n = 0;
+	uint32_t i;
+
+	for (i = 0; i < NVALS; i++)
+		items[i] = intern(i);
+	assert(chash_count(table) == NVALS);
+
+	for (i = 0; i < NVALS; i++) {
+		assert(intern(i) == items[i]);
+		assert(items[i]->refcnt == 2);
+		assert(chash_lookup(table, items[i]) == items[i]);
+	}
+
+	chash_iterate(table, count_iter, &n);
+	assert(n == NVALS);
+
+	for (i = 0; i < NVALS; i++)
+		release(items[i]);
+	assert(chash_count(table) == NVALS);
+
+	for (i = 0; i < NVALS; i++) {
+		struct item key = {.val = i};
+
+		release(items[i]);
+		assert(!chash_lookup(table, &key));
+	}
+	assert(chash_count(table) == 0);
+
+	printf("single pthread: %u values, %lu allocations\n", NVALS,
+	       (unsigned long)allocs);
+}
+
+struct testthread {
+	pthread_t pt;
+	struct rcu_thread *rcu;
+	uint64_t seed;
+};
+
+static void *thread_func(void *arg)
+{
+	struct testthread *tt = arg;
+	struct item *held[THREAD_HELD] = {};
+	struct prng *prng;
+	unsigned int i, slot;
+
+	rcu_thread_start(tt->rcu);
+	prng = prng_new(tt->seed);
+
+	for (i = 0; i < THREAD_OPS; i++) {
+		slot = prng_rand(prng) % THREAD_HELD;
+		if (held[slot])
+			release(held[slot]);
+		held[slot] = intern(prng_rand(prng) % THREAD_VALS);
+
+		/* let deferred frees through now and then */
+		if (i % 1024 == 0) {
+			rcu_read_unlock();
+			rcu_read_lock();
+		}
+	}
+
+	for (slot = 0; slot < THREAD_HELD; slot++)
+		if (held[slot])
+			release(held[slot]);
+
+	prng_free(prng);
+	return NULL;
+}
+
+static void multi_thread(void)
+{
+	struct testthread tt[NTHREADS];
+	unsigned int i;
+
+	for (i = 0; i < NTHREADS; i++) {
+		tt[i].rcu = rcu_thread_prepare();
+		tt[i].seed = i + 1;
+		pthread_create(&tt[i].pt, NULL, thread_func, &tt[i]);
+	}
+	for (i = 0; i < NTHREADS; i++)
+		pthread_join(tt[i].pt, NULL);
+
+	assert(chash_count(table) == 0);
+	printf("%u pthreads: %u operations each\n", NTHREADS, THREAD_OPS);
+}
+
+int main(int argc, char **argv)
+{
+	table = chash_create(item_hash, item_cmp,
+			     offsetof(struct item, refcnt), "test");
+
+	single_thread();
+	multi_thread();
+
+	chash_free(table, item_free);
+	return 0;
+}
@@ -0,0 +1,6 @@
+import frrtest
+
+class TestChash(frrtest.TestMultiOut):
+    program = './test_chash'
+
+TestChash.exit_cleanly()
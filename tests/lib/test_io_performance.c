@@ -0,0 +1,139 @@
+/*
+ * Test program which measures thread_fetch() latency for I/O tasks
+ * against the number of file descriptors being watched, for each
+ * available I/O backend.
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; see the file COPYING; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <zebra.h>
+
+#include <stdio.h>
+#include <unistd.h>
+#include <sys/resource.h>
+
+#include "thread.h"
+#include "prng.h"
+
+#define FETCH_ROUNDS 20000
+
+static const char *const backends[] = {"poll", "epoll"};
+static const unsigned int fd_counts[] = {16, 128, 1024, 4096, 16384};
+
+struct thread_master *master;
+
+static int read_func(struct thread *thread)
+{
+	int fd = THREAD_FD(thread);
+	char buf[16];
+
+	if (read(fd, buf, sizeof(buf)) < 0)
+		perror("read");
+
+	/* re-arm, as a socket reader would */
+	thread_add_read(master, read_func, NULL, fd, NULL);
+	return 0;
+}
+
+static void poke(int fd)
+{
+	if (write(fd, "x", 1) != 1) {
+		perror("write");
+		exit(1);
+	}
+}
+
+static void run(const char *backend, unsigned int count, struct prng *prng)
+{
+	struct timeval tv_start, tv_stop;
+	struct thread thread;
+	int (*pipes)[2];
+	unsigned long usec;
+	unsigned int i;
+
+	thread_io_backend_set(backend);
+	master = thread_master_create(NULL);
+	master->handle_signals = false;
+
+	pipes = calloc(count, sizeof(*pipes));
+	for (i = 0; i < count; i++) {
+		if (pipe(pipes[i]) < 0) {
+			perror("pipe");
+			exit(1);
+		}
+		thread_add_read(master, read_func, NULL, pipes[i][0], NULL);
+	}
+
+	/* one idle round trip to settle backend state */
+	poke(pipes[0][1]);
+	thread_fetch(master, &thread);
+	thread_call(&thread);
+
+	monotime(&tv_start);
+	for (i = 0; i < FETCH_ROUNDS; i++) {
+		unsigned int idx = prng_rand(prng) % count;
+
+		poke(pipes[idx][1]);
+		if (!thread_fetch(master, &thread)) {
+			fprintf(stderr, "thread_fetch() failed\n");
+			exit(1);
+		}
+		thread_call(&thread);
+	}
+	monotime(&tv_stop);
+
+	usec = 1000000 * (tv_stop.tv_sec - tv_start.tv_sec);
+	usec += tv_stop.tv_usec - tv_start.tv_usec;
+
+	printf("%-6s %6u fds: %8.2f usec per fetch (%s)\n", backend, count,
+	       (double)usec / FETCH_ROUNDS, thread_io_backend_name(master));
+	fflush(stdout);
+
+	for (i = 0; i < count; i++) {
+		close(pipes[i][0]);
+		close(pipes[i][1]);
+	}
+	free(pipes);
+	thread_master_free(master);
+}
+
+int main(int argc, char **argv)
+{
+	struct rlimit limit;
+	struct prng *prng;
+	size_t b, c;
+
+	/* each pipe costs two fds */
+	getrlimit(RLIMIT_NOFILE, &limit);
+	limit.rlim_cur = limit.rlim_max;
+	setrlimit(RLIMIT_NOFILE, &limit);
+	getrlimit(RLIMIT_NOFILE, &limit);
+
+	prng = prng_new(0);
+
+	for (b = 0; b < array_size(backends); b++)
+		for (c = 0; c < array_size(fd_counts); c++) {
+			if (2 * fd_counts[c] + 16 > limit.rlim_cur) {
+				printf("%-6s %6u fds: skipped (fd limit %lu)\n",
+				       backends[b], fd_counts[c],
+				       (unsigned long)limit.rlim_cur);
+				continue;
+			}
+			run(backends[b], fd_counts[c], prng);
+		}
+
+	prng_free(prng);
+	return 0;
+}
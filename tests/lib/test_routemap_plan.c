@@ -0,0 +1,318 @@
+/*
+ * Route-map evaluation plan tests
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; see the file COPYING; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Checks that indexing route-maps by their prefix-list matches leaves the
+ * result of route_map_apply() alone: which sequence a route ends up in, for
+ * permit and deny sequences and lists, empty and missing lists, and after
+ * a prefix-list changes.  Sequences the index skips are seen by a counting
+ * match rule placed ahead of the prefix-list one.
+ */
+
+#include <zebra.h>
+
+#include "command.h"
+#include "memory.h"
+#include "plist.h"
+#include "prefix.h"
+#include "routemap.h"
+#include "vty.h"
+
+struct thread_master *master;
+
+/* What a route went through */
+struct plan_route {
+	/* "set test-value" of the sequence it ended up in, 0 if none */
+	int value;
+
+	/* Sequences that looked at it, by "match test-count" */
+	unsigned int counted;
+
+	/* Calls to the prefix-list rules' own match functions */
+	unsigned int plist_calls;
+};
+
+static struct vty *vty;
+static int failed;
+
+static enum route_map_cmd_result_t
+test_match_plist(void *rule, const struct prefix *prefix,
+		 route_map_object_t type, void *object, afi_t afi)
+{
+	struct plan_route *route = object;
+
+	route->plist_calls++;
+	return prefix_list_apply(prefix_list_lookup(afi, rule), prefix)
+			       == PREFIX_DENY
+		       ? RMAP_NOMATCH
+		       : RMAP_MATCH;
+}
+
+static enum route_map_cmd_result_t
+test_match_plist_v4(void *rule, const struct prefix *prefix,
+		    route_map_object_t type, void *object)
+{
+	return test_match_plist(rule, prefix, type, object, AFI_IP);
+}
+
+static enum route_map_cmd_result_t
+test_match_count(void *rule, const struct prefix *prefix,
+		 route_map_object_t type, void *object)
+{
+	struct plan_route *route = object;
+
+	route->counted++;
+	return RMAP_MATCH;
+}
+
+static enum route_map_cmd_result_t
+test_set_value(void *rule, const struct prefix *prefix,
+	       route_map_object_t type, void *object)
+{
+	struct plan_route *route = object;
+
+	route->value = atoi(rule);
+	return RMAP_OKAY;
+}
+
+static void *test_compile(const char *arg)
+{
+	return XSTRDUP(MTYPE_ROUTE_MAP_COMPILED, arg);
+}
+
+static void test_free(void *rule)
+{
+	XFREE(MTYPE_ROUTE_MAP_COMPILED, rule);
+}
+
+static struct route_map_rule_cmd test_match_plist_cmd = {
+	"ip address prefix-list", test_match_plist_v4, test_compile,
+	test_free,
+	.match_plist_afi = AFI_IP,
+};
+
+/* The same, but not declared as a prefix-list match */
+static struct route_map_rule_cmd test_match_plist_opaque_cmd = {
+	"test-plist", test_match_plist_v4, test_compile, test_free,
+};
+
+static struct route_map_rule_cmd test_match_count_cmd = {
+	"test-count", test_match_count, test_compile, test_free,
+};
+
+static struct route_map_rule_cmd test_set_value_cmd = {
+	"test-value", test_set_value, test_compile, test_free,
+};
+
+static void config(const char *cmd)
+{
+	vector vline;
+	int ret;
+
+	vline = cmd_make_strvec(cmd);
+	ret = cmd_execute_command(vline, vty, NULL, 0);
+	cmd_free_strvec(vline);
+
+	if (ret != CMD_SUCCESS) {
+		printf("command \"%s\" failed: %d\n", cmd, ret);
+		failed++;
+	}
+}
+
+/*
+ * Add a sequence: "match test-count", then "match <plist_rule> <plist>" if
+ * plist is given, and "set test-value <pref>".
+ */
+static void seq(const char *map, const char *type, int pref,
+		const char *plist_rule, const char *plist)
+{
+	struct route_map_index *index;
+	char buf[64];
+
+	vty->node = CONFIG_NODE;
+	snprintf(buf, sizeof(buf), "route-map %s %s %d", map, type, pref);
+	config(buf);
+
+	index = VTY_GET_CONTEXT(route_map_index);
+	if (!index) {
+		failed++;
+		return;
+	}
+
+	route_map_add_match(index, "test-count", "", RMAP_EVENT_MATCH_ADDED);
+	if (plist)
+		route_map_add_match(index, plist_rule, plist,
+				    RMAP_EVENT_PLIST_ADDED);
+	snprintf(buf, sizeof(buf), "%d", pref);
+	route_map_add_set(index, "test-value", buf);
+}
+
+static route_map_result_t apply(const char *map, const char *pfx,
+				struct plan_route *route)
+{
+	struct prefix p;
+
+	memset(route, 0, sizeof(*route));
+	str2prefix(pfx, &p);
+	return route_map_apply(route_map_lookup_by_name(map), &p, RMAP_ZEBRA,
+			       route);
+}
+
+static void check(const char *name, bool ok)
+{
+	printf("%s: %s\n", name, ok ? "OK" : "failed");
+	if (!ok)
+		failed++;
+}
+
+static void test_first_match(void)
+{
+	struct plan_route r;
+
+	vty->node = CONFIG_NODE;
+	config("ip prefix-list A seq 5 permit 10.0.0.0/8 le 32");
+	config("ip prefix-list B seq 5 permit 20.0.0.0/8 le 32");
+	seq("FIRST", "permit", 10, "ip address prefix-list", "A");
+	seq("FIRST", "permit", 20, "ip address prefix-list", "B");
+	seq("FIRST", "permit", 30, NULL, NULL);
+
+	/* Only sequence 20 and the unfiltered 30 can match 20/8 */
+	check("first match jump",
+	      apply("FIRST", "20.1.0.0/16", &r) == RMAP_PERMITMATCH
+		      && r.value == 20 && r.counted == 1
+		      && r.plist_calls == 0);
+
+	check("first match in order",
+	      apply("FIRST", "10.1.0.0/16", &r) == RMAP_PERMITMATCH
+		      && r.value == 10 && r.counted == 1);
+
+	check("unfiltered sequence",
+	      apply("FIRST", "30.1.0.0/16", &r) == RMAP_PERMITMATCH
+		      && r.value == 30 && r.counted == 1);
+
+	/* A rule that is not declared as a prefix-list match is just run */
+	seq("OPAQUE", "permit", 10, "test-plist", "A");
+	seq("OPAQUE", "permit", 20, NULL, NULL);
+	check("undeclared prefix-list rule",
+	      apply("OPAQUE", "20.1.0.0/16", &r) == RMAP_PERMITMATCH
+		      && r.value == 20 && r.counted == 2
+		      && r.plist_calls == 1);
+}
+
+static void test_deny_permit(void)
+{
+	struct plan_route r;
+
+	/* A deny sequence ahead of a permit one still wins */
+	vty->node = CONFIG_NODE;
+	config("ip prefix-list C seq 5 permit 10.1.0.0/16 le 32");
+	seq("ORDER", "deny", 10, "ip address prefix-list", "A");
+	seq("ORDER", "permit", 20, "ip address prefix-list", "C");
+	check("deny sequence first",
+	      apply("ORDER", "10.1.2.0/24", &r) == RMAP_DENYMATCH
+		      && r.counted == 1);
+
+	/* Deny entries of a list don't make its sequence a candidate */
+	vty->node = CONFIG_NODE;
+	config("ip prefix-list D seq 5 deny 10.1.0.0/16 le 32");
+	config("ip prefix-list D seq 10 permit 10.0.0.0/8 le 32");
+	seq("LISTDENY", "permit", 10, "ip address prefix-list", "D");
+	seq("LISTDENY", "permit", 20, NULL, NULL);
+	check("list deny entry",
+	      apply("LISTDENY", "10.1.2.0/24", &r) == RMAP_PERMITMATCH
+		      && r.value == 20);
+	check("list permit entry",
+	      apply("LISTDENY", "10.2.0.0/16", &r) == RMAP_PERMITMATCH
+		      && r.value == 10 && r.counted == 1);
+
+	check("no sequence matches",
+	      apply("ORDER", "20.1.0.0/16", &r) == RMAP_DENYMATCH
+		      && r.value == 0 && r.counted == 0);
+}
+
+static void test_empty_missing(void)
+{
+	struct plan_route r;
+
+	/* An empty list matches everything, a missing one nothing */
+	vty->node = CONFIG_NODE;
+	config("ip prefix-list EMPTY description no entries");
+	seq("EMPTY", "permit", 10, "ip address prefix-list", "MISSING");
+	seq("EMPTY", "permit", 20, "ip address prefix-list", "EMPTY");
+	seq("EMPTY", "permit", 30, "ip address prefix-list", "A");
+
+	check("missing list",
+	      apply("EMPTY", "10.1.0.0/16", &r) == RMAP_PERMITMATCH
+		      && r.value == 20 && r.counted == 1);
+	check("empty list",
+	      apply("EMPTY", "40.1.0.0/16", &r) == RMAP_PERMITMATCH
+		      && r.value == 20 && r.counted == 1);
+}
+
+static void test_plist_change(void)
+{
+	struct plan_route r;
+
+	/* Build the plan, then change a list it was built from */
+	check("before list change",
+	      apply("FIRST", "50.1.0.0/16", &r) == RMAP_PERMITMATCH
+		      && r.value == 30 && r.counted == 1);
+
+	vty->node = CONFIG_NODE;
+	config("ip prefix-list B seq 10 permit 50.0.0.0/8 le 32");
+	check("list entry added",
+	      apply("FIRST", "50.1.0.0/16", &r) == RMAP_PERMITMATCH
+		      && r.value == 20 && r.counted == 1);
+
+	vty->node = CONFIG_NODE;
+	config("no ip prefix-list B seq 10 permit 50.0.0.0/8 le 32");
+	check("list entry removed",
+	      apply("FIRST", "50.1.0.0/16", &r) == RMAP_PERMITMATCH
+		      && r.value == 30 && r.counted == 1);
+
+	/* A list created after the route-map referred to it */
+	vty->node = CONFIG_NODE;
+	config("ip prefix-list MISSING seq 5 permit 10.0.0.0/8 le 32");
+	check("list created",
+	      apply("EMPTY", "10.1.0.0/16", &r) == RMAP_PERMITMATCH
+		      && r.value == 10 && r.counted == 1);
+}
+
+int main(void)
+{
+	master = thread_master_create(NULL);
+	cmd_init(1);
+	route_map_init();
+	prefix_list_init();
+
+	route_map_install_match(&test_match_plist_cmd);
+	route_map_install_match(&test_match_plist_opaque_cmd);
+	route_map_install_match(&test_match_count_cmd);
+	route_map_install_set(&test_set_value_cmd);
+
+	vty = vty_new();
+	vty->type = VTY_TERM;
+
+	test_first_match();
+	test_deny_permit();
+	test_empty_missing();
+	test_plist_change();
+
+	vty_close(vty);
+	return failed ? 1 : 0;
+}
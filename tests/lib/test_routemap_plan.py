@@ -0,0 +1,19 @@
+import frrtest
+
+class TestRoutemapPlan(frrtest.TestMultiOut):
+    program = './test_routemap_plan'
+
+TestRoutemapPlan.okfail("first match jump")
+TestRoutemapPlan.okfail("first match in order")
+TestRoutemapPlan.okfail("unfiltered sequence")
+TestRoutemapPlan.okfail("undeclared prefix-list rule")
+TestRoutemapPlan.okfail("deny sequence first")
+TestRoutemapPlan.okfail("list deny entry")
+TestRoutemapPlan.okfail("list permit entry")
+TestRoutemapPlan.okfail("no sequence matches")
+TestRoutemapPlan.okfail("missing list")
+TestRoutemapPlan.okfail("empty list")
+TestRoutemapPlan.okfail("before list change")
+TestRoutemapPlan.okfail("list entry added")
+TestRoutemapPlan.okfail("list entry removed")
+TestRoutemapPlan.okfail("list created")
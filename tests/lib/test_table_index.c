@@ -0,0 +1,337 @@
+/*
+ * Route table multibit index test and benchmark
+ *
+ * This program is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation; either version 2 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; see the file COPYING; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Fills one table with its index forced on and one with it turned off,
+ * checks that route_node_match() and route_table_get_next() agree between
+ * the two (also after deleting part of the prefixes), then times insert,
+ * longest-prefix match and in-order walk for both.
+ *
+ *   test_table_index [-4 IPV4_PREFIXES] [-6 IPV6_PREFIXES] [-l LOOKUPS]
+ */
+
+#include <zebra.h>
+
+#include "prefix.h"
+#include "table.h"
+#include "monotime.h"
+
+#include "prng.h"
+
+struct thread_master *master;
+
+static int present;
+
+/* Roughly the length distribution of a full table. */
+static void rand_prefix(struct prng *prng, int family, struct prefix *p)
+{
+	unsigned int r = prng_rand(prng) % 100;
+	int i;
+
+	memset(p, 0, sizeof(*p));
+	p->family = family;
+	if (family == AF_INET) {
+		p->u.prefix4.s_addr = prng_rand(prng);
+		if (r < 60)
+			p->prefixlen = 24;
+		else if (r < 95)
+			p->prefixlen = 16 + prng_rand(prng) % 8;
+		else
+			p->prefixlen = 8 + prng_rand(prng) % 8;
+	} else {
+		for (i = 0; i < 4; i++)
+			p->u.prefix6.s6_addr32[i] = prng_rand(prng);
+		/* mostly 2000::/3 */
+		if (r < 90)
+			p->u.prefix6.s6_addr[0] = 0x20
+						  | (p->u.prefix6.s6_addr[0]
+						     & 0x0f);
+		if (r < 50)
+			p->prefixlen = 48;
+		else if (r < 90)
+			p->prefixlen = 29 + prng_rand(prng) % 19;
+		else if (r < 97)
+			p->prefixlen = 64;
+		else
+			p->prefixlen = 16 + prng_rand(prng) % 13;
+	}
+	apply_mask(p);
+}
+
+/* A host address, half of them inside one of the given prefixes. */
+static void rand_addr(struct prng *prng, struct prefix *prefixes,
+		      unsigned int count, struct prefix *a)
+{
+	struct prefix host;
+	int i;
+
+	memset(&host, 0, sizeof(host));
+	host.family = prefixes[0].family;
+	host.prefixlen = prefix_blen(&host) * 8;
+	for (i = 0; i < 4; i++)
+		host.u.prefix6.s6_addr32[i] = prng_rand(prng);
+	if (host.family == AF_INET)
+		memset(&host.u.prefix6.s6_addr[4], 0, 12);
+
+	if (prng_rand(prng) % 2) {
+		struct prefix *p = &prefixes[prng_rand(prng) % count];
+		unsigned int bit;
+
+		for (bit = 0; bit < p->prefixlen; bit++) {
+			uint8_t mask = 0x80 >> (bit % 8);
+
+			host.u.val[bit / 8] &= ~mask;
+			host.u.val[bit / 8] |= p->u.val[bit / 8] & mask;
+		}
+	}
+	*a = host;
+}
+
+static void add_prefixes(struct route_table *table, struct prefix *prefixes,
+			 unsigned int count)
+{
+	struct route_node *rn;
+	unsigned int i;
+
+	for (i = 0; i < count; i++) {
+		rn = route_node_get(table, &prefixes[i]);
+		if (rn->info)
+			route_unlock_node(rn);
+		else
+			rn->info = &present;
+	}
+}
+
+static void del_prefix(struct route_table *table, struct prefix *p)
+{
+	struct route_node *rn;
+
+	rn = route_node_lookup(table, p);
+	if (!rn)
+		return;
+	rn->info = NULL;
+	route_unlock_node(rn);
+	route_unlock_node(rn);
+}
+
+static void clear_table(struct route_table *table)
+{
+	struct route_node *rn;
+
+	for (rn = route_top(table); rn; rn = route_next(rn))
+		if (rn->info) {
+			rn->info = NULL;
+			route_unlock_node(rn);
+		}
+}
+
+static bool same_node(struct route_node *a, struct route_node *b)
+{
+	bool same;
+
+	same = (!a && !b) || (a && b && prefix_same(&a->p, &b->p));
+	if (a)
+		route_unlock_node(a);
+	if (b)
+		route_unlock_node(b);
+	return same;
+}
+
+static bool compare(struct prng *prng, struct route_table *with,
+		    struct route_table *without, struct prefix *prefixes,
+		    unsigned int count, unsigned int lookups)
+{
+	struct route_node *a, *b;
+	struct prefix addr;
+	unsigned int i;
+	bool ok = true;
+
+	for (i = 0; i < lookups; i++) {
+		rand_addr(prng, prefixes, count, &addr);
+		if (i % 4 == 0) {
+			/* also less specific lookups */
+			addr.prefixlen = prng_rand(prng) % (addr.prefixlen + 1);
+			apply_mask(&addr);
+		}
+
+		a = route_node_match(with, &addr);
+		b = route_node_match(without, &addr);
+		if (!same_node(a, b)) {
+			printf("match differs for %pFX\n", &addr);
+			ok = false;
+		}
+
+		a = route_table_get_next(with, &addr);
+		b = route_table_get_next(without, &addr);
+		if (!same_node(a, b)) {
+			printf("get_next differs for %pFX\n", &addr);
+			ok = false;
+		}
+	}
+
+	a = route_top(with);
+	b = route_top(without);
+	while (a && b) {
+		if (!prefix_same(&a->p, &b->p)) {
+			ok = false;
+			break;
+		}
+		a = route_next(a);
+		b = route_next(b);
+	}
+	if (a || b) {
+		printf("walks differ\n");
+		ok = false;
+		if (a)
+			route_unlock_node(a);
+		if (b)
+			route_unlock_node(b);
+	}
+	return ok;
+}
+
+static void check(int family, unsigned int count, unsigned int lookups)
+{
+	struct route_table *with, *without;
+	struct prefix *prefixes;
+	struct prng *prng;
+	unsigned int i;
+	bool ok;
+
+	prng = prng_new(family);
+	prefixes = XCALLOC(MTYPE_TMP, count * sizeof(*prefixes));
+	for (i = 0; i < count; i++)
+		rand_prefix(prng, family, &prefixes[i]);
+
+	with = route_table_init();
+	route_table_set_index(with, true);
+	without = route_table_init();
+	route_table_set_index(without, false);
+
+	add_prefixes(with, prefixes, count);
+	add_prefixes(without, prefixes, count);
+	ok = compare(prng, with, without, prefixes, count, lookups);
+
+	for (i = 0; i < count; i += 3) {
+		del_prefix(with, &prefixes[i]);
+		del_prefix(without, &prefixes[i]);
+	}
+	ok &= compare(prng, with, without, prefixes, count, lookups);
+
+	printf("%s index: %s\n", family == AF_INET ? "IPv4" : "IPv6",
+	       ok ? "OK" : "failed");
+
+	clear_table(with);
+	clear_table(without);
+	route_table_finish(with);
+	route_table_finish(without);
+	XFREE(MTYPE_TMP, prefixes);
+	prng_free(prng);
+}
+
+static void bench_one(int family, unsigned int count, unsigned int lookups,
+		      bool index)
+{
+	struct route_table *table;
+	struct route_node *rn;
+	struct prefix *prefixes, *addrs;
+	struct timeval start;
+	int64_t usec_add, usec_match, usec_walk;
+	unsigned int i, hits = 0, nodes = 0;
+	struct prng *prng;
+
+	prng = prng_new(family);
+	prefixes = XCALLOC(MTYPE_TMP, count * sizeof(*prefixes));
+	addrs = XCALLOC(MTYPE_TMP, lookups * sizeof(*addrs));
+	for (i = 0; i < count; i++)
+		rand_prefix(prng, family, &prefixes[i]);
+	for (i = 0; i < lookups; i++)
+		rand_addr(prng, prefixes, count, &addrs[i]);
+
+	table = route_table_init();
+	route_table_set_index(table, index);
+
+	monotime(&start);
+	add_prefixes(table, prefixes, count);
+	usec_add = monotime_since(&start, NULL);
+
+	monotime(&start);
+	for (i = 0; i < lookups; i++) {
+		rn = route_node_match(table, &addrs[i]);
+		if (rn) {
+			hits++;
+			route_unlock_node(rn);
+		}
+	}
+	usec_match = monotime_since(&start, NULL);
+
+	monotime(&start);
+	for (rn = route_top(table); rn; rn = route_next(rn))
+		nodes++;
+	usec_walk = monotime_since(&start, NULL);
+
+	printf("%s %-8s %7u prefixes: insert %7" PRId64 " us, %u lookups %7"
+	       PRId64 " us (%u hits), walk %6" PRId64 " us (%u nodes)\n",
+	       family == AF_INET ? "IPv4" : "IPv6",
+	       index ? "index" : "no index", count, usec_add, lookups,
+	       usec_match, hits, usec_walk, nodes);
+
+	clear_table(table);
+	route_table_finish(table);
+	XFREE(MTYPE_TMP, addrs);
+	XFREE(MTYPE_TMP, prefixes);
+	prng_free(prng);
+}
+
+int main(int argc, char **argv)
+{
+	unsigned int count4 = 50000, count6 = 10000, lookups = 100000;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "4:6:l:")) != -1) {
+		switch (opt) {
+		case '4':
+			count4 = strtoul(optarg, NULL, 10);
+			break;
+		case '6':
+			count6 = strtoul(optarg, NULL, 10);
+			break;
+		case 'l':
+			lookups = strtoul(optarg, NULL, 10);
+			break;
+		default:
+			fprintf(stderr,
+				"usage: %s [-4 IPV4_PREFIXES] [-6 IPV6_PREFIXES] [-l LOOKUPS]\n",
+				argv[0]);
+			return 1;
+		}
+	}
+
+	check(AF_INET, 20000, 20000);
+	check(AF_INET6, 20000, 20000);
+
+	if (count4 && lookups) {
+		bench_one(AF_INET, count4, lookups, false);
+		bench_one(AF_INET, count4, lookups, true);
+	}
+	if (count6 && lookups) {
+		bench_one(AF_INET6, count6, lookups, false);
+		bench_one(AF_INET6, count6, lookups, true);
+	}
+	return 0;
+}
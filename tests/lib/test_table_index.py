@@ -0,0 +1,7 @@
+import frrtest
+
+class TestTableIndex(frrtest.TestMultiOut):
+    program = './test_table_index'
+
+TestTableIndex.onesimple('IPv4 index: OK')
+TestTableIndex.onesimple('IPv6 index: OK')
@@ -50,6 +50,7 @@
 #include "zebra/if_netlink.h"
 #include "zebra/interface.h"
 #include "zebra/zebra_vxlan.h"
+#include "zebra/zebra_nhg.h"
 #include "zebra/zebra_errors.h"
 
 DEFINE_MTYPE_STATIC(ZEBRA, ZINFO, "Zebra Interface Information")
@@ -936,6 +937,8 @@ void if_up(struct interface *ifp)
 	zif->up_count++;
 	quagga_timestamp(2, zif->up_last, sizeof(zif->up_last));
 
+	zebra_nhg_interface_up(ifp);
+
 	/* Notify the protocol daemons. */
 	if (ifp->ptm_enable && (ifp->ptm_status == ZEBRA_PTM_STATUS_DOWN)) {
 		flog_warn(EC_ZEBRA_PTM_NOT_READY,
@@ -1005,6 +1008,8 @@ void if_down(struct interface *ifp)
 			zebra_vxlan_svi_down(ifp, link_if);
 	}
 
+	/* The kernel has dropped the nexthop objects over the interface */
+	zebra_nhg_interface_down(ifp);
 
 	/* Notify to the protocol daemons. */
 	zebra_interface_down_update(ifp);
@@ -99,6 +99,9 @@ static const struct message nlmsg_str[] = {{RTM_NEWROUTE, "RTM_NEWROUTE"},
 					   {RTM_NEWRULE, "RTM_NEWRULE"},
 					   {RTM_DELRULE, "RTM_DELRULE"},
 					   {RTM_GETRULE, "RTM_GETRULE"},
+					   {RTM_NEWNEXTHOP, "RTM_NEWNEXTHOP"},
+					   {RTM_DELNEXTHOP, "RTM_DELNEXTHOP"},
+					   {RTM_GETNEXTHOP, "RTM_GETNEXTHOP"},
 					   {0}};
 
 static const struct message rtproto_str[] = {
@@ -418,67 +421,70 @@ static int kernel_read(struct thread *thread)
  * so that we only had to write one way to handle incoming
  * address add/delete changes.
  */
-static void netlink_install_filter(int sock, __u32 pid, __u32 dplane_pid)
+static void netlink_install_filter(int sock, const __u32 *pids,
+				   unsigned int npids)
 {
 	/*
 	 * BPF_JUMP instructions and where you jump to are based upon
 	 * 0 as being the next statement.  So count from 0.  Writing
 	 * this down because every time I look at this I have to
 	 * re-remember it.
+	 *
+	 * Logic:
+	 *   if (nlmsg_pid == any of our own pids) {
+	 *       if (the incoming nlmsg_type ==
+	 *           RTM_NEWADDR | RTM_DELADDR)
+	 *           keep this message
+	 *       else
+	 *           skip this message
+	 *   } else
+	 *       keep this netlink message
 	 */
-	struct sock_filter filter[] = {
-		/*
-		 * Logic:
-		 *   if (nlmsg_pid == pid ||
-		 *       nlmsg_pid == dplane_pid) {
-		 *       if (the incoming nlmsg_type ==
-		 *           RTM_NEWADDR | RTM_DELADDR)
-		 *           keep this message
-		 *       else
-		 *           skip this message
-		 *   } else
-		 *       keep this netlink message
-		 */
-		/*
-		 * 0: Load the nlmsg_pid into the BPF register
-		 */
-		BPF_STMT(BPF_LD | BPF_ABS | BPF_W,
-			 offsetof(struct nlmsghdr, nlmsg_pid)),
-		/*
-		 * 1: Compare to pid
-		 */
-		BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, htonl(pid), 1, 0),
-		/*
-		 * 2: Compare to dplane pid
-		 */
-		BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, htonl(dplane_pid), 0, 4),
-		/*
-		 * 3: Load the nlmsg_type into BPF register
-		 */
-		BPF_STMT(BPF_LD | BPF_ABS | BPF_H,
-			 offsetof(struct nlmsghdr, nlmsg_type)),
-		/*
-		 * 4: Compare to RTM_NEWADDR
-		 */
-		BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, htons(RTM_NEWADDR), 2, 0),
-		/*
-		 * 5: Compare to RTM_DELADDR
-		 */
-		BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, htons(RTM_DELADDR), 1, 0),
-		/*
-		 * 6: This is the end state of we want to skip the
-		 *    message
-		 */
-		BPF_STMT(BPF_RET | BPF_K, 0),
-		/* 7: This is the end state of we want to keep
-		 *     the message
-		 */
-		BPF_STMT(BPF_RET | BPF_K, 0xffff),
-	};
+	struct sock_filter filter[ZEBRA_DPLANE_MAX_WORKERS + 7];
+	struct sock_fprog prog;
+	unsigned int i, idx = 0;
+
+	assert(npids > 0 && npids <= ZEBRA_DPLANE_MAX_WORKERS + 1);
+
+	/*
+	 * 0: Load the nlmsg_pid into the BPF register
+	 */
+	filter[idx++] = (struct sock_filter)BPF_STMT(
+		BPF_LD | BPF_ABS | BPF_W, offsetof(struct nlmsghdr, nlmsg_pid));
+	/*
+	 * 1..npids: Compare to each pid; a match jumps to the type
+	 * check, and no match at all jumps to 'keep'
+	 */
+	for (i = 0; i < npids; i++)
+		filter[idx++] = (struct sock_filter)BPF_JUMP(
+			BPF_JMP | BPF_JEQ | BPF_K, htonl(pids[i]),
+			npids - 1 - i, (i == npids - 1) ? 4 : 0);
+	/*
+	 * Load the nlmsg_type into BPF register
+	 */
+	filter[idx++] = (struct sock_filter)BPF_STMT(
+		BPF_LD | BPF_ABS | BPF_H, offsetof(struct nlmsghdr, nlmsg_type));
+	/*
+	 * Compare to RTM_NEWADDR
+	 */
+	filter[idx++] = (struct sock_filter)BPF_JUMP(
+		BPF_JMP | BPF_JEQ | BPF_K, htons(RTM_NEWADDR), 2, 0);
+	/*
+	 * Compare to RTM_DELADDR
+	 */
+	filter[idx++] = (struct sock_filter)BPF_JUMP(
+		BPF_JMP | BPF_JEQ | BPF_K, htons(RTM_DELADDR), 1, 0);
+	/*
+	 * This is the end state of we want to skip the message
+	 */
+	filter[idx++] = (struct sock_filter)BPF_STMT(BPF_RET | BPF_K, 0);
+	/*
+	 * This is the end state of we want to keep the message
+	 */
+	filter[idx++] = (struct sock_filter)BPF_STMT(BPF_RET | BPF_K, 0xffff);
 
-	struct sock_fprog prog = {
-		.len = array_size(filter), .filter = filter,
-	};
+	prog.len = idx;
+	prog.filter = filter;
 
 	if (setsockopt(sock, SOL_SOCKET, SO_ATTACH_FILTER, &prog, sizeof(prog))
 	    < 0)
@@ -693,6 +699,61 @@ static void netlink_parse_extended_ack(struct nlmsghdr *h)
 	}
 }
 
+/*
+ * Classify and log an error reply from the kernel. Returns 0 if the
+ * error is one of the known races we treat as success, -1 otherwise.
+ */
+static int netlink_parse_error(const struct nlsock *nl,
+			       const struct zebra_dplane_info *zns,
+			       const struct nlmsgerr *err)
+{
+	int errnum = err->error;
+	int msg_type = err->msg.nlmsg_type;
+
+	/* Deal with errors that occur because of races in link handling */
+	if (zns->is_cmd
+	    && ((msg_type == RTM_DELROUTE
+		 && (-errnum == ENODEV || -errnum == ESRCH))
+		|| (msg_type == RTM_NEWROUTE
+		    && (-errnum == ENETDOWN || -errnum == EEXIST)))) {
+		if (IS_ZEBRA_DEBUG_KERNEL)
+			zlog_debug("%s: error: %s type=%s(%u), seq=%u, pid=%u",
+				   nl->name, safe_strerror(-errnum),
+				   nl_msg_type_to_str(msg_type), msg_type,
+				   err->msg.nlmsg_seq, err->msg.nlmsg_pid);
+		return 0;
+	}
+
+	/* We see RTM_DELNEIGH when shutting down an interface with an IPv4
+	 * link-local.  The kernel should have already deleted the neighbor
+	 * so do not log these as an error.  Kernels without nexthop objects
+	 * refuse RTM_GETNEXTHOP, which is how support for them is probed,
+	 * and a nexthop object may already be gone when we delete it.
+	 */
+	if (msg_type == RTM_DELNEIGH
+	    || (msg_type == RTM_GETNEXTHOP
+		&& (-errnum == EOPNOTSUPP || -errnum == EINVAL))
+	    || (msg_type == RTM_DELNEXTHOP && -errnum == ENOENT)
+	    || (zns->is_cmd && msg_type == RTM_NEWROUTE
+		&& (-errnum == ESRCH || -errnum == ENETUNREACH))) {
+		/* This is known to happen in some situations, don't log
+		 * as error.
+		 */
+		if (IS_ZEBRA_DEBUG_KERNEL)
+			zlog_debug("%s error: %s, type=%s(%u), seq=%u, pid=%u",
+				   nl->name, safe_strerror(-errnum),
+				   nl_msg_type_to_str(msg_type), msg_type,
+				   err->msg.nlmsg_seq, err->msg.nlmsg_pid);
+	} else
+		flog_err(EC_ZEBRA_UNEXPECTED_MESSAGE,
+			 "%s error: %s, type=%s(%u), seq=%u, pid=%u",
+			 nl->name, safe_strerror(-errnum),
+			 nl_msg_type_to_str(msg_type), msg_type,
+			 err->msg.nlmsg_seq, err->msg.nlmsg_pid);
+
+	return -1;
+}
+
 /*
  * netlink_parse_info
  *
@@ -796,8 +857,6 @@ int netlink_parse_info(int (*filter)(struct nlmsghdr *, ns_id_t, int),
 			if (h->nlmsg_type == NLMSG_ERROR) {
 				struct nlmsgerr *err =
 					(struct nlmsgerr *)NLMSG_DATA(h);
-				int errnum = err->error;
-				int msg_type = err->msg.nlmsg_type;
 
 				if (h->nlmsg_len
 				    < NLMSG_LENGTH(sizeof(struct nlmsgerr))) {
@@ -838,63 +897,7 @@ int netlink_parse_info(int (*filter)(struct nlmsghdr *, ns_id_t, int),
 					continue;
 				}
 
-				/* Deal with errors that occur because of races
-				 * in link handling */
-				if (zns->is_cmd
-				    && ((msg_type == RTM_DELROUTE
-					 && (-errnum == ENODEV
-					     || -errnum == ESRCH))
-					|| (msg_type == RTM_NEWROUTE
-					    && (-errnum == ENETDOWN
-						|| -errnum == EEXIST)))) {
-					if (IS_ZEBRA_DEBUG_KERNEL)
-						zlog_debug(
-							"%s: error: %s type=%s(%u), seq=%u, pid=%u",
-							nl->name,
-							safe_strerror(-errnum),
-							nl_msg_type_to_str(
-								msg_type),
-							msg_type,
-							err->msg.nlmsg_seq,
-							err->msg.nlmsg_pid);
-					return 0;
-				}
-
-				/* We see RTM_DELNEIGH when shutting down an
-				 * interface with an IPv4
-				 * link-local.  The kernel should have already
-				 * deleted the neighbor
-				 * so do not log these as an error.
-				 */
-				if (msg_type == RTM_DELNEIGH
-				    || (zns->is_cmd && msg_type == RTM_NEWROUTE
-					&& (-errnum == ESRCH
-					    || -errnum == ENETUNREACH))) {
-					/* This is known to happen in some
-					 * situations, don't log
-					 * as error.
-					 */
-					if (IS_ZEBRA_DEBUG_KERNEL)
-						zlog_debug(
-							"%s error: %s, type=%s(%u), seq=%u, pid=%u",
-							nl->name,
-							safe_strerror(-errnum),
-							nl_msg_type_to_str(
-								msg_type),
-							msg_type,
-							err->msg.nlmsg_seq,
-							err->msg.nlmsg_pid);
-				} else
-					flog_err(
-						EC_ZEBRA_UNEXPECTED_MESSAGE,
-						"%s error: %s, type=%s(%u), seq=%u, pid=%u",
-						nl->name,
-						safe_strerror(-errnum),
-						nl_msg_type_to_str(msg_type),
-						msg_type, err->msg.nlmsg_seq,
-						err->msg.nlmsg_pid);
-
-				return -1;
+				return netlink_parse_error(nl, zns, err);
 			}
 
 			/* OK we got netlink message. */
@@ -1033,6 +1036,246 @@ int netlink_talk(int (*filter)(struct nlmsghdr *, ns_id_t, int startup),
 	return netlink_talk_info(filter, n, &dp_info, startup);
 }
 
+/*
+ * Reset a netlink batch so it can be filled again.
+ */
+void nl_batch_init(struct nl_batch *bth)
+{
+	bth->curlen = 0;
+	bth->msgcnt = 0;
+	bth->dp_info = NULL;
+}
+
+/*
+ * Append a copy of a message to a batch. The caller sets the sequence
+ * number; the result of the message is recorded against 'arg'. Returns
+ * false if the message does not fit, or is bound for a different
+ * socket than the rest of the batch: the caller should send the batch
+ * and try again.
+ */
+bool nl_batch_add(struct nl_batch *bth, const struct nlmsghdr *n,
+		  const struct zebra_dplane_info *dp_info, void *arg)
+{
+	struct nlmsghdr *h;
+	struct nl_batch_msg *m;
+	size_t len = NLMSG_ALIGN(n->nlmsg_len);
+
+	if (bth->msgcnt >= NL_BATCH_MAX_MSGS
+	    || bth->curlen + len > sizeof(bth->buf))
+		return false;
+
+	if (bth->dp_info == NULL)
+		bth->dp_info = dp_info;
+	else if (bth->dp_info->nls.sock != dp_info->nls.sock)
+		return false;
+
+	h = (struct nlmsghdr *)(bth->buf + bth->curlen);
+	memcpy(h, n, n->nlmsg_len);
+	h->nlmsg_pid = dp_info->nls.snl.nl_pid;
+
+	if (IS_ZEBRA_DEBUG_KERNEL)
+		zlog_debug(
+			"netlink_batch: %s type %s(%u), len=%d seq=%u flags 0x%x",
+			dp_info->nls.name, nl_msg_type_to_str(h->nlmsg_type),
+			h->nlmsg_type, h->nlmsg_len, h->nlmsg_seq,
+			h->nlmsg_flags);
+
+	m = &bth->msgs[bth->msgcnt++];
+	m->seq = h->nlmsg_seq;
+	m->arg = arg;
+	m->status = 0;
+	m->replied = false;
+
+	bth->curlen += len;
+
+	return true;
+}
+
+/*
+ * Find the batch entry for a reply. The kernel handles the messages in
+ * order, so the search starts from the entry after the last match.
+ */
+static struct nl_batch_msg *nl_batch_lookup(struct nl_batch *bth,
+					    uint32_t seq, unsigned int *hint)
+{
+	unsigned int i, idx;
+
+	for (i = 0; i < bth->msgcnt; i++) {
+		idx = (*hint + i) % bth->msgcnt;
+		if (bth->msgs[idx].seq == seq && !bth->msgs[idx].replied) {
+			*hint = idx + 1;
+			return &bth->msgs[idx];
+		}
+	}
+
+	return NULL;
+}
+
+/*
+ * Send all the messages in a batch, then read the kernel's replies and
+ * record the result of each message. Returns 0 on success, -1 if the
+ * batch could not be sent or replies were lost; the status of each
+ * message is valid in either case.
+ *
+ * As with netlink_talk_info(), messages are sent without NLM_F_ACK: the
+ * kernel only replies to the ones that fail. Asking for an ACK to each
+ * message would overrun the socket's receive buffer with large batches.
+ */
+int nl_batch_send(struct nl_batch *bth)
+{
+	const struct nlsock *nl;
+	struct sockaddr_nl snl;
+	struct iovec iov;
+	struct msghdr msg;
+	unsigned int i, lost = 0, hint = 0;
+	bool overrun = false;
+	int status, save_errno = 0;
+
+	if (bth->msgcnt == 0)
+		return 0;
+
+	nl = &(bth->dp_info->nls);
+
+	memset(&snl, 0, sizeof(snl));
+	memset(&msg, 0, sizeof(msg));
+
+	snl.nl_family = AF_NETLINK;
+
+	iov.iov_base = bth->buf;
+	iov.iov_len = bth->curlen;
+	msg.msg_name = (void *)&snl;
+	msg.msg_namelen = sizeof(snl);
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+
+	if (IS_ZEBRA_DEBUG_KERNEL)
+		zlog_debug("%s: %s sending %u messages, len=%zu", __func__,
+			   nl->name, bth->msgcnt, bth->curlen);
+
+	frr_with_privs(&zserv_privs) {
+		status = sendmsg(nl->sock, &msg, 0);
+		save_errno = errno;
+	}
+
+	if (IS_ZEBRA_DEBUG_KERNEL_MSGDUMP_SEND) {
+		zlog_debug("%s: >> netlink message dump [sent]", __func__);
+		zlog_hexdump(bth->buf, bth->curlen);
+	}
+
+	if (status < 0) {
+		flog_err_sys(EC_LIB_SOCKET, "%s sendmsg() error: %s", __func__,
+			     safe_strerror(save_errno));
+		for (i = 0; i < bth->msgcnt; i++)
+			bth->msgs[i].status = -1;
+		return -1;
+	}
+
+	/*
+	 * The kernel processes the whole buffer before sendmsg() returns,
+	 * so every reply is already queued on the socket: read until it
+	 * is empty.
+	 */
+	while (1) {
+		char buf[NL_RCV_PKT_BUF_SIZE];
+		struct nlmsghdr *h;
+
+		iov.iov_base = buf;
+		iov.iov_len = sizeof(buf);
+		msg.msg_namelen = sizeof(snl);
+
+		status = recvmsg(nl->sock, &msg, 0);
+		if (status < 0) {
+			if (errno == EINTR)
+				continue;
+			if (errno == EWOULDBLOCK || errno == EAGAIN)
+				break;
+			flog_err(EC_ZEBRA_RECVMSG_OVERRUN,
+				 "%s recvmsg overrun: %s", nl->name,
+				 safe_strerror(errno));
+			overrun = true;
+			/* Replies queued after the overrun can still be read */
+			if (errno == ENOBUFS)
+				continue;
+			break;
+		}
+
+		if (status == 0) {
+			flog_err_sys(EC_LIB_SOCKET, "%s EOF", nl->name);
+			overrun = true;
+			break;
+		}
+
+		if (IS_ZEBRA_DEBUG_KERNEL_MSGDUMP_RECV) {
+			zlog_debug("%s: << netlink message dump [recv]",
+				   __func__);
+			zlog_hexdump(buf, status);
+		}
+
+		for (h = (struct nlmsghdr *)buf;
+		     NLMSG_OK(h, (unsigned int)status);
+		     h = NLMSG_NEXT(h, status)) {
+			struct nlmsgerr *err = (struct nlmsgerr *)NLMSG_DATA(h);
+			struct nl_batch_msg *m;
+
+			if (h->nlmsg_type != NLMSG_ERROR)
+				continue;
+
+			if (h->nlmsg_len < NLMSG_LENGTH(sizeof(*err))) {
+				flog_err(EC_ZEBRA_NETLINK_LENGTH_ERROR,
+					 "%s error: message truncated",
+					 nl->name);
+				continue;
+			}
+
+			if (h->nlmsg_flags & NLM_F_ACK_TLVS)
+				netlink_parse_extended_ack(h);
+
+			m = nl_batch_lookup(bth, err->msg.nlmsg_seq, &hint);
+			if (m == NULL) {
+				if (IS_ZEBRA_DEBUG_KERNEL)
+					zlog_debug("%s: %s unmatched reply seq=%u",
+						   __func__, nl->name,
+						   err->msg.nlmsg_seq);
+				continue;
+			}
+
+			if (err->error == 0) {
+				if (IS_ZEBRA_DEBUG_KERNEL)
+					zlog_debug(
+						"%s: %s ACK: type=%s(%u), seq=%u, pid=%u",
+						__func__, nl->name,
+						nl_msg_type_to_str(
+							err->msg.nlmsg_type),
+						err->msg.nlmsg_type,
+						err->msg.nlmsg_seq,
+						err->msg.nlmsg_pid);
+				m->status = 0;
+			} else
+				m->status = netlink_parse_error(
+					nl, bth->dp_info, err);
+
+			m->replied = true;
+		}
+	}
+
+	if (!overrun)
+		return 0;
+
+	/* Some errors may have been lost: only trust the replies we saw */
+	for (i = 0; i < bth->msgcnt; i++) {
+		if (!bth->msgs[i].replied) {
+			bth->msgs[i].status = -1;
+			lost++;
+		}
+	}
+
+	flog_err(EC_ZEBRA_UNEXPECTED_MESSAGE,
+		 "%s: %s replies lost, failing %u of %u messages", __func__,
+		 nl->name, lost, bth->msgcnt);
+
+	return -1;
+}
+
 /* Issue request message to kernel via netlink socket. GET messages
  * are issued through this interface.
  */
@@ -1075,6 +1318,9 @@ int netlink_request(struct nlsock *nl, struct nlmsghdr *n)
 void kernel_init(struct zebra_ns *zns)
 {
 	unsigned long groups;
+	struct nlsock *nl;
+	__u32 pids[ZEBRA_DPLANE_MAX_WORKERS + 1];
+	unsigned int i, npids = 0;
 #if defined SOL_NETLINK
 	int one, ret;
 #endif
@@ -1116,13 +1362,29 @@ void kernel_init(struct zebra_ns *zns)
 		exit(-1);
 	}
 
-	snprintf(zns->netlink_dplane.name, sizeof(zns->netlink_dplane.name),
-		 "netlink-dp (NS %u)", zns->ns_id);
-	zns->netlink_dplane.sock = -1;
-	if (netlink_socket(&zns->netlink_dplane, 0, zns->ns_id) < 0) {
-		zlog_err("Failure to create %s socket",
-			 zns->netlink_dplane.name);
-		exit(-1);
+	pids[npids++] = zns->netlink_cmd.snl.nl_pid;
+
+	/* One dataplane socket per kernel dataplane worker */
+	for (i = 0; i < ZEBRA_DPLANE_MAX_WORKERS; i++) {
+		nl = &zns->netlink_dplane[i];
+		nl->sock = -1;
+
+		if (i >= zrouter.dplane_workers)
+			continue;
+
+		if (i == 0)
+			snprintf(nl->name, sizeof(nl->name),
+				 "netlink-dp (NS %u)", zns->ns_id);
+		else
+			snprintf(nl->name, sizeof(nl->name),
+				 "netlink-dp%u (NS %u)", i, zns->ns_id);
+
+		if (netlink_socket(nl, 0, zns->ns_id) < 0) {
+			zlog_err("Failure to create %s socket", nl->name);
+			exit(-1);
+		}
+
+		pids[npids++] = nl->snl.nl_pid;
 	}
 
 	/*
@@ -1143,13 +1405,34 @@ void kernel_init(struct zebra_ns *zns)
 		zlog_notice("Registration for extended cmd ACK failed : %d %s",
 			    errno, safe_strerror(errno));
 
-	one = 1;
-	ret = setsockopt(zns->netlink_dplane.sock, SOL_NETLINK, NETLINK_EXT_ACK,
-			 &one, sizeof(one));
+	for (i = 0; i < zrouter.dplane_workers; i++) {
+		nl = &zns->netlink_dplane[i];
 
-	if (ret < 0)
-		zlog_notice("Registration for extended dp ACK failed : %d %s",
-			    errno, safe_strerror(errno));
+		one = 1;
+		ret = setsockopt(nl->sock, SOL_NETLINK, NETLINK_EXT_ACK, &one,
+				 sizeof(one));
+
+		if (ret < 0)
+			zlog_notice(
+				"Registration for extended dp ACK failed : %d %s",
+				errno, safe_strerror(errno));
+
+#if defined NETLINK_CAP_ACK
+		/*
+		 * Route updates are sent to the dplane socket in batches;
+		 * don't have the kernel echo each failed request back in
+		 * its reply.
+		 */
+		one = 1;
+		ret = setsockopt(nl->sock, SOL_NETLINK, NETLINK_CAP_ACK, &one,
+				 sizeof(one));
+
+		if (ret < 0)
+			zlog_notice(
+				"Registration for capped dp ACK failed : %d %s",
+				errno, safe_strerror(errno));
+#endif
+	}
 #endif
 
 	/* Register kernel socket. */
@@ -1161,17 +1444,19 @@ void kernel_init(struct zebra_ns *zns)
 		zlog_err("Can't set %s socket error: %s(%d)",
 			 zns->netlink_cmd.name, safe_strerror(errno), errno);
 
-	if (fcntl(zns->netlink_dplane.sock, F_SETFL, O_NONBLOCK) < 0)
-		zlog_err("Can't set %s socket error: %s(%d)",
-			 zns->netlink_dplane.name, safe_strerror(errno), errno);
+	for (i = 0; i < zrouter.dplane_workers; i++) {
+		nl = &zns->netlink_dplane[i];
+
+		if (fcntl(nl->sock, F_SETFL, O_NONBLOCK) < 0)
+			zlog_err("Can't set %s socket error: %s(%d)",
+				 nl->name, safe_strerror(errno), errno);
+	}
 
 	/* Set receive buffer size if it's set from command line */
 	if (nl_rcvbufsize)
 		netlink_recvbuf(&zns->netlink, nl_rcvbufsize);
 
-	netlink_install_filter(zns->netlink.sock,
-			       zns->netlink_cmd.snl.nl_pid,
-			       zns->netlink_dplane.snl.nl_pid);
+	netlink_install_filter(zns->netlink.sock, pids, npids);
 
 	zns->t_netlink = NULL;
 
@@ -1183,6 +1468,8 @@ void kernel_init(struct zebra_ns *zns)
 
 void kernel_terminate(struct zebra_ns *zns, bool complete)
 {
+	unsigned int i;
+
 	THREAD_READ_OFF(zns->t_netlink);
 
 	if (zns->netlink.sock >= 0) {
@@ -1199,9 +1486,11 @@ void kernel_terminate(struct zebra_ns *zns, bool complete)
 	 * around until all work is done.
 	 */
 	if (complete) {
-		if (zns->netlink_dplane.sock >= 0) {
-			close(zns->netlink_dplane.sock);
-			zns->netlink_dplane.sock = -1;
+		for (i = 0; i < ZEBRA_DPLANE_MAX_WORKERS; i++) {
+			if (zns->netlink_dplane[i].sock >= 0) {
+				close(zns->netlink_dplane[i].sock);
+				zns->netlink_dplane[i].sock = -1;
+			}
 		}
 	}
 }
@@ -70,6 +70,42 @@ int netlink_talk_info(int (*filter)(struct nlmsghdr *, ns_id_t, int startup),
 
 extern int netlink_request(struct nlsock *nl, struct nlmsghdr *n);
 
+/*
+ * A batch of netlink requests, sent to the kernel with a single sendmsg().
+ * The kernel's replies are matched back to each request by sequence
+ * number.
+ */
+#define NL_BATCH_BUF_SIZE       (16 * NL_PKT_BUF_SIZE)
+#define NL_BATCH_MAX_MSGS       512
+
+struct nl_batch_msg {
+	uint32_t seq;
+
+	/* Opaque caller data, e.g. a dplane context */
+	void *arg;
+
+	/* Result of the request: 0 on success, -1 on error */
+	int status;
+	bool replied;
+};
+
+struct nl_batch {
+	/* Encoded messages, back-to-back; kept first for alignment */
+	char buf[NL_BATCH_BUF_SIZE];
+	size_t curlen;
+
+	/* All messages in a batch go to the same netlink socket */
+	const struct zebra_dplane_info *dp_info;
+
+	unsigned int msgcnt;
+	struct nl_batch_msg msgs[NL_BATCH_MAX_MSGS];
+};
+
+extern void nl_batch_init(struct nl_batch *bth);
+extern bool nl_batch_add(struct nl_batch *bth, const struct nlmsghdr *n,
+			 const struct zebra_dplane_info *dp_info, void *arg);
+extern int nl_batch_send(struct nl_batch *bth);
+
 #endif /* HAVE_NETLINK */
 
 #ifdef __cplusplus
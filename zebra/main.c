@@ -83,6 +83,8 @@ uint32_t nl_rcvbufsize = 4194304;
 #endif /* HAVE_NETLINK */
 
 #define OPTION_V6_RR_SEMANTICS 2000
+#define OPTION_DPLANE_WORKERS 2001
+#define OPTION_ZAPI_IO_THREADS 2002
 /* Command line options. */
 struct option longopts[] = {
 	{"batch", no_argument, NULL, 'b'},
@@ -93,10 +95,12 @@ struct option longopts[] = {
 	{"retain", no_argument, NULL, 'r'},
 	{"vrfdefaultname", required_argument, NULL, 'o'},
 	{"graceful_restart", required_argument, NULL, 'K'},
+	{"zapi-io-threads", required_argument, NULL, OPTION_ZAPI_IO_THREADS},
 #ifdef HAVE_NETLINK
 	{"vrfwnetns", no_argument, NULL, 'n'},
 	{"nl-bufsize", required_argument, NULL, 's'},
 	{"v6-rr-semantics", no_argument, NULL, OPTION_V6_RR_SEMANTICS},
+	{"dplane-workers", required_argument, NULL, OPTION_DPLANE_WORKERS},
 #endif /* HAVE_NETLINK */
 	{0}};
 
@@ -286,10 +290,12 @@ int main(int argc, char **argv)
 		"  -r, --retain             When program terminates, retain added route by zebra.\n"
 		"  -o, --vrfdefaultname     Set default VRF name.\n"
 		"  -K, --graceful_restart   Graceful restart at the kernel level, timer in seconds for expiration\n"
+		"      --zapi-io-threads    Number of pthreads serving client sockets\n"
 #ifdef HAVE_NETLINK
 		"  -n, --vrfwnetns          Use NetNS as VRF backend\n"
 		"  -s, --nl-bufsize         Set netlink receive buffer size\n"
 		"      --v6-rr-semantics    Use v6 RR semantics\n"
+		"      --dplane-workers     Number of kernel dataplane worker pthreads\n"
 #endif /* HAVE_NETLINK */
 #if defined(HANDLE_ZAPI_FUZZING)
 		"  -c <file>                Bypass normal startup and use this file for testing of zapi\n"
@@ -343,6 +349,16 @@ int main(int argc, char **argv)
 		case 'K':
 			graceful_restart = atoi(optarg);
 			break;
+		case OPTION_ZAPI_IO_THREADS:
+			zrouter.zapi_io_threads = atoi(optarg);
+			if (zrouter.zapi_io_threads > ZEBRA_ZAPI_IO_MAX_THREADS
+			    || zrouter.zapi_io_threads == 0) {
+				fprintf(stderr,
+					"Number of ZAPI I/O threads must be between 1 and %d\n",
+					ZEBRA_ZAPI_IO_MAX_THREADS);
+				return 1;
+			}
+			break;
 #ifdef HAVE_NETLINK
 		case 's':
 			nl_rcvbufsize = atoi(optarg);
@@ -353,6 +369,16 @@ int main(int argc, char **argv)
 		case OPTION_V6_RR_SEMANTICS:
 			v6_rr_semantics = true;
 			break;
+		case OPTION_DPLANE_WORKERS:
+			zrouter.dplane_workers = atoi(optarg);
+			if (zrouter.dplane_workers > ZEBRA_DPLANE_MAX_WORKERS
+			    || zrouter.dplane_workers == 0) {
+				fprintf(stderr,
+					"Number of dplane workers must be between 1 and %d\n",
+					ZEBRA_DPLANE_MAX_WORKERS);
+				return 1;
+			}
+			break;
 #endif /* HAVE_NETLINK */
 #if defined(HANDLE_ZAPI_FUZZING)
 		case 'c':
@@ -42,7 +42,7 @@ extern "C" {
 
 typedef enum { RNH_NEXTHOP_TYPE, RNH_IMPORT_CHECK_TYPE } rnh_type_t;
 
-PREDECL_LIST(rnh_list)
+PREDECL_DLIST(rnh_list)
 
 /* Nexthop structure. */
 struct rnh {
@@ -70,6 +70,9 @@ struct rnh {
 
 	struct route_node *node;
 
+	/* RIB node whose dest->nht list holds this rnh, if any */
+	struct route_node *resolved_node;
+
 	/*
 	 * if this has been filtered for the client
 	 */
@@ -83,6 +86,8 @@ struct rnh {
 
 PREDECL_LIST(re_list)
 
+struct nhg_hash_entry;
+
 struct route_entry {
 	/* Link list. */
 	struct re_list_item next;
@@ -93,6 +98,9 @@ struct route_entry {
 	/* Nexthop group from FIB (optional) */
 	struct nexthop_group fib_ng;
 
+	/* Shared nexthop group the route was last installed with, if any */
+	struct nhg_hash_entry *nhe;
+
 	/* Tag */
 	route_tag_t tag;
 
@@ -134,6 +142,10 @@ struct route_entry {
 #define ROUTE_ENTRY_INSTALLED        0x10
 /* Route has Failed installation into the Data Plane in some manner */
 #define ROUTE_ENTRY_FAILED           0x20
+/* Route is being reinstalled over the kernel nexthop object it already
+ * uses, which has been updated in place
+ */
+#define ROUTE_ENTRY_NHG_KEPT         0x40
 
 	/* Nexthop information. */
 	uint8_t nexthop_num;
@@ -161,9 +173,56 @@ struct route_entry {
  * sub-queue 4: any other origin (if any)
  */
 #define MQ_SIZE 5
+
+/*
+ * Each sub-queue holds one FIFO per VRF. The work queue serves the
+ * sub-queues weighted round-robin, a weight's worth of route nodes per
+ * turn, and within a sub-queue it takes one route node from each VRF in
+ * turn, so a burst in one VRF or protocol cannot hold up the others.
+ */
+PREDECL_LIST(mq_entry_list);
+PREDECL_DLIST(mq_vrf_list);
+
+/* A route node waiting in a sub-queue */
+struct meta_queue_entry {
+	struct mq_entry_list_item item;
+	struct route_node *rn;
+	struct timeval queued;
+};
+
+/* One VRF's route nodes in one sub-queue */
+struct meta_queue_vrf {
+	struct mq_vrf_list_item item;
+	struct zebra_vrf *zvrf;
+	uint8_t qindex;
+	struct mq_entry_list_head entries;
+};
+
+struct meta_subq {
+	/* VRFs with route nodes queued, in service order */
+	struct mq_vrf_list_head vrfs;
+
+	/* Route nodes served per turn, and what is left of this turn */
+	uint32_t weight;
+	uint32_t credit;
+
+	/* Statistics */
+	uint32_t depth;
+	uint32_t depth_max;
+	uint64_t dequeued;
+	uint64_t wait_usecs;
+	uint64_t wait_max_usecs;
+};
+
 struct meta_queue {
-	struct list *subq[MQ_SIZE];
+	struct meta_subq subq[MQ_SIZE];
 	uint32_t size; /* sum of lengths of all subqueues */
+
+	/* Sub-queue being served */
+	uint8_t cur;
+
+	/* meta_queue_vrf by (VRF, sub-queue) */
+	struct hash *vrfs;
 };
 
 /*
@@ -194,7 +253,9 @@ typedef struct rib_dest_t_ {
 	 * depending on this route node.
 	 * After route processing is returned from
 	 * the data plane we will run evaluate_rnh
-	 * on these prefixes.
+	 * on these prefixes. Together with the rnh tables
+	 * this is the reverse index used to find the rnh's
+	 * affected by a route change.
 	 */
 	struct rnh_list_head nht;
 
@@ -205,8 +266,10 @@ typedef struct rib_dest_t_ {
 
 } rib_dest_t;
 
-DECLARE_LIST(rnh_list, struct rnh, rnh_list_item);
+DECLARE_DLIST(rnh_list, struct rnh, rnh_list_item);
 DECLARE_LIST(re_list, struct route_entry, next);
+DECLARE_LIST(mq_entry_list, struct meta_queue_entry, item);
+DECLARE_DLIST(mq_vrf_list, struct meta_queue_vrf, item);
 
 #define RIB_ROUTE_QUEUED(x)	(1 << (x))
 // If MQ_SIZE is modified this value needs to be updated.
@@ -397,6 +460,9 @@ extern unsigned long rib_score_proto_table(uint8_t proto,
 					   struct route_table *table);
 extern void rib_queue_add(struct route_node *rn);
 extern void meta_queue_free(struct meta_queue *mq);
+extern void rib_meta_queue_free_vrf(struct meta_queue *mq,
+				    struct zebra_vrf *zvrf);
+extern void rib_meta_queue_show(struct vty *vty, struct meta_queue *mq);
 extern int zebra_rib_labeled_unicast(struct route_entry *re);
 extern struct route_table *rib_table_ipv6;
 
@@ -47,6 +47,26 @@ extern "C" {
 extern enum zebra_dplane_result kernel_route_update(
 	struct zebra_dplane_ctx *ctx);
 
+/*
+ * Scratch space for kernel_route_update_multi(). Each thread sending
+ * route updates keeps its own, for as long as it runs.
+ */
+struct kernel_route_batch;
+
+extern struct kernel_route_batch *kernel_route_batch_new(void);
+extern void kernel_route_batch_free(struct kernel_route_batch **batch);
+
+/*
+ * Update or delete a list of routes, setting the status of each context.
+ * Returns the number of messages sent to the kernel.
+ */
+extern int kernel_route_update_multi(struct dplane_ctx_q *ctx_list,
+				     struct kernel_route_batch *batch);
+
+/* Add, replace or delete a kernel nexthop object */
+extern enum zebra_dplane_result
+kernel_nexthop_update(struct zebra_dplane_ctx *ctx);
+
 extern enum zebra_dplane_result kernel_lsp_update(
 	struct zebra_dplane_ctx *ctx);
 
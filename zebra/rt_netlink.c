@@ -26,6 +26,7 @@
 #include <linux/lwtunnel.h>
 #include <linux/mpls_iptunnel.h>
 #include <linux/neighbour.h>
+#include <linux/nexthop.h>
 #include <linux/rtnetlink.h>
 
 /* Hack for GNU libc version 2. */
@@ -60,12 +61,16 @@
 #include "zebra/rtadv.h"
 #include "zebra/zebra_ptm.h"
 #include "zebra/zebra_mpls.h"
+#include "zebra/zebra_nhg.h"
+#include "zebra/zebra_router.h"
 #include "zebra/kernel_netlink.h"
 #include "zebra/rt_netlink.h"
 #include "zebra/zebra_mroute.h"
 #include "zebra/zebra_vxlan.h"
 #include "zebra/zebra_errors.h"
 
+DEFINE_MTYPE_STATIC(ZEBRA, NL_BATCH, "Netlink route batch")
+
 #ifndef AF_MPLS
 #define AF_MPLS 28
 #endif
@@ -968,6 +973,80 @@ int netlink_route_read(struct zebra_ns *zns)
 	return 0;
 }
 
+#define NHA_RTA(r)                                                             \
+	((struct rtattr *)(((char *)(r)) + NLMSG_ALIGN(sizeof(struct nhmsg))))
+
+/* Record the nexthop objects zebra left in the kernel last time round */
+static int netlink_nexthop_change_read(struct nlmsghdr *h, ns_id_t ns_id,
+				       int startup)
+{
+	struct nhmsg *nhm = NLMSG_DATA(h);
+	struct rtattr *tb[NHA_MAX + 1];
+	int len;
+
+	if (h->nlmsg_type != RTM_NEWNEXTHOP)
+		return 0;
+
+	len = h->nlmsg_len - NLMSG_LENGTH(sizeof(struct nhmsg));
+	if (len < 0) {
+		zlog_err("%s: Message received from netlink is of a broken size %d %zu",
+			 __func__, h->nlmsg_len,
+			 (size_t)NLMSG_LENGTH(sizeof(struct nhmsg)));
+		return -1;
+	}
+
+	if (nhm->nh_protocol != RTPROT_ZEBRA || ns_id != NS_DEFAULT)
+		return 0;
+
+	memset(tb, 0, sizeof(tb));
+	netlink_parse_rtattr(tb, NHA_MAX, NHA_RTA(nhm), len);
+
+	if (!tb[NHA_ID])
+		return 0;
+
+	zebra_nhg_kernel_stale_add(*(uint32_t *)RTA_DATA(tb[NHA_ID]),
+				   tb[NHA_GROUP] != NULL);
+
+	return 0;
+}
+
+/*
+ * Read the kernel's nexthop objects.  Only called at startup; this is
+ * also how we find out whether the kernel has nexthop objects at all.
+ */
+int netlink_nexthop_read(struct zebra_ns *zns)
+{
+	int ret;
+	struct zebra_dplane_info dp_info;
+	struct {
+		struct nlmsghdr n;
+		struct nhmsg nhm;
+	} req;
+
+	zebra_dplane_info_from_zns(&dp_info, zns, true /*is_cmd*/);
+
+	memset(&req, 0, sizeof(req));
+	req.n.nlmsg_type = RTM_GETNEXTHOP;
+	req.n.nlmsg_flags = NLM_F_ROOT | NLM_F_MATCH | NLM_F_REQUEST;
+	req.n.nlmsg_len = NLMSG_LENGTH(sizeof(struct nhmsg));
+	req.nhm.nh_family = AF_UNSPEC;
+
+	ret = netlink_request(&zns->netlink_cmd, &req.n);
+	if (ret >= 0)
+		ret = netlink_parse_info(netlink_nexthop_change_read,
+					 &zns->netlink_cmd, &dp_info, 0, 1);
+
+	if (zns->ns_id == NS_DEFAULT) {
+		zrouter.nhg_kernel_supported = (ret >= 0);
+
+		if (IS_ZEBRA_DEBUG_KERNEL)
+			zlog_debug("Kernel nexthop objects %ssupported",
+				   ret >= 0 ? "" : "not ");
+	}
+
+	return ret;
+}
+
 static void _netlink_route_nl_add_gateway_info(uint8_t route_family,
 					       uint8_t gw_family,
 					       struct nlmsghdr *nlmsg,
@@ -1470,10 +1549,58 @@ static int netlink_neigh_update(int cmd, int ifindex, uint32_t addr, char *lla,
 			    0);
 }
 
+/* Request buffer for a single route message */
+struct nl_route_req {
+	struct nlmsghdr n;
+	struct rtmsg r;
+	char buf[NL_PKT_BUF_SIZE];
+};
+
 /*
- * Routing table change via netlink interface, using a dataplane context object
+ * Find the preferred source of a route from its nexthops, the way the
+ * nexthop encoding below does; for routes that refer to a kernel nexthop
+ * object, and so do not carry the nexthops themselves.
  */
-static int netlink_route_multipath(int cmd, struct zebra_dplane_ctx *ctx)
+static bool netlink_route_nexthop_src(const struct nexthop_group *ng,
+				      int family, union g_addr *src)
+{
+	struct nexthop *nexthop;
+
+	for (ALL_NEXTHOPS_PTR(ng, nexthop)) {
+		if (!CHECK_FLAG(nexthop->flags, NEXTHOP_FLAG_RECURSIVE)
+		    && !NEXTHOP_IS_ACTIVE(nexthop->flags))
+			continue;
+
+		if (family == AF_INET) {
+			if (nexthop->rmap_src.ipv4.s_addr != 0) {
+				src->ipv4 = nexthop->rmap_src.ipv4;
+				return true;
+			} else if (nexthop->src.ipv4.s_addr != 0) {
+				src->ipv4 = nexthop->src.ipv4;
+				return true;
+			}
+		} else if (family == AF_INET6) {
+			if (!IN6_IS_ADDR_UNSPECIFIED(&nexthop->rmap_src.ipv6)) {
+				src->ipv6 = nexthop->rmap_src.ipv6;
+				return true;
+			} else if (!IN6_IS_ADDR_UNSPECIFIED(
+					   &nexthop->src.ipv6)) {
+				src->ipv6 = nexthop->src.ipv6;
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
+
+/*
+ * Encode a routing table change from a dataplane context object into a
+ * netlink message. Returns the length of the message, or zero if there is
+ * nothing to send to the kernel.
+ */
+static int netlink_route_multipath_encode(int cmd, struct zebra_dplane_ctx *ctx,
+					  struct nl_route_req *req)
 {
 	int bytelen;
 	struct nexthop *nexthop = NULL;
@@ -1483,43 +1610,37 @@ static int netlink_route_multipath(int cmd, struct zebra_dplane_ctx *ctx)
 	int setsrc = 0;
 	union g_addr src;
 	const struct prefix *p, *src_p;
-	uint32_t table_id;
-
-	struct {
-		struct nlmsghdr n;
-		struct rtmsg r;
-		char buf[NL_PKT_BUF_SIZE];
-	} req;
+	uint32_t table_id, nhg_id;
 
 	p = dplane_ctx_get_dest(ctx);
 	src_p = dplane_ctx_get_src(ctx);
 
 	family = PREFIX_FAMILY(p);
 
-	memset(&req, 0, sizeof(req) - NL_PKT_BUF_SIZE);
+	memset(req, 0, sizeof(*req) - NL_PKT_BUF_SIZE);
 
 	bytelen = (family == AF_INET ? 4 : 16);
 
-	req.n.nlmsg_len = NLMSG_LENGTH(sizeof(struct rtmsg));
-	req.n.nlmsg_flags = NLM_F_CREATE | NLM_F_REQUEST;
+	req->n.nlmsg_len = NLMSG_LENGTH(sizeof(struct rtmsg));
+	req->n.nlmsg_flags = NLM_F_CREATE | NLM_F_REQUEST;
 
 	if ((cmd == RTM_NEWROUTE) &&
 	    ((p->family == AF_INET) || v6_rr_semantics))
-		req.n.nlmsg_flags |= NLM_F_REPLACE;
+		req->n.nlmsg_flags |= NLM_F_REPLACE;
 
-	req.n.nlmsg_type = cmd;
+	req->n.nlmsg_type = cmd;
 
-	req.n.nlmsg_pid = dplane_ctx_get_ns(ctx)->nls.snl.nl_pid;
+	req->n.nlmsg_pid = dplane_ctx_get_ns(ctx)->nls.snl.nl_pid;
 
-	req.r.rtm_family = family;
-	req.r.rtm_dst_len = p->prefixlen;
-	req.r.rtm_src_len = src_p ? src_p->prefixlen : 0;
-	req.r.rtm_scope = RT_SCOPE_UNIVERSE;
+	req->r.rtm_family = family;
+	req->r.rtm_dst_len = p->prefixlen;
+	req->r.rtm_src_len = src_p ? src_p->prefixlen : 0;
+	req->r.rtm_scope = RT_SCOPE_UNIVERSE;
 
 	if (cmd == RTM_DELROUTE)
-		req.r.rtm_protocol = zebra2proto(dplane_ctx_get_old_type(ctx));
+		req->r.rtm_protocol = zebra2proto(dplane_ctx_get_old_type(ctx));
 	else
-		req.r.rtm_protocol = zebra2proto(dplane_ctx_get_type(ctx));
+		req->r.rtm_protocol = zebra2proto(dplane_ctx_get_type(ctx));
 
 	/*
 	 * blackhole routes are not RTN_UNICAST, they are
@@ -1530,11 +1651,11 @@ static int netlink_route_multipath(int cmd, struct zebra_dplane_ctx *ctx)
 	 * the RTM_DELROUTE case
 	 */
 	if (cmd != RTM_DELROUTE)
-		req.r.rtm_type = RTN_UNICAST;
+		req->r.rtm_type = RTN_UNICAST;
 
-	addattr_l(&req.n, sizeof(req), RTA_DST, &p->u.prefix, bytelen);
+	addattr_l(&req->n, sizeof(*req), RTA_DST, &p->u.prefix, bytelen);
 	if (src_p)
-		addattr_l(&req.n, sizeof(req), RTA_SRC, &src_p->u.prefix,
+		addattr_l(&req->n, sizeof(*req), RTA_SRC, &src_p->u.prefix,
 			  bytelen);
 
 	/* Metric. */
@@ -1544,7 +1665,7 @@ static int netlink_route_multipath(int cmd, struct zebra_dplane_ctx *ctx)
 	 * path(s)
 	 * by the routing protocol and for communicating with protocol peers.
 	 */
-	addattr32(&req.n, sizeof(req), RTA_PRIORITY, NL_DEFAULT_ROUTE_METRIC);
+	addattr32(&req->n, sizeof(*req), RTA_PRIORITY, NL_DEFAULT_ROUTE_METRIC);
 
 #if defined(SUPPORT_REALMS)
 	{
@@ -1556,16 +1677,16 @@ static int netlink_route_multipath(int cmd, struct zebra_dplane_ctx *ctx)
 			tag = dplane_ctx_get_tag(ctx);
 
 		if (tag > 0 && tag <= 255)
-			addattr32(&req.n, sizeof(req), RTA_FLOW, tag);
+			addattr32(&req->n, sizeof(*req), RTA_FLOW, tag);
 	}
 #endif
 	/* Table corresponding to this route. */
 	table_id = dplane_ctx_get_table(ctx);
 	if (table_id < 256)
-		req.r.rtm_table = table_id;
+		req->r.rtm_table = table_id;
 	else {
-		req.r.rtm_table = RT_TABLE_UNSPEC;
-		addattr32(&req.n, sizeof(req), RTA_TABLE, table_id);
+		req->r.rtm_table = RT_TABLE_UNSPEC;
+		addattr32(&req->n, sizeof(*req), RTA_TABLE, table_id);
 	}
 
 	_netlink_route_debug(cmd, p, family, dplane_ctx_get_vrf(ctx), table_id);
@@ -1591,10 +1712,24 @@ static int netlink_route_multipath(int cmd, struct zebra_dplane_ctx *ctx)
 		rta->rta_len = RTA_LENGTH(0);
 		rta_addattr_l(rta, NL_PKT_BUF_SIZE,
 			      RTAX_MTU, &mtu, sizeof(mtu));
-		addattr_l(&req.n, NL_PKT_BUF_SIZE, RTA_METRICS, RTA_DATA(rta),
+		addattr_l(&req->n, NL_PKT_BUF_SIZE, RTA_METRICS, RTA_DATA(rta),
 			  RTA_PAYLOAD(rta));
 	}
 
+	/* The route's nexthops are installed as a kernel nexthop object:
+	 * just refer to it.
+	 */
+	nhg_id = dplane_ctx_get_nhg_id(ctx);
+	if (nhg_id) {
+		addattr32(&req->n, sizeof(*req), RTA_NH_ID, nhg_id);
+
+		if (netlink_route_nexthop_src(dplane_ctx_get_ng(ctx), family,
+					      &src))
+			addattr_l(&req->n, sizeof(*req), RTA_PREFSRC, &src,
+				  bytelen);
+		goto skip;
+	}
+
 	/* Count overall nexthops so we can decide whether to use singlepath
 	 * or multipath case.
 	 */
@@ -1622,13 +1757,13 @@ static int netlink_route_multipath(int cmd, struct zebra_dplane_ctx *ctx)
 			if (nexthop->type == NEXTHOP_TYPE_BLACKHOLE) {
 				switch (nexthop->bh_type) {
 				case BLACKHOLE_ADMINPROHIB:
-					req.r.rtm_type = RTN_PROHIBIT;
+					req->r.rtm_type = RTN_PROHIBIT;
 					break;
 				case BLACKHOLE_REJECT:
-					req.r.rtm_type = RTN_UNREACHABLE;
+					req->r.rtm_type = RTN_UNREACHABLE;
 					break;
 				default:
-					req.r.rtm_type = RTN_BLACKHOLE;
+					req->r.rtm_type = RTN_BLACKHOLE;
 					break;
 				}
 				goto skip;
@@ -1675,18 +1810,18 @@ static int netlink_route_multipath(int cmd, struct zebra_dplane_ctx *ctx)
 						    : "single-path";
 
 				_netlink_route_build_singlepath(
-					routedesc, bytelen, nexthop, &req.n,
-					&req.r, sizeof(req), cmd);
+					routedesc, bytelen, nexthop, &req->n,
+					&req->r, sizeof(*req), cmd);
 				nexthop_num++;
 				break;
 			}
 		}
 		if (setsrc && (cmd == RTM_NEWROUTE)) {
 			if (family == AF_INET)
-				addattr_l(&req.n, sizeof(req), RTA_PREFSRC,
+				addattr_l(&req->n, sizeof(*req), RTA_PREFSRC,
 					  &src.ipv4, bytelen);
 			else if (family == AF_INET6)
-				addattr_l(&req.n, sizeof(req), RTA_PREFSRC,
+				addattr_l(&req->n, sizeof(*req), RTA_PREFSRC,
 					  &src.ipv6, bytelen);
 		}
 	} else {    /* Multipath case */
@@ -1746,7 +1881,7 @@ static int netlink_route_multipath(int cmd, struct zebra_dplane_ctx *ctx)
 
 				_netlink_route_build_multipath(
 					routedesc, bytelen, nexthop, rta, rtnh,
-					&req.r, &src1);
+					&req->r, &src1);
 				rtnh = RTNH_NEXT(rtnh);
 
 				if (!setsrc && src1) {
@@ -1761,17 +1896,17 @@ static int netlink_route_multipath(int cmd, struct zebra_dplane_ctx *ctx)
 		}
 		if (setsrc && (cmd == RTM_NEWROUTE)) {
 			if (family == AF_INET)
-				addattr_l(&req.n, sizeof(req), RTA_PREFSRC,
+				addattr_l(&req->n, sizeof(*req), RTA_PREFSRC,
 					  &src.ipv4, bytelen);
 			else if (family == AF_INET6)
-				addattr_l(&req.n, sizeof(req), RTA_PREFSRC,
+				addattr_l(&req->n, sizeof(*req), RTA_PREFSRC,
 					  &src.ipv6, bytelen);
 			if (IS_ZEBRA_DEBUG_KERNEL)
 				zlog_debug("Setting source");
 		}
 
 		if (rta->rta_len > RTA_LENGTH(0))
-			addattr_l(&req.n, NL_PKT_BUF_SIZE, RTA_MULTIPATH,
+			addattr_l(&req->n, NL_PKT_BUF_SIZE, RTA_MULTIPATH,
 				  RTA_DATA(rta), RTA_PAYLOAD(rta));
 	}
 
@@ -1784,11 +1919,121 @@ static int netlink_route_multipath(int cmd, struct zebra_dplane_ctx *ctx)
 	}
 
 skip:
+	return req->n.nlmsg_len;
+}
+
+/*
+ * Routing table change via netlink interface, using a dataplane context object
+ */
+static int netlink_route_multipath(int cmd, struct zebra_dplane_ctx *ctx)
+{
+	struct nl_route_req req;
+
+	if (netlink_route_multipath_encode(cmd, ctx, &req) == 0)
+		return 0;
+
 	/* Talk to netlink socket. */
 	return netlink_talk_info(netlink_talk_filter, &req.n,
 				 dplane_ctx_get_ns(ctx), 0);
 }
 
+/*
+ * Add, replace or delete a kernel nexthop object, using info from a
+ * dataplane context object. A group refers to its members by id, so they
+ * have to be installed before it.
+ */
+static int netlink_nexthop(int cmd, struct zebra_dplane_ctx *ctx)
+{
+	struct {
+		struct nlmsghdr n;
+		struct nhmsg nhm;
+		char buf[NL_PKT_BUF_SIZE];
+	} req;
+	struct nexthop_grp grp[MULTIPATH_NUM];
+	const struct nexthop *nh;
+	const uint32_t *grp_ids;
+	uint32_t id = dplane_ctx_get_nhe_id(ctx);
+	uint8_t num, i;
+
+	memset(&req, 0, sizeof(req) - NL_PKT_BUF_SIZE);
+
+	req.n.nlmsg_len = NLMSG_LENGTH(sizeof(struct nhmsg));
+	req.n.nlmsg_flags = NLM_F_REQUEST;
+	if (cmd == RTM_NEWNEXTHOP)
+		req.n.nlmsg_flags |= NLM_F_CREATE | NLM_F_REPLACE;
+	req.n.nlmsg_type = cmd;
+	req.n.nlmsg_pid = dplane_ctx_get_ns(ctx)->nls.snl.nl_pid;
+
+	req.nhm.nh_family = AF_UNSPEC;
+	req.nhm.nh_protocol = RTPROT_ZEBRA;
+
+	addattr32(&req.n, sizeof(req), NHA_ID, id);
+
+	if (cmd == RTM_NEWNEXTHOP) {
+		grp_ids = dplane_ctx_get_nhe_grp(ctx, &num);
+		nh = dplane_ctx_get_nhe_nexthop(ctx);
+
+		if (num) {
+			/* Members all have the same weight */
+			memset(grp, 0, sizeof(grp));
+			for (i = 0; i < num; i++)
+				grp[i].id = grp_ids[i];
+
+			addattr_l(&req.n, sizeof(req), NHA_GROUP, grp,
+				  num * sizeof(*grp));
+		} else {
+			req.nhm.nh_family =
+				afi2family(dplane_ctx_get_nhe_afi(ctx));
+			if (CHECK_FLAG(nh->flags, NEXTHOP_FLAG_ONLINK))
+				req.nhm.nh_flags |= RTNH_F_ONLINK;
+
+			addattr32(&req.n, sizeof(req), NHA_OIF, nh->ifindex);
+
+			switch (nh->type) {
+			case NEXTHOP_TYPE_IPV4:
+			case NEXTHOP_TYPE_IPV4_IFINDEX:
+				addattr_l(&req.n, sizeof(req), NHA_GATEWAY,
+					  &nh->gate.ipv4, IPV4_MAX_BYTELEN);
+				break;
+			case NEXTHOP_TYPE_IPV6:
+			case NEXTHOP_TYPE_IPV6_IFINDEX:
+				addattr_l(&req.n, sizeof(req), NHA_GATEWAY,
+					  &nh->gate.ipv6, IPV6_MAX_BYTELEN);
+				break;
+			case NEXTHOP_TYPE_IFINDEX:
+			case NEXTHOP_TYPE_BLACKHOLE:
+				break;
+			}
+		}
+	}
+
+	if (IS_ZEBRA_DEBUG_KERNEL)
+		zlog_debug("%s: %s id %u", __func__, nl_msg_type_to_str(cmd),
+			   id);
+
+	return netlink_talk_info(netlink_talk_filter, &req.n,
+				 dplane_ctx_get_ns(ctx), 0);
+}
+
+enum zebra_dplane_result kernel_nexthop_update(struct zebra_dplane_ctx *ctx)
+{
+	int ret = -1;
+
+	switch (dplane_ctx_get_op(ctx)) {
+	case DPLANE_OP_NH_INSTALL:
+		ret = netlink_nexthop(RTM_NEWNEXTHOP, ctx);
+		break;
+	case DPLANE_OP_NH_DELETE:
+		ret = netlink_nexthop(RTM_DELNEXTHOP, ctx);
+		break;
+	default:
+		break;
+	}
+
+	return (ret == 0 ?
+		ZEBRA_DPLANE_REQUEST_SUCCESS : ZEBRA_DPLANE_REQUEST_FAILURE);
+}
+
 int kernel_get_ipmr_sg_stats(struct zebra_vrf *zvrf, void *in)
 {
 	uint32_t actual_table;
@@ -1843,24 +2088,26 @@ int kernel_get_ipmr_sg_stats(struct zebra_vrf *zvrf, void *in)
 }
 
 /*
- * Update or delete a prefix from the kernel,
- * using info from a dataplane context.
+ * Work out the netlink command for a dataplane route update, and whether
+ * the old route must be deleted first. The result of that delete is
+ * always ignored.
  */
-enum zebra_dplane_result kernel_route_update(struct zebra_dplane_ctx *ctx)
+static int netlink_route_update_cmd(struct zebra_dplane_ctx *ctx, int *cmd,
+				    bool *predelete)
 {
-	int cmd, ret;
 	const struct prefix *p = dplane_ctx_get_dest(ctx);
-	struct nexthop *nexthop;
+
+	*predelete = false;
 
 	if (dplane_ctx_get_op(ctx) == DPLANE_OP_ROUTE_DELETE) {
-		cmd = RTM_DELROUTE;
+		*cmd = RTM_DELROUTE;
 	} else if (dplane_ctx_get_op(ctx) == DPLANE_OP_ROUTE_INSTALL) {
-		cmd = RTM_NEWROUTE;
+		*cmd = RTM_NEWROUTE;
 	} else if (dplane_ctx_get_op(ctx) == DPLANE_OP_ROUTE_UPDATE) {
 
 		if (p->family == AF_INET || v6_rr_semantics) {
 			/* Single 'replace' operation */
-			cmd = RTM_NEWROUTE;
+			*cmd = RTM_NEWROUTE;
 
 			/*
 			 * With route replace semantics in place
@@ -1872,8 +2119,7 @@ enum zebra_dplane_result kernel_route_update(struct zebra_dplane_ctx *ctx)
 			 */
 			if (RSYSTEM_ROUTE(dplane_ctx_get_type(ctx)) &&
 			    !RSYSTEM_ROUTE(dplane_ctx_get_old_type(ctx)))
-				(void)netlink_route_multipath(RTM_DELROUTE,
-							      ctx);
+				*predelete = true;
 		} else {
 			/*
 			 * So v6 route replace semantics are not in
@@ -1888,35 +2134,200 @@ enum zebra_dplane_result kernel_route_update(struct zebra_dplane_ctx *ctx)
 			 * screwed.
 			 */
 			if (!RSYSTEM_ROUTE(dplane_ctx_get_old_type(ctx)))
-				(void)netlink_route_multipath(RTM_DELROUTE,
-							      ctx);
-			cmd = RTM_NEWROUTE;
+				*predelete = true;
+			*cmd = RTM_NEWROUTE;
 		}
 
 	} else {
-		return ZEBRA_DPLANE_REQUEST_FAILURE;
+		return -1;
+	}
+
+	return 0;
+}
+
+/*
+ * Update installed nexthops to signal which have been installed.
+ */
+static void netlink_route_update_fib(struct zebra_dplane_ctx *ctx)
+{
+	struct nexthop *nexthop;
+
+	for (ALL_NEXTHOPS_PTR(dplane_ctx_get_ng(ctx), nexthop)) {
+		if (CHECK_FLAG(nexthop->flags, NEXTHOP_FLAG_RECURSIVE))
+			continue;
+
+		if (CHECK_FLAG(nexthop->flags, NEXTHOP_FLAG_ACTIVE)) {
+			SET_FLAG(nexthop->flags, NEXTHOP_FLAG_FIB);
+		}
+	}
+}
+
+/*
+ * Does the kernel already have this route update?  That is when the route
+ * stays on the nexthop object it refers to, which has been replaced in
+ * place, unless the route's preferred source came with its nexthops.
+ */
+static bool netlink_route_update_kept(struct zebra_dplane_ctx *ctx)
+{
+	union g_addr src;
+
+	return dplane_ctx_get_nhg_kept(ctx)
+	       && !netlink_route_nexthop_src(
+		       dplane_ctx_get_ng(ctx),
+		       PREFIX_FAMILY(dplane_ctx_get_dest(ctx)), &src);
+}
+
+/*
+ * Update or delete a prefix from the kernel,
+ * using info from a dataplane context.
+ */
+enum zebra_dplane_result kernel_route_update(struct zebra_dplane_ctx *ctx)
+{
+	int cmd, ret;
+	bool predelete;
+
+	if (netlink_route_update_kept(ctx)) {
+		netlink_route_update_fib(ctx);
+		return ZEBRA_DPLANE_REQUEST_SUCCESS;
 	}
 
+	if (netlink_route_update_cmd(ctx, &cmd, &predelete) < 0)
+		return ZEBRA_DPLANE_REQUEST_FAILURE;
+
+	if (predelete)
+		(void)netlink_route_multipath(RTM_DELROUTE, ctx);
+
 	if (!RSYSTEM_ROUTE(dplane_ctx_get_type(ctx)))
 		ret = netlink_route_multipath(cmd, ctx);
 	else
 		ret = 0;
-	if ((cmd == RTM_NEWROUTE) && (ret == 0)) {
-		/* Update installed nexthops to signal which have been
-		 * installed.
-		 */
-		for (ALL_NEXTHOPS_PTR(dplane_ctx_get_ng(ctx), nexthop)) {
-			if (CHECK_FLAG(nexthop->flags, NEXTHOP_FLAG_RECURSIVE))
-				continue;
+	if ((cmd == RTM_NEWROUTE) && (ret == 0))
+		netlink_route_update_fib(ctx);
 
-			if (CHECK_FLAG(nexthop->flags, NEXTHOP_FLAG_ACTIVE)) {
-				SET_FLAG(nexthop->flags, NEXTHOP_FLAG_FIB);
-			}
+	return (ret == 0 ?
+		ZEBRA_DPLANE_REQUEST_SUCCESS : ZEBRA_DPLANE_REQUEST_FAILURE);
+}
+
+/*
+ * Send a batch of route messages and apply the kernel's replies to
+ * their contexts. Returns the number of messages sent.
+ */
+static unsigned int netlink_route_batch_flush(struct nl_batch *bth)
+{
+	struct nl_batch_msg *m;
+	unsigned int i, count;
+
+	(void)nl_batch_send(bth);
+
+	for (i = 0; i < bth->msgcnt; i++) {
+		m = &bth->msgs[i];
+
+		/* Pre-deletes have no context; their result is ignored */
+		if (m->arg && m->status != 0)
+			dplane_ctx_set_status(m->arg,
+					      ZEBRA_DPLANE_REQUEST_FAILURE);
+	}
+
+	count = bth->msgcnt;
+	nl_batch_init(bth);
+
+	return count;
+}
+
+static unsigned int netlink_route_batch_add(struct nl_batch *bth,
+					    struct nl_route_req *req,
+					    struct zebra_dplane_ctx *ctx,
+					    uint32_t seq, void *arg)
+{
+	unsigned int count = 0;
+
+	req->n.nlmsg_seq = seq;
+
+	if (!nl_batch_add(bth, &req->n, dplane_ctx_get_ns(ctx), arg)) {
+		count = netlink_route_batch_flush(bth);
+		nl_batch_add(bth, &req->n, dplane_ctx_get_ns(ctx), arg);
+	}
+
+	return count;
+}
+
+struct kernel_route_batch {
+	struct nl_batch nlb;
+};
+
+struct kernel_route_batch *kernel_route_batch_new(void)
+{
+	return XMALLOC(MTYPE_NL_BATCH, sizeof(struct kernel_route_batch));
+}
+
+void kernel_route_batch_free(struct kernel_route_batch **batch)
+{
+	XFREE(MTYPE_NL_BATCH, *batch);
+}
+
+/*
+ * Update or delete a list of prefixes in the kernel. The netlink messages
+ * for all the contexts are sent together, and each context's status is
+ * set from the kernel's reply to its own message. Returns the number of
+ * netlink messages sent.
+ */
+int kernel_route_update_multi(struct dplane_ctx_q *ctx_list,
+			      struct kernel_route_batch *krb)
+{
+	struct nl_batch *batch = &krb->nlb;
+	struct dplane_ctx_q handled;
+	struct zebra_dplane_ctx *ctx;
+	struct nl_route_req req;
+	unsigned int count = 0;
+	uint32_t seq;
+	bool predelete;
+	int cmd;
+
+	TAILQ_INIT(&handled);
+	nl_batch_init(batch);
+
+	while ((ctx = dplane_ctx_dequeue(ctx_list)) != NULL) {
+		dplane_ctx_enqueue_tail(&handled, ctx);
+		dplane_ctx_set_status(ctx, ZEBRA_DPLANE_REQUEST_SUCCESS);
+
+		if (netlink_route_update_kept(ctx))
+			continue;
+
+		if (netlink_route_update_cmd(ctx, &cmd, &predelete) < 0) {
+			dplane_ctx_set_status(ctx,
+					      ZEBRA_DPLANE_REQUEST_FAILURE);
+			continue;
 		}
+
+		/*
+		 * Update contexts reserve two sequence numbers, so a
+		 * pre-delete and the update itself can be told apart.
+		 */
+		seq = dplane_ctx_get_ns(ctx)->nls.seq;
+
+		if (predelete
+		    && netlink_route_multipath_encode(RTM_DELROUTE, ctx, &req))
+			count += netlink_route_batch_add(batch, &req, ctx,
+							 seq++, NULL);
+
+		if (!RSYSTEM_ROUTE(dplane_ctx_get_type(ctx))
+		    && netlink_route_multipath_encode(cmd, ctx, &req))
+			count += netlink_route_batch_add(batch, &req, ctx,
+							 seq, ctx);
 	}
 
-	return (ret == 0 ?
-		ZEBRA_DPLANE_REQUEST_SUCCESS : ZEBRA_DPLANE_REQUEST_FAILURE);
+	count += netlink_route_batch_flush(batch);
+
+	while ((ctx = dplane_ctx_dequeue(&handled)) != NULL) {
+		if (dplane_ctx_get_op(ctx) != DPLANE_OP_ROUTE_DELETE
+		    && dplane_ctx_get_status(ctx)
+			       == ZEBRA_DPLANE_REQUEST_SUCCESS)
+			netlink_route_update_fib(ctx);
+
+		dplane_ctx_enqueue_tail(ctx_list, ctx);
+	}
+
+	return count;
 }
 
 int kernel_neigh_update(int add, int ifindex, uint32_t addr, char *lla,
@@ -364,6 +364,49 @@ enum zebra_dplane_result kernel_route_update(struct zebra_dplane_ctx *ctx)
 	return res;
 }
 
+/*
+ * The routing socket has no way to batch updates; apply each one in turn.
+ * There is nothing to keep between calls.
+ */
+struct kernel_route_batch *kernel_route_batch_new(void)
+{
+	return NULL;
+}
+
+void kernel_route_batch_free(struct kernel_route_batch **batch)
+{
+	*batch = NULL;
+}
+
+int kernel_route_update_multi(struct dplane_ctx_q *ctx_list,
+			      struct kernel_route_batch *batch)
+{
+	struct dplane_ctx_q handled;
+	struct zebra_dplane_ctx *ctx;
+	int count = 0;
+
+	TAILQ_INIT(&handled);
+
+	while ((ctx = dplane_ctx_dequeue(ctx_list)) != NULL) {
+		dplane_ctx_set_status(ctx, kernel_route_update(ctx));
+		dplane_ctx_enqueue_tail(&handled, ctx);
+		count++;
+	}
+
+	dplane_ctx_list_append(ctx_list, &handled);
+
+	return count;
+}
+
+/*
+ * No kernel nexthop objects here: zebra_nhg_kernel_enabled() is never true,
+ * so nothing gets queued for them.
+ */
+enum zebra_dplane_result kernel_nexthop_update(struct zebra_dplane_ctx *ctx)
+{
+	return ZEBRA_DPLANE_REQUEST_FAILURE;
+}
+
 int kernel_neigh_update(int add, int ifindex, uint32_t addr, char *lla,
 			int llalen, ns_id_t ns_id)
 {
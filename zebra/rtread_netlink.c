@@ -31,6 +31,7 @@
 
 void route_read(struct zebra_ns *zns)
 {
+	netlink_nexthop_read(zns);
 	netlink_route_read(zns);
 }
 
@@ -1040,7 +1040,7 @@ static void zread_rnh_register(ZAPI_HANDLER_ARGS)
 	uint8_t flags = 0;
 	uint16_t type = cmd2type[hdr->command];
 	bool exist;
-	bool flag_changed = false;
+	bool flag_changed;
 	uint8_t orig_flags;
 
 	if (IS_ZEBRA_DEBUG_NHT)
@@ -1091,6 +1091,7 @@ static void zread_rnh_register(ZAPI_HANDLER_ARGS)
 			return;
 
 		orig_flags = rnh->flags;
+		flag_changed = false;
 		if (type == RNH_NEXTHOP_TYPE) {
 			if (flags
 			    && !CHECK_FLAG(rnh->flags, ZEBRA_NHT_CONNECTED))
@@ -1385,10 +1386,31 @@ void zserv_nexthop_num_warn(const char *caller, const struct prefix *p,
 	}
 }
 
-static void zread_route_add(ZAPI_HANDLER_ARGS)
+/*
+ * Count routes received from a client, in one second buckets of monotime,
+ * for the route rates shown by "show zebra client".
+ */
+static void zserv_route_rate_update(struct zserv *client, uint32_t count)
+{
+	time_t now = monotime(NULL);
+
+	if (now != client->route_rate_time) {
+		if (now == client->route_rate_time + 1)
+			client->route_rate_last = client->route_rate_cur;
+		else
+			client->route_rate_last = 0;
+		client->route_rate_cur = 0;
+		client->route_rate_time = now;
+	}
+
+	client->route_rate_cur += count;
+	if (client->route_rate_cur > client->route_rate_peak)
+		client->route_rate_peak = client->route_rate_cur;
+}
+
+static void zapi_route_add(struct zserv *client, struct zebra_vrf *zvrf,
+			   struct zapi_route *api)
 {
-	struct stream *s;
-	struct zapi_route api;
 	struct zapi_nexthop *api_nh;
 	afi_t afi;
 	struct prefix_ipv6 *src_p = NULL;
@@ -1398,43 +1420,35 @@ static void zread_route_add(ZAPI_HANDLER_ARGS)
 	vrf_id_t vrf_id = 0;
 	struct ipaddr vtep_ip;
 
-	s = msg;
-	if (zapi_route_decode(s, &api) < 0) {
-		if (IS_ZEBRA_DEBUG_RECV)
-			zlog_debug("%s: Unable to decode zapi_route sent",
-				   __PRETTY_FUNCTION__);
-		return;
-	}
-
 	if (IS_ZEBRA_DEBUG_RECV) {
 		char buf_prefix[PREFIX_STRLEN];
 
-		prefix2str(&api.prefix, buf_prefix, sizeof(buf_prefix));
+		prefix2str(&api->prefix, buf_prefix, sizeof(buf_prefix));
 		zlog_debug("%s: p=%s, ZAPI_MESSAGE_LABEL: %sset, flags=0x%x",
 			   __func__, buf_prefix,
-			   (CHECK_FLAG(api.message, ZAPI_MESSAGE_LABEL) ? ""
+			   (CHECK_FLAG(api->message, ZAPI_MESSAGE_LABEL) ? ""
 									: "un"),
-			   api.flags);
+			   api->flags);
 	}
 
 	/* Allocate new route. */
 	vrf_id = zvrf_id(zvrf);
 	re = XCALLOC(MTYPE_RE, sizeof(struct route_entry));
-	re->type = api.type;
-	re->instance = api.instance;
-	re->flags = api.flags;
+	re->type = api->type;
+	re->instance = api->instance;
+	re->flags = api->flags;
 	re->uptime = monotime(NULL);
 	re->vrf_id = vrf_id;
-	if (api.tableid)
-		re->table = api.tableid;
+	if (api->tableid)
+		re->table = api->tableid;
 	else
 		re->table = zvrf->table_id;
 
-	if (!CHECK_FLAG(api.message, ZAPI_MESSAGE_NEXTHOP)
-	    || api.nexthop_num == 0) {
+	if (!CHECK_FLAG(api->message, ZAPI_MESSAGE_NEXTHOP)
+	    || api->nexthop_num == 0) {
 		flog_warn(EC_ZEBRA_RX_ROUTE_NO_NEXTHOPS,
 			  "%s: received a route without nexthops for prefix %pFX from client %s",
-			  __func__, &api.prefix,
+			  __func__, &api->prefix,
 			  zebra_route_string(client->proto));
 		XFREE(MTYPE_RE, re);
 		return;
@@ -1445,8 +1459,8 @@ static void zread_route_add(ZAPI_HANDLER_ARGS)
 	 * api_nh->vrf_id instead of re->vrf_id ? I only changed
 	 * for cases NEXTHOP_TYPE_IPV4 and NEXTHOP_TYPE_IPV6.
 	 */
-	for (i = 0; i < api.nexthop_num; i++) {
-		api_nh = &api.nexthops[i];
+	for (i = 0; i < api->nexthop_num; i++) {
+		api_nh = &api->nexthops[i];
 		ifindex_t ifindex = 0;
 
 		if (IS_ZEBRA_DEBUG_RECV)
@@ -1490,14 +1504,14 @@ static void zread_route_add(ZAPI_HANDLER_ARGS)
 			/* Special handling for IPv4 routes sourced from EVPN:
 			 * the nexthop and associated MAC need to be installed.
 			 */
-			if (CHECK_FLAG(api.flags, ZEBRA_FLAG_EVPN_ROUTE)) {
+			if (CHECK_FLAG(api->flags, ZEBRA_FLAG_EVPN_ROUTE)) {
 				vtep_ip.ipa_type = IPADDR_V4;
 				memcpy(&(vtep_ip.ipaddr_v4),
 				       &(api_nh->gate.ipv4),
 				       sizeof(struct in_addr));
 				zebra_vxlan_evpn_vrf_route_add(
 					api_nh->vrf_id, &api_nh->rmac,
-					&vtep_ip, &api.prefix);
+					&vtep_ip, &api->prefix);
 			}
 			break;
 		case NEXTHOP_TYPE_IPV6:
@@ -1514,13 +1528,13 @@ static void zread_route_add(ZAPI_HANDLER_ARGS)
 			/* Special handling for IPv6 routes sourced from EVPN:
 			 * the nexthop and associated MAC need to be installed.
 			 */
-			if (CHECK_FLAG(api.flags, ZEBRA_FLAG_EVPN_ROUTE)) {
+			if (CHECK_FLAG(api->flags, ZEBRA_FLAG_EVPN_ROUTE)) {
 				vtep_ip.ipa_type = IPADDR_V6;
 				memcpy(&vtep_ip.ipaddr_v6, &(api_nh->gate.ipv6),
 				       sizeof(struct in6_addr));
 				zebra_vxlan_evpn_vrf_route_add(
 					api_nh->vrf_id, &api_nh->rmac,
-					&vtep_ip, &api.prefix);
+					&vtep_ip, &api->prefix);
 			}
 			break;
 		case NEXTHOP_TYPE_BLACKHOLE:
@@ -1533,7 +1547,7 @@ static void zread_route_add(ZAPI_HANDLER_ARGS)
 			flog_warn(
 				EC_ZEBRA_NEXTHOP_CREATION_FAILED,
 				"%s: Nexthops Specified: %d but we failed to properly create one",
-				__PRETTY_FUNCTION__, api.nexthop_num);
+				__PRETTY_FUNCTION__, api->nexthop_num);
 			nexthops_free(re->ng.nexthop);
 			XFREE(MTYPE_RE, re);
 			return;
@@ -1542,7 +1556,7 @@ static void zread_route_add(ZAPI_HANDLER_ARGS)
 			SET_FLAG(nexthop->flags, NEXTHOP_FLAG_ONLINK);
 
 		/* MPLS labels for BGP-LU or Segment Routing */
-		if (CHECK_FLAG(api.message, ZAPI_MESSAGE_LABEL)
+		if (CHECK_FLAG(api->message, ZAPI_MESSAGE_LABEL)
 		    && api_nh->type != NEXTHOP_TYPE_IFINDEX
 		    && api_nh->type != NEXTHOP_TYPE_BLACKHOLE) {
 			enum lsp_types_t label_type;
@@ -1562,17 +1576,17 @@ static void zread_route_add(ZAPI_HANDLER_ARGS)
 		}
 	}
 
-	if (CHECK_FLAG(api.message, ZAPI_MESSAGE_DISTANCE))
-		re->distance = api.distance;
-	if (CHECK_FLAG(api.message, ZAPI_MESSAGE_METRIC))
-		re->metric = api.metric;
-	if (CHECK_FLAG(api.message, ZAPI_MESSAGE_TAG))
-		re->tag = api.tag;
-	if (CHECK_FLAG(api.message, ZAPI_MESSAGE_MTU))
-		re->mtu = api.mtu;
+	if (CHECK_FLAG(api->message, ZAPI_MESSAGE_DISTANCE))
+		re->distance = api->distance;
+	if (CHECK_FLAG(api->message, ZAPI_MESSAGE_METRIC))
+		re->metric = api->metric;
+	if (CHECK_FLAG(api->message, ZAPI_MESSAGE_TAG))
+		re->tag = api->tag;
+	if (CHECK_FLAG(api->message, ZAPI_MESSAGE_MTU))
+		re->mtu = api->mtu;
 
-	afi = family2afi(api.prefix.family);
-	if (afi != AFI_IP6 && CHECK_FLAG(api.message, ZAPI_MESSAGE_SRCPFX)) {
+	afi = family2afi(api->prefix.family);
+	if (afi != AFI_IP6 && CHECK_FLAG(api->message, ZAPI_MESSAGE_SRCPFX)) {
 		flog_warn(EC_ZEBRA_RX_SRCDEST_WRONG_AFI,
 			  "%s: Received SRC Prefix but afi is not v6",
 			  __PRETTY_FUNCTION__);
@@ -1580,13 +1594,13 @@ static void zread_route_add(ZAPI_HANDLER_ARGS)
 		XFREE(MTYPE_RE, re);
 		return;
 	}
-	if (CHECK_FLAG(api.message, ZAPI_MESSAGE_SRCPFX))
-		src_p = &api.src_prefix;
+	if (CHECK_FLAG(api->message, ZAPI_MESSAGE_SRCPFX))
+		src_p = &api->src_prefix;
 
-	ret = rib_add_multipath(afi, api.safi, &api.prefix, src_p, re);
+	ret = rib_add_multipath(afi, api->safi, &api->prefix, src_p, re);
 
 	/* Stats */
-	switch (api.prefix.family) {
+	switch (api->prefix.family) {
 	case AF_INET:
 		if (ret > 0)
 			client->v4_route_add_cnt++;
@@ -1602,39 +1616,49 @@ static void zread_route_add(ZAPI_HANDLER_ARGS)
 	}
 }
 
-static void zread_route_del(ZAPI_HANDLER_ARGS)
+static void zread_route_add(ZAPI_HANDLER_ARGS)
 {
-	struct stream *s;
 	struct zapi_route api;
+
+	if (zapi_route_decode(msg, &api) < 0) {
+		if (IS_ZEBRA_DEBUG_RECV)
+			zlog_debug("%s: Unable to decode zapi_route sent",
+				   __PRETTY_FUNCTION__);
+		return;
+	}
+
+	zapi_route_add(client, zvrf, &api);
+	zserv_route_rate_update(client, 1);
+}
+
+static void zapi_route_del(struct zserv *client, struct zebra_vrf *zvrf,
+			   struct zapi_route *api)
+{
 	afi_t afi;
 	struct prefix_ipv6 *src_p = NULL;
 	uint32_t table_id;
 
-	s = msg;
-	if (zapi_route_decode(s, &api) < 0)
-		return;
-
-	afi = family2afi(api.prefix.family);
-	if (afi != AFI_IP6 && CHECK_FLAG(api.message, ZAPI_MESSAGE_SRCPFX)) {
+	afi = family2afi(api->prefix.family);
+	if (afi != AFI_IP6 && CHECK_FLAG(api->message, ZAPI_MESSAGE_SRCPFX)) {
 		flog_warn(EC_ZEBRA_RX_SRCDEST_WRONG_AFI,
 			  "%s: Received a src prefix while afi is not v6",
 			  __PRETTY_FUNCTION__);
 		return;
 	}
-	if (CHECK_FLAG(api.message, ZAPI_MESSAGE_SRCPFX))
-		src_p = &api.src_prefix;
+	if (CHECK_FLAG(api->message, ZAPI_MESSAGE_SRCPFX))
+		src_p = &api->src_prefix;
 
-	if (api.tableid)
-		table_id = api.tableid;
+	if (api->tableid)
+		table_id = api->tableid;
 	else
 		table_id = zvrf->table_id;
 
-	rib_delete(afi, api.safi, zvrf_id(zvrf), api.type, api.instance,
-		   api.flags, &api.prefix, src_p, NULL, table_id, api.metric,
-		   api.distance, false);
+	rib_delete(afi, api->safi, zvrf_id(zvrf), api->type, api->instance,
+		   api->flags, &api->prefix, src_p, NULL, table_id, api->metric,
+		   api->distance, false);
 
 	/* Stats */
-	switch (api.prefix.family) {
+	switch (api->prefix.family) {
 	case AF_INET:
 		client->v4_route_del_cnt++;
 		break;
@@ -1644,6 +1668,71 @@ static void zread_route_del(ZAPI_HANDLER_ARGS)
 	}
 }
 
+static void zread_route_del(ZAPI_HANDLER_ARGS)
+{
+	struct zapi_route api;
+
+	if (zapi_route_decode(msg, &api) < 0)
+		return;
+
+	zapi_route_del(client, zvrf, &api);
+	zserv_route_rate_update(client, 1);
+}
+
+/*
+ * Bulk route add/delete: one route as zapi_route_encode() writes it, then
+ * a count of further prefixes that share all of its other fields. See
+ * zclient_route_bulk_add() for the client side.
+ */
+static void zread_route_bulk(ZAPI_HANDLER_ARGS)
+{
+	struct zapi_route api;
+	uint16_t count, i;
+	uint8_t maxlen;
+	uint32_t done = 0;
+
+	if (zapi_route_decode(msg, &api) < 0) {
+		if (IS_ZEBRA_DEBUG_RECV)
+			zlog_debug("%s: Unable to decode zapi_route sent",
+				   __PRETTY_FUNCTION__);
+		return;
+	}
+	STREAM_GETW(msg, count);
+
+	if (IS_ZEBRA_DEBUG_RECV)
+		zlog_debug("%s: %s with %u routes from client %s", __func__,
+			   zserv_command_string(hdr->command), count + 1,
+			   zebra_route_string(client->proto));
+
+	maxlen = prefix_blen(&api.prefix) * 8;
+	client->route_bulk_cnt++;
+
+	for (i = 0;; i++) {
+		if (hdr->command == ZEBRA_ROUTE_ADD_BULK)
+			zapi_route_add(client, zvrf, &api);
+		else
+			zapi_route_del(client, zvrf, &api);
+		done++;
+
+		if (i == count)
+			break;
+
+		STREAM_GETC(msg, api.prefix.prefixlen);
+		if (api.prefix.prefixlen > maxlen) {
+			if (IS_ZEBRA_DEBUG_RECV)
+				zlog_debug("%s: prefix length %u too long",
+					   __func__, api.prefix.prefixlen);
+			break;
+		}
+		memset(&api.prefix.u, 0, sizeof(api.prefix.u));
+		STREAM_GET(&api.prefix.u.prefix, msg,
+			   PSIZE(api.prefix.prefixlen));
+	}
+
+stream_failure:
+	zserv_route_rate_update(client, done);
+}
+
 /* MRIB Nexthop lookup for IPv4. */
 static void zread_ipv4_nexthop_lookup_mrib(ZAPI_HANDLER_ARGS)
 {
@@ -1686,6 +1775,8 @@ static void zsend_capabilities(struct zserv *client, struct zebra_vrf *zvrf)
 	stream_putc(s, mpls_enabled);
 	stream_putl(s, zrouter.multipath_num);
 	stream_putc(s, zebra_mlag_get_role());
+	/* Bulk route add/delete messages are understood */
+	stream_putc(s, 1);
 
 	stream_putw_at(s, 0, stream_get_endp(s));
 	zserv_send_message(client, s);
@@ -2488,6 +2579,8 @@ void (*zserv_handlers[])(ZAPI_HANDLER_ARGS) = {
 	[ZEBRA_INTERFACE_SET_PROTODOWN] = zread_interface_set_protodown,
 	[ZEBRA_ROUTE_ADD] = zread_route_add,
 	[ZEBRA_ROUTE_DELETE] = zread_route_del,
+	[ZEBRA_ROUTE_ADD_BULK] = zread_route_bulk,
+	[ZEBRA_ROUTE_DELETE_BULK] = zread_route_bulk,
 	[ZEBRA_REDISTRIBUTE_ADD] = zebra_redistribute_add,
 	[ZEBRA_REDISTRIBUTE_DELETE] = zebra_redistribute_delete,
 	[ZEBRA_REDISTRIBUTE_DEFAULT_ADD] = zebra_redistribute_default_add,
@@ -25,6 +25,7 @@
 #include "lib/debug.h"
 #include "lib/frratomic.h"
 #include "lib/frr_pthread.h"
+#include "lib/jhash.h"
 #include "lib/memory.h"
 #include "lib/queue.h"
 #include "lib/zebra.h"
@@ -32,6 +33,7 @@
 #include "zebra/zebra_memory.h"
 #include "zebra/zebra_router.h"
 #include "zebra/zebra_dplane.h"
+#include "zebra/zebra_nhg.h"
 #include "zebra/rt.h"
 #include "zebra/debug.h"
 
@@ -52,6 +54,13 @@ const uint32_t DPLANE_DEFAULT_MAX_QUEUED = 200;
 /* Default value for new work per cycle */
 const uint32_t DPLANE_DEFAULT_NEW_WORK = 100;
 
+/* Default number of route updates sent to the kernel together */
+const uint32_t DPLANE_DEFAULT_BATCH_SIZE = 32;
+
+/* Limits on free contexts and nexthops kept for reuse */
+const uint32_t DPLANE_CTX_CACHE_MAX = 1024;
+const uint32_t DPLANE_NH_CACHE_MAX = 4096;
+
 /* Validation check macro for context blocks */
 /* #define DPLANE_DEBUG 1 */
 
@@ -101,10 +110,30 @@ struct dplane_route_info {
 	/* "Previous" nexthops, used only in route updates without netlink */
 	struct nexthop_group zd_old_ng;
 
+	/* Kernel nexthop object standing for zd_ng, if any */
+	uint32_t zd_nhg_id;
+
+	/* The installed route already refers to zd_nhg_id */
+	bool zd_nhg_kept;
+
 	/* TODO -- use fixed array of nexthops, to avoid mallocs? */
 
 };
 
+/*
+ * Kernel nexthop object info for the dataplane
+ */
+struct dplane_nh_info {
+	uint32_t id;
+	afi_t afi;
+	vrf_id_t vrf_id;
+
+	/* Either a single nexthop, or the ids of a group's members */
+	struct nexthop nh;
+	uint32_t grp[MULTIPATH_NUM];
+	uint8_t grp_num;
+};
+
 /*
  * Pseudowire info for the dataplane
  */
@@ -211,6 +240,7 @@ struct zebra_dplane_ctx {
 	/* Support info for different kinds of updates */
 	union {
 		struct dplane_route_info rinfo;
+		struct dplane_nh_info nh;
 		zebra_lsp_t lsp;
 		struct dplane_pw_info pw;
 		struct dplane_intf_info intf;
@@ -221,6 +251,12 @@ struct zebra_dplane_ctx {
 	/* Namespace info, used especially for netlink kernel communication */
 	struct zebra_dplane_info zd_ns_info;
 
+	/* Kernel dataplane worker handling this update, and when it was
+	 * handed to that worker.
+	 */
+	uint32_t zd_worker;
+	struct timeval zd_worker_time;
+
 	/* Embedded list linkage */
 	TAILQ_ENTRY(zebra_dplane_ctx) zd_q_entries;
 };
@@ -279,6 +315,61 @@ struct zebra_dplane_provider {
 	TAILQ_ENTRY(zebra_dplane_provider) dp_prov_link;
 };
 
+/*
+ * Free contexts, and the nexthops copied into them, kept for reuse.
+ * Contexts are allocated in the zebra main pthread, and come back to it
+ * through the results queue to be freed; the cache belongs to that
+ * pthread, and is used there without locking. Any other pthread just
+ * allocates and frees.
+ */
+struct dplane_ctx_cache {
+	pthread_t dc_owner;
+
+	struct dplane_ctx_q dc_ctx_q;
+	uint32_t dc_ctx_count;
+
+	/* Free nexthops, linked through 'next' */
+	struct nexthop *dc_nh_list;
+	uint32_t dc_nh_count;
+
+	/* Counters */
+	_Atomic uint64_t dc_ctx_allocs;
+	_Atomic uint64_t dc_ctx_hits;
+	_Atomic uint32_t dc_ctx_in_use;
+	_Atomic uint32_t dc_ctx_in_use_max;
+	_Atomic uint64_t dc_nh_allocs;
+	_Atomic uint64_t dc_nh_hits;
+};
+
+/*
+ * Kernel dataplane worker: a pthread, with its own netlink socket, that
+ * handles a share of the kernel provider's updates.
+ */
+struct dplane_kernel_worker {
+	uint32_t dw_id;
+
+	/* Worker pthread and its event */
+	struct frr_pthread *dw_pthread;
+	struct thread *dw_t_work;
+
+	/* Mutex and queue of updates waiting for this worker */
+	pthread_mutex_t dw_mutex;
+	struct dplane_ctx_q dw_ctx_q;
+
+	/* Route batch buffer, reused for every batch this worker sends */
+	struct kernel_route_batch *dw_batch;
+
+	/* Counters */
+	_Atomic uint64_t dw_counter;
+	_Atomic uint32_t dw_queued;
+	_Atomic uint32_t dw_queued_max;
+	_Atomic uint64_t dw_usecs;
+	_Atomic uint64_t dw_max_usecs;
+};
+
+#define DPLANE_WORKER_LOCK(w) pthread_mutex_lock(&((w)->dw_mutex))
+#define DPLANE_WORKER_UNLOCK(w) pthread_mutex_unlock(&((w)->dw_mutex))
+
 /*
  * Globals
  */
@@ -315,12 +406,18 @@ static struct zebra_dplane_globals {
 	 */
 	uint32_t dg_updates_per_cycle;
 
+	/* Limit number of route updates sent to the kernel in one batch */
+	_Atomic uint32_t dg_batch_size;
+
 	_Atomic uint32_t dg_routes_in;
 	_Atomic uint32_t dg_routes_queued;
 	_Atomic uint32_t dg_routes_queued_max;
 	_Atomic uint32_t dg_route_errors;
 	_Atomic uint32_t dg_other_errors;
 
+	_Atomic uint32_t dg_nexthops_in;
+	_Atomic uint32_t dg_nexthop_errors;
+
 	_Atomic uint32_t dg_lsps_in;
 	_Atomic uint32_t dg_lsp_errors;
 
@@ -338,6 +435,18 @@ static struct zebra_dplane_globals {
 
 	_Atomic uint32_t dg_update_yields;
 
+	_Atomic uint32_t dg_batches;
+	_Atomic uint64_t dg_batch_msgs;
+	_Atomic uint64_t dg_batch_usecs;
+	_Atomic uint64_t dg_batch_max_usecs;
+
+	/* Cache of free contexts and nexthops */
+	struct dplane_ctx_cache dg_cache;
+
+	/* Kernel provider, and its worker pthreads if there's more than one */
+	struct zebra_dplane_provider *dg_kernel_prov;
+	struct dplane_kernel_worker dg_workers[ZEBRA_DPLANE_MAX_WORKERS];
+
 	/* Dataplane pthread */
 	struct frr_pthread *dg_pthread;
 
@@ -368,7 +477,7 @@ static struct zebra_dplane_globals {
 /* Prototypes */
 static int dplane_thread_loop(struct thread *event);
 static void dplane_info_from_zns(struct zebra_dplane_info *ns_info,
-				 struct zebra_ns *zns);
+				 struct zebra_ns *zns, uint32_t worker);
 static enum zebra_dplane_result lsp_update_internal(zebra_lsp_t *lsp,
 						    enum dplane_op_e op);
 static enum zebra_dplane_result pw_update_internal(struct zebra_pw *pw,
@@ -398,21 +507,188 @@ struct thread_master *dplane_get_thread_master(void)
 	return zdplane_info.dg_master;
 }
 
+/*
+ * Raise an atomic high-water mark; kernel workers may race to update it.
+ */
+static void dplane_atomic_max64(_Atomic uint64_t *max, uint64_t val)
+{
+	uint64_t cur;
+
+	cur = atomic_load_explicit(max, memory_order_relaxed);
+	while (val > cur) {
+		if (atomic_compare_exchange_weak_explicit(
+			    max, &cur, val, memory_order_relaxed,
+			    memory_order_relaxed))
+			break;
+	}
+}
+
+static void dplane_atomic_max32(_Atomic uint32_t *max, uint32_t val)
+{
+	uint32_t cur;
+
+	cur = atomic_load_explicit(max, memory_order_relaxed);
+	while (val > cur) {
+		if (atomic_compare_exchange_weak_explicit(
+			    max, &cur, val, memory_order_relaxed,
+			    memory_order_relaxed))
+			break;
+	}
+}
+
+/*
+ * Check whether the calling pthread owns the context cache
+ */
+static bool dplane_cache_is_owner(void)
+{
+	return pthread_equal(pthread_self(), zdplane_info.dg_cache.dc_owner);
+}
+
 /*
  * Allocate a dataplane update context
  */
 struct zebra_dplane_ctx *dplane_ctx_alloc(void)
 {
-	struct zebra_dplane_ctx *p;
+	struct dplane_ctx_cache *cache = &zdplane_info.dg_cache;
+	struct zebra_dplane_ctx *p = NULL;
+	uint32_t in_use;
 
-	/* TODO -- just alloc'ing memory, but would like to maintain
-	 * a pool
-	 */
-	p = XCALLOC(MTYPE_DP_CTX, sizeof(struct zebra_dplane_ctx));
+	if (dplane_cache_is_owner()) {
+		p = TAILQ_FIRST(&cache->dc_ctx_q);
+		if (p) {
+			TAILQ_REMOVE(&cache->dc_ctx_q, p, zd_q_entries);
+			cache->dc_ctx_count--;
+
+			memset(p, 0, sizeof(*p));
+
+			atomic_fetch_add_explicit(&cache->dc_ctx_hits, 1,
+						  memory_order_relaxed);
+		}
+	}
+
+	atomic_fetch_add_explicit(&cache->dc_ctx_allocs, 1,
+				  memory_order_relaxed);
+
+	in_use = atomic_fetch_add_explicit(&cache->dc_ctx_in_use, 1,
+					   memory_order_relaxed);
+	dplane_atomic_max32(&cache->dc_ctx_in_use_max, in_use + 1);
+
+	if (p == NULL)
+		p = XCALLOC(MTYPE_DP_CTX, sizeof(struct zebra_dplane_ctx));
 
 	return p;
 }
 
+/*
+ * Allocate a nexthop for a context, from the cache if possible
+ */
+static struct nexthop *dplane_nexthop_new(void)
+{
+	struct dplane_ctx_cache *cache = &zdplane_info.dg_cache;
+	struct nexthop *nh;
+
+	atomic_fetch_add_explicit(&cache->dc_nh_allocs, 1,
+				  memory_order_relaxed);
+
+	if (cache->dc_nh_list == NULL || !dplane_cache_is_owner())
+		return nexthop_new();
+
+	nh = cache->dc_nh_list;
+	cache->dc_nh_list = nh->next;
+	cache->dc_nh_count--;
+
+	memset(nh, 0, sizeof(*nh));
+
+	atomic_fetch_add_explicit(&cache->dc_nh_hits, 1,
+				  memory_order_relaxed);
+
+	return nh;
+}
+
+/*
+ * Free a list of a context's nexthops, keeping them in the cache if
+ * possible. This deals with recursive nexthops too.
+ */
+static void dplane_nexthops_free(struct nexthop *nexthop)
+{
+	struct dplane_ctx_cache *cache = &zdplane_info.dg_cache;
+	struct nexthop *nh, *next;
+	bool owner = dplane_cache_is_owner();
+
+	for (nh = nexthop; nh; nh = next) {
+		next = nh->next;
+
+		if (nh->resolved) {
+			dplane_nexthops_free(nh->resolved);
+			nh->resolved = NULL;
+		}
+
+		if (!owner || cache->dc_nh_count >= DPLANE_NH_CACHE_MAX) {
+			nexthop_free(nh);
+			continue;
+		}
+
+		nexthop_del_labels(nh);
+
+		nh->next = cache->dc_nh_list;
+		cache->dc_nh_list = nh;
+		cache->dc_nh_count++;
+	}
+}
+
+/*
+ * Copy a list of nexthops into a context; like copy_nexthops(), but
+ * using the nexthop cache.
+ */
+static void dplane_copy_nexthops(struct nexthop **tnh,
+				 const struct nexthop *nh,
+				 struct nexthop *rparent)
+{
+	struct nexthop *nexthop, *last;
+	const struct nexthop *nh1;
+
+	for (last = *tnh; last && last->next; last = last->next)
+		;
+
+	for (nh1 = nh; nh1; nh1 = nh1->next) {
+		nexthop = dplane_nexthop_new();
+		nexthop_copy(nexthop, nh1, rparent);
+
+		if (last) {
+			last->next = nexthop;
+			nexthop->prev = last;
+		} else
+			*tnh = nexthop;
+		last = nexthop;
+
+		if (CHECK_FLAG(nh1->flags, NEXTHOP_FLAG_RECURSIVE))
+			dplane_copy_nexthops(&nexthop->resolved,
+					     nh1->resolved, nexthop);
+	}
+}
+
+/*
+ * Release everything held in the context cache
+ */
+static void dplane_ctx_cache_flush(void)
+{
+	struct dplane_ctx_cache *cache = &zdplane_info.dg_cache;
+	struct zebra_dplane_ctx *ctx;
+	struct nexthop *nh;
+
+	while ((ctx = TAILQ_FIRST(&cache->dc_ctx_q)) != NULL) {
+		TAILQ_REMOVE(&cache->dc_ctx_q, ctx, zd_q_entries);
+		XFREE(MTYPE_DP_CTX, ctx);
+	}
+	cache->dc_ctx_count = 0;
+
+	while ((nh = cache->dc_nh_list) != NULL) {
+		cache->dc_nh_list = nh->next;
+		nexthop_free(nh);
+	}
+	cache->dc_nh_count = 0;
+}
+
 /* Enable system route notifications */
 void dplane_enable_sys_route_notifs(void)
 {
@@ -429,10 +705,6 @@ static void dplane_ctx_free(struct zebra_dplane_ctx **pctx)
 
 	DPLANE_CTX_VALID(*pctx);
 
-	/* TODO -- just freeing memory, but would like to maintain
-	 * a pool
-	 */
-
 	/* Some internal allocations may need to be freed, depending on
 	 * the type of info captured in the ctx.
 	 */
@@ -446,15 +718,14 @@ static void dplane_ctx_free(struct zebra_dplane_ctx **pctx)
 
 		/* Free allocated nexthops */
 		if ((*pctx)->u.rinfo.zd_ng.nexthop) {
-			/* This deals with recursive nexthops too */
-			nexthops_free((*pctx)->u.rinfo.zd_ng.nexthop);
+			dplane_nexthops_free((*pctx)->u.rinfo.zd_ng.nexthop);
 
 			(*pctx)->u.rinfo.zd_ng.nexthop = NULL;
 		}
 
 		if ((*pctx)->u.rinfo.zd_old_ng.nexthop) {
-			/* This deals with recursive nexthops too */
-			nexthops_free((*pctx)->u.rinfo.zd_old_ng.nexthop);
+			dplane_nexthops_free(
+				(*pctx)->u.rinfo.zd_old_ng.nexthop);
 
 			(*pctx)->u.rinfo.zd_old_ng.nexthop = NULL;
 		}
@@ -488,8 +759,7 @@ static void dplane_ctx_free(struct zebra_dplane_ctx **pctx)
 	case DPLANE_OP_PW_UNINSTALL:
 		/* Free allocated nexthops */
 		if ((*pctx)->u.pw.nhg.nexthop) {
-			/* This deals with recursive nexthops too */
-			nexthops_free((*pctx)->u.pw.nhg.nexthop);
+			dplane_nexthops_free((*pctx)->u.pw.nhg.nexthop);
 
 			(*pctx)->u.pw.nhg.nexthop = NULL;
 		}
@@ -512,10 +782,27 @@ static void dplane_ctx_free(struct zebra_dplane_ctx **pctx)
 	case DPLANE_OP_NEIGH_DELETE:
 	case DPLANE_OP_VTEP_ADD:
 	case DPLANE_OP_VTEP_DELETE:
+	case DPLANE_OP_NH_INSTALL:
+	case DPLANE_OP_NH_DELETE:
 	case DPLANE_OP_NONE:
 		break;
 	}
 
+	atomic_fetch_sub_explicit(&zdplane_info.dg_cache.dc_ctx_in_use, 1,
+				  memory_order_relaxed);
+
+	if (dplane_cache_is_owner()) {
+		struct dplane_ctx_cache *cache = &zdplane_info.dg_cache;
+
+		if (cache->dc_ctx_count < DPLANE_CTX_CACHE_MAX) {
+			TAILQ_INSERT_HEAD(&cache->dc_ctx_q, *pctx,
+					  zd_q_entries);
+			cache->dc_ctx_count++;
+			*pctx = NULL;
+			return;
+		}
+	}
+
 	XFREE(MTYPE_DP_CTX, *pctx);
 	*pctx = NULL;
 }
@@ -525,7 +812,6 @@ static void dplane_ctx_free(struct zebra_dplane_ctx **pctx)
  */
 void dplane_ctx_fini(struct zebra_dplane_ctx **pctx)
 {
-	/* TODO -- maintain pool; for now, just free */
 	dplane_ctx_free(pctx);
 }
 
@@ -694,6 +980,13 @@ const char *dplane_op2str(enum dplane_op_e op)
 	case DPLANE_OP_VTEP_DELETE:
 		ret = "VTEP_DELETE";
 		break;
+
+	case DPLANE_OP_NH_INSTALL:
+		ret = "NH_INSTALL";
+		break;
+	case DPLANE_OP_NH_DELETE:
+		ret = "NH_DELETE";
+		break;
 	}
 
 	return ret;
@@ -985,10 +1278,10 @@ void dplane_ctx_set_nexthops(struct zebra_dplane_ctx *ctx, struct nexthop *nh)
 	DPLANE_CTX_VALID(ctx);
 
 	if (ctx->u.rinfo.zd_ng.nexthop) {
-		nexthops_free(ctx->u.rinfo.zd_ng.nexthop);
+		dplane_nexthops_free(ctx->u.rinfo.zd_ng.nexthop);
 		ctx->u.rinfo.zd_ng.nexthop = NULL;
 	}
-	copy_nexthops(&(ctx->u.rinfo.zd_ng.nexthop), nh, NULL);
+	dplane_copy_nexthops(&(ctx->u.rinfo.zd_ng.nexthop), nh, NULL);
 }
 
 const struct nexthop_group *dplane_ctx_get_ng(
@@ -1007,6 +1300,56 @@ const struct nexthop_group *dplane_ctx_get_old_ng(
 	return &(ctx->u.rinfo.zd_old_ng);
 }
 
+uint32_t dplane_ctx_get_nhg_id(const struct zebra_dplane_ctx *ctx)
+{
+	DPLANE_CTX_VALID(ctx);
+
+	return ctx->u.rinfo.zd_nhg_id;
+}
+
+bool dplane_ctx_get_nhg_kept(const struct zebra_dplane_ctx *ctx)
+{
+	DPLANE_CTX_VALID(ctx);
+
+	return ctx->u.rinfo.zd_nhg_kept;
+}
+
+/* Accessors for nexthop object information */
+uint32_t dplane_ctx_get_nhe_id(const struct zebra_dplane_ctx *ctx)
+{
+	DPLANE_CTX_VALID(ctx);
+
+	return ctx->u.nh.id;
+}
+
+afi_t dplane_ctx_get_nhe_afi(const struct zebra_dplane_ctx *ctx)
+{
+	DPLANE_CTX_VALID(ctx);
+
+	return ctx->u.nh.afi;
+}
+
+/* The single nexthop of the object, NULL for a group */
+const struct nexthop *dplane_ctx_get_nhe_nexthop(
+	const struct zebra_dplane_ctx *ctx)
+{
+	DPLANE_CTX_VALID(ctx);
+
+	if (ctx->u.nh.grp_num)
+		return NULL;
+
+	return &(ctx->u.nh.nh);
+}
+
+const uint32_t *dplane_ctx_get_nhe_grp(const struct zebra_dplane_ctx *ctx,
+				       uint8_t *num)
+{
+	DPLANE_CTX_VALID(ctx);
+
+	*num = ctx->u.nh.grp_num;
+	return ctx->u.nh.grp;
+}
+
 const struct zebra_dplane_info *dplane_ctx_get_ns(
 	const struct zebra_dplane_ctx *ctx)
 {
@@ -1334,6 +1677,28 @@ void dplane_set_in_queue_limit(uint32_t limit, bool set)
 			      memory_order_relaxed);
 }
 
+/*
+ * Retrieve the number of route updates sent to the kernel in one batch.
+ */
+uint32_t dplane_get_batch_size(void)
+{
+	return atomic_load_explicit(&zdplane_info.dg_batch_size,
+				    memory_order_relaxed);
+}
+
+/*
+ * Configure the number of route updates sent to the kernel in one batch.
+ */
+void dplane_set_batch_size(uint32_t size, bool set)
+{
+	/* Reset to default on 'unset' */
+	if (!set)
+		size = DPLANE_DEFAULT_BATCH_SIZE;
+
+	atomic_store_explicit(&zdplane_info.dg_batch_size, size,
+			      memory_order_relaxed);
+}
+
 /*
  * Retrieve the current queue depth of incoming, unprocessed updates
  */
@@ -1343,6 +1708,34 @@ uint32_t dplane_get_in_queue_len(void)
 				    memory_order_seq_cst);
 }
 
+/*
+ * Choose the kernel dataplane worker for a context. Route updates are
+ * spread across the workers by namespace and table, so all the updates
+ * for a given prefix go, in order, through the same worker. Nexthop
+ * objects are only shared by the routes of one table, and go through
+ * that table's worker, so an object is installed before the routes using
+ * it and deleted after them. Everything else is handled by the first
+ * worker, and so is not ordered against route updates.
+ */
+static uint32_t dplane_ctx_worker_select(const struct zebra_dplane_ctx *ctx,
+					 const struct zebra_ns *zns)
+{
+	if (zrouter.dplane_workers <= 1)
+		return 0;
+
+	switch (ctx->zd_op) {
+	case DPLANE_OP_ROUTE_INSTALL:
+	case DPLANE_OP_ROUTE_UPDATE:
+	case DPLANE_OP_ROUTE_DELETE:
+	case DPLANE_OP_NH_INSTALL:
+	case DPLANE_OP_NH_DELETE:
+		return jhash_2words(zns->ns_id, ctx->zd_table_id, 0)
+		       % zrouter.dplane_workers;
+	default:
+		return 0;
+	}
+}
+
 /*
  * Common dataplane context init with zebra namespace info.
  */
@@ -1350,16 +1743,18 @@ static int dplane_ctx_ns_init(struct zebra_dplane_ctx *ctx,
 			      struct zebra_ns *zns,
 			      bool is_update)
 {
-	dplane_info_from_zns(&(ctx->zd_ns_info), zns);
+	ctx->zd_worker = dplane_ctx_worker_select(ctx, zns);
+
+	dplane_info_from_zns(&(ctx->zd_ns_info), zns, ctx->zd_worker);
 
 #if defined(HAVE_NETLINK)
 	/* Increment message counter after copying to context struct - may need
 	 * two messages in some 'update' cases.
 	 */
 	if (is_update)
-		zns->netlink_dplane.seq += 2;
+		zns->netlink_dplane[ctx->zd_worker].seq += 2;
 	else
-		zns->netlink_dplane.seq++;
+		zns->netlink_dplane[ctx->zd_worker].seq++;
 #endif	/* HAVE_NETLINK */
 
 	return AOK;
@@ -1419,7 +1814,8 @@ static int dplane_ctx_route_init(struct zebra_dplane_ctx *ctx,
 	ctx->u.rinfo.zd_safi = info->safi;
 
 	/* Copy nexthops; recursive info is included too */
-	copy_nexthops(&(ctx->u.rinfo.zd_ng.nexthop), re->ng.nexthop, NULL);
+	dplane_copy_nexthops(&(ctx->u.rinfo.zd_ng.nexthop), re->ng.nexthop,
+			     NULL);
 
 	/* Ensure that the dplane's nexthops flags are clear. */
 	for (ALL_NEXTHOPS(ctx->u.rinfo.zd_ng, nexthop))
@@ -1432,6 +1828,17 @@ static int dplane_ctx_route_init(struct zebra_dplane_ctx *ctx,
 		goto done;
 	}
 
+	/* Refer to the route's kernel nexthop object, unless that failed
+	 * to install.
+	 */
+	if (op != DPLANE_OP_ROUTE_DELETE && re->nhe
+	    && !CHECK_FLAG(re->nhe->flags, NEXTHOP_GROUP_FAILED)) {
+		ctx->u.rinfo.zd_nhg_id = re->nhe->id;
+		ctx->u.rinfo.zd_nhg_kept =
+			(op == DPLANE_OP_ROUTE_UPDATE
+			 && CHECK_FLAG(re->status, ROUTE_ENTRY_NHG_KEPT));
+	}
+
 	/* Extract ns info - can't use pointers to 'core' structs */
 	zvrf = vrf_info_lookup(re->vrf_id);
 	zns = zvrf->zns;
@@ -1449,6 +1856,58 @@ done:
 	return ret;
 }
 
+/*
+ * Capture information for a kernel nexthop object update in a dplane
+ * context.
+ */
+static int dplane_ctx_nexthop_init(struct zebra_dplane_ctx *ctx,
+				   enum dplane_op_e op,
+				   const struct nhg_hash_entry *nhe)
+{
+	struct zebra_vrf *zvrf;
+	struct zebra_ns *zns;
+	uint8_t i;
+
+	if (IS_ZEBRA_DEBUG_DPLANE_DETAIL)
+		zlog_debug("init dplane ctx %s: nexthop group %u, %u member(s)",
+			   dplane_op2str(op), nhe->id, nhe->member_num);
+
+	ctx->zd_op = op;
+	ctx->zd_status = ZEBRA_DPLANE_REQUEST_SUCCESS;
+	ctx->zd_vrf_id = nhe->vrf_id;
+	ctx->zd_table_id = nhe->table_id;
+
+	memset(&ctx->u.nh, 0, sizeof(ctx->u.nh));
+
+	ctx->u.nh.id = nhe->id;
+	ctx->u.nh.afi = nhe->afi;
+	ctx->u.nh.vrf_id = nhe->vrf_id;
+
+	/* A delete only needs the id */
+	if (op == DPLANE_OP_NH_INSTALL) {
+		if (nhe->member_num) {
+			if (nhe->member_num > array_size(ctx->u.nh.grp))
+				return EINVAL;
+
+			for (i = 0; i < nhe->member_num; i++)
+				ctx->u.nh.grp[i] = nhe->members[i]->id;
+			ctx->u.nh.grp_num = nhe->member_num;
+		} else {
+			ctx->u.nh.nh = *nhe->nhg.nexthop;
+			ctx->u.nh.nh.next = ctx->u.nh.nh.prev = NULL;
+			ctx->u.nh.nh.resolved = ctx->u.nh.nh.rparent = NULL;
+			ctx->u.nh.nh.nh_label = NULL;
+		}
+	}
+
+	/* Capture namespace info */
+	zvrf = vrf_info_lookup(nhe->vrf_id);
+	zns = zvrf ? zvrf->zns : zebra_ns_lookup(NS_DEFAULT);
+	dplane_ctx_ns_init(ctx, zns, false);
+
+	return AOK;
+}
+
 /*
  * Capture information for an LSP update in a dplane context.
  */
@@ -1576,8 +2035,8 @@ static int dplane_ctx_pw_init(struct zebra_dplane_ctx *ctx,
 			}
 
 			if (re)
-				copy_nexthops(&(ctx->u.pw.nhg.nexthop),
-					      re->ng.nexthop, NULL);
+				dplane_copy_nexthops(&(ctx->u.pw.nhg.nexthop),
+						     re->ng.nexthop, NULL);
 
 			route_unlock_node(rn);
 		}
@@ -1672,8 +2131,9 @@ dplane_route_update_internal(struct route_node *rn,
 			/* For bsd, capture previous re's nexthops too, sigh.
 			 * We'll need these to do per-nexthop deletes.
 			 */
-			copy_nexthops(&(ctx->u.rinfo.zd_old_ng.nexthop),
-				      old_re->ng.nexthop, NULL);
+			dplane_copy_nexthops(
+				&(ctx->u.rinfo.zd_old_ng.nexthop),
+				old_re->ng.nexthop, NULL);
 #endif	/* !HAVE_NETLINK */
 		}
 
@@ -1829,11 +2289,11 @@ dplane_route_notif_update(struct route_node *rn,
 	if (op == DPLANE_OP_ROUTE_UPDATE ||
 	    op == DPLANE_OP_ROUTE_INSTALL) {
 
-		nexthops_free(new_ctx->u.rinfo.zd_ng.nexthop);
+		dplane_nexthops_free(new_ctx->u.rinfo.zd_ng.nexthop);
 		new_ctx->u.rinfo.zd_ng.nexthop = NULL;
 
-		copy_nexthops(&(new_ctx->u.rinfo.zd_ng.nexthop),
-			      (rib_active_nhg(re))->nexthop, NULL);
+		dplane_copy_nexthops(&(new_ctx->u.rinfo.zd_ng.nexthop),
+				     (rib_active_nhg(re))->nexthop, NULL);
 
 		for (ALL_NEXTHOPS(new_ctx->u.rinfo.zd_ng, nexthop))
 			UNSET_FLAG(nexthop->flags, NEXTHOP_FLAG_FIB);
@@ -1852,6 +2312,55 @@ done:
 	return ret;
 }
 
+/*
+ * Common helper for kernel nexthop object updates.
+ */
+static enum zebra_dplane_result
+nexthop_update_internal(struct nhg_hash_entry *nhe, enum dplane_op_e op)
+{
+	enum zebra_dplane_result result = ZEBRA_DPLANE_REQUEST_FAILURE;
+	int ret;
+	struct zebra_dplane_ctx *ctx = NULL;
+
+	/* Obtain context block */
+	ctx = dplane_ctx_alloc();
+
+	ret = dplane_ctx_nexthop_init(ctx, op, nhe);
+	if (ret == AOK)
+		ret = dplane_update_enqueue(ctx);
+
+	/* Update counter */
+	atomic_fetch_add_explicit(&zdplane_info.dg_nexthops_in, 1,
+				  memory_order_relaxed);
+
+	if (ret == AOK)
+		result = ZEBRA_DPLANE_REQUEST_QUEUED;
+	else {
+		atomic_fetch_add_explicit(&zdplane_info.dg_nexthop_errors, 1,
+					  memory_order_relaxed);
+		dplane_ctx_free(&ctx);
+	}
+
+	return result;
+}
+
+/*
+ * Enqueue a kernel nexthop object add, or replace, for the dataplane.
+ */
+enum zebra_dplane_result dplane_nexthop_add(struct nhg_hash_entry *nhe)
+{
+	return nexthop_update_internal(nhe, DPLANE_OP_NH_INSTALL);
+}
+
+/*
+ * Enqueue a kernel nexthop object delete for the dataplane.  Only the
+ * entry's id is used.
+ */
+enum zebra_dplane_result dplane_nexthop_delete(struct nhg_hash_entry *nhe)
+{
+	return nexthop_update_internal(nhe, DPLANE_OP_NH_DELETE);
+}
+
 /*
  * Enqueue LSP add for the dataplane.
  */
@@ -2405,7 +2914,8 @@ neigh_update_internal(enum dplane_op_e op,
 int dplane_show_helper(struct vty *vty, bool detailed)
 {
 	uint64_t queued, queue_max, limit, errs, incoming, yields,
-		other_errs;
+		other_errs, batches, batch_msgs, batch_usecs, batch_max;
+	uint64_t allocs, hits, in_use, in_use_max;
 
 	/* Using atomics because counters are being changed in different
 	 * pthread contexts.
@@ -2434,6 +2944,52 @@ int dplane_show_helper(struct vty *vty, bool detailed)
 	vty_out(vty, "Route update queue max:   %"PRIu64"\n", queue_max);
 	vty_out(vty, "Dplane update yields:     %"PRIu64"\n", yields);
 
+	limit = atomic_load_explicit(&zdplane_info.dg_batch_size,
+				     memory_order_relaxed);
+	batches = atomic_load_explicit(&zdplane_info.dg_batches,
+				       memory_order_relaxed);
+	batch_msgs = atomic_load_explicit(&zdplane_info.dg_batch_msgs,
+					  memory_order_relaxed);
+	batch_usecs = atomic_load_explicit(&zdplane_info.dg_batch_usecs,
+					   memory_order_relaxed);
+	batch_max = atomic_load_explicit(&zdplane_info.dg_batch_max_usecs,
+					 memory_order_relaxed);
+
+	vty_out(vty, "Route batch size:         %"PRIu64"\n", limit);
+	vty_out(vty, "Route batches:            %"PRIu64"\n", batches);
+	vty_out(vty, "Route batch messages:     %"PRIu64" (avg %"PRIu64")\n",
+		batch_msgs, batches ? batch_msgs / batches : 0);
+	vty_out(vty, "Route batch usecs:        avg %"PRIu64", max %"PRIu64"\n",
+		batches ? batch_usecs / batches : 0, batch_max);
+
+	allocs = atomic_load_explicit(&zdplane_info.dg_cache.dc_ctx_allocs,
+				      memory_order_relaxed);
+	hits = atomic_load_explicit(&zdplane_info.dg_cache.dc_ctx_hits,
+				    memory_order_relaxed);
+	in_use = atomic_load_explicit(&zdplane_info.dg_cache.dc_ctx_in_use,
+				      memory_order_relaxed);
+	in_use_max = atomic_load_explicit(
+		&zdplane_info.dg_cache.dc_ctx_in_use_max,
+		memory_order_relaxed);
+	vty_out(vty, "Contexts in use:          %"PRIu64" (max %"PRIu64")\n",
+		in_use, in_use_max);
+	vty_out(vty, "Context cache hits:       %"PRIu64" of %"PRIu64" (%"PRIu64"%%)\n",
+		hits, allocs, allocs ? (100 * hits) / allocs : 0);
+
+	allocs = atomic_load_explicit(&zdplane_info.dg_cache.dc_nh_allocs,
+				      memory_order_relaxed);
+	hits = atomic_load_explicit(&zdplane_info.dg_cache.dc_nh_hits,
+				    memory_order_relaxed);
+	vty_out(vty, "Nexthop cache hits:       %"PRIu64" of %"PRIu64" (%"PRIu64"%%)\n",
+		hits, allocs, allocs ? (100 * hits) / allocs : 0);
+
+	incoming = atomic_load_explicit(&zdplane_info.dg_nexthops_in,
+					memory_order_relaxed);
+	errs = atomic_load_explicit(&zdplane_info.dg_nexthop_errors,
+				    memory_order_relaxed);
+	vty_out(vty, "Nexthop object updates:   %"PRIu64"\n", incoming);
+	vty_out(vty, "Nexthop object errors:    %"PRIu64"\n", errs);
+
 	incoming = atomic_load_explicit(&zdplane_info.dg_lsps_in,
 					memory_order_relaxed);
 	errs = atomic_load_explicit(&zdplane_info.dg_lsp_errors,
@@ -2478,7 +3034,9 @@ int dplane_show_helper(struct vty *vty, bool detailed)
 int dplane_show_provs_helper(struct vty *vty, bool detailed)
 {
 	struct zebra_dplane_provider *prov;
-	uint64_t in, in_max, out, out_max;
+	struct dplane_kernel_worker *w;
+	uint64_t in, in_max, out, out_max, usecs, max_usecs;
+	uint32_t i;
 
 	vty_out(vty, "Zebra dataplane providers:\n");
 
@@ -2507,6 +3065,28 @@ int dplane_show_provs_helper(struct vty *vty, bool detailed)
 		DPLANE_UNLOCK();
 	}
 
+	/* Kernel workers: latency is measured from dispatch to result */
+	for (i = 0; zrouter.dplane_workers > 1 && i < zrouter.dplane_workers;
+	     i++) {
+		w = &zdplane_info.dg_workers[i];
+
+		out = atomic_load_explicit(&w->dw_counter,
+					   memory_order_relaxed);
+		in = atomic_load_explicit(&w->dw_queued,
+					  memory_order_relaxed);
+		in_max = atomic_load_explicit(&w->dw_queued_max,
+					      memory_order_relaxed);
+		usecs = atomic_load_explicit(&w->dw_usecs,
+					     memory_order_relaxed);
+		max_usecs = atomic_load_explicit(&w->dw_max_usecs,
+						 memory_order_relaxed);
+
+		vty_out(vty, "  Kernel worker %u: updates: %"PRIu64", "
+			"queued: %"PRIu64", q_max: %"PRIu64", "
+			"usecs avg: %"PRIu64", max: %"PRIu64"\n",
+			i, out, in, in_max, out ? usecs / out : 0, max_usecs);
+	}
+
 	return CMD_SUCCESS;
 }
 
@@ -2519,6 +3099,10 @@ int dplane_config_write_helper(struct vty *vty)
 		vty_out(vty, "zebra dplane limit %u\n",
 			zdplane_info.dg_max_queued_updates);
 
+	if (zdplane_info.dg_batch_size != DPLANE_DEFAULT_BATCH_SIZE)
+		vty_out(vty, "zebra dplane batch-size %u\n",
+			zdplane_info.dg_batch_size);
+
 	return 0;
 }
 
@@ -2722,13 +3306,13 @@ bool dplane_provider_is_threaded(const struct zebra_dplane_provider *prov)
  * called in the zebra main pthread context as part of dplane ctx init.
  */
 static void dplane_info_from_zns(struct zebra_dplane_info *ns_info,
-				 struct zebra_ns *zns)
+				 struct zebra_ns *zns, uint32_t worker)
 {
 	ns_info->ns_id = zns->ns_id;
 
 #if defined(HAVE_NETLINK)
 	ns_info->is_cmd = true;
-	ns_info->nls = zns->netlink_dplane;
+	ns_info->nls = zns->netlink_dplane[worker];
 #endif /* NETLINK */
 }
 
@@ -2789,6 +3373,29 @@ kernel_dplane_lsp_update(struct zebra_dplane_ctx *ctx)
 	return res;
 }
 
+/*
+ * Handler for kernel nexthop object updates
+ */
+static enum zebra_dplane_result
+kernel_dplane_nexthop_update(struct zebra_dplane_ctx *ctx)
+{
+	enum zebra_dplane_result res;
+
+	if (IS_ZEBRA_DEBUG_DPLANE_DETAIL)
+		zlog_debug("Dplane nexthop %s: id %u",
+			   dplane_op2str(dplane_ctx_get_op(ctx)),
+			   dplane_ctx_get_nhe_id(ctx));
+
+	res = kernel_nexthop_update(ctx);
+
+	if (res != ZEBRA_DPLANE_REQUEST_SUCCESS)
+		atomic_fetch_add_explicit(
+			&zdplane_info.dg_nexthop_errors, 1,
+			memory_order_relaxed);
+
+	return res;
+}
+
 /*
  * Handler for kernel pseudowire updates
  */
@@ -2816,13 +3423,58 @@ kernel_dplane_pw_update(struct zebra_dplane_ctx *ctx)
 }
 
 /*
- * Handler for kernel route updates
+ * Send a batch of kernel route updates, and move the results to 'done'.
  */
-static enum zebra_dplane_result
-kernel_dplane_route_update(struct zebra_dplane_ctx *ctx)
+static void kernel_dplane_route_batch(struct dplane_kernel_worker *w,
+				      struct dplane_ctx_q *batch,
+				      struct dplane_ctx_q *done)
 {
-	enum zebra_dplane_result res;
+	struct zebra_dplane_ctx *ctx;
+	struct timeval start;
+	uint64_t usecs;
+	int msgs;
+
+	if (TAILQ_EMPTY(batch))
+		return;
 
+	monotime(&start);
+
+	/* Call into the synchronous kernel-facing code here */
+	msgs = kernel_route_update_multi(batch, w->dw_batch);
+
+	usecs = monotime_since(&start, NULL);
+
+	if (msgs > 0) {
+		atomic_fetch_add_explicit(&zdplane_info.dg_batches, 1,
+					  memory_order_relaxed);
+		atomic_fetch_add_explicit(&zdplane_info.dg_batch_msgs, msgs,
+					  memory_order_relaxed);
+		atomic_fetch_add_explicit(&zdplane_info.dg_batch_usecs, usecs,
+					  memory_order_relaxed);
+
+		dplane_atomic_max64(&zdplane_info.dg_batch_max_usecs, usecs);
+	}
+
+	if (IS_ZEBRA_DEBUG_DPLANE_DETAIL)
+		zlog_debug("Dplane route batch: %d msgs in %" PRIu64 " usecs",
+			   msgs, usecs);
+
+	while ((ctx = dplane_ctx_dequeue(batch)) != NULL) {
+		if (dplane_ctx_get_status(ctx) != ZEBRA_DPLANE_REQUEST_SUCCESS)
+			atomic_fetch_add_explicit(
+				&zdplane_info.dg_route_errors, 1,
+				memory_order_relaxed);
+
+		dplane_ctx_enqueue_tail(done, ctx);
+	}
+}
+
+/*
+ * Add a kernel route update to a pending batch
+ */
+static void kernel_dplane_route_enqueue(struct dplane_ctx_q *batch,
+					struct zebra_dplane_ctx *ctx)
+{
 	if (IS_ZEBRA_DEBUG_DPLANE_DETAIL) {
 		char dest_str[PREFIX_STRLEN];
 
@@ -2834,15 +3486,25 @@ kernel_dplane_route_update(struct zebra_dplane_ctx *ctx)
 			   ctx, dplane_op2str(dplane_ctx_get_op(ctx)));
 	}
 
-	/* Call into the synchronous kernel-facing code here */
-	res = kernel_route_update(ctx);
+	dplane_ctx_enqueue_tail(batch, ctx);
+}
 
-	if (res != ZEBRA_DPLANE_REQUEST_SUCCESS)
-		atomic_fetch_add_explicit(
-			&zdplane_info.dg_route_errors, 1,
-			memory_order_relaxed);
+/*
+ * Check whether a context is a kernel route update, which are batched
+ */
+static bool kernel_dplane_is_route_update(const struct zebra_dplane_ctx *ctx)
+{
+	if (dplane_ctx_is_skip_kernel(ctx))
+		return false;
 
-	return res;
+	switch (dplane_ctx_get_op(ctx)) {
+	case DPLANE_OP_ROUTE_INSTALL:
+	case DPLANE_OP_ROUTE_UPDATE:
+	case DPLANE_OP_ROUTE_DELETE:
+		return true;
+	default:
+		return false;
+	}
 }
 
 /*
@@ -2930,25 +3592,42 @@ kernel_dplane_neigh_update(struct zebra_dplane_ctx *ctx)
 }
 
 /*
- * Kernel provider callback
+ * Apply a list of updates to the kernel, moving the results, in order,
+ * to 'done'. This runs either in the dplane pthread, as worker 0, or in a
+ * kernel worker.
  */
-static int kernel_dplane_process_func(struct zebra_dplane_provider *prov)
+static void kernel_dplane_process_list(struct dplane_kernel_worker *w,
+				       struct dplane_ctx_q *work,
+				       struct dplane_ctx_q *done)
 {
 	enum zebra_dplane_result res;
 	struct zebra_dplane_ctx *ctx;
-	int counter, limit;
+	struct dplane_ctx_q batch;
+	uint32_t batched = 0, batch_size;
 
-	limit = dplane_provider_get_work_limit(prov);
+	batch_size = dplane_get_batch_size();
 
-	if (IS_ZEBRA_DEBUG_DPLANE_DETAIL)
-		zlog_debug("dplane provider '%s': processing",
-			   dplane_provider_get_name(prov));
+	TAILQ_INIT(&batch);
 
-	for (counter = 0; counter < limit; counter++) {
+	while ((ctx = dplane_ctx_dequeue(work)) != NULL) {
 
-		ctx = dplane_provider_dequeue_in_ctx(prov);
-		if (ctx == NULL)
-			break;
+		/* Route updates are collected and sent to the kernel
+		 * together.
+		 */
+		if (kernel_dplane_is_route_update(ctx)) {
+			kernel_dplane_route_enqueue(&batch, ctx);
+			if (++batched >= batch_size) {
+				kernel_dplane_route_batch(w, &batch, done);
+				batched = 0;
+			}
+			continue;
+		}
+
+		/* Keep results in order: send any pending route updates
+		 * before handling anything else.
+		 */
+		kernel_dplane_route_batch(w, &batch, done);
+		batched = 0;
 
 		/* A previous provider plugin may have asked to skip the
 		 * kernel update.
@@ -2961,10 +3640,9 @@ static int kernel_dplane_process_func(struct zebra_dplane_provider *prov)
 		/* Dispatch to appropriate kernel-facing apis */
 		switch (dplane_ctx_get_op(ctx)) {
 
-		case DPLANE_OP_ROUTE_INSTALL:
-		case DPLANE_OP_ROUTE_UPDATE:
-		case DPLANE_OP_ROUTE_DELETE:
-			res = kernel_dplane_route_update(ctx);
+		case DPLANE_OP_NH_INSTALL:
+		case DPLANE_OP_NH_DELETE:
+			res = kernel_dplane_nexthop_update(ctx);
 			break;
 
 		case DPLANE_OP_LSP_INSTALL:
@@ -3016,7 +3694,164 @@ static int kernel_dplane_process_func(struct zebra_dplane_provider *prov)
 skip_one:
 		dplane_ctx_set_status(ctx, res);
 
-		dplane_provider_enqueue_out_ctx(prov, ctx);
+		dplane_ctx_enqueue_tail(done, ctx);
+	}
+
+	kernel_dplane_route_batch(w, &batch, done);
+}
+
+/*
+ * Kernel worker event: apply some of the worker's queued updates, and
+ * hand the results back to the kernel provider. This runs in the worker's
+ * pthread.
+ */
+static int kernel_dplane_worker_run(struct thread *event)
+{
+	struct dplane_kernel_worker *w = THREAD_ARG(event);
+	struct zebra_dplane_ctx *ctx;
+	struct dplane_ctx_q work, done;
+	uint32_t counter, limit;
+	uint64_t usecs;
+	bool more;
+
+	limit = zdplane_info.dg_updates_per_cycle;
+
+	TAILQ_INIT(&work);
+	TAILQ_INIT(&done);
+
+	DPLANE_WORKER_LOCK(w);
+	{
+		for (counter = 0; counter < limit; counter++) {
+			ctx = dplane_ctx_dequeue(&w->dw_ctx_q);
+			if (ctx == NULL)
+				break;
+			dplane_ctx_enqueue_tail(&work, ctx);
+		}
+
+		more = !TAILQ_EMPTY(&w->dw_ctx_q);
+	}
+	DPLANE_WORKER_UNLOCK(w);
+
+	if (IS_ZEBRA_DEBUG_DPLANE_DETAIL)
+		zlog_debug("dplane kernel worker %u: processing %u",
+			   w->dw_id, counter);
+
+	kernel_dplane_process_list(w, &work, &done);
+
+	while ((ctx = dplane_ctx_dequeue(&done)) != NULL) {
+		usecs = monotime_since(&ctx->zd_worker_time, NULL);
+
+		atomic_fetch_add_explicit(&w->dw_usecs, usecs,
+					  memory_order_relaxed);
+		dplane_atomic_max64(&w->dw_max_usecs, usecs);
+
+		dplane_provider_enqueue_out_ctx(zdplane_info.dg_kernel_prov,
+						ctx);
+	}
+
+	atomic_fetch_add_explicit(&w->dw_counter, counter,
+				  memory_order_relaxed);
+	atomic_fetch_sub_explicit(&w->dw_queued, counter,
+				  memory_order_relaxed);
+
+	/* Let the dplane pthread collect the results */
+	dplane_provider_work_ready();
+
+	if (more)
+		thread_add_event(w->dw_pthread->master,
+				 kernel_dplane_worker_run, w, 0,
+				 &w->dw_t_work);
+
+	return 0;
+}
+
+/*
+ * Hand incoming updates to the kernel workers. All the updates for a
+ * namespace and table go to the same worker, so they reach the kernel
+ * in the order they were queued.
+ */
+static int kernel_dplane_dispatch(struct zebra_dplane_provider *prov,
+				  int limit)
+{
+	struct dplane_ctx_q lists[ZEBRA_DPLANE_MAX_WORKERS];
+	uint32_t counts[ZEBRA_DPLANE_MAX_WORKERS] = {};
+	struct dplane_kernel_worker *w;
+	struct zebra_dplane_ctx *ctx;
+	uint32_t i, queued;
+	int counter;
+
+	for (i = 0; i < zrouter.dplane_workers; i++)
+		TAILQ_INIT(&lists[i]);
+
+	for (counter = 0; counter < limit; counter++) {
+
+		ctx = dplane_provider_dequeue_in_ctx(prov);
+		if (ctx == NULL)
+			break;
+
+		monotime(&ctx->zd_worker_time);
+
+		dplane_ctx_enqueue_tail(&lists[ctx->zd_worker], ctx);
+		counts[ctx->zd_worker]++;
+	}
+
+	for (i = 0; i < zrouter.dplane_workers; i++) {
+		if (counts[i] == 0)
+			continue;
+
+		w = &zdplane_info.dg_workers[i];
+
+		DPLANE_WORKER_LOCK(w);
+		{
+			TAILQ_CONCAT(&w->dw_ctx_q, &lists[i], zd_q_entries);
+		}
+		DPLANE_WORKER_UNLOCK(w);
+
+		queued = atomic_fetch_add_explicit(&w->dw_queued, counts[i],
+						   memory_order_relaxed);
+		dplane_atomic_max32(&w->dw_queued_max, queued + counts[i]);
+
+		thread_add_event(w->dw_pthread->master,
+				 kernel_dplane_worker_run, w, 0,
+				 &w->dw_t_work);
+	}
+
+	return counter;
+}
+
+/*
+ * Kernel provider callback
+ */
+static int kernel_dplane_process_func(struct zebra_dplane_provider *prov)
+{
+	struct zebra_dplane_ctx *ctx;
+	struct dplane_ctx_q work, done;
+	int counter, limit;
+
+	limit = dplane_provider_get_work_limit(prov);
+
+	if (IS_ZEBRA_DEBUG_DPLANE_DETAIL)
+		zlog_debug("dplane provider '%s': processing",
+			   dplane_provider_get_name(prov));
+
+	if (zrouter.dplane_workers > 1) {
+		counter = kernel_dplane_dispatch(prov, limit);
+	} else {
+		TAILQ_INIT(&work);
+		TAILQ_INIT(&done);
+
+		for (counter = 0; counter < limit; counter++) {
+			ctx = dplane_provider_dequeue_in_ctx(prov);
+			if (ctx == NULL)
+				break;
+			dplane_ctx_enqueue_tail(&work, ctx);
+		}
+
+		kernel_dplane_process_list(&zdplane_info.dg_workers[0], &work,
+					   &done);
+
+		while ((ctx = dplane_ctx_dequeue(&done)) != NULL)
+			dplane_provider_enqueue_out_ctx(prov, ctx);
 	}
 
 	/* Ensure that we'll run the work loop again if there's still
@@ -3036,6 +3871,62 @@ skip_one:
 	return 0;
 }
 
+/*
+ * Kernel provider start callback: set up each worker's route batch, and
+ * start the kernel worker pthreads if zebra was configured to use more
+ * than one. With a single worker, the dplane pthread uses worker 0's
+ * batch.
+ */
+static int kernel_dplane_start_func(struct zebra_dplane_provider *prov)
+{
+	struct dplane_kernel_worker *w;
+	struct frr_pthread_attr pattr = {
+		.start = frr_pthread_attr_default.start,
+		.stop = frr_pthread_attr_default.stop
+	};
+	char name[32], os_name[16];
+	uint32_t i;
+
+	for (i = 0; i < MAX(zrouter.dplane_workers, 1U); i++)
+		zdplane_info.dg_workers[i].dw_batch = kernel_route_batch_new();
+
+	if (zrouter.dplane_workers <= 1)
+		return 0;
+
+	for (i = 0; i < zrouter.dplane_workers; i++) {
+		w = &zdplane_info.dg_workers[i];
+
+		snprintf(name, sizeof(name), "Zebra dplane worker %u", i);
+		snprintf(os_name, sizeof(os_name), "zebra_dpw%u", i);
+
+		w->dw_pthread = frr_pthread_new(&pattr, name, os_name);
+		frr_pthread_run(w->dw_pthread, NULL);
+	}
+
+	return 0;
+}
+
+/*
+ * Stop and free the kernel worker pthreads
+ */
+static void kernel_dplane_workers_stop(void)
+{
+	struct dplane_kernel_worker *w;
+	uint32_t i;
+
+	for (i = 0; i < ZEBRA_DPLANE_MAX_WORKERS; i++) {
+		w = &zdplane_info.dg_workers[i];
+
+		if (w->dw_pthread == NULL)
+			continue;
+
+		frr_pthread_stop(w->dw_pthread, NULL);
+		frr_pthread_destroy(w->dw_pthread);
+		w->dw_pthread = NULL;
+		w->dw_t_work = NULL;
+	}
+}
+
 #if DPLANE_TEST_PROVIDER
 
 /*
@@ -3109,12 +4000,18 @@ static void dplane_provider_init(void)
 {
 	int ret;
 
+	/* With several kernel workers, the provider's queues are shared
+	 * between pthreads and need locking.
+	 */
 	ret = dplane_provider_register("Kernel",
 				       DPLANE_PRIO_KERNEL,
-				       DPLANE_PROV_FLAGS_DEFAULT, NULL,
+				       zrouter.dplane_workers > 1 ?
+				       DPLANE_PROV_FLAG_THREADED :
+				       DPLANE_PROV_FLAGS_DEFAULT,
+				       kernel_dplane_start_func,
 				       kernel_dplane_process_func,
 				       NULL,
-				       NULL, NULL);
+				       NULL, &zdplane_info.dg_kernel_prov);
 
 	if (ret != AOK)
 		zlog_err("Unable to register kernel dplane provider: %d",
@@ -3169,6 +4066,7 @@ static bool dplane_work_pending(void)
 	bool ret = false;
 	struct zebra_dplane_ctx *ctx;
 	struct zebra_dplane_provider *prov;
+	uint32_t i;
 
 	/* TODO -- just checking incoming/pending work for now, must check
 	 * providers
@@ -3203,8 +4101,19 @@ static bool dplane_work_pending(void)
 		DPLANE_UNLOCK();
 	}
 
-	if (ctx != NULL)
+	if (ctx != NULL) {
 		ret = true;
+		goto done;
+	}
+
+	/* Updates may still be in flight in the kernel workers */
+	for (i = 0; i < ZEBRA_DPLANE_MAX_WORKERS; i++) {
+		if (atomic_load_explicit(&zdplane_info.dg_workers[i].dw_queued,
+					 memory_order_relaxed) > 0) {
+			ret = true;
+			break;
+		}
+	}
 
 done:
 	return ret;
@@ -3458,6 +4367,8 @@ done:
  */
 void zebra_dplane_shutdown(void)
 {
+	uint32_t i;
+
 	if (IS_ZEBRA_DEBUG_DPLANE)
 		zlog_debug("Zebra dataplane shutdown called");
 
@@ -3467,6 +4378,11 @@ void zebra_dplane_shutdown(void)
 
 	THREAD_OFF(zdplane_info.dg_t_update);
 
+	/* Stop the kernel workers first, they hand results to the dplane
+	 * pthread.
+	 */
+	kernel_dplane_workers_stop();
+
 	frr_pthread_stop(zdplane_info.dg_pthread, NULL);
 
 	/* Destroy pthread */
@@ -3474,11 +4390,17 @@ void zebra_dplane_shutdown(void)
 	zdplane_info.dg_pthread = NULL;
 	zdplane_info.dg_master = NULL;
 
+	/* Nothing sends route batches any more */
+	for (i = 0; i < ZEBRA_DPLANE_MAX_WORKERS; i++)
+		kernel_route_batch_free(&zdplane_info.dg_workers[i].dw_batch);
+
 	/* TODO -- Notify provider(s) of final shutdown */
 
 	/* TODO -- Clean-up provider objects */
 
 	/* TODO -- Clean queue(s), free memory */
+
+	dplane_ctx_cache_flush();
 }
 
 /*
@@ -3486,6 +4408,8 @@ void zebra_dplane_shutdown(void)
  */
 static void zebra_dplane_init_internal(void)
 {
+	uint32_t i;
+
 	memset(&zdplane_info, 0, sizeof(zdplane_info));
 
 	pthread_mutex_init(&zdplane_info.dg_mutex, NULL);
@@ -3493,9 +4417,20 @@ static void zebra_dplane_init_internal(void)
 	TAILQ_INIT(&zdplane_info.dg_update_ctx_q);
 	TAILQ_INIT(&zdplane_info.dg_providers_q);
 
+	/* The context cache belongs to the zebra main pthread */
+	zdplane_info.dg_cache.dc_owner = pthread_self();
+	TAILQ_INIT(&zdplane_info.dg_cache.dc_ctx_q);
+
+	for (i = 0; i < ZEBRA_DPLANE_MAX_WORKERS; i++) {
+		zdplane_info.dg_workers[i].dw_id = i;
+		pthread_mutex_init(&zdplane_info.dg_workers[i].dw_mutex, NULL);
+		TAILQ_INIT(&zdplane_info.dg_workers[i].dw_ctx_q);
+	}
+
 	zdplane_info.dg_updates_per_cycle = DPLANE_DEFAULT_NEW_WORK;
 
 	zdplane_info.dg_max_queued_updates = DPLANE_DEFAULT_MAX_QUEUED;
+	zdplane_info.dg_batch_size = DPLANE_DEFAULT_BATCH_SIZE;
 
 	/* Register default kernel 'provider' during init */
 	dplane_provider_init();
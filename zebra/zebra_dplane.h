@@ -138,6 +138,10 @@ enum dplane_op_e {
 	/* EVPN VTEP updates */
 	DPLANE_OP_VTEP_ADD,
 	DPLANE_OP_VTEP_DELETE,
+
+	/* Kernel nexthop object updates */
+	DPLANE_OP_NH_INSTALL,
+	DPLANE_OP_NH_DELETE,
 };
 
 /*
@@ -268,6 +272,10 @@ const struct nexthop_group *dplane_ctx_get_ng(
 	const struct zebra_dplane_ctx *ctx);
 const struct nexthop_group *dplane_ctx_get_old_ng(
 	const struct zebra_dplane_ctx *ctx);
+/* Kernel nexthop object a route update refers to, or zero */
+uint32_t dplane_ctx_get_nhg_id(const struct zebra_dplane_ctx *ctx);
+/* ... and whether the installed route already refers to it */
+bool dplane_ctx_get_nhg_kept(const struct zebra_dplane_ctx *ctx);
 
 /* Accessors for LSP information */
 mpls_label_t dplane_ctx_get_in_label(const struct zebra_dplane_ctx *ctx);
@@ -338,6 +346,14 @@ const struct ethaddr *dplane_ctx_neigh_get_mac(
 uint32_t dplane_ctx_neigh_get_flags(const struct zebra_dplane_ctx *ctx);
 uint16_t dplane_ctx_neigh_get_state(const struct zebra_dplane_ctx *ctx);
 
+/* Accessors for nexthop object information */
+uint32_t dplane_ctx_get_nhe_id(const struct zebra_dplane_ctx *ctx);
+afi_t dplane_ctx_get_nhe_afi(const struct zebra_dplane_ctx *ctx);
+const struct nexthop *dplane_ctx_get_nhe_nexthop(
+	const struct zebra_dplane_ctx *ctx);
+const uint32_t *dplane_ctx_get_nhe_grp(const struct zebra_dplane_ctx *ctx,
+				       uint8_t *num);
+
 /* Namespace info - esp. for netlink communication */
 const struct zebra_dplane_info *dplane_ctx_get_ns(
 	const struct zebra_dplane_ctx *ctx);
@@ -373,6 +389,14 @@ enum zebra_dplane_result dplane_route_notif_update(
 	enum dplane_op_e op,
 	struct zebra_dplane_ctx *ctx);
 
+/*
+ * Enqueue kernel nexthop object operations for the dataplane.
+ */
+struct nhg_hash_entry;
+
+enum zebra_dplane_result dplane_nexthop_add(struct nhg_hash_entry *nhe);
+enum zebra_dplane_result dplane_nexthop_delete(struct nhg_hash_entry *nhe);
+
 /*
  * Enqueue LSP change operations for the dataplane.
  */
@@ -450,6 +474,14 @@ void dplane_set_in_queue_limit(uint32_t limit, bool set);
 /* Retrieve the current queue depth of incoming, unprocessed updates */
 uint32_t dplane_get_in_queue_len(void);
 
+/* Retrieve the number of route updates sent to the kernel in one batch. */
+uint32_t dplane_get_batch_size(void);
+
+/* Configure the number of route updates sent to the kernel in one batch. If
+ * 'unset', reset to default value.
+ */
+void dplane_set_batch_size(uint32_t size, bool set);
+
 /*
  * Vty/cli apis
  */
@@ -22,19 +22,40 @@
  */
 #include <zebra.h>
 
+#include "lib/hash.h"
+#include "lib/jhash.h"
+#include "lib/linklist.h"
 #include "lib/nexthop.h"
 #include "lib/nexthop_group_private.h"
 #include "lib/routemap.h"
 #include "lib/mpls.h"
+#include "lib/vty.h"
 
 #include "zebra/connected.h"
 #include "zebra/debug.h"
+#include "zebra/zebra_dplane.h"
+#include "zebra/zebra_errors.h"
+#include "zebra/zebra_memory.h"
 #include "zebra/zebra_router.h"
 #include "zebra/zebra_nhg.h"
 #include "zebra/zebra_rnh.h"
 #include "zebra/zebra_routemap.h"
 #include "zebra/rt.h"
 
+DEFINE_MTYPE_STATIC(ZEBRA, NHG, "Nexthop Group Entry")
+
+/* Kernel nexthop object ids found at startup, to be swept */
+struct nhg_stale {
+	uint32_t id;
+	bool group;
+};
+
+static struct nhg_stale *nhg_stale;
+static uint32_t nhg_stale_num, nhg_stale_size;
+
+/* Last kernel nexthop object id handed out */
+static uint32_t nhg_id_last;
+
 static void nexthop_set_resolved(afi_t afi, const struct nexthop *newhop,
 				 struct nexthop *nexthop)
 {
@@ -552,3 +573,706 @@ int nexthop_active_update(struct route_node *rn, struct route_entry *re)
 	return re->nexthop_active_num;
 }
 
+
+/*
+ * Shared nexthop groups
+ */
+
+static uint32_t zebra_nhg_hash_key(const void *arg)
+{
+	const struct nhg_hash_entry *nhe = arg;
+	const struct nexthop *nh = nhe->nhg.nexthop;
+	uint32_t key;
+	uint8_t i;
+
+	key = jhash_3words(nhe->afi, nhe->vrf_id, nhe->member_num, 0x5a6b7c8d);
+	key = jhash_1word(nhe->table_id, key);
+
+	if (nhe->member_num) {
+		for (i = 0; i < nhe->member_num; i++)
+			key = jhash_1word(nhe->members[i]->id, key);
+		return key;
+	}
+
+	key = jhash_3words(nh->type, nh->ifindex, nh->vrf_id, key);
+	key = jhash(&nh->gate, sizeof(nh->gate), key);
+
+	return jhash_1word(nh->flags, key);
+}
+
+static bool zebra_nhg_hash_equal(const void *arg1, const void *arg2)
+{
+	const struct nhg_hash_entry *nhe1 = arg1;
+	const struct nhg_hash_entry *nhe2 = arg2;
+	const struct nexthop *nh1, *nh2;
+
+	if (nhe1->afi != nhe2->afi || nhe1->vrf_id != nhe2->vrf_id
+	    || nhe1->table_id != nhe2->table_id
+	    || nhe1->member_num != nhe2->member_num)
+		return false;
+
+	/* Members are themselves unique entries */
+	if (nhe1->member_num)
+		return !memcmp(nhe1->members, nhe2->members,
+			       nhe1->member_num * sizeof(*nhe1->members));
+
+	nh1 = nhe1->nhg.nexthop;
+	nh2 = nhe2->nhg.nexthop;
+
+	return nh1->type == nh2->type && nh1->ifindex == nh2->ifindex
+	       && nh1->vrf_id == nh2->vrf_id && nh1->flags == nh2->flags
+	       && !memcmp(&nh1->gate, &nh2->gate, sizeof(nh1->gate));
+}
+
+static uint32_t zebra_nhg_id_key(const void *arg)
+{
+	const struct nhg_hash_entry *nhe = arg;
+
+	return nhe->id;
+}
+
+static bool zebra_nhg_id_equal(const void *arg1, const void *arg2)
+{
+	const struct nhg_hash_entry *nhe1 = arg1;
+	const struct nhg_hash_entry *nhe2 = arg2;
+
+	return nhe1->id == nhe2->id;
+}
+
+bool zebra_nhg_kernel_enabled(void)
+{
+	return zrouter.nhg_kernel && zrouter.nhg_kernel_supported;
+}
+
+/*
+ * Can this installed nexthop be turned into a kernel nexthop object?
+ * Labelled and blackhole nexthops, and IPv4 routes over IPv6 nexthops,
+ * keep being sent with the route.
+ */
+static bool zebra_nhg_nexthop_usable(const struct nexthop *nh, afi_t afi)
+{
+	if (nh->nh_label && nh->nh_label->num_labels)
+		return false;
+
+	if (!nh->ifindex)
+		return false;
+
+	switch (nh->type) {
+	case NEXTHOP_TYPE_IFINDEX:
+		return true;
+	case NEXTHOP_TYPE_IPV4:
+	case NEXTHOP_TYPE_IPV4_IFINDEX:
+		return afi == AFI_IP;
+	case NEXTHOP_TYPE_IPV6:
+	case NEXTHOP_TYPE_IPV6_IFINDEX:
+		return afi == AFI_IP6;
+	case NEXTHOP_TYPE_BLACKHOLE:
+		break;
+	}
+
+	return false;
+}
+
+/* Copy the parts of a nexthop that go into the kernel object */
+static void zebra_nhg_nexthop_copy(struct nexthop *dst,
+				   const struct nexthop *src)
+{
+	memset(dst, 0, sizeof(*dst));
+
+	dst->type = src->type;
+	dst->vrf_id = src->vrf_id;
+	dst->ifindex = src->ifindex;
+
+	switch (src->type) {
+	case NEXTHOP_TYPE_IPV4:
+	case NEXTHOP_TYPE_IPV4_IFINDEX:
+		dst->gate.ipv4 = src->gate.ipv4;
+		break;
+	case NEXTHOP_TYPE_IPV6:
+	case NEXTHOP_TYPE_IPV6_IFINDEX:
+		dst->gate.ipv6 = src->gate.ipv6;
+		break;
+	case NEXTHOP_TYPE_IFINDEX:
+	case NEXTHOP_TYPE_BLACKHOLE:
+		break;
+	}
+
+	SET_FLAG(dst->flags, NEXTHOP_FLAG_ACTIVE);
+	if (CHECK_FLAG(src->flags, NEXTHOP_FLAG_ONLINK))
+		SET_FLAG(dst->flags, NEXTHOP_FLAG_ONLINK);
+}
+
+static uint32_t zebra_nhg_id_alloc(void)
+{
+	struct nhg_hash_entry lookup;
+
+	do {
+		if (++nhg_id_last == 0)
+			nhg_id_last = 1;
+		lookup.id = nhg_id_last;
+	} while (hash_lookup(zrouter.nhgs_id, &lookup));
+
+	return nhg_id_last;
+}
+
+static void zebra_nhg_install(struct nhg_hash_entry *nhe)
+{
+	switch (dplane_nexthop_add(nhe)) {
+	case ZEBRA_DPLANE_REQUEST_QUEUED:
+		SET_FLAG(nhe->flags, NEXTHOP_GROUP_QUEUED);
+		break;
+	case ZEBRA_DPLANE_REQUEST_FAILURE:
+		flog_err(EC_ZEBRA_DP_INSTALL_FAIL,
+			 "Failed to enqueue install of nexthop group %u",
+			 nhe->id);
+		SET_FLAG(nhe->flags, NEXTHOP_GROUP_FAILED);
+		break;
+	case ZEBRA_DPLANE_REQUEST_SUCCESS:
+		SET_FLAG(nhe->flags, NEXTHOP_GROUP_INSTALLED);
+		break;
+	}
+}
+
+static void *zebra_nhg_alloc(void *arg)
+{
+	const struct nhg_hash_entry *lookup = arg;
+	struct nhg_hash_entry *nhe;
+	struct nexthop *nh;
+	uint8_t i;
+
+	nhe = XCALLOC(MTYPE_NHG, sizeof(*nhe));
+	nhe->afi = lookup->afi;
+	nhe->vrf_id = lookup->vrf_id;
+	nhe->table_id = lookup->table_id;
+	nhe->id = zebra_nhg_id_alloc();
+
+	if (lookup->member_num) {
+		/* The group takes over the caller's member references */
+		nhe->member_num = lookup->member_num;
+		nhe->members = XCALLOC(MTYPE_NHG, nhe->member_num
+							  * sizeof(*nhe->members));
+		memcpy(nhe->members, lookup->members,
+		       nhe->member_num * sizeof(*nhe->members));
+
+		for (i = 0; i < nhe->member_num; i++) {
+			nh = nexthop_new();
+			zebra_nhg_nexthop_copy(nh,
+					       nhe->members[i]->nhg.nexthop);
+			_nexthop_add(&nhe->nhg.nexthop, nh);
+		}
+	} else {
+		nh = nexthop_new();
+		zebra_nhg_nexthop_copy(nh, lookup->nhg.nexthop);
+		nhe->nhg.nexthop = nh;
+	}
+
+	hash_get(zrouter.nhgs_id, nhe, hash_alloc_intern);
+
+	if (IS_ZEBRA_DEBUG_RIB_DETAILED)
+		zlog_debug("%s: nexthop group %u, %u member(s)", __func__,
+			   nhe->id, nhe->member_num);
+
+	zebra_nhg_install(nhe);
+
+	return nhe;
+}
+
+static void zebra_nhg_free(struct nhg_hash_entry *nhe)
+{
+	uint8_t i;
+
+	for (i = 0; i < nhe->member_num; i++)
+		zebra_nhg_release(nhe->members[i]);
+
+	XFREE(MTYPE_NHG, nhe->members);
+	nexthops_free(nhe->nhg.nexthop);
+	XFREE(MTYPE_NHG, nhe);
+}
+
+struct nhg_hash_entry *zebra_nhg_lookup_id(uint32_t id)
+{
+	struct nhg_hash_entry lookup;
+
+	if (!zrouter.nhgs_id)
+		return NULL;
+
+	lookup.id = id;
+	return hash_lookup(zrouter.nhgs_id, &lookup);
+}
+
+void zebra_nhg_release(struct nhg_hash_entry *nhe)
+{
+	if (!nhe)
+		return;
+
+	assert(nhe->refcnt > 0);
+	if (--nhe->refcnt > 0)
+		return;
+
+	if (!CHECK_FLAG(nhe->flags, NEXTHOP_GROUP_RETIRED))
+		hash_release(zrouter.nhgs, nhe);
+	hash_release(zrouter.nhgs_id, nhe);
+
+	/* The routes using it have been queued for removal, or update,
+	 * ahead of this: a group goes before its members, as they are
+	 * released afterwards.
+	 */
+	if (CHECK_FLAG(nhe->flags,
+		       NEXTHOP_GROUP_INSTALLED | NEXTHOP_GROUP_QUEUED)
+	    && !atomic_load_explicit(&zrouter.in_shutdown,
+				     memory_order_relaxed)
+	    && !dplane_is_in_shutdown()) {
+		if (dplane_nexthop_delete(nhe) == ZEBRA_DPLANE_REQUEST_FAILURE)
+			flog_err(EC_ZEBRA_DP_DELETE_FAIL,
+				 "Failed to enqueue delete of nexthop group %u",
+				 nhe->id);
+	}
+
+	zebra_nhg_free(nhe);
+}
+
+static struct nhg_hash_entry *zebra_nhg_get(struct nhg_hash_entry *lookup,
+					    bool *created)
+{
+	struct nhg_hash_entry *nhe;
+
+	nhe = hash_get(zrouter.nhgs, lookup, zebra_nhg_alloc);
+	*created = (nhe->refcnt == 0);
+	nhe->refcnt++;
+
+	return nhe;
+}
+
+struct nhg_hash_entry *zebra_nhg_rib_find(const struct route_entry *re,
+					  afi_t afi)
+{
+	struct nhg_hash_entry *members[MULTIPATH_NUM];
+	struct nhg_hash_entry lookup, *nhe;
+	struct nexthop *nexthop, nh;
+	bool created;
+	uint8_t num = 0, i, j;
+
+	if (!zebra_nhg_kernel_enabled())
+		return NULL;
+
+	/* Entries are not shared across tables, so that a nexthop object
+	 * and the routes using it are sent down the same dplane worker, and
+	 * so reach the kernel in order.
+	 */
+	memset(&lookup, 0, sizeof(lookup));
+	lookup.afi = afi;
+	lookup.table_id = re->table;
+
+	/* The nexthops that would be sent to the kernel with the route
+	 * become the group's members.
+	 */
+	for (ALL_NEXTHOPS(re->ng, nexthop)) {
+		if (CHECK_FLAG(nexthop->flags, NEXTHOP_FLAG_RECURSIVE))
+			continue;
+		if (!NEXTHOP_IS_ACTIVE(nexthop->flags))
+			continue;
+
+		if (num >= array_size(members)
+		    || !zebra_nhg_nexthop_usable(nexthop, afi))
+			goto unusable;
+
+		zebra_nhg_nexthop_copy(&nh, nexthop);
+		lookup.vrf_id = nh.vrf_id;
+		lookup.nhg.nexthop = &nh;
+		nhe = zebra_nhg_get(&lookup, &created);
+
+		for (i = 0; i < num; i++)
+			if (members[i] == nhe)
+				break;
+		if (i < num) {
+			zebra_nhg_release(nhe);
+			continue;
+		}
+
+		/* Keep members sorted by id, so the same set of nexthops
+		 * makes the same group in whatever order they come in.
+		 */
+		for (i = num; i > 0 && members[i - 1]->id > nhe->id; i--)
+			members[i] = members[i - 1];
+		members[i] = nhe;
+		num++;
+	}
+
+	if (num == 0)
+		return NULL;
+	if (num == 1)
+		return members[0];
+
+	lookup.vrf_id = re->vrf_id;
+	lookup.nhg.nexthop = NULL;
+	lookup.members = members;
+	lookup.member_num = num;
+	nhe = zebra_nhg_get(&lookup, &created);
+
+	/* An existing group already holds its members */
+	if (!created)
+		for (j = 0; j < num; j++)
+			zebra_nhg_release(members[j]);
+
+	return nhe;
+
+unusable:
+	for (j = 0; j < num; j++)
+		zebra_nhg_release(members[j]);
+
+	return NULL;
+}
+
+void zebra_nhg_dplane_result(struct zebra_dplane_ctx *ctx)
+{
+	struct nhg_hash_entry *nhe;
+	enum dplane_op_e op = dplane_ctx_get_op(ctx);
+	enum zebra_dplane_result status = dplane_ctx_get_status(ctx);
+	uint32_t id = dplane_ctx_get_nhe_id(ctx);
+
+	if (IS_ZEBRA_DEBUG_DPLANE_DETAIL)
+		zlog_debug("Nexthop group %u dplane ctx %p, op %s, result %s",
+			   id, ctx, dplane_op2str(op),
+			   dplane_res2str(status));
+
+	switch (op) {
+	case DPLANE_OP_NH_INSTALL:
+		/* The entry may have been released in the meantime */
+		nhe = zebra_nhg_lookup_id(id);
+		if (!nhe)
+			break;
+
+		UNSET_FLAG(nhe->flags, NEXTHOP_GROUP_QUEUED);
+		if (status == ZEBRA_DPLANE_REQUEST_SUCCESS) {
+			SET_FLAG(nhe->flags, NEXTHOP_GROUP_INSTALLED);
+		} else {
+			/* Routes installed from now on spell out their
+			 * nexthops instead.
+			 */
+			SET_FLAG(nhe->flags, NEXTHOP_GROUP_FAILED);
+			flog_err(EC_ZEBRA_DP_INSTALL_FAIL,
+				 "Failed to install nexthop group %u", id);
+		}
+		break;
+	case DPLANE_OP_NH_DELETE:
+		if (status != ZEBRA_DPLANE_REQUEST_SUCCESS
+		    && IS_ZEBRA_DEBUG_DPLANE)
+			zlog_debug("Failed to delete nexthop group %u", id);
+		break;
+	default:
+		break;
+	}
+
+	dplane_ctx_fini(&ctx);
+}
+
+struct nhg_if_walk {
+	const struct interface *ifp;
+	bool down;
+	struct list *singles;
+	struct list *groups;
+};
+
+static bool zebra_nhg_nexthop_over(const struct nexthop *nh,
+				   const struct interface *ifp)
+{
+	return nh->ifindex == ifp->ifindex && nh->vrf_id == ifp->vrf_id;
+}
+
+static int zebra_nhg_if_walk(struct hash_bucket *bucket, void *arg)
+{
+	struct nhg_hash_entry *nhe = bucket->data;
+	struct nhg_if_walk *walk = arg;
+	struct nexthop *nh;
+
+	if (!walk->down && !CHECK_FLAG(nhe->flags, NEXTHOP_GROUP_FAILED))
+		return HASHWALK_CONTINUE;
+
+	for (nh = nhe->nhg.nexthop; nh; nh = nh->next) {
+		if (zebra_nhg_nexthop_over(nh, walk->ifp)) {
+			listnode_add(nhe->member_num ? walk->groups
+						     : walk->singles,
+				     nhe);
+			break;
+		}
+	}
+
+	return HASHWALK_CONTINUE;
+}
+
+static void zebra_nhg_retire(struct nhg_hash_entry *nhe,
+			     const struct interface *ifp, bool down)
+{
+	hash_release(zrouter.nhgs, nhe);
+	SET_FLAG(nhe->flags, NEXTHOP_GROUP_RETIRED);
+
+	/* A group loses the member, but stays in the kernel */
+	if (down && !nhe->member_num)
+		UNSET_FLAG(nhe->flags,
+			   NEXTHOP_GROUP_INSTALLED | NEXTHOP_GROUP_QUEUED);
+
+	if (IS_ZEBRA_DEBUG_RIB_DETAILED)
+		zlog_debug("%s: nexthop group %u retired, %s %s", __func__,
+			   nhe->id, ifp->name, down ? "down" : "up");
+}
+
+/*
+ * Drop the members over an interface that went down from a group, keeping
+ * its id, and replace it in the kernel.  The routes that used the group
+ * resolve to it again, and so need no kernel update of their own.  Only
+ * done if at least two members are left, and no other group already has
+ * them; otherwise the group is retired, and its routes move on to another
+ * entry when they are reinstalled.
+ */
+static bool zebra_nhg_group_shrink(struct nhg_hash_entry *nhe,
+				   const struct interface *ifp)
+{
+	struct nhg_hash_entry *members[MULTIPATH_NUM];
+	struct nhg_hash_entry *dropped[MULTIPATH_NUM];
+	struct nhg_hash_entry lookup;
+	struct nexthop *nh;
+	uint8_t num = 0, dropped_num = 0, i;
+
+	if (CHECK_FLAG(nhe->flags, NEXTHOP_GROUP_FAILED))
+		return false;
+
+	for (i = 0; i < nhe->member_num; i++) {
+		if (zebra_nhg_nexthop_over(nhe->members[i]->nhg.nexthop, ifp))
+			dropped[dropped_num++] = nhe->members[i];
+		else
+			members[num++] = nhe->members[i];
+	}
+
+	if (num < 2)
+		return false;
+
+	memset(&lookup, 0, sizeof(lookup));
+	lookup.afi = nhe->afi;
+	lookup.vrf_id = nhe->vrf_id;
+	lookup.table_id = nhe->table_id;
+	lookup.members = members;
+	lookup.member_num = num;
+	if (hash_lookup(zrouter.nhgs, &lookup))
+		return false;
+
+	hash_release(zrouter.nhgs, nhe);
+
+	nexthops_free(nhe->nhg.nexthop);
+	nhe->nhg.nexthop = NULL;
+	for (i = 0; i < num; i++) {
+		nhe->members[i] = members[i];
+
+		nh = nexthop_new();
+		zebra_nhg_nexthop_copy(nh, members[i]->nhg.nexthop);
+		_nexthop_add(&nhe->nhg.nexthop, nh);
+	}
+	nhe->member_num = num;
+
+	hash_get(zrouter.nhgs, nhe, hash_alloc_intern);
+
+	if (IS_ZEBRA_DEBUG_RIB_DETAILED)
+		zlog_debug("%s: nexthop group %u replaced, %u member(s) left, %s down",
+			   __func__, nhe->id, num, ifp->name);
+
+	/* The replace is queued ahead of any delete of the members */
+	zebra_nhg_install(nhe);
+
+	for (i = 0; i < dropped_num; i++)
+		zebra_nhg_release(dropped[i]);
+
+	return true;
+}
+
+/*
+ * Take the entries over an interface out of the lookup hash, so routes
+ * installed from now on get new ones; the routes still using them keep
+ * them until they are reinstalled.  Groups losing a member to an
+ * interface going down are replaced in place where possible instead.
+ */
+static void zebra_nhg_interface_change(const struct interface *ifp,
+				       bool down)
+{
+	struct nhg_if_walk walk = {.ifp = ifp, .down = down};
+	struct nhg_hash_entry *nhe;
+	struct listnode *node;
+
+	if (!zrouter.nhgs || !hashcount(zrouter.nhgs))
+		return;
+
+	walk.singles = list_new();
+	walk.groups = list_new();
+	hash_walk(zrouter.nhgs, zebra_nhg_if_walk, &walk);
+
+	/* Single nexthops first: a group shrinking may release the last
+	 * reference on one of them.
+	 */
+	for (ALL_LIST_ELEMENTS_RO(walk.singles, node, nhe))
+		zebra_nhg_retire(nhe, ifp, down);
+
+	for (ALL_LIST_ELEMENTS_RO(walk.groups, node, nhe))
+		if (!down || !zebra_nhg_group_shrink(nhe, ifp))
+			zebra_nhg_retire(nhe, ifp, down);
+
+	list_delete(&walk.singles);
+	list_delete(&walk.groups);
+}
+
+/* The kernel flushes the nexthop objects over an interface that goes
+ * down, and the routes using them.
+ */
+void zebra_nhg_interface_down(const struct interface *ifp)
+{
+	zebra_nhg_interface_change(ifp, true);
+}
+
+/* Entries that could not be installed while the interface was down get
+ * another chance.
+ */
+void zebra_nhg_interface_up(const struct interface *ifp)
+{
+	zebra_nhg_interface_change(ifp, false);
+}
+
+void zebra_nhg_kernel_stale_add(uint32_t id, bool group)
+{
+	if (nhg_stale_num == nhg_stale_size) {
+		nhg_stale_size = nhg_stale_size ? nhg_stale_size * 2 : 16;
+		nhg_stale = XREALLOC(MTYPE_NHG, nhg_stale,
+				     nhg_stale_size * sizeof(*nhg_stale));
+	}
+
+	nhg_stale[nhg_stale_num].id = id;
+	nhg_stale[nhg_stale_num].group = group;
+	nhg_stale_num++;
+
+	/* Hand out ids above those already in use */
+	if (id > nhg_id_last)
+		nhg_id_last = id;
+}
+
+/*
+ * Remove the nexthop objects a previous zebra left in the kernel.  Done
+ * with the rib sweep, rather than at startup, so routes kept in the kernel
+ * across a restart keep forwarding until then; groups go first, so their
+ * members are unused by the time they go.
+ */
+void zebra_nhg_sweep_stale(void)
+{
+	struct nhg_hash_entry nhe;
+	uint32_t i;
+	int pass;
+
+	for (pass = 0; pass < 2; pass++) {
+		for (i = 0; i < nhg_stale_num; i++) {
+			if (nhg_stale[i].group != (pass == 0))
+				continue;
+			if (zebra_nhg_lookup_id(nhg_stale[i].id))
+				continue;
+
+			memset(&nhe, 0, sizeof(nhe));
+			nhe.id = nhg_stale[i].id;
+			nhe.vrf_id = VRF_DEFAULT;
+			dplane_nexthop_delete(&nhe);
+		}
+	}
+
+	XFREE(MTYPE_NHG, nhg_stale);
+	nhg_stale_num = nhg_stale_size = 0;
+}
+
+static void zebra_nhg_show_nexthop(struct vty *vty, const struct nexthop *nh)
+{
+	char buf[INET6_ADDRSTRLEN];
+
+	switch (nh->type) {
+	case NEXTHOP_TYPE_IPV4:
+	case NEXTHOP_TYPE_IPV4_IFINDEX:
+		vty_out(vty, "    via %s",
+			inet_ntop(AF_INET, &nh->gate.ipv4, buf, sizeof(buf)));
+		break;
+	case NEXTHOP_TYPE_IPV6:
+	case NEXTHOP_TYPE_IPV6_IFINDEX:
+		vty_out(vty, "    via %s",
+			inet_ntop(AF_INET6, &nh->gate.ipv6, buf, sizeof(buf)));
+		break;
+	case NEXTHOP_TYPE_IFINDEX:
+		vty_out(vty, "    directly connected");
+		break;
+	case NEXTHOP_TYPE_BLACKHOLE:
+		vty_out(vty, "    blackhole");
+		break;
+	}
+
+	vty_out(vty, ", %s%s\n", ifindex2ifname(nh->ifindex, nh->vrf_id),
+		CHECK_FLAG(nh->flags, NEXTHOP_FLAG_ONLINK) ? " onlink" : "");
+}
+
+static int zebra_nhg_show_entry(struct hash_bucket *bucket, void *arg)
+{
+	struct nhg_hash_entry *nhe = bucket->data;
+	struct vty *vty = arg;
+	struct nexthop *nh;
+	uint8_t i;
+
+	vty_out(vty, "ID: %u  %s  VRF %s  refcnt %u%s%s%s%s\n", nhe->id,
+		afi2str(nhe->afi), vrf_id_to_name(nhe->vrf_id), nhe->refcnt,
+		CHECK_FLAG(nhe->flags, NEXTHOP_GROUP_INSTALLED)
+			? "  Installed"
+			: "",
+		CHECK_FLAG(nhe->flags, NEXTHOP_GROUP_QUEUED) ? "  Queued" : "",
+		CHECK_FLAG(nhe->flags, NEXTHOP_GROUP_FAILED) ? "  Failed" : "",
+		CHECK_FLAG(nhe->flags, NEXTHOP_GROUP_RETIRED) ? "  Retired"
+							      : "");
+
+	if (nhe->member_num) {
+		vty_out(vty, "  Members:");
+		for (i = 0; i < nhe->member_num; i++)
+			vty_out(vty, " %u", nhe->members[i]->id);
+		vty_out(vty, "\n");
+	}
+
+	for (nh = nhe->nhg.nexthop; nh; nh = nh->next)
+		zebra_nhg_show_nexthop(vty, nh);
+
+	return HASHWALK_CONTINUE;
+}
+
+void zebra_nhg_show(struct vty *vty)
+{
+	const char *state = "in use";
+
+	if (!zrouter.nhg_kernel)
+		state = "disabled";
+	else if (!zrouter.nhg_kernel_supported)
+		state = "not supported by the kernel";
+
+	vty_out(vty, "Kernel nexthop objects: %s\n", state);
+	vty_out(vty, "Nexthop groups: %lu\n", hashcount(zrouter.nhgs));
+
+	hash_walk(zrouter.nhgs, zebra_nhg_show_entry, vty);
+}
+
+void zebra_nhg_init(void)
+{
+	zrouter.nhgs = hash_create_size(8, zebra_nhg_hash_key,
+					zebra_nhg_hash_equal,
+					"Nexthop Group Hash");
+	zrouter.nhgs_id = hash_create_size(8, zebra_nhg_id_key,
+					   zebra_nhg_id_equal,
+					   "Nexthop Group ID Hash");
+}
+
+void zebra_nhg_terminate(void)
+{
+	/* Routes have all been freed, and released their groups, by now */
+	hash_clean(zrouter.nhgs_id, NULL);
+	hash_free(zrouter.nhgs_id);
+	zrouter.nhgs_id = NULL;
+
+	hash_clean(zrouter.nhgs, NULL);
+	hash_free(zrouter.nhgs);
+	zrouter.nhgs = NULL;
+
+	XFREE(MTYPE_NHG, nhg_stale);
+	nhg_stale_num = nhg_stale_size = 0;
+}
@@ -25,5 +25,71 @@
 
 #include "zebra/rib.h"
 
+struct zebra_dplane_ctx;
+
+/*
+ * A set of resolved nexthops, shared by all the routes that forward over
+ * it, and programmed into the kernel once as a nexthop object that those
+ * routes refer to by id.  An entry is either a single nexthop, or a group
+ * of single-nexthop entries.
+ */
+struct nhg_hash_entry {
+	/* Kernel nexthop object id */
+	uint32_t id;
+
+	afi_t afi;
+	vrf_id_t vrf_id;
+
+	/* Routing table of the routes using it: the entry's kernel updates
+	 * go through the same dplane worker as theirs.
+	 */
+	uint32_t table_id;
+
+	/* The nexthops forwarded over: one for a single nexthop, a copy of
+	 * each member's for a group.
+	 */
+	struct nexthop_group nhg;
+
+	/* Group members, sorted by id; none for a single nexthop */
+	struct nhg_hash_entry **members;
+	uint8_t member_num;
+
+	/* Routes, and groups, using this entry */
+	uint32_t refcnt;
+
+	uint32_t flags;
+#define NEXTHOP_GROUP_INSTALLED (1 << 0)
+#define NEXTHOP_GROUP_QUEUED    (1 << 1)
+#define NEXTHOP_GROUP_FAILED    (1 << 2)
+/* No longer handed out to routes; see zebra_nhg_interface_down() */
+#define NEXTHOP_GROUP_RETIRED   (1 << 3)
+};
+
 extern int nexthop_active_update(struct route_node *rn, struct route_entry *re);
+
+extern void zebra_nhg_init(void);
+extern void zebra_nhg_terminate(void);
+
+/* Are routes installed using kernel nexthop objects? */
+extern bool zebra_nhg_kernel_enabled(void);
+
+/* Find, or create, the entry for the nexthops re is installed with, and
+ * take a reference on it.  Returns NULL if re has to be installed with
+ * its nexthops spelled out, e.g. because they carry labels.
+ */
+extern struct nhg_hash_entry *zebra_nhg_rib_find(const struct route_entry *re,
+						 afi_t afi);
+extern void zebra_nhg_release(struct nhg_hash_entry *nhe);
+extern struct nhg_hash_entry *zebra_nhg_lookup_id(uint32_t id);
+
+extern void zebra_nhg_dplane_result(struct zebra_dplane_ctx *ctx);
+
+extern void zebra_nhg_interface_up(const struct interface *ifp);
+extern void zebra_nhg_interface_down(const struct interface *ifp);
+
+/* Nexthop objects left in the kernel by a previous zebra */
+extern void zebra_nhg_kernel_stale_add(uint32_t id, bool group);
+extern void zebra_nhg_sweep_stale(void);
+
+extern void zebra_nhg_show(struct vty *vty);
 #endif
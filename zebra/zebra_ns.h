@@ -32,6 +32,9 @@
 extern "C" {
 #endif
 
+/* Upper bound on the number of kernel dataplane worker pthreads */
+#define ZEBRA_DPLANE_MAX_WORKERS 16
+
 #ifdef HAVE_NETLINK
 /* Socket interface to kernel */
 struct nlsock {
@@ -52,7 +55,8 @@ struct zebra_ns {
 #ifdef HAVE_NETLINK
 	struct nlsock netlink;        /* kernel messages */
 	struct nlsock netlink_cmd;    /* command channel */
-	struct nlsock netlink_dplane; /* dataplane channel */
+	/* dataplane channels, one per kernel dataplane worker */
+	struct nlsock netlink_dplane[ZEBRA_DPLANE_MAX_WORKERS];
 	struct thread *t_netlink;
 #endif
 
@@ -38,6 +38,8 @@
 #include "workqueue.h"
 #include "nexthop_group_private.h"
 #include "frr_pthread.h"
+#include "hash.h"
+#include "jhash.h"
 
 #include "zebra/zebra_router.h"
 #include "zebra/connected.h"
@@ -65,6 +67,9 @@ static pthread_mutex_t dplane_mutex;
 static struct thread *t_dplane;
 static struct dplane_ctx_q rib_dplane_q;
 
+DEFINE_MTYPE_STATIC(ZEBRA, RIB_MQ_ENTRY, "RIB meta queue entry")
+DEFINE_MTYPE_STATIC(ZEBRA, RIB_MQ_VRF, "RIB meta queue VRF")
+
 DEFINE_HOOK(rib_update, (struct route_node * rn, const char *reason),
 	    (rn, reason))
 
@@ -521,6 +526,7 @@ void rib_install_kernel(struct route_node *rn, struct route_entry *re,
 	struct zebra_vrf *zvrf = vrf_info_lookup(re->vrf_id);
 	const struct prefix *p, *src_p;
 	enum zebra_dplane_result ret;
+	struct nhg_hash_entry *old_nhe;
 
 	rib_dest_t *dest = rib_dest_from_rnode(rn);
 
@@ -563,12 +569,29 @@ void rib_install_kernel(struct route_node *rn, struct route_entry *re,
 	 */
 	hook_call(rib_update, rn, "installing in kernel");
 
+	/* Point the route at the shared group for its nexthops; the group it
+	 * used before can only go once the update has been queued after it.
+	 */
+	old_nhe = re->nhe;
+	re->nhe = zebra_nhg_rib_find(re, info->afi);
+
+	/* A route re-resolved onto the group it is installed with, that has
+	 * lost a member in place, needs nothing more from the kernel.
+	 */
+	if (old == re && old_nhe && re->nhe == old_nhe
+	    && CHECK_FLAG(re->status, ROUTE_ENTRY_INSTALLED)
+	    && !CHECK_FLAG(old_nhe->flags, NEXTHOP_GROUP_FAILED))
+		SET_FLAG(re->status, ROUTE_ENTRY_NHG_KEPT);
+
 	/* Send add or update */
 	if (old)
 		ret = dplane_route_update(rn, re, old);
 	else
 		ret = dplane_route_add(rn, re);
 
+	UNSET_FLAG(re->status, ROUTE_ENTRY_NHG_KEPT);
+	zebra_nhg_release(old_nhe);
+
 	switch (ret) {
 	case ZEBRA_DPLANE_REQUEST_QUEUED:
 		SET_FLAG(re->status, ROUTE_ENTRY_QUEUED);
@@ -731,84 +754,59 @@ static int rib_can_delete_dest(rib_dest_t *dest)
 void zebra_rib_evaluate_rn_nexthops(struct route_node *rn, uint32_t seq)
 {
 	rib_dest_t *dest = rib_dest_from_rnode(rn);
+	struct route_node *prn;
 	struct rnh *rnh;
+	size_t covering = 0;
+
+	if (IS_ZEBRA_DEBUG_NHT_DETAILED) {
+		char buf[PREFIX_STRLEN];
+
+		zlog_debug("%s: %s Being examined for Nexthop Tracking Count: %zd",
+			   __PRETTY_FUNCTION__,
+			   srcdest_rnode2str(rn, buf, sizeof(buf)),
+			   dest ? rnh_list_count(&dest->nht) : 0);
+	}
+
+	zebra_rnh_batch_start();
 
 	/*
-	 * We are storing the rnh's associated withb
-	 * the tracked nexthop as a list of the rn's.
-	 * Unresolved rnh's are placed at the top
-	 * of the tree list.( 0.0.0.0/0 for v4 and 0::0/0 for v6 )
-	 * As such for each rn we need to walk up the tree
-	 * and see if any rnh's need to see if they
-	 * would match a more specific route
+	 * If we have any rnh's stored in the nht list
+	 * then we know that this route node was used for
+	 * nht resolution and as such we need to call the
+	 * nexthop tracking evaluation code
 	 */
-	while (rn) {
-		if (IS_ZEBRA_DEBUG_NHT_DETAILED) {
-			char buf[PREFIX_STRLEN];
+	if (dest) {
+		frr_each_safe(rnh_list, &dest->nht, rnh)
+			zebra_rnh_evaluate_dependent(rn, rnh, seq);
+	}
 
-			zlog_debug("%s: %s Being examined for Nexthop Tracking Count: %zd",
-				   __PRETTY_FUNCTION__,
-				   srcdest_rnode2str(rn, buf, sizeof(buf)),
-				   dest ? rnh_list_count(&dest->nht) : 0);
-		}
-		if (!dest) {
-			rn = rn->parent;
-			if (rn)
-				dest = rib_dest_from_rnode(rn);
-			continue;
-		}
-		/*
-		 * If we have any rnh's stored in the nht list
-		 * then we know that this route node was used for
-		 * nht resolution and as such we need to call the
-		 * nexthop tracking evaluation code
-		 */
-		frr_each_safe(rnh_list, &dest->nht, rnh) {
-			struct zebra_vrf *zvrf =
-				zebra_vrf_lookup_by_id(rnh->vrf_id);
-			struct prefix *p = &rnh->node->p;
-
-			if (IS_ZEBRA_DEBUG_NHT_DETAILED) {
-				char buf1[PREFIX_STRLEN];
-				char buf2[PREFIX_STRLEN];
-
-				zlog_debug("%u:%s has Nexthop(%s) Type: %s depending on it, evaluating %u:%u",
-					   zvrf->vrf->vrf_id,
-					   srcdest_rnode2str(rn, buf1,
-						      sizeof(buf1)),
-					   prefix2str(p, buf2, sizeof(buf2)),
-					   rnh_type2str(rnh->type),
-					   seq, rnh->seqno);
-			}
+	/*
+	 * Rnh's resolved through a less specific route, including the
+	 * unresolved ones kept on the default route, may now match this
+	 * node. Only those inside our prefix can, look them up in the rnh
+	 * tables unless the covering routes track fewer rnh's altogether.
+	 */
+	for (prn = rn->parent; prn; prn = prn->parent) {
+		dest = rib_dest_from_rnode(prn);
+		if (dest)
+			covering += rnh_list_count(&dest->nht);
+	}
 
-			/*
-			 * If we have evaluated this node on this pass
-			 * already, due to following the tree up
-			 * then we know that we can move onto the next
-			 * rnh to process.
-			 *
-			 * Additionally we call zebra_evaluate_rnh
-			 * when we gc the dest.  In this case we know
-			 * that there must be no other re's where
-			 * we were originally as such we know that
-			 * that sequence number is ok to respect.
-			 */
-			if (rnh->seqno == seq) {
-				if (IS_ZEBRA_DEBUG_NHT_DETAILED)
-					zlog_debug(
-						"\tNode processed and moved already");
+	if (covering && !zebra_rnh_evaluate_covered(rn, seq, covering)) {
+		for (prn = rn->parent; prn; prn = prn->parent) {
+			dest = rib_dest_from_rnode(prn);
+			if (!dest)
 				continue;
-			}
 
-			rnh->seqno = seq;
-			zebra_evaluate_rnh(zvrf, family2afi(p->family), 0,
-					   rnh->type, p);
+			frr_each_safe(rnh_list, &dest->nht, rnh) {
+				if (prefix_match(&rn->p, &rnh->node->p))
+					zebra_rnh_evaluate_dependent(rn, rnh,
+								     seq);
+			}
 		}
-
-		rn = rn->parent;
-		if (rn)
-			dest = rib_dest_from_rnode(rn);
 	}
+
+	zebra_rnh_batch_end();
 }
 
 /*
@@ -840,7 +838,7 @@ int rib_gc_dest(struct route_node *rn)
 	zebra_rib_evaluate_rn_nexthops(rn, zebra_router_get_next_sequence());
 
 	dest->rnode = NULL;
-	rnh_list_fini(&dest->nht);
+	zebra_rnh_release_dest(dest);
 	XFREE(MTYPE_RIB_DEST, dest);
 	rn->info = NULL;
 
@@ -2060,21 +2058,58 @@ done:
 	dplane_ctx_fini(&ctx);
 }
 
-/* Take a list of route_node structs and return 1, if there was a record
- * picked from it and processed by rib_process(). Don't process more,
- * than one RN record; operate only in the specified sub-queue.
+/*
+ * Meta queue sub-queue weights: route nodes served per turn. Connected and
+ * IGP changes get most of the time, BGP still gets its share under IGP
+ * churn.
  */
-static unsigned int process_subq(struct list *subq, uint8_t qindex)
+static const uint32_t meta_queue_weight[MQ_SIZE] = {32, 16, 16, 4, 2};
+
+static const char *const meta_queue_name[MQ_SIZE] = {
+	"connected/kernel", "static", "IGP", "BGP", "other",
+};
+
+static unsigned int meta_queue_vrf_hash_key(const void *arg)
+{
+	const struct meta_queue_vrf *mqv = arg;
+
+	return jhash_2words((uint32_t)(uintptr_t)mqv->zvrf, mqv->qindex, 0);
+}
+
+static bool meta_queue_vrf_hash_cmp(const void *arg1, const void *arg2)
+{
+	const struct meta_queue_vrf *a = arg1, *b = arg2;
+
+	return a->zvrf == b->zvrf && a->qindex == b->qindex;
+}
+
+static void *meta_queue_vrf_alloc(void *arg)
+{
+	const struct meta_queue_vrf *key = arg;
+	struct meta_queue_vrf *mqv;
+
+	mqv = XCALLOC(MTYPE_RIB_MQ_VRF, sizeof(*mqv));
+	mqv->zvrf = key->zvrf;
+	mqv->qindex = key->qindex;
+	mq_entry_list_init(&mqv->entries);
+	return mqv;
+}
+
+static void meta_queue_vrf_free(struct meta_queue *mq,
+				struct meta_queue_vrf *mqv)
+{
+	mq_vrf_list_del(&mq->subq[mqv->qindex].vrfs, mqv);
+	hash_release(mq->vrfs, mqv);
+	mq_entry_list_fini(&mqv->entries);
+	XFREE(MTYPE_RIB_MQ_VRF, mqv);
+}
+
+/* Process a route node taken off sub-queue qindex by rib_process(). */
+static void process_subq(struct route_node *rnode, uint8_t qindex)
 {
-	struct listnode *lnode = listhead(subq);
-	struct route_node *rnode;
 	rib_dest_t *dest;
 	struct zebra_vrf *zvrf = NULL;
 
-	if (!lnode)
-		return 0;
-
-	rnode = listgetdata(lnode);
 	dest = rib_dest_from_rnode(rnode);
 	if (dest)
 		zvrf = rib_dest_vrf(dest);
@@ -2093,29 +2128,43 @@ static unsigned int process_subq(struct list *subq, uint8_t qindex)
 		UNSET_FLAG(rib_dest_from_rnode(rnode)->flags,
 			   RIB_ROUTE_QUEUED(qindex));
 
-#if 0
-  else
-    {
-      zlog_debug ("%s: called for route_node (%p, %d) with no ribs",
-                  __func__, rnode, rnode->lock);
-      zlog_backtrace(LOG_DEBUG);
-    }
-#endif
 	route_unlock_node(rnode);
-	list_delete_node(subq, lnode);
-	return 1;
 }
 
-/* Dispatch the meta queue by picking, processing and unlocking the next RN from
- * a non-empty sub-queue with lowest priority. wq is equal to zebra->ribq and
- * data
- * is pointed to the meta queue structure.
+/*
+ * Pick the sub-queue to serve next: the current one while it has route
+ * nodes and credit left, else the next non-empty one with a fresh turn.
+ * The meta queue must not be empty.
+ */
+static struct meta_subq *meta_queue_next_subq(struct meta_queue *mq)
+{
+	struct meta_subq *sq = &mq->subq[mq->cur];
+	unsigned int i;
+
+	for (i = 0; i < MQ_SIZE && !(sq->depth && sq->credit); i++) {
+		mq->cur = (mq->cur + 1) % MQ_SIZE;
+		sq = &mq->subq[mq->cur];
+		sq->credit = sq->weight;
+	}
+
+	return sq;
+}
+
+/* Dispatch the meta queue by picking, processing and unlocking the next RN.
+ * Each call handles a single RN, so the work queue can yield in between.
+ * wq is equal to zebra->ribq and data is pointed to the meta queue
+ * structure.
  */
 static wq_item_status meta_queue_process(struct work_queue *dummy, void *data)
 {
 	struct meta_queue *mq = data;
-	unsigned i;
+	struct meta_subq *sq;
+	struct meta_queue_vrf *mqv;
+	struct meta_queue_entry *entry;
+	struct route_node *rn;
 	uint32_t queue_len, queue_limit;
+	uint64_t wait;
+	uint8_t qindex;
 
 	/* Ensure there's room for more dataplane updates */
 	queue_limit = dplane_get_in_queue_limit();
@@ -2132,11 +2181,34 @@ static wq_item_status meta_queue_process(struct work_queue *dummy, void *data)
 		return WQ_QUEUE_BLOCKED;
 	}
 
-	for (i = 0; i < MQ_SIZE; i++)
-		if (process_subq(mq->subq[i], i)) {
-			mq->size--;
-			break;
-		}
+	if (!mq->size)
+		return WQ_SUCCESS;
+
+	sq = meta_queue_next_subq(mq);
+	qindex = mq->cur;
+
+	/* Take one RN from the VRF at the front, then send it to the back */
+	mqv = mq_vrf_list_pop(&sq->vrfs);
+	entry = mq_entry_list_pop(&mqv->entries);
+	if (mq_entry_list_count(&mqv->entries))
+		mq_vrf_list_add_tail(&sq->vrfs, mqv);
+	else
+		meta_queue_vrf_free(mq, mqv);
+
+	wait = monotime_since(&entry->queued, NULL);
+	sq->wait_usecs += wait;
+	if (wait > sq->wait_max_usecs)
+		sq->wait_max_usecs = wait;
+	sq->dequeued++;
+	sq->depth--;
+	sq->credit--;
+	mq->size--;
+
+	rn = entry->rn;
+	XFREE(MTYPE_RIB_MQ_ENTRY, entry);
+
+	process_subq(rn, qindex);
+
 	return mq->size ? WQ_REQUEUE : WQ_SUCCESS;
 }
 
@@ -2164,6 +2236,9 @@ static void rib_meta_queue_add(struct meta_queue *mq, struct route_node *rn)
 {
 	struct route_entry *re = NULL, *curr_re = NULL;
 	uint8_t qindex = MQ_SIZE, curr_qindex = MQ_SIZE;
+	struct meta_queue_vrf key, *mqv;
+	struct meta_queue_entry *entry;
+	struct meta_subq *sq;
 
 	RNODE_FOREACH_RE (rn, curr_re) {
 		curr_qindex = route_info[curr_re->type].meta_q_map;
@@ -2188,9 +2263,24 @@ static void rib_meta_queue_add(struct meta_queue *mq, struct route_node *rn)
 	}
 
 	SET_FLAG(rib_dest_from_rnode(rn)->flags, RIB_ROUTE_QUEUED(qindex));
-	listnode_add(mq->subq[qindex], rn);
+
+	sq = &mq->subq[qindex];
+	key.zvrf = rib_dest_vrf(rib_dest_from_rnode(rn));
+	key.qindex = qindex;
+	mqv = hash_get(mq->vrfs, &key, meta_queue_vrf_alloc);
+	if (!mq_entry_list_count(&mqv->entries))
+		mq_vrf_list_add_tail(&sq->vrfs, mqv);
+
+	entry = XMALLOC(MTYPE_RIB_MQ_ENTRY, sizeof(*entry));
+	entry->rn = rn;
+	monotime(&entry->queued);
+	mq_entry_list_add_tail(&mqv->entries, entry);
+
 	route_lock_node(rn);
 	mq->size++;
+	sq->depth++;
+	if (sq->depth > sq->depth_max)
+		sq->depth_max = sq->depth;
 
 	if (IS_ZEBRA_DEBUG_RIB_DETAILED)
 		rnode_debug(rn, re->vrf_id, "queued rn %p into sub-queue %u",
@@ -2244,23 +2334,89 @@ static struct meta_queue *meta_queue_new(void)
 	new = XCALLOC(MTYPE_WORK_QUEUE, sizeof(struct meta_queue));
 
 	for (i = 0; i < MQ_SIZE; i++) {
-		new->subq[i] = list_new();
-		assert(new->subq[i]);
+		mq_vrf_list_init(&new->subq[i].vrfs);
+		new->subq[i].weight = meta_queue_weight[i];
 	}
+	new->subq[0].credit = new->subq[0].weight;
+	new->vrfs = hash_create_size(8, meta_queue_vrf_hash_key,
+				     meta_queue_vrf_hash_cmp,
+				     "RIB meta queue VRFs");
 
 	return new;
 }
 
+/*
+ * Drop the route nodes of a VRF from all sub-queues, when the VRF goes
+ * away.
+ */
+void rib_meta_queue_free_vrf(struct meta_queue *mq, struct zebra_vrf *zvrf)
+{
+	struct meta_queue_vrf key, *mqv;
+	struct meta_queue_entry *entry;
+	unsigned i;
+
+	key.zvrf = zvrf;
+	for (i = 0; i < MQ_SIZE; i++) {
+		key.qindex = i;
+		mqv = hash_lookup(mq->vrfs, &key);
+		if (!mqv)
+			continue;
+
+		while ((entry = mq_entry_list_pop(&mqv->entries))) {
+			route_unlock_node(entry->rn);
+			XFREE(MTYPE_RIB_MQ_ENTRY, entry);
+			mq->subq[i].depth--;
+			mq->size--;
+		}
+		meta_queue_vrf_free(mq, mqv);
+	}
+}
+
 void meta_queue_free(struct meta_queue *mq)
 {
+	struct meta_queue_vrf *mqv;
+	struct meta_queue_entry *entry;
 	unsigned i;
 
-	for (i = 0; i < MQ_SIZE; i++)
-		list_delete(&mq->subq[i]);
+	for (i = 0; i < MQ_SIZE; i++) {
+		while ((mqv = mq_vrf_list_first(&mq->subq[i].vrfs))) {
+			while ((entry = mq_entry_list_pop(&mqv->entries)))
+				XFREE(MTYPE_RIB_MQ_ENTRY, entry);
+			meta_queue_vrf_free(mq, mqv);
+		}
+		mq_vrf_list_fini(&mq->subq[i].vrfs);
+	}
+	hash_free(mq->vrfs);
 
 	XFREE(MTYPE_WORK_QUEUE, mq);
 }
 
+void rib_meta_queue_show(struct vty *vty, struct meta_queue *mq)
+{
+	struct meta_subq *sq;
+	struct meta_queue_vrf *mqv;
+	unsigned i;
+
+	vty_out(vty, "Route nodes queued: %u\n\n", mq->size);
+	vty_out(vty, "%-18s %6s %8s %8s %12s %10s %10s\n", "Sub-queue",
+		"Weight", "Depth", "Max", "Dequeued", "Wait avg", "Wait max");
+	for (i = 0; i < MQ_SIZE; i++) {
+		sq = &mq->subq[i];
+		vty_out(vty,
+			"%-18s %6u %8u %8u %12" PRIu64 " %8" PRIu64
+			"us %8" PRIu64 "us\n",
+			meta_queue_name[i], sq->weight, sq->depth,
+			sq->depth_max, sq->dequeued,
+			sq->dequeued ? sq->wait_usecs / sq->dequeued : 0,
+			sq->wait_max_usecs);
+
+		frr_each (mq_vrf_list, &sq->vrfs, mqv)
+			vty_out(vty, "  VRF %-13s %15zu\n",
+				zvrf_name(mqv->zvrf),
+				mq_entry_list_count(&mqv->entries));
+	}
+}
+
 /* initialise zebra rib work queue */
 static void rib_queue_init(void)
 {
@@ -2414,6 +2570,7 @@ void rib_unlink(struct route_node *rn, struct route_entry *re)
 
 	nexthops_free(re->ng.nexthop);
 	nexthops_free(re->fib_ng.nexthop);
+	zebra_nhg_release(re->nhe);
 
 	XFREE(MTYPE_RE, re);
 }
@@ -3300,6 +3457,11 @@ static int rib_process_dplane_results(struct thread *thread)
 				zebra_vxlan_handle_result(ctx);
 				break;
 
+			case DPLANE_OP_NH_INSTALL:
+			case DPLANE_OP_NH_DELETE:
+				zebra_nhg_dplane_result(ctx);
+				break;
+
 			/* Some op codes not handled here */
 			case DPLANE_OP_ADDR_INSTALL:
 			case DPLANE_OP_ADDR_UNINSTALL:
@@ -51,6 +51,20 @@
 #include "zebra/zebra_errors.h"
 
 DEFINE_MTYPE_STATIC(ZEBRA, RNH, "Nexthop tracking object")
+DEFINE_MTYPE_STATIC(ZEBRA, RNH_BATCH, "Nexthop tracking notification batch")
+
+/*
+ * Notifications generated while evaluating are held per client and
+ * handed to the client's I/O thread in one go when the outermost
+ * evaluation is done.
+ */
+struct rnh_batch {
+	struct zserv *client;
+	struct stream_fifo *fifo;
+};
+
+static struct list *rnh_batch_list;
+static unsigned int rnh_batch_depth;
 
 static void free_state(vrf_id_t vrf_id, struct route_entry *re,
 		       struct route_node *rn);
@@ -64,9 +78,60 @@ static int zebra_client_cleanup_rnh(struct zserv *client);
 
 void zebra_rnh_init(void)
 {
+	rnh_batch_list = list_new();
 	hook_register(zserv_client_close, zebra_client_cleanup_rnh);
 }
 
+void zebra_rnh_batch_start(void)
+{
+	rnh_batch_depth++;
+}
+
+void zebra_rnh_batch_end(void)
+{
+	struct rnh_batch *batch;
+
+	assert(rnh_batch_depth);
+	if (--rnh_batch_depth)
+		return;
+
+	while ((batch = listnode_head(rnh_batch_list))) {
+		listnode_delete(rnh_batch_list, batch);
+
+		if (IS_ZEBRA_DEBUG_NHT_DETAILED)
+			zlog_debug("Sending %zu nexthop updates to client %s",
+				   batch->fifo->count,
+				   zebra_route_string(batch->client->proto));
+
+		zserv_send_messages(batch->client, batch->fifo);
+		stream_fifo_free(batch->fifo);
+		XFREE(MTYPE_RNH_BATCH, batch);
+	}
+}
+
+static int zebra_rnh_send(struct zserv *client, struct stream *msg)
+{
+	struct rnh_batch *batch;
+	struct listnode *node;
+
+	if (!rnh_batch_depth)
+		return zserv_send_message(client, msg);
+
+	for (ALL_LIST_ELEMENTS_RO(rnh_batch_list, node, batch))
+		if (batch->client == client)
+			break;
+
+	if (!node) {
+		batch = XCALLOC(MTYPE_RNH_BATCH, sizeof(*batch));
+		batch->client = client;
+		batch->fifo = stream_fifo_new();
+		listnode_add(rnh_batch_list, batch);
+	}
+
+	stream_fifo_push(batch->fifo, msg);
+	return 0;
+}
+
 static inline struct route_table *get_rnh_table(vrf_id_t vrfid, afi_t afi,
 						rnh_type_t type)
 {
@@ -95,15 +160,9 @@ char *rnh_str(struct rnh *rnh, char *buf, int size)
 
 static void zebra_rnh_remove_from_routing_table(struct rnh *rnh)
 {
-	struct zebra_vrf *zvrf = zebra_vrf_lookup_by_id(rnh->vrf_id);
-	struct route_table *table = zvrf->table[rnh->afi][SAFI_UNICAST];
-	struct route_node *rn;
+	struct route_node *rn = rnh->resolved_node;
 	rib_dest_t *dest;
 
-	if (!table)
-		return;
-
-	rn = route_node_match(table, &rnh->resolved_route);
 	if (!rn)
 		return;
 
@@ -119,7 +178,7 @@ static void zebra_rnh_remove_from_routing_table(struct rnh *rnh)
 
 	dest = rib_dest_from_rnode(rn);
 	rnh_list_del(&dest->nht, rnh);
-	route_unlock_node(rn);
+	rnh->resolved_node = NULL;
 }
 
 static void zebra_rnh_store_in_routing_table(struct rnh *rnh)
@@ -145,9 +204,24 @@ static void zebra_rnh_store_in_routing_table(struct rnh *rnh)
 
 	dest = rib_dest_from_rnode(rn);
 	rnh_list_add_tail(&dest->nht, rnh);
+	rnh->resolved_node = rn;
 	route_unlock_node(rn);
 }
 
+/*
+ * The dest is going away: forget the rnh's still resolved through it,
+ * they are moved again on their next evaluation.
+ */
+void zebra_rnh_release_dest(rib_dest_t *dest)
+{
+	struct rnh *rnh;
+
+	while ((rnh = rnh_list_pop(&dest->nht)))
+		rnh->resolved_node = NULL;
+
+	rnh_list_fini(&dest->nht);
+}
+
 struct rnh *zebra_add_rnh(struct prefix *p, vrf_id_t vrfid, rnh_type_t type,
 			  bool *exists)
 {
@@ -230,30 +304,11 @@ struct rnh *zebra_lookup_rnh(struct prefix *p, vrf_id_t vrfid, rnh_type_t type)
 
 void zebra_free_rnh(struct rnh *rnh)
 {
-	struct zebra_vrf *zvrf;
-	struct route_table *table;
-
 	zebra_rnh_remove_from_routing_table(rnh);
 	rnh->flags |= ZEBRA_NHT_DELETED;
 	list_delete(&rnh->client_list);
 	list_delete(&rnh->zebra_pseudowire_list);
 
-	zvrf = zebra_vrf_lookup_by_id(rnh->vrf_id);
-	table = zvrf->table[family2afi(rnh->resolved_route.family)][SAFI_UNICAST];
-
-	if (table) {
-		struct route_node *rern;
-
-		rern = route_node_match(table, &rnh->resolved_route);
-		if (rern) {
-			rib_dest_t *dest;
-
-			route_unlock_node(rern);
-
-			dest = rib_dest_from_rnode(rern);
-			rnh_list_del(&dest->nht, rnh);
-		}
-	}
 	free_state(rnh->vrf_id, rnh->state, rnh->node);
 	XFREE(MTYPE_RNH, rnh);
 }
@@ -882,6 +937,7 @@ void zebra_evaluate_rnh(struct zebra_vrf *zvrf, afi_t afi, int force,
 	if (!rnh_table) // unexpected
 		return;
 
+	zebra_rnh_batch_start();
 	if (p) {
 		/* Evaluating a specific entry, make sure it exists. */
 		nrn = route_node_lookup(rnh_table, p);
@@ -906,6 +962,101 @@ void zebra_evaluate_rnh(struct zebra_vrf *zvrf, afi_t afi, int force,
 			nrn = route_next(nrn); /* this will also unlock nrn */
 		}
 	}
+	zebra_rnh_batch_end();
+}
+
+/*
+ * Re-evaluate a tracked entry that may be affected by a change of the RIB
+ * node rn, unless this has been done already on this pass (seq).
+ */
+void zebra_rnh_evaluate_dependent(struct route_node *rn, struct rnh *rnh,
+				  uint32_t seq)
+{
+	struct zebra_vrf *zvrf = zebra_vrf_lookup_by_id(rnh->vrf_id);
+
+	if (IS_ZEBRA_DEBUG_NHT_DETAILED) {
+		char buf1[PREFIX_STRLEN];
+		char buf2[PREFIX_STRLEN];
+
+		zlog_debug("%u:%s has Nexthop(%s) Type: %s depending on it, evaluating %u:%u",
+			   rnh->vrf_id,
+			   srcdest_rnode2str(rn, buf1, sizeof(buf1)),
+			   prefix2str(&rnh->node->p, buf2, sizeof(buf2)),
+			   rnh_type2str(rnh->type), seq, rnh->seqno);
+	}
+
+	/*
+	 * If we have evaluated this node on this pass
+	 * already, due to following the tree up
+	 * then we know that we can move onto the next
+	 * rnh to process.
+	 *
+	 * Additionally we are called when we gc the dest.
+	 * In this case we know that there must be no other
+	 * re's where we were originally as such we know that
+	 * that sequence number is ok to respect.
+	 */
+	if (rnh->seqno == seq) {
+		if (IS_ZEBRA_DEBUG_NHT_DETAILED)
+			zlog_debug("\tNode processed and moved already");
+		return;
+	}
+
+	rnh->seqno = seq;
+	zebra_rnh_evaluate_entry(zvrf, rnh->afi, 0, rnh->type, rnh->node);
+}
+
+/*
+ * A change of the RIB node rn can only affect the rnh's resolved through
+ * a less specific route if they fall inside rn's prefix. Find those in the
+ * rnh tables, which are prefix tries over the tracked prefixes, and
+ * evaluate them.
+ *
+ * Gives up and returns false once more than limit tracked entries have
+ * been looked at, the caller then walks the covering routes' lists.
+ */
+bool zebra_rnh_evaluate_covered(struct route_node *rn, uint32_t seq,
+				size_t limit)
+{
+	rib_table_info_t *info = srcdest_rnode_table_info(rn);
+	struct zebra_vrf *zvrf = info->zvrf;
+	struct route_table *table;
+	struct route_node *top, *nrn;
+	struct rnh *rnh;
+	size_t visited = 0;
+	rnh_type_t type;
+
+	if (rn->table != zvrf->table[info->afi][SAFI_UNICAST])
+		return true;
+
+	for (type = RNH_NEXTHOP_TYPE; type <= RNH_IMPORT_CHECK_TYPE; type++) {
+		table = get_rnh_table(zvrf_id(zvrf), info->afi, type);
+		if (!table)
+			continue;
+
+		/* Keep top around, route_next_until() stops there */
+		top = route_node_get(table, &rn->p);
+		route_lock_node(top);
+
+		for (nrn = top; nrn; nrn = route_next_until(nrn, top)) {
+			rnh = nrn->info;
+			if (!rnh)
+				continue;
+
+			if (++visited > limit) {
+				route_unlock_node(nrn);
+				route_unlock_node(top);
+				return false;
+			}
+
+			if (rnh->resolved_route.prefixlen < rn->p.prefixlen)
+				zebra_rnh_evaluate_dependent(rn, rnh, seq);
+		}
+
+		route_unlock_node(top);
+	}
+
+	return true;
 }
 
 void zebra_print_rnh_table(vrf_id_t vrfid, afi_t afi, struct vty *vty,
@@ -1082,7 +1233,7 @@ static int send_client(struct rnh *rnh, struct zserv *client, rnh_type_t type,
 
 	client->nh_last_upd_time = monotime(NULL);
 	client->last_write_cmd = cmd;
-	return zserv_send_message(client, s);
+	return zebra_rnh_send(client, s);
 }
 
 static void print_nh(struct nexthop *nexthop, struct vty *vty)
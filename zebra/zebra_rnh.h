@@ -56,6 +56,13 @@ extern void zebra_remove_rnh_client(struct rnh *rnh, struct zserv *client,
 				    rnh_type_t type);
 extern void zebra_evaluate_rnh(struct zebra_vrf *zvrf, afi_t afi, int force,
 			       rnh_type_t type, struct prefix *p);
+extern void zebra_rnh_evaluate_dependent(struct route_node *rn,
+					 struct rnh *rnh, uint32_t seq);
+extern bool zebra_rnh_evaluate_covered(struct route_node *rn, uint32_t seq,
+				       size_t limit);
+extern void zebra_rnh_release_dest(rib_dest_t *dest);
+extern void zebra_rnh_batch_start(void);
+extern void zebra_rnh_batch_end(void);
 extern void zebra_print_rnh_table(vrf_id_t vrfid, afi_t afi, struct vty *vty,
 				  rnh_type_t type, struct prefix *p);
 extern char *rnh_str(struct rnh *rnh, char *buf, int size);
@@ -1234,7 +1234,9 @@ static void route_match_address_prefix_list_free(void *rule)
 static struct route_map_rule_cmd route_match_ip_address_prefix_list_cmd = {
 	"ip address prefix-list", route_match_ip_address_prefix_list,
 	route_match_address_prefix_list_compile,
-	route_match_address_prefix_list_free};
+	route_match_address_prefix_list_free,
+	.match_plist_afi = AFI_IP,
+};
 
 static enum route_map_cmd_result_t
 route_match_ipv6_address_prefix_list(void *rule, const struct prefix *prefix,
@@ -1247,7 +1249,9 @@ route_match_ipv6_address_prefix_list(void *rule, const struct prefix *prefix,
 static struct route_map_rule_cmd route_match_ipv6_address_prefix_list_cmd = {
 	"ipv6 address prefix-list", route_match_ipv6_address_prefix_list,
 	route_match_address_prefix_list_compile,
-	route_match_address_prefix_list_free};
+	route_match_address_prefix_list_free,
+	.match_plist_afi = AFI_IP6,
+};
 
 /* `match ipv6 next-hop type <TYPE>' */
 
@@ -36,6 +36,9 @@ DEFINE_MTYPE_STATIC(ZEBRA, RIB_TABLE_INFO, "RIB table info")
 
 struct zebra_router zrouter = {
 	.multipath_num = MULTIPATH_NUM,
+	.dplane_workers = 1,
+	.zapi_io_threads = ZEBRA_ZAPI_IO_THREADS_DEFAULT,
+	.nhg_kernel = true,
 	.ipv4_multicast_mode = MCAST_NO_CONFIG,
 };
 
@@ -152,6 +155,8 @@ void zebra_router_sweep_route(void)
 			continue;
 		rib_sweep_table(zrt->table);
 	}
+
+	zebra_nhg_sweep_stale();
 }
 
 static void zebra_router_free_table(struct zebra_router_table *zrt)
@@ -227,6 +232,8 @@ void zebra_router_terminate(void)
 	hash_free(zrouter.ipset_entry_hash);
 	hash_clean(zrouter.iptable_hash, zebra_pbr_iptable_free);
 	hash_free(zrouter.iptable_hash);
+
+	zebra_nhg_terminate();
 }
 
 void zebra_router_init(void)
@@ -253,4 +260,6 @@ void zebra_router_init(void)
 	zrouter.iptable_hash = hash_create_size(8, zebra_pbr_iptable_hash_key,
 						zebra_pbr_iptable_hash_equal,
 						"IPtable Hash Entry");
+
+	zebra_nhg_init();
 }
@@ -95,6 +95,10 @@ struct zebra_router {
 
 	struct hash *iptable_hash;
 
+	/* Shared nexthop groups, by content and by id */
+	struct hash *nhgs;
+	struct hash *nhgs_id;
+
 	/* used if vrf backend is not network namespace */
 	int rtadv_sock;
 
@@ -115,6 +119,11 @@ struct zebra_router {
 #define ZEBRA_ZAPI_PACKETS_TO_PROCESS 1000
 	_Atomic uint32_t packets_to_process;
 
+	/* Size of the pthread pool serving ZAPI client sockets */
+#define ZEBRA_ZAPI_IO_THREADS_DEFAULT 2
+#define ZEBRA_ZAPI_IO_MAX_THREADS 16
+	uint32_t zapi_io_threads;
+
 	/* Mlag information for the router */
 	struct zebra_mlag_info mlag_info;
 
@@ -125,6 +134,15 @@ struct zebra_router {
 
 	uint32_t multipath_num;
 
+	/* Number of kernel dataplane worker pthreads */
+	uint32_t dplane_workers;
+
+	/* Install routes using kernel nexthop objects, if the kernel has
+	 * them.
+	 */
+	bool nhg_kernel;
+	bool nhg_kernel_supported;
+
 	/* RPF Lookup behavior */
 	enum multicast_mode ipv4_multicast_mode;
 
@@ -36,6 +36,7 @@
 #include "vxlan.h"
 
 #include "zebra/zebra_router.h"
+#include "zebra/zebra_nhg.h"
 #include "zebra/zserv.h"
 #include "zebra/zebra_vrf.h"
 #include "zebra/zebra_mpls.h"
@@ -2659,6 +2660,9 @@ static int config_write_protocol(struct vty *vty)
 							      ? "lower-distance"
 							      : "longer-prefix");
 
+	if (!zrouter.nhg_kernel)
+		vty_out(vty, "no zebra nexthop kernel\n");
+
 	/* Include dataplane info */
 	dplane_config_write_helper(vty);
 
@@ -2891,6 +2895,77 @@ DEFUN (no_zebra_dplane_queue_limit,
 	return CMD_SUCCESS;
 }
 
+/* Configure number of route updates sent to the kernel together */
+DEFUN (zebra_dplane_batch_size,
+       zebra_dplane_batch_size_cmd,
+       "zebra dplane batch-size (1-256)",
+       ZEBRA_STR
+       "Zebra dataplane\n"
+       "Route updates sent to the kernel in one batch\n"
+       "Number of route updates\n")
+{
+	uint32_t size;
+
+	size = strtoul(argv[3]->arg, NULL, 10);
+
+	dplane_set_batch_size(size, true);
+
+	return CMD_SUCCESS;
+}
+
+/* Reset dataplane batch size to default value */
+DEFUN (no_zebra_dplane_batch_size,
+       no_zebra_dplane_batch_size_cmd,
+       "no zebra dplane batch-size [(1-256)]",
+       NO_STR
+       ZEBRA_STR
+       "Zebra dataplane\n"
+       "Route updates sent to the kernel in one batch\n"
+       "Number of route updates\n")
+{
+	dplane_set_batch_size(0, false);
+
+	return CMD_SUCCESS;
+}
+
+/* Install routes using kernel nexthop objects */
+DEFUN (zebra_nexthop_kernel,
+       zebra_nexthop_kernel_cmd,
+       "zebra nexthop kernel",
+       ZEBRA_STR
+       "Nexthop configuration\n"
+       "Install shared nexthop groups as kernel nexthop objects\n")
+{
+	zrouter.nhg_kernel = true;
+
+	return CMD_SUCCESS;
+}
+
+DEFUN (no_zebra_nexthop_kernel,
+       no_zebra_nexthop_kernel_cmd,
+       "no zebra nexthop kernel",
+       NO_STR
+       ZEBRA_STR
+       "Nexthop configuration\n"
+       "Install shared nexthop groups as kernel nexthop objects\n")
+{
+	zrouter.nhg_kernel = false;
+
+	return CMD_SUCCESS;
+}
+
+DEFUN (show_nexthop_group_rib,
+       show_nexthop_group_rib_cmd,
+       "show nexthop-group rib",
+       SHOW_STR
+       "Nexthop Group Information\n"
+       "Nexthop groups shared by RIB routes\n")
+{
+	zebra_nhg_show(vty);
+
+	return CMD_SUCCESS;
+}
+
 DEFUN (zebra_show_routing_tables_summary,
        zebra_show_routing_tables_summary_cmd,
        "show zebra router table summary",
@@ -2905,6 +2980,18 @@ DEFUN (zebra_show_routing_tables_summary,
 	return CMD_SUCCESS;
 }
 
+DEFUN (show_zebra_meta_queue,
+       show_zebra_meta_queue_cmd,
+       "show zebra meta-queue",
+       SHOW_STR
+       ZEBRA_STR
+       "RIB processing meta-queue\n")
+{
+	rib_meta_queue_show(vty, zrouter.mq);
+
+	return CMD_SUCCESS;
+}
+
 /* Table configuration write function. */
 static int config_write_table(struct vty *vty)
 {
@@ -3101,6 +3188,13 @@ void zebra_vty_init(void)
 	install_element(VIEW_NODE, &show_dataplane_providers_cmd);
 	install_element(CONFIG_NODE, &zebra_dplane_queue_limit_cmd);
 	install_element(CONFIG_NODE, &no_zebra_dplane_queue_limit_cmd);
+	install_element(CONFIG_NODE, &zebra_dplane_batch_size_cmd);
+	install_element(CONFIG_NODE, &no_zebra_dplane_batch_size_cmd);
+
+	install_element(CONFIG_NODE, &zebra_nexthop_kernel_cmd);
+	install_element(CONFIG_NODE, &no_zebra_nexthop_kernel_cmd);
+	install_element(VIEW_NODE, &show_nexthop_group_rib_cmd);
 
 	install_element(VIEW_NODE, &zebra_show_routing_tables_summary_cmd);
+	install_element(VIEW_NODE, &show_zebra_meta_queue_cmd);
 }
@@ -71,6 +71,26 @@ extern struct zebra_privs_t zserv_privs;
 /* The listener socket for clients connecting to us */
 static int zsock;
 
+/*
+ * Client sockets are served by a fixed pool of I/O pthreads; each client
+ * is bound to one of them for its lifetime, and each pthread multiplexes
+ * its clients' sockets through its own thread_master.
+ */
+static struct zserv_io_pool {
+	struct frr_pthread *pthreads[ZEBRA_ZAPI_IO_MAX_THREADS];
+	/* Clients bound to each pthread, main pthread only */
+	unsigned int clients[ZEBRA_ZAPI_IO_MAX_THREADS];
+	unsigned int count;
+} zserv_io;
+
+/*
+ * Clients with messages waiting for the main pthread. A single main
+ * pthread task serves all of them, round-robin.
+ */
+static struct zserv_ready_head zserv_ready;
+static pthread_mutex_t zserv_ready_mtx = PTHREAD_MUTEX_INITIALIZER;
+static struct thread *t_zserv_process;
+
 /*
  * Client thread events.
  *
@@ -166,13 +186,13 @@ void zserv_log_message(const char *errmsg, struct stream *msg,
 /*
  * Gracefully shut down a client connection.
  *
- * Cancel any pending tasks for the client's thread. Then schedule a task on
- * the main thread to shut down the calling thread.
+ * Cancel any pending tasks for the client on its I/O pthread. Then schedule
+ * a task on the main thread to close the client.
  *
  * It is not safe to close the client socket in this function. The socket is
  * owned by the main thread.
  *
- * Must be called from the client pthread, never the main thread.
+ * Must be called from the client's I/O pthread, never the main thread.
  */
 static void zserv_client_fail(struct zserv *client)
 {
@@ -180,8 +200,7 @@ static void zserv_client_fail(struct zserv *client)
 		  "Client '%s' encountered an error and is shutting down.",
 		  zebra_route_string(client->proto));
 
-	atomic_store_explicit(&client->pthread->running, false,
-			      memory_order_relaxed);
+	atomic_store_explicit(&client->io_failed, true, memory_order_relaxed);
 
 	THREAD_OFF(client->t_read);
 	THREAD_OFF(client->t_write);
@@ -281,6 +300,68 @@ zwrite_fail:
 	return 0;
 }
 
+/*
+ * Note the arrival of a batch of count messages on a client's input queue.
+ * If the ring of stamps is full the batch is folded into the newest one,
+ * which overstates its latency slightly.
+ *
+ * Must be called with the client's ibuf_mtx held.
+ */
+static void zserv_ibuf_stamp(struct zserv *client, uint32_t count)
+{
+	struct zserv_ibuf_stamp *st;
+	unsigned int i;
+
+	if (client->ibuf_stamp_num == ZSERV_IBUF_STAMPS) {
+		i = (client->ibuf_stamp_head + ZSERV_IBUF_STAMPS - 1)
+		    % ZSERV_IBUF_STAMPS;
+		client->ibuf_stamps[i].count += count;
+		return;
+	}
+
+	i = (client->ibuf_stamp_head + client->ibuf_stamp_num)
+	    % ZSERV_IBUF_STAMPS;
+	st = &client->ibuf_stamps[i];
+	monotime(&st->tv);
+	st->count = count;
+	client->ibuf_stamp_num++;
+}
+
+/*
+ * Account count messages taken off a client's input queue in its latency
+ * histogram.
+ *
+ * Must be called on the main pthread with the client's ibuf_mtx held.
+ */
+static void zserv_ibuf_latency(struct zserv *client, uint32_t count)
+{
+	struct zserv_ibuf_stamp *st;
+	int64_t usecs, limit;
+	uint32_t n;
+	int b;
+
+	while (count && client->ibuf_stamp_num) {
+		st = &client->ibuf_stamps[client->ibuf_stamp_head];
+		n = MIN(count, st->count);
+
+		usecs = monotime_since(&st->tv, NULL);
+		for (b = 0, limit = 10;
+		     b < ZSERV_LATENCY_BUCKETS - 1 && usecs >= limit;
+		     b++, limit *= 10)
+			;
+		client->ibuf_latency[b] += n;
+
+		st->count -= n;
+		count -= n;
+		if (!st->count) {
+			client->ibuf_stamp_head =
+				(client->ibuf_stamp_head + 1)
+				% ZSERV_IBUF_STAMPS;
+			client->ibuf_stamp_num--;
+		}
+	}
+}
+
 /*
  * Read and process data from a client socket.
  *
@@ -426,6 +507,7 @@ static int zserv_read(struct thread *thread)
 
 		/* publish read packets on client's input queue */
 		frr_with_mutex(&client->ibuf_mtx) {
+			zserv_ibuf_stamp(client, p2p_orig - p2p);
 			while (cache->head)
 				stream_fifo_push(client->ibuf_fifo,
 						 stream_fifo_pop(cache));
@@ -456,6 +538,10 @@ zread_fail:
 static void zserv_client_event(struct zserv *client,
 			       enum zserv_client_event event)
 {
+	/* The main pthread is about to close it */
+	if (atomic_load_explicit(&client->io_failed, memory_order_relaxed))
+		return;
+
 	switch (event) {
 	case ZSERV_CLIENT_READ:
 		thread_add_read(client->pthread->master, zserv_read, client,
@@ -471,58 +557,85 @@ static void zserv_client_event(struct zserv *client,
 /* Main thread lifecycle ---------------------------------------------------- */
 
 /*
- * Read and process messages from a client.
- *
- * This task runs on the main pthread. It is scheduled by client pthreads when
- * they have new messages available on their input queues. The client is passed
- * as the task argument.
+ * Put a client on the main pthread's ready list, if it is not already there.
+ */
+static void zserv_ready_enqueue(struct zserv *client)
+{
+	frr_with_mutex(&zserv_ready_mtx) {
+		if (!client->ready) {
+			client->ready = true;
+			zserv_ready_add_tail(&zserv_ready, client);
+		}
+	}
+}
+
+/*
+ * Read and process messages from all clients with input.
  *
- * Each message is popped off the client's input queue and the action associated
- * with the message is executed. This proceeds until there are no more messages,
- * an error occurs, or the processing limit is reached.
+ * This task runs on the main pthread. It is scheduled by the I/O pthreads
+ * when they put new messages on a client's input queue, and serves every
+ * client on the ready list in turn, so one wakeup handles input from all of
+ * them.
  *
- * The client's I/O thread can push at most zrouter.packets_to_process messages
- * onto the input buffer before notifying us there are packets to read. As long
- * as we always process zrouter.packets_to_process messages here, then we can
- * rely on the read thread to handle queuing this task enough times to process
- * everything on the input queue.
+ * zrouter.packets_to_process bounds the messages handled per run; it is
+ * shared evenly between the clients that are ready when the run starts. A
+ * client with messages left over goes to the back of the ready list and
+ * the task reschedules itself.
  */
 static int zserv_process_messages(struct thread *thread)
 {
-	struct zserv *client = THREAD_ARG(thread);
+	struct zserv *client;
 	struct stream *msg;
 	struct stream_fifo *cache = stream_fifo_new();
 	uint32_t p2p = zrouter.packets_to_process;
-	bool need_resched = false;
-
-	frr_with_mutex(&client->ibuf_mtx) {
-		uint32_t i;
-		for (i = 0; i < p2p && stream_fifo_head(client->ibuf_fifo);
-		     ++i) {
-			msg = stream_fifo_pop(client->ibuf_fifo);
-			stream_fifo_push(cache, msg);
+	uint32_t nclients = 0, quantum, i, j;
+	bool more = false;
+
+	frr_with_mutex(&zserv_ready_mtx) {
+		nclients = zserv_ready_count(&zserv_ready);
+	}
+	quantum = MAX(p2p / MAX(nclients, 1), 1);
+
+	for (i = 0; i < nclients; i++) {
+		frr_with_mutex(&zserv_ready_mtx) {
+			client = zserv_ready_pop(&zserv_ready);
+			if (client)
+				client->ready = false;
 		}
+		if (!client)
+			break;
 
-		msg = NULL;
+		frr_with_mutex(&client->ibuf_mtx) {
+			for (j = 0;
+			     j < quantum && stream_fifo_head(client->ibuf_fifo);
+			     ++j) {
+				msg = stream_fifo_pop(client->ibuf_fifo);
+				stream_fifo_push(cache, msg);
+			}
+			zserv_ibuf_latency(client, j);
 
-		/* Need to reschedule processing work if there are still
-		 * packets in the fifo.
-		 */
-		if (stream_fifo_head(client->ibuf_fifo))
-			need_resched = true;
-	}
+			more = stream_fifo_head(client->ibuf_fifo) != NULL;
+		}
 
-	while (stream_fifo_head(cache)) {
-		msg = stream_fifo_pop(cache);
-		zserv_handle_commands(client, msg);
-		stream_free(msg);
+		if (more)
+			zserv_ready_enqueue(client);
+
+		while (stream_fifo_head(cache)) {
+			msg = stream_fifo_pop(cache);
+			zserv_handle_commands(client, msg);
+			stream_free(msg);
+		}
 	}
 
 	stream_fifo_free(cache);
 
 	/* Reschedule ourselves if necessary */
-	if (need_resched)
-		zserv_event(client, ZSERV_PROCESS_MESSAGES);
+	frr_with_mutex(&zserv_ready_mtx) {
+		more = zserv_ready_count(&zserv_ready) > 0;
+	}
+	if (more)
+		thread_add_event(zrouter.master, zserv_process_messages, NULL,
+				 0, &t_zserv_process);
 
 	return 0;
 }
@@ -538,6 +651,23 @@ int zserv_send_message(struct zserv *client, struct stream *msg)
 	return 0;
 }
 
+int zserv_send_messages(struct zserv *client, struct stream_fifo *fifo)
+{
+	struct stream *msg;
+
+	if (!fifo->count)
+		return 0;
+
+	frr_with_mutex(&client->obuf_mtx) {
+		while ((msg = stream_fifo_pop(fifo)))
+			stream_fifo_push(client->obuf_fifo, msg);
+	}
+
+	zserv_client_event(client, ZSERV_CLIENT_WRITE);
+
+	return 0;
+}
+
 
 /* Hooks for client connect / disconnect */
 DEFINE_HOOK(zserv_client_connect, (struct zserv *client), (client));
@@ -603,8 +733,13 @@ static void zserv_client_free(struct zserv *client)
 
 void zserv_close_client(struct zserv *client)
 {
-	/* synchronously stop and join pthread */
-	frr_pthread_stop(client->pthread, NULL);
+	/*
+	 * Synchronously stop the client's tasks on its I/O pthread, which
+	 * keeps serving its other clients.
+	 */
+	atomic_store_explicit(&client->io_failed, true, memory_order_relaxed);
+	thread_cancel_async(client->pthread->master, &client->t_read, NULL);
+	thread_cancel_async(client->pthread->master, &client->t_write, NULL);
 
 	if (IS_ZEBRA_DEBUG_EVENT)
 		zlog_debug("Closing client '%s'",
@@ -612,10 +747,15 @@ void zserv_close_client(struct zserv *client)
 
 	thread_cancel_event(zrouter.master, client);
 	THREAD_OFF(client->t_cleanup);
-	THREAD_OFF(client->t_process);
 
-	/* destroy pthread */
-	frr_pthread_destroy(client->pthread);
+	frr_with_mutex(&zserv_ready_mtx) {
+		if (client->ready) {
+			zserv_ready_del(&zserv_ready, client);
+			client->ready = false;
+		}
+	}
+
+	zserv_io.clients[client->io_index]--;
 	client->pthread = NULL;
 
 	/* remove from client list */
@@ -683,22 +823,18 @@ static struct zserv *zserv_client_create(int sock)
 	/* Add this client to linked list. */
 	listnode_add(zrouter.client_list, client);
 
-	struct frr_pthread_attr zclient_pthr_attrs = {
-		.start = frr_pthread_attr_default.start,
-		.stop = frr_pthread_attr_default.stop
-	};
-	client->pthread =
-		frr_pthread_new(&zclient_pthr_attrs, "Zebra API client thread",
-				"zebra_apic");
-
-	/* start read loop */
-	zserv_client_event(client, ZSERV_CLIENT_READ);
+	/* Bind it to the least loaded I/O pthread */
+	for (i = 1; i < (int)zserv_io.count; i++)
+		if (zserv_io.clients[i] < zserv_io.clients[client->io_index])
+			client->io_index = i;
+	zserv_io.clients[client->io_index]++;
+	client->pthread = zserv_io.pthreads[client->io_index];
 
 	/* call callbacks */
 	hook_call(zserv_client_connect, client);
 
-	/* start pthread */
-	frr_pthread_run(client->pthread, NULL);
+	/* start read loop */
+	zserv_client_event(client, ZSERV_CLIENT_READ);
 
 	return client;
 }
@@ -738,6 +874,8 @@ static int zserv_accept(struct thread *thread)
 
 void zserv_close(void)
 {
+	unsigned int i;
+
 	/*
 	 * On shutdown, let's close the socket down
 	 * so that long running processes of killing the
@@ -746,6 +884,43 @@ void zserv_close(void)
 	 */
 	close(zsock);
 	zsock = -1;
+
+	/* The clients are gone, so are the I/O pthreads */
+	for (i = 0; i < zserv_io.count; i++) {
+		frr_pthread_stop(zserv_io.pthreads[i], NULL);
+		frr_pthread_destroy(zserv_io.pthreads[i]);
+		zserv_io.pthreads[i] = NULL;
+	}
+	zserv_io.count = 0;
+}
+
+/*
+ * Start the I/O pthread pool.
+ */
+static void zserv_io_start(void)
+{
+	struct frr_pthread_attr pattr = {
+		.start = frr_pthread_attr_default.start,
+		.stop = frr_pthread_attr_default.stop
+	};
+	char name[32], os_name[16];
+	unsigned int i;
+
+	for (i = 0; i < zrouter.zapi_io_threads; i++) {
+		snprintf(name, sizeof(name), "Zebra API I/O thread %u", i);
+		snprintf(os_name, sizeof(os_name), "zebra_apic%u", i);
+
+		zserv_io.pthreads[i] = frr_pthread_new(&pattr, name, os_name);
+
+		/* Each pthread watches the sockets of many clients; where
+		 * there is epoll, a wakeup then costs only the ready ones.
+		 */
+		(void)thread_master_io_backend_set(
+			zserv_io.pthreads[i]->master, "epoll");
+
+		frr_pthread_run(zserv_io.pthreads[i], NULL);
+	}
+	zserv_io.count = zrouter.zapi_io_threads;
 }
 
 void zserv_start(char *path)
@@ -759,6 +934,8 @@ void zserv_start(char *path)
 		/* should be caught in zebra main() */
 		return;
 
+	zserv_io_start();
+
 	/* Set umask */
 	old_mask = umask(0077);
 
@@ -816,8 +993,9 @@ void zserv_event(struct zserv *client, enum zserv_event event)
 				NULL);
 		break;
 	case ZSERV_PROCESS_MESSAGES:
-		thread_add_event(zrouter.master, zserv_process_messages, client,
-				 0, &client->t_process);
+		zserv_ready_enqueue(client);
+		thread_add_event(zrouter.master, zserv_process_messages, NULL,
+				 0, &t_zserv_process);
 		break;
 	case ZSERV_HANDLE_CLIENT_FAIL:
 		thread_add_event(zrouter.master, zserv_handle_client_fail,
@@ -859,6 +1037,33 @@ static char *zserv_time_buf(time_t *time1, char *buf, int buflen)
 	return buf;
 }
 
+static void zebra_show_client_route_rate(struct vty *vty,
+					 struct zserv *client,
+					 time_t connect_time)
+{
+	time_t now = monotime(NULL);
+	uint32_t last, total;
+
+	/* The buckets only roll over when routes arrive */
+	if (now == client->route_rate_time)
+		last = client->route_rate_last;
+	else if (now == client->route_rate_time + 1)
+		last = client->route_rate_cur;
+	else
+		last = 0;
+
+	total = client->v4_route_add_cnt + client->v4_route_upd8_cnt
+		+ client->v4_route_del_cnt + client->v6_route_add_cnt
+		+ client->v6_route_upd8_cnt + client->v6_route_del_cnt;
+
+	vty_out(vty,
+		"Routes/sec: last %u, peak %u, average %u (bulk msgs %u)\n",
+		last, client->route_rate_peak,
+		now > connect_time ? (uint32_t)(total / (now - connect_time))
+				   : total,
+		client->route_bulk_cnt);
+}
+
 static void zebra_show_client_detail(struct vty *vty, struct zserv *client)
 {
 	char cbuf[ZEBRA_TIME_BUF], rbuf[ZEBRA_TIME_BUF];
@@ -873,6 +1078,7 @@ static void zebra_show_client_detail(struct vty *vty, struct zserv *client)
 
 	vty_out(vty, "------------------------ \n");
 	vty_out(vty, "FD: %d \n", client->sock);
+	vty_out(vty, "I/O Thread: %u \n", client->io_index);
 
 	connect_time = (time_t) atomic_load_explicit(&client->connect_time,
 						     memory_order_relaxed);
@@ -942,6 +1148,15 @@ static void zebra_show_client_detail(struct vty *vty, struct zserv *client)
 	vty_out(vty, "L3-VNI delete notifications: %d\n", client->l3vnidel_cnt);
 	vty_out(vty, "MAC-IP add notifications: %d\n", client->macipadd_cnt);
 	vty_out(vty, "MAC-IP delete notifications: %d\n", client->macipdel_cnt);
+	zebra_show_client_route_rate(vty, client, connect_time);
+	vty_out(vty,
+		"Input Queue Latency: <10us %" PRIu64 ", <100us %" PRIu64
+		", <1ms %" PRIu64 ", <10ms %" PRIu64 ", <100ms %" PRIu64
+		", <1s %" PRIu64 ", >=1s %" PRIu64 "\n",
+		client->ibuf_latency[0], client->ibuf_latency[1],
+		client->ibuf_latency[2], client->ibuf_latency[3],
+		client->ibuf_latency[4], client->ibuf_latency[5],
+		client->ibuf_latency[6]);
 
 #if defined DEV_BUILD
 	vty_out(vty, "Input Fifo: %zu:%zu Output Fifo: %zu:%zu\n",
@@ -1045,6 +1260,7 @@ void zserv_init(void)
 {
 	/* Client list init. */
 	zrouter.client_list = list_new();
+	zserv_ready_init(&zserv_ready);
 
 	/* Misc init. */
 	zsock = -1;
@@ -36,6 +36,7 @@
 #include "lib/linklist.h"     /* for list */
 #include "lib/workqueue.h"    /* for work_queue */
 #include "lib/hook.h"         /* for DECLARE_HOOK, DECLARE_KOOH */
+#include "lib/typesafe.h"     /* for PREDECL_DLIST, DECLARE_DLIST */
 
 #include "zebra/zebra_vrf.h"  /* for zebra_vrf */
 /* clang-format on */
@@ -52,10 +53,31 @@ extern "C" {
 
 #define ZEBRA_RMAP_DEFAULT_UPDATE_TIMER 5 /* disabled by default */
 
+/*
+ * Input queue latency, from a message being queued by the I/O pthread to
+ * the main pthread picking it up, in decades of microseconds: <10us,
+ * <100us, ... <1s, and 1s or more.
+ */
+#define ZSERV_LATENCY_BUCKETS 7
+
+/* Arrival times of the batches on a client's input queue */
+#define ZSERV_IBUF_STAMPS 32
+struct zserv_ibuf_stamp {
+	struct timeval tv;
+	uint32_t count;
+};
+
+/* Clients with input waiting for the main pthread */
+PREDECL_DLIST(zserv_ready);
+
 /* Client structure. */
 struct zserv {
-	/* Client pthread */
+	/* I/O pthread from the pool that serves this client */
 	struct frr_pthread *pthread;
+	unsigned int io_index;
+
+	/* Set by the I/O pthread once the client has failed */
+	_Atomic bool io_failed;
 
 	/* Client file descriptor. */
 	int sock;
@@ -77,8 +99,20 @@ struct zserv {
 	struct thread *t_read;
 	struct thread *t_write;
 
-	/* Event for message processing, for the main pthread */
-	struct thread *t_process;
+	/*
+	 * Input queue bookkeeping, under ibuf_mtx: when each batch was
+	 * queued, as a ring of stamps.
+	 */
+	struct zserv_ibuf_stamp ibuf_stamps[ZSERV_IBUF_STAMPS];
+	unsigned int ibuf_stamp_head;
+	unsigned int ibuf_stamp_num;
+
+	/* On the main pthread's ready list, under its mutex */
+	struct zserv_ready_item ready_item;
+	bool ready;
+
+	/* Input queue latency histogram, main pthread only */
+	uint64_t ibuf_latency[ZSERV_LATENCY_BUCKETS];
 
 	/* Threads for the main pthread */
 	struct thread *t_cleanup;
@@ -139,6 +173,13 @@ struct zserv {
 	uint32_t v6_nh_watch_rem_cnt;
 	uint32_t vxlan_sg_add_cnt;
 	uint32_t vxlan_sg_del_cnt;
+	uint32_t route_bulk_cnt;
+
+	/* Routes received per second: current, previous and busiest second */
+	time_t route_rate_time;
+	uint32_t route_rate_cur;
+	uint32_t route_rate_last;
+	uint32_t route_rate_peak;
 
 	time_t nh_reg_time;
 	time_t nh_dereg_time;
@@ -164,6 +205,8 @@ struct zserv {
 	_Atomic uint32_t last_write_cmd;
 };
 
+DECLARE_DLIST(zserv_ready, struct zserv, ready_item);
+
 #define ZAPI_HANDLER_ARGS                                                      \
 	struct zserv *client, struct zmsghdr *hdr, struct stream *msg,         \
 		struct zebra_vrf *zvrf
@@ -182,15 +225,16 @@ extern void zserv_init(void);
 /*
  * Stop the Zebra API server.
  *
- * closes the socket
+ * closes the socket and stops the I/O pthreads; clients must have been
+ * closed first
  */
 extern void zserv_close(void);
 
 /*
  * Start Zebra API server.
  *
- * Allocates resources, creates the server socket and begins listening on the
- * socket.
+ * Allocates resources, starts the I/O pthreads, creates the server socket and
+ * begins listening on the socket.
  *
  * path
  *    where to place the Unix domain socket
@@ -208,6 +252,18 @@ extern void zserv_start(char *path);
  */
 extern int zserv_send_message(struct zserv *client, struct stream *msg);
 
+/*
+ * Send all messages queued on fifo to a connected Zebra API client, waking
+ * up its I/O thread only once. The fifo is left empty.
+ *
+ * client
+ *    the client to send to
+ *
+ * fifo
+ *    the messages to send
+ */
+extern int zserv_send_messages(struct zserv *client, struct stream_fifo *fifo);
+
 /*
  * Retrieve a client by its protocol and instance number.
  *
@@ -226,8 +282,8 @@ extern struct zserv *zserv_find_client(uint8_t proto, unsigned short instance);
 /*
  * Close a client.
  *
- * Kills a client's thread, removes the client from the client list and cleans
- * up its resources.
+ * Stops the client's I/O tasks, removes the client from the client list and
+ * cleans up its resources.
  *
  * client
  *    the client to close